@@ -1,13 +1,28 @@
 #include <ArduinoLog.h>
 #include <math.h>
+#include <SPIFFS.h>
 #include "battery.h"
 #include "definitions.h"
 #include "configuration.h"
 #include "utils.h"
 
-Battery::Battery(IO_Analog& io_analog, TwoWire& w) : io_analog(io_analog), wire(w) {}
+Battery::Battery(IO_Analog& io_analog, TwoWire& w) :
+  io_analog(io_analog),
+  wire(w),
+  socEstimator(Definitions::BATTERY_CAPACITY, Definitions::BATTERY_EMPTY, Definitions::BATTERY_FULLY_CHARGED, Definitions::BATTERY_SOC_CURVE),
+  chargeModel(Definitions::BATTERY_CAPACITY, Definitions::BATTERY_FULLY_CHARGED, Definitions::CHARGE_CURRENT_THRESHOLD),
+  historyRing(SPIFFS, "/battery.bin", HISTORY_BLOCK_SIZE, HISTORY_BLOCKS),
+  batteryHistory(historyRing, HISTORY_BLOCK_SIZE, HISTORY_FIELDS),
+  historyLock(xSemaphoreCreateMutex()) {}
 
 void Battery::start() {
+
+  if (SPIFFS.begin() && historyRing.begin()) {
+    batteryHistory.begin();
+    Log.notice(F("Battery history: %l samples, %l bytes" CR), batteryHistory.size(), batteryHistory.getUsedBytes());
+  } else {
+    Log.warning(F("Could not open battery history, only the latest samples will be kept." CR));
+  }
   
   // Set initial state.
   for (auto i = 0; i < CURRENT_MEDIAN_SAMPLES; i++) {
@@ -15,6 +30,8 @@ void Battery::start() {
   }
 
   updateBatteryVoltage();
+  // mower has been idle until now, so voltage is a good starting point.
+  socEstimator.reset(batteryVoltage);
   Log.trace("Battery voltage: %F volt, charge current: %F mA" CR, batteryVoltage, lastChargeCurrentReading);
 
   // update battery voltage readings every XX second.
@@ -32,18 +49,84 @@ void Battery::updateBatteryVoltage() {
   float adc_reading = io_analog.getVoltageAdc1(Definitions::BATTERY_SENSOR_CHANNEL);
   batteryVoltage = roundf((adc_reading * Definitions::BATTERY_MULTIPLIER) * 100) / 100;  // adjust reading and round to two decimals.
 
-  _needRecharge = batteryVoltage <= Definitions::BATTERY_EMPTY;
+  loadCurrent = readLoadCurrent();
+  // positive current is going out of battery.
+  socEstimator.update(millis(), batteryVoltage, loadCurrent - lastChargeCurrentReading);
+  chargeModel.update(millis(), batteryVoltage, lastChargeCurrentReading, socEstimator.getStateOfCharge());
+
+  // voltage sags under load, so compare what voltage would be without load. Otherwise we risk going back to dock as soon as the cutter works hard.
+  _needRecharge = socEstimator.getStateOfCharge() <= 0 || socEstimator.getOpenCircuitVoltage() <= Definitions::BATTERY_EMPTY;
   _isFullyCharged = batteryVoltage >= Definitions::BATTERY_FULLY_CHARGED && !_isCharging;
 
-  // make sure sample list don't grow larger than MAX_SAMPLES. Older samples are removed.
-  if (batterySamples.size() >= MAX_SAMPLES) {
-    batterySamples.pop_front();
+  // voltage changes slowly when not mowing, fewer samples then lets the ring on flash hold weeks of history.
+  // Mowing starts a new sample right away, since the last one is always older than BATTERY_SAMPLE_INTERVAL.
+  bool idle = _isDocked || _isCharging || load.cutter + load.wheels < IDLE_MOTOR_CURRENT;
+  uint32_t interval = idle ? IDLE_SAMPLE_INTERVAL : BATTERY_SAMPLE_INTERVAL;
+  auto now = millis();
+  if (lastSampleTime > 0 && now - lastSampleTime < interval * 1000) {
+    return;
+  }
+  lastSampleTime = now;
+
+  // round values to what the sensors can resolve, noise in the last digits would ruin compression.
+  // Adding 0 turns -0 into 0, they have different bits and -0 would show up in the history.
+  historySample sample = {
+    (uint32_t)(Utils::getEpocTime() / 1000),
+    {
+      batteryVoltage,
+      roundf((loadCurrent - lastChargeCurrentReading) / 10) * 10 + 0.0f,
+      roundf(socEstimator.getStateOfCharge() * 1000) / 10
+    }
+  };
+
+  // we are running in the timer task, history is updated by process().
+  portENTER_CRITICAL(&historyQueueMux);
+  if (historyQueueLength == HISTORY_QUEUE_SIZE) {
+    historyQueueStart = (historyQueueStart + 1) % HISTORY_QUEUE_SIZE;
+    historyQueueLength--;
+  }
+  historyQueue[(historyQueueStart + historyQueueLength) % HISTORY_QUEUE_SIZE] = sample;
+  historyQueueLength++;
+  portEXIT_CRITICAL(&historyQueueMux);
+}
+
+/**
+ * Add samples taken by the timer to history, a full block is written to flash.
+ */
+void Battery::process() {
+  while (true) {
+    historySample sample;
+
+    portENTER_CRITICAL(&historyQueueMux);
+    bool hasSample = historyQueueLength > 0;
+    if (hasSample) {
+      sample = historyQueue[historyQueueStart];
+      historyQueueStart = (historyQueueStart + 1) % HISTORY_QUEUE_SIZE;
+      historyQueueLength--;
+    }
+    portEXIT_CRITICAL(&historyQueueMux);
+
+    if (!hasSample) {
+      return;
+    }
+
+    xSemaphoreTake(historyLock, portMAX_DELAY);
+    batteryHistory.add(sample.time, sample.values);
+    xSemaphoreGive(historyLock);
   }
+}
+
+/**
+ * Total current (mA) drawn from battery by motors and electronics.
+ */
+float Battery::readLoadCurrent() {
+  // 1000 for converting ampere to milliampere
+  load.cutter = io_analog.getVoltageAdc1(Definitions::CUTTER_LOAD_CHANNEL) / Definitions::CUTTER_LOAD_RESISTOR * 1000;
+  load.wheels = io_analog.getVoltageAdc1(Definitions::LEFT_WHEEL_MOTOR_LOAD_CHANNEL) / Definitions::WHEEL_MOTOR_LOAD_RESISTOR * 1000;
+  load.wheels += io_analog.getVoltageAdc1(Definitions::RIGHT_WHEEL_MOTOR_LOAD_CHANNEL) / Definitions::WHEEL_MOTOR_LOAD_RESISTOR * 1000;
+  load.electronics = IDLE_CURRENT;
 
-  batterySamples.emplace_back();
-  auto& sample = batterySamples.back();
-  sample.time = Utils::getEpocTime();
-  sample.batteryVoltage = batteryVoltage;
+  return load.cutter + load.wheels + load.electronics;
 }
 
 void Battery::updateChargeCurrent() {
@@ -70,6 +153,7 @@ void Battery::updateChargeCurrent() {
     
     if (_isFullyCharged) {
       Log.notice("Done charging battery." CR);
+      socEstimator.setFull();
       auto currEpocSeconds = Utils::getEpocTime();
       Configuration::config.lastFullyChargeTime = currEpocSeconds;
       if (Configuration::config.startChargeTime > 0) {
@@ -99,15 +183,70 @@ float Battery::getChargeCurrent() const {
 * Get battery status in percent, 100% = fully charged.
 */
 uint8_t Battery::getBatteryStatus() const {
+  return round(socEstimator.getStateOfCharge() * 100);
+}
+
+/*
+* Get estimated minutes left until battery needs recharging, given that we keep using as much power as we have done the last minute.
+* Returns UINT16_MAX if we are not using any power worth mentioning.
+*/
+uint16_t Battery::getRemainingMinutes() const {
+  return socEstimator.getRemainingMinutes();
+}
+
+/*
+* Get estimated energy (in Wh) left until battery needs recharging.
+*/
+float Battery::getRemainingEnergy() const {
+  return socEstimator.getRemainingEnergy();
+}
 
-  auto level = round((batteryVoltage - Definitions::BATTERY_EMPTY) / (Definitions::BATTERY_FULLY_CHARGED - Definitions::BATTERY_EMPTY) * 100);
-  if (level < 0) {
-    level = 0;
-  } else if (level > 100) {
-    level = 100;
+/*
+* Get total energy (in Wh) taken from battery since start, compare two readings to see how much some work cost.
+*/
+float Battery::getEnergyUsed() const {
+  return socEstimator.getEnergyUsed();
+}
+
+/*
+* Get latest reading of what each part of the mower draws from the battery.
+*/
+const batteryLoad& Battery::getLoad() const {
+  return load;
+}
+
+/*
+* Get estimated minutes of charging left until battery is fully charged.
+*/
+uint16_t Battery::getMinutesToFull() const {
+  return chargeModel.getTimeToFull(socEstimator.getStateOfCharge()) / 60;
+}
+
+/*
+* Get estimated minutes a charge between two battery levels (in percent) takes.
+*/
+uint16_t Battery::getChargeTime(uint8_t fromLevel, uint8_t toLevel) const {
+  return chargeModel.getChargeTime(fromLevel / 100.0f, toLevel / 100.0f) / 60;
+}
+
+/*
+* Get estimated minutes of mowing a battery level (in percent) gives, based on how much power mowing has needed so far. Returns 0 if we have not been mowing yet.
+*/
+uint16_t Battery::getMowingTime(uint8_t level) const {
+  auto current = socEstimator.getWorkCurrent();
+
+  if (current == 0) {
+    return 0;
   }
 
-  return level;
+  return level / 100.0f * Definitions::BATTERY_CAPACITY / current * 60;
+}
+
+/*
+* Get estimated internal resistance of battery (in ohm), goes up as battery gets old.
+*/
+float Battery::getInternalResistance() const {
+  return socEstimator.getInternalResistance();
 }
 
 bool Battery::isDocked() const {
@@ -134,6 +273,18 @@ uint32_t Battery::getLastChargeDuration() const {
   return Configuration::config.lastChargeDuration;
 }
 
-const std::deque<batterySample>& Battery::getBatteryHistory() const {
-  return batterySamples;
+/*
+* Write battery history as JSON (for /api/v1/history/battery), streamed directly from the compressed history.
+* @param points downsample history to this many samples (keeping the shape of the voltage curve), 0 to get all samples.
+*/
+void Battery::printBatteryHistory(Print& output, uint16_t points) {
+  static const char* const names[HISTORY_FIELDS] = {"value", "current", "level"};
+  static const uint8_t decimals[HISTORY_FIELDS] = {2, 0, 1};
+
+  output.print(F("{\"samples\":"));
+  // main loop would otherwise seal a block and move it to flash while we are reading.
+  xSemaphoreTake(historyLock, portMAX_DELAY);
+  batteryHistory.printJson(output, names, decimals, points > MAX_HISTORY_POINTS ? (uint16_t)MAX_HISTORY_POINTS : points);
+  xSemaphoreGive(historyLock);
+  output.print('}');
 }
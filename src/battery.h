@@ -5,38 +5,70 @@
 #include <Arduino.h>
 #include <Ticker.h>
 #include <Wire.h>
-#include <deque>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include "io_analog.h"
+#include "flash_ring.h"
+#include "time_series.h"
+#include "soc_estimator.h"
+#include "charge_model.h"
+#include "processable.h"
 
-struct batterySample {
-  uint32_t time;
-  float batteryVoltage;
+struct batteryLoad {
+  float cutter = 0;       // mA
+  float wheels = 0;       // mA, both wheel motors.
+  float electronics = 0;  // mA, not measured, see IDLE_CURRENT.
 };
 
-class Battery {
+class Battery : public Processable {
   public:
     Battery(IO_Analog& io_analog, TwoWire& w);
     float getBatteryVoltage() const;
     float getChargeCurrent() const;
     uint8_t getBatteryStatus() const;
+    uint16_t getRemainingMinutes() const;
+    float getInternalResistance() const;
+    float getRemainingEnergy() const;
+    float getEnergyUsed() const;
+    const batteryLoad& getLoad() const;
+    uint16_t getMinutesToFull() const;
+    uint16_t getChargeTime(uint8_t fromLevel, uint8_t toLevel) const;
+    uint16_t getMowingTime(uint8_t level) const;
     uint32_t getLastFullyChargeTime() const;
     uint32_t getLastChargeDuration() const;
-    const std::deque<batterySample>& getBatteryHistory() const;
+    void printBatteryHistory(Print& output, uint16_t points = 0);
     bool isDocked() const;
     bool isCharging() const;
     bool needRecharge() const;
     bool isFullyCharged() const;
     void start();
+    /* Internal use only! */
+    void process();
 
   private:
-    static const uint16_t MAX_SAMPLES = 100;   // How much history are we going to keep? set too high will consume excessive memory and we may get out-of-memory related errors.
+    static const uint16_t HISTORY_BLOCK_SIZE = 256;   // Size (bytes) of each compressed block of history, one block is kept in RAM.
+    static const uint16_t HISTORY_BLOCKS = 384;       // How much history are we going to keep on flash, in blocks (96 kB). About 15 days when mowing 4 hours a day, see IDLE_SAMPLE_INTERVAL.
+    static const uint8_t HISTORY_FIELDS = 3;          // voltage, current and battery level.
+    static const uint16_t MAX_HISTORY_POINTS = 1000;  // Max number of points when downsampling history, each point costs 16 bytes of RAM while downsampling.
     static const uint16_t BATTERY_CHARGECURRENT_DELAY = 100; // Read charge current every XXX milliseconds.
-    static const uint16_t BATTERY_VOLTAGE_DELAY = 20;        // Read battery voltage every XXX seconds.
+    static const uint16_t BATTERY_VOLTAGE_DELAY = 1;         // Read battery voltage (and motor currents) every XXX seconds.
+    static const uint16_t BATTERY_SAMPLE_INTERVAL = 20;      // Add battery voltage to history every XXX seconds.
+    static const uint16_t IDLE_SAMPLE_INTERVAL = 300;        // Add battery voltage to history every XXX seconds when docked, charging or motors are stopped.
+    static const uint16_t IDLE_MOTOR_CURRENT = 100;          // Motors (mA, cutter and wheels together) are considered stopped below this.
+    static const uint16_t IDLE_CURRENT = 150;                // Current (mA) drawn by electronics (controller, sensors, radio), not measured by any shunt.
     static const uint8_t CURRENT_MEDIAN_SAMPLES = 11;        // How many samples should we take to calculate a median value for charge current. Don't fiddle with this unless needed.
+    static const uint8_t HISTORY_QUEUE_SIZE = 4;             // Samples waiting for main loop to add them to history, oldest is dropped if loop doesn't keep up.
+
+    struct historySample {
+      uint32_t time;
+      float values[HISTORY_FIELDS];
+    };
 
     IO_Analog& io_analog;
     TwoWire& wire;
     float batteryVoltage = 0;
+    float loadCurrent = 0;
+    batteryLoad load;
     float lastChargeCurrentReading = 0;
     bool _isDocked = false;
     bool _isCharging = false;
@@ -44,11 +76,22 @@ class Battery {
     bool _isFullyCharged = false;
     float currentMedian[CURRENT_MEDIAN_SAMPLES] = {0};
     uint8_t currentMedianIndex = 0;
+    uint32_t lastSampleTime = 0;
+    SocEstimator socEstimator;
+    ChargeModel chargeModel;
     void updateBatteryVoltage();
     void updateChargeCurrent();
+    float readLoadCurrent();
     Ticker batteryVoltageTicker;
     Ticker chargeCurrentTicker;
-    std::deque<batterySample> batterySamples;
+    FlashRing historyRing;
+    TimeSeries batteryHistory;
+    // samples are taken by a timer, but adding them to history may write to flash and that is left to the main loop.
+    historySample historyQueue[HISTORY_QUEUE_SIZE];
+    uint8_t historyQueueStart = 0;
+    uint8_t historyQueueLength = 0;
+    portMUX_TYPE historyQueueMux = portMUX_INITIALIZER_UNLOCKED;
+    SemaphoreHandle_t historyLock;  // held while reading or writing history, web requests read it from another task.
 };
 
 #endif
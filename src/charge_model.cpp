@@ -0,0 +1,135 @@
+#include <ArduinoLog.h>
+#include <math.h>
+#include "charge_model.h"
+
+ChargeModel::ChargeModel(float capacity, float maxVoltage, float terminationCurrent) :
+  capacity(capacity),
+  maxVoltage(maxVoltage),
+  terminationCurrent(terminationCurrent),
+  kneeLevel(INITIAL_KNEE_LEVEL / 100.0f),
+  timeConstant(INITIAL_TIME_CONSTANT) { }
+
+void ChargeModel::update(uint32_t now, float voltage, float current, float level) {
+  lastCurrent = current;
+
+  if (current < terminationCurrent) {
+    phase = PHASE::IDLE;
+    return;
+  }
+
+  if (voltage < maxVoltage - VOLTAGE_TOLERANCE / 1000.0f) {
+    phase = PHASE::CONSTANT_CURRENT;
+    constantCurrent = constantCurrent == 0 ? current : constantCurrent + (current - constantCurrent) * 0.05f;
+    return;
+  }
+
+  if (phase != PHASE::CONSTANT_VOLTAGE) {
+    // only learn knee if we saw the CC phase end, charging could have started in CV phase.
+    if (phase == PHASE::CONSTANT_CURRENT) {
+      kneeLevel += (level - kneeLevel) * 0.5f;
+      Log.trace(F("Charging reached CV phase at %d%%" CR), (int)(level * 100));
+    }
+
+    phase = PHASE::CONSTANT_VOLTAGE;
+    decayStartCurrent = current;
+    decayStartTime = now;
+    return;
+  }
+
+  if (now - decayStartTime >= DECAY_SAMPLE_TIME * 1000) {
+    // current decays as I = I0 * e^(-t/tau), so tau = t / ln(I0/I).
+    if (current < decayStartCurrent) {
+      float measured = (now - decayStartTime) / 1000.0f / log(decayStartCurrent / current);
+      timeConstant += (measured - timeConstant) * 0.2f;
+    }
+
+    decayStartCurrent = current;
+    decayStartTime = now;
+  }
+}
+
+ChargeModel::PHASE ChargeModel::getPhase() const {
+  return phase;
+}
+
+float ChargeModel::getConstantCurrent() const {
+  return constantCurrent;
+}
+
+float ChargeModel::getKneeLevel() const {
+  return kneeLevel;
+}
+
+float ChargeModel::getTimeConstant() const {
+  return timeConstant;
+}
+
+uint32_t ChargeModel::getTimeToLevel(float level, float target) const {
+  if (phase == PHASE::CONSTANT_VOLTAGE && target > level) {
+    return getConstantVoltageTime(level, target, lastCurrent);
+  }
+
+  return getChargeTime(level, target);
+}
+
+uint32_t ChargeModel::getChargeTime(float level, float target) const {
+  if (target <= level) {
+    return 0;
+  }
+
+  // we have never been charging, assume a charger doing 0.5C.
+  float current = constantCurrent > 0 ? constantCurrent : capacity / 2;
+  float seconds = 0;
+
+  if (level < kneeLevel) {
+    float kneeTarget = target < kneeLevel ? target : kneeLevel;
+    seconds += (kneeTarget - level) * capacity / current * 3600;
+    level = kneeTarget;
+  }
+
+  if (target > level) {
+    seconds += getConstantVoltageTime(level, target, current);
+  }
+
+  return seconds;
+}
+
+uint32_t ChargeModel::getTimeToFull(float level) const {
+  return getTimeToLevel(level, 1);
+}
+
+uint16_t ChargeModel::getMowingInWindow(uint16_t window, uint16_t firstCharge, uint16_t firstMowing, uint16_t cycleCharge, uint16_t cycleMowing) {
+  uint32_t time = firstCharge;
+  uint32_t mowing = 0;
+  uint16_t mow = firstMowing;
+
+  while (time < window) {
+    uint32_t left = window - time;
+    mowing += mow < left ? mow : left;
+    time += mow + cycleCharge;
+
+    if (cycleMowing == 0) {
+      break;
+    }
+    mow = cycleMowing;
+  }
+
+  return mowing;
+}
+
+/**
+ * In CV phase the charge going in is I0 * tau * (1 - e^(-t/tau)), solve for t.
+ */
+float ChargeModel::getConstantVoltageTime(float fromLevel, float toLevel, float startCurrent) const {
+  float toFull = startCurrent > terminationCurrent ? timeConstant * log(startCurrent / terminationCurrent) : 0;
+  float charge = (toLevel - fromLevel) * capacity * 3600;   // mAs
+  float available = startCurrent * timeConstant;            // what would go in if current decayed all the way to zero.
+
+  if (toLevel >= 1 || charge >= available) {
+    return toFull;
+  }
+
+  float seconds = -timeConstant * log(1 - charge / available);
+
+  return seconds < toFull ? seconds : toFull;
+}
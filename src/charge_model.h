@@ -0,0 +1,89 @@
+#ifndef _charge_model_h
+#define _charge_model_h
+
+#include <Arduino.h>
+
+/**
+* Model of how the battery charges, learned from the charge current of each charge cycle. Used to predict how long charging will take.
+*
+* A Li-ion charger first charges with constant current (CC) until battery reaches its max voltage (the "knee", at about 70-80% SoC),
+* then it holds the voltage constant (CV) while the current decays exponentially until it drops below a termination current.
+* The CV phase is slow, the last 20% can take as long as the first 80%.
+*/
+class ChargeModel {
+  public:
+    enum class PHASE {
+      IDLE,               // not charging.
+      CONSTANT_CURRENT,
+      CONSTANT_VOLTAGE
+    };
+
+    /**
+    * @param capacity usable battery capacity (mAh).
+    * @param maxVoltage voltage the charger holds in CV phase.
+    * @param terminationCurrent charger stops when current drops below this (mA).
+    */
+    ChargeModel(float capacity, float maxVoltage, float terminationCurrent);
+    /**
+    * Should be called regularly (about once a second) with latest measurements.
+    * @param current charge current (mA).
+    * @param level state of charge (0-1).
+    */
+    void update(uint32_t now, float voltage, float current, float level);
+    PHASE getPhase() const;
+    /**
+    * Current in CC phase (mA).
+    */
+    float getConstantCurrent() const;
+    /**
+    * State of charge (0-1) where charging goes from CC to CV phase.
+    */
+    float getKneeLevel() const;
+    /**
+    * How fast current decays in CV phase, seconds for it to drop to 37% (1/e).
+    */
+    float getTimeConstant() const;
+    /**
+    * Seconds of charging needed to go from level to target level (0-1). If we are charging, the current phase and current are taken into account.
+    */
+    uint32_t getTimeToLevel(float level, float target) const;
+    /**
+    * Seconds a charge from level to target level (0-1) takes, for a charge that has not started yet.
+    */
+    uint32_t getChargeTime(float level, float target) const;
+    /**
+    * Seconds of charging needed to go from level to fully charged (charger stops).
+    */
+    uint32_t getTimeToFull(float level) const;
+    /**
+    * Minutes of mowing we get before the schedule window ends, when repeating the same charge/mow cycle. Compare the result for different
+    * charge levels to find out if it pays off to leave before battery is full.
+    * @param window minutes left of mowing schedule.
+    * @param firstCharge minutes of charging before we leave the first time.
+    * @param firstMowing minutes of mowing we get the first time.
+    * @param cycleCharge minutes of charging after each return (battery is empty).
+    * @param cycleMowing minutes of mowing we get after each charge.
+    */
+    static uint16_t getMowingInWindow(uint16_t window, uint16_t firstCharge, uint16_t firstMowing, uint16_t cycleCharge, uint16_t cycleMowing);
+
+  private:
+    static const uint8_t VOLTAGE_TOLERANCE = 50;       // Battery is considered at CV voltage when this close (mV).
+    static const uint16_t DECAY_SAMPLE_TIME = 60;      // Measure current decay in CV phase over this many seconds.
+    static const uint16_t INITIAL_TIME_CONSTANT = 2400; // CV phase time constant (seconds) until we have measured it.
+    static const uint8_t INITIAL_KNEE_LEVEL = 75;      // SoC (%) of knee until we have measured it.
+
+    float capacity;
+    float maxVoltage;
+    float terminationCurrent;
+    PHASE phase = PHASE::IDLE;
+    float constantCurrent = 0;
+    float kneeLevel;
+    float timeConstant;
+    float lastCurrent = 0;
+    float decayStartCurrent = 0;
+    uint32_t decayStartTime = 0;
+
+    float getConstantVoltageTime(float fromLevel, float toLevel, float startCurrent) const;
+};
+
+#endif
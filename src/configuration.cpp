@@ -38,6 +38,11 @@ namespace Configuration {
       config.startChargeTime = json["startChargeTime"];
       config.lastFullyChargeTime = json["lastFullyChargeTime"];
       config.lastChargeDuration = json["lastChargeDuration"];
+
+      config.departureLevel = 100;
+      if (json.containsKey("departureLevel")) {
+        config.departureLevel = json["departureLevel"];
+      }
       
       if (json.containsKey("lastState")) {
         config.lastState = json["lastState"].as<String>();
@@ -79,6 +84,7 @@ namespace Configuration {
     json["startChargeTime"] = config.startChargeTime;
     json["lastFullyChargeTime"] = config.lastFullyChargeTime;
     json["lastChargeDuration"] = config.lastChargeDuration;
+    json["departureLevel"] = config.departureLevel;
     json["lastState"] = config.lastState;
     json["gmt"] = config.gmt;
     json["wifiPassword"] = config.wifiPassword;
@@ -17,6 +17,7 @@ namespace Configuration {
     uint32_t startChargeTime = 0;
     uint32_t lastFullyChargeTime = 0;
     uint32_t lastChargeDuration = 0;
+    uint8_t departureLevel = 100;   // battery level (%) at which mower may leave docking station before fully charged, if that gives more mowing. 100 = always charge fully.
     String lastState;    
     String gmt;
     String wifiPassword;
@@ -3,12 +3,19 @@
 #include "definitions.h"
 #include "utils.h"
 
-Cutter::Cutter(IO_Analog& io_analog) : cutter_id(3), io_analog(io_analog) {
+static const float FUSE_BLOWN_RATIO = 0.2;      // Below this part of no-load current motor has no power.
+static const float BLADE_MISSING_RATIO = 0.6;   // Below this part of no-load current there is no blade to drag along.
+
+Cutter::Cutter(IO_Analog& io_analog) :
+  cutter_id(3),
+  io_analog(io_analog),
+  governor(Definitions::CUTTER_MIN_SPEED, Definitions::CUTTER_MAX_SPEED) {
+
   pinMode(Definitions::CUTTER_MOTOR_PIN, OUTPUT);
   pinMode(Definitions::CUTTER_BRAKE_PIN, OUTPUT);
   digitalWrite(Definitions::CUTTER_BRAKE_PIN, LOW);
   
-  ledcSetup(cutter_id, Definitions::MOTOR_BASE_FREQ, Definitions::MOTOR_TIMER_13_BIT);
+  ledcSetup(cutter_id, Definitions::MOTOR_BASE_FREQ, Definitions::MOTOR_PWM_RESOLUTION);
   ledcAttachPin(Definitions::CUTTER_MOTOR_PIN, cutter_id);
 
   ledcWrite(cutter_id, cutterSpeed);
@@ -20,8 +27,18 @@ Cutter::~Cutter() {
 
 void Cutter::start() {
   if (cutterSpeed == 0) {
-    cutterLoadReadingTicker.attach_ms<Cutter*>(100, [](Cutter* instance) {
-      instance->senseLoad();
+    jammed = false;
+    jamDetector.reset();
+    windowSamples = 0;
+    windowSum = 0;
+    windowSumSquares = 0;
+    windowPeak = 0;
+    fuseBlownCounter = 0;
+    bladeMissingCounter = 0;
+
+    io_analog.startContinuousAdc1(Definitions::CUTTER_LOAD_CHANNEL);
+    cutterLoadReadingTicker.attach_ms<Cutter*>(SAMPLE_INTERVAL, [](Cutter* instance) {
+      instance->sampleCurrent();
     }, this);
 
     digitalWrite(Definitions::CUTTER_BRAKE_PIN, LOW);
@@ -30,6 +47,8 @@ void Cutter::start() {
 
     cutterSpeed = Definitions::CUTTER_MAX_SPEED;
     cutterCurrentSpeed = 1;
+    governing = false;
+    governor.reset(millis());
 
     setCutterSpeed(cutterCurrentSpeed);
 
@@ -41,6 +60,7 @@ void Cutter::stop(bool brake) {
   if (cutterSpeed > 0) {
     cutterSpeed = 0;
     cutterCurrentSpeed = 0;
+    governing = false;
 
     setCutterSpeed(cutterCurrentSpeed);
 
@@ -52,7 +72,11 @@ void Cutter::stop(bool brake) {
     }
 
     cutterLoadReadingTicker.detach();
+    io_analog.stopContinuousAdc1();
     load = 0;
+    current = 0;
+    currentRms = 0;
+    currentPeak = 0;
 
     Log.trace(F("Cutter-stop, brake: %d" CR), brake);
   }
@@ -62,10 +86,54 @@ bool Cutter::isCutting() {
     return cutterSpeed > 0;
 }
 
+uint8_t Cutter::getSpeed() {
+  return cutterCurrentSpeed;
+}
+
+void Cutter::setGroundSpeed(uint8_t speed) {
+  groundSpeed = speed;
+}
+
+/**
+ * Runs every couple of milliseconds (from a timer), collects current samples into windows of 100 ms and watches for a jammed blade.
+ */
+void Cutter::sampleCurrent() {
+  float voltage;
+  if (!io_analog.readContinuousAdc1(voltage)) {
+    return;
+  }
+
+  float sample = voltage / Definitions::CUTTER_LOAD_RESISTOR * 1000; // 1000 for converting ampere to milliampere
+
+  // A blade that has stopped draws stall current, which blows the fuse in a few seconds. Cut power well before that.
+  if (!jammed && jamDetector.update(sample, cutterCurrentSpeed)) {
+    setCutterSpeed(0);
+    jammed = true;
+  }
+
+  windowSum += sample;
+  windowSumSquares += sample * sample;
+  if (sample > windowPeak) {
+    windowPeak = sample;
+  }
+
+  if (++windowSamples >= WINDOW_SAMPLES) {
+    current = windowSum / windowSamples;
+    currentRms = sqrt(windowSumSquares / windowSamples);
+    currentPeak = windowPeak;
+    windowSamples = 0;
+    windowSum = 0;
+    windowSumSquares = 0;
+    windowPeak = 0;
+
+    senseLoad();
+  }
+}
+
 void Cutter::senseLoad() {
 
-  auto current = round(io_analog.getVoltageAdc1(Definitions::CUTTER_LOAD_CHANNEL) / Definitions::CUTTER_LOAD_RESISTOR * 1000); // 1000 for converting ampere to milliampere
-  auto newLoad = round((current - Definitions::CUTTER_NOLOAD_CURRENT) / (Definitions::CUTTER_MAX_CURRENT - Definitions::CUTTER_NOLOAD_CURRENT) * 100);
+  auto noLoadCurrent = getNoLoadCurrent();
+  auto newLoad = round((current - noLoadCurrent) / (Definitions::CUTTER_MAX_CURRENT - noLoadCurrent) * 100);
 
   // make sure we stay within percentage boundaries.
   if (newLoad < 0) {
@@ -84,7 +152,30 @@ void Cutter::senseLoad() {
     overloadCounter--;
   }
 
-  //Log.notice("%F mA, %d%%" CR, current, load);
+  // only when blade has reached its speed, while starting up current could be anything.
+  if (governing && current < noLoadCurrent * FUSE_BLOWN_RATIO) {
+    fuseBlownCounter++;
+  } else {
+    fuseBlownCounter = 0;
+  }
+
+  if (governing && current >= noLoadCurrent * FUSE_BLOWN_RATIO && current < noLoadCurrent * BLADE_MISSING_RATIO) {
+    bladeMissingCounter++;
+  } else if (bladeMissingCounter > 0) {
+    bladeMissingCounter--;
+  }
+
+  //Log.notice("%F mA (rms %F, peak %F), %d%%" CR, current, currentRms, currentPeak, load);
+}
+
+/**
+ * Current (mA) without any grass to cut at current blade speed. Blade drag grows with the square of speed, so a slowed down blade draws
+ * less current. Otherwise a slow blade would look unloaded (or blown fuse).
+ */
+float Cutter::getNoLoadCurrent() {
+  float speed = cutterCurrentSpeed / 100.0f;
+
+  return Definitions::CUTTER_NOLOAD_CURRENT * speed * speed;
 }
 
 void Cutter::setCutterSpeed(uint8_t speed) {
@@ -92,8 +183,8 @@ void Cutter::setCutterSpeed(uint8_t speed) {
   if (speed == 0) {
     ledcWrite(cutter_id, 0);
   } else {
-    // calculate duty, 8191 from 2 ^ 13 - 1
-    uint32_t duty = ((pow(2, Definitions::MOTOR_TIMER_13_BIT) - 1) / 100) * abs(speed);
+    // calculate duty, max duty is 8191 from 2 ^ 13 - 1 (computed at compile time)
+    uint32_t duty = Definitions::MOTOR_MAX_DUTY * abs(speed) / 100;
     ledcWrite(cutter_id, duty);
   }
 }
@@ -102,6 +193,32 @@ uint8_t Cutter::getLoad() {
   return load;
 }
 
+float Cutter::getCurrent() {
+  return current;
+}
+
+float Cutter::getCurrentRms() {
+  return currentRms;
+}
+
+float Cutter::getCurrentPeak() {
+  return currentPeak;
+}
+
+/**
+ * Estimated from back-EMF, see CutterJamDetector::estimateRpm(). Ripple from the commutator would give speed directly, but it's at several
+ * hundred Hz and the ADC can't sample that fast.
+ */
+uint16_t Cutter::getRpm() {
+  if (!isCutting()) {
+    return 0;
+  }
+
+  auto rpm = CutterJamDetector::estimateRpm(current, cutterCurrentSpeed);
+
+  return rpm > 0 ? rpm : 0;
+}
+
 /**
  * Signals that cuttermotor has surpassed the CUTTER_LOAD_THRESHOLD and is working too hard keeping up.
  * Continue working at this load may blow a fuse.
@@ -115,14 +232,41 @@ bool Cutter::isOverloaded() {
  * Stop cutter and wait a while for polyfuse to reset or replace fuse.
  */
 bool Cutter::isFuseblown() {
-  return isCutting() && load < 2; // are we cutting without any load? That is not possible unless motor is standing still.
+  return isCutting() && fuseBlownCounter >= FUSE_BLOWN_WINDOWS; // are we cutting without any current? That is not possible unless motor is standing still.
+}
+
+bool Cutter::isJammed() {
+  return jammed;
+}
+
+bool Cutter::isBladeMissing() {
+  return isCutting() && bladeMissingCounter > BLADE_MISSING_WINDOWS;
 }
 
 void Cutter::process() {
+  // power has already been cut when jam was detected, make it official.
+  if (jammed && cutterSpeed > 0) {
+    Log.warning(F("Cutter jammed, power cut at %F mA." CR), jamDetector.getJamCurrent());
+    stop(false);
+
+    return;
+  }
+
+  // adapt blade speed to how much grass there is, once blade has reached full speed.
+  if (governing && millis() - lastGovernorUpdate >= GOVERNOR_INTERVAL) {
+    lastGovernorUpdate = millis();
+    cutterSpeed = governor.update(millis(), load, groundSpeed);
+  }
+
   // slowly ramp cutter speed up to reach target ("cutterSpeed"), this is to save fuses and electronics from current surges.
   if (cutterCurrentSpeed < cutterSpeed) {
+    // a blade that is already spinning doesn't cause much of a surge, so governor can get it back to speed quickly.
+    uint8_t rampInterval = SPINUP_RAMP_INTERVAL;
+    if (governing && cutterCurrentSpeed >= Definitions::CUTTER_MIN_SPEED) {
+      rampInterval = GOVERNOR_RAMP_INTERVAL;
+    }
 
-    if (millis() - cutterLastSpeedRamp > 50) {
+    if (millis() - cutterLastSpeedRamp > rampInterval) {
       cutterLastSpeedRamp = millis();
       cutterCurrentSpeed++;
       setCutterSpeed(cutterCurrentSpeed);
@@ -133,5 +277,8 @@ void Cutter::process() {
     cutterCurrentSpeed--;
     setCutterSpeed(cutterCurrentSpeed);
 
+  } else if (cutterSpeed > 0 && !governing) {
+    governing = true;
+    governor.reset(millis());
   }
 }
\ No newline at end of file
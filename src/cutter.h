@@ -4,6 +4,8 @@
 #include <Arduino.h>
 #include <Ticker.h>
 #include "io_analog.h"
+#include "cutter_governor.h"
+#include "cutter_jam_detector.h"
 #include "processable.h"
 
 
@@ -17,14 +19,47 @@ class Cutter : public Processable {
     void start();
     void stop(bool brake = true);
     bool isCutting();
+    /**
+    * Current blade speed (0-100%).
+    */
+    uint8_t getSpeed();
     uint8_t getLoad();
+    /**
+    * Average, RMS, and peak cutter current (mA) over the last 100 ms.
+    */
+    float getCurrent();
+    float getCurrentRms();
+    float getCurrentPeak();
+    /**
+    * Blade speed (rpm) estimated from back-EMF of motor.
+    */
+    uint16_t getRpm();
     bool isOverloaded();
     bool isFuseblown();
+    /**
+    * Blade has stopped while powered (e.g. stuck on a root or stone) and power was cut before fuse blew. Cleared when cutter is started again.
+    */
+    bool isJammed();
+    /**
+    * Blade spins with less resistance than it should, it's loose or gone.
+    */
+    bool isBladeMissing();
+    /**
+    * Tell cutter how fast the mower is moving forward (0-100%), the faster we go the faster the blade has to spin to give a clean cut.
+    */
+    void setGroundSpeed(uint8_t speed);
     /* Internal use only! */
     void process();
 
   private:
     static const uint8_t LOAD_MEDIAN_SAMPLES = 5; // How many samples should we take to calculate a median value for cutter load. Don't fiddle with this unless needed.
+    static const uint8_t SPINUP_RAMP_INTERVAL = 50;    // Increase speed by 1% this often (ms) when starting blade.
+    static const uint8_t GOVERNOR_RAMP_INTERVAL = 10;  // Same, but when blade is already spinning and governor wants it faster.
+    static const uint8_t GOVERNOR_INTERVAL = 100;      // How often (ms) governor adapts blade speed to load, same as load is read.
+    static const uint8_t SAMPLE_INTERVAL = 2;          // How often (ms) cutter current is sampled.
+    static const uint8_t WINDOW_SAMPLES = 50;          // Samples to calculate average, RMS, and peak current from (100 ms).
+    static const uint8_t FUSE_BLOWN_WINDOWS = 3;       // Current must stay close to zero for this many windows before we think fuse has blown.
+    static const uint8_t BLADE_MISSING_WINDOWS = 20;   // Current must stay low for this many windows before we think blade is missing.
 
     const uint8_t cutter_id;
     IO_Analog& io_analog;
@@ -33,10 +68,28 @@ class Cutter : public Processable {
     long cutterLastSpeedRamp = 0;
     uint8_t load = 0;
     uint16_t overloadCounter = 0;
+    uint8_t fuseBlownCounter = 0;
+    uint8_t bladeMissingCounter = 0;
+    float current = 0;
+    float currentRms = 0;
+    float currentPeak = 0;
+    // current samples of window being collected.
+    uint8_t windowSamples = 0;
+    float windowSum = 0;
+    float windowSumSquares = 0;
+    float windowPeak = 0;
+    CutterJamDetector jamDetector;
+    volatile bool jammed = false;
     uint8_t loadMedian[LOAD_MEDIAN_SAMPLES] = {0};
     uint8_t loadMedianIndex = 0;
+    CutterGovernor governor;
+    bool governing = false;         // blade has reached full speed once, and governor is in charge.
+    uint32_t lastGovernorUpdate = 0;
+    uint8_t groundSpeed = 0;
     Ticker cutterLoadReadingTicker;
+    void sampleCurrent();
     void senseLoad();
+    float getNoLoadCurrent();
     void setCutterSpeed(uint8_t speed);
 };
 
@@ -0,0 +1,83 @@
+#include <ArduinoLog.h>
+#include "cutter_governor.h"
+
+CutterGovernor::CutterGovernor(uint8_t minSpeed, uint8_t maxSpeed) :
+  minSpeed(minSpeed < maxSpeed ? minSpeed : maxSpeed),
+  maxSpeed(maxSpeed),
+  speed(maxSpeed) { }
+
+void CutterGovernor::reset(uint32_t now) {
+  speed = maxSpeed;
+  filteredLoad = 0;
+  lastUpdate = now;
+  lowSince = 0;
+  lastStep = now;
+  lastRaise = now;
+  hasRaised = false;
+}
+
+uint8_t CutterGovernor::update(uint32_t now, uint8_t load, uint8_t groundSpeed) {
+  float dt = now - lastUpdate;
+  lastUpdate = now;
+  filteredLoad += (load - filteredLoad) * (dt < FILTER_TIME ? dt / FILTER_TIME : 1);
+
+  auto floor = getFloor(groundSpeed);
+
+  // react on unfiltered load, thick grass should get full blade speed right away.
+  if (load > HIGH_LOAD || speed < floor) {
+    if (load > HIGH_LOAD && speed < maxSpeed) {
+      Log.trace(F("Cutter load %d%%, back to full blade speed." CR), load);
+      speed = maxSpeed;
+      lastRaise = now;
+      hasRaised = true;
+      // filtered load was from the slower speed.
+      filteredLoad = load;
+    } else if (speed < floor) {
+      speed = floor;
+    }
+    lowSince = 0;
+
+    return speed;
+  }
+
+  if (filteredLoad >= LOW_LOAD) {
+    lowSince = 0;
+    return speed;
+  }
+
+  if (lowSince == 0) {
+    lowSince = now;
+  }
+
+  uint32_t holdTime = HOLD_TIME;
+  if (hasRaised && now - lastRaise < RAISED_HOLD_TIME) {
+    holdTime = RAISED_HOLD_TIME;
+  }
+
+  if (now - lowSince >= holdTime && now - lastStep >= STEP_INTERVAL && speed > floor) {
+    speed = speed - floor > STEP_DOWN ? speed - STEP_DOWN : floor;
+    lastStep = now;
+  }
+
+  return speed;
+}
+
+uint8_t CutterGovernor::getSpeed() const {
+  return speed;
+}
+
+/**
+ * The blade has to cut all grass the mower drives over, so the faster we go the faster the blade has to spin. At full ground speed the floor
+ * is halfway between min and max speed.
+ */
+uint8_t CutterGovernor::getFloor(uint8_t groundSpeed) const {
+  if (groundSpeed > 100) {
+    groundSpeed = 100;
+  }
+
+  return minSpeed + (maxSpeed - minSpeed) * groundSpeed / 200;
+}
+
+float CutterGovernor::getFilteredLoad() const {
+  return filteredLoad;
+}
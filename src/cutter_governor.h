@@ -0,0 +1,62 @@
+#ifndef _cutter_governor_h
+#define _cutter_governor_h
+
+#include <Arduino.h>
+
+/**
+* Adapts blade speed to the load on the cutter. In short or sparse grass most of the cutter power goes to spinning the blade through the air,
+* so we spin it slower and save energy. As soon as the load rises (thicker grass) the blade gets back to full speed.
+*
+* - Blade speed is lowered in small steps, and only after the (filtered) load has stayed low for a while.
+* - Blade speed goes straight back to max when load rises above the high threshold. Between the low and high thresholds speed is kept as is,
+*   so the governor doesn't hunt back and forth.
+* - After going back to max we wait longer before lowering again, slower blade means higher load for the same grass and we could otherwise
+*   oscillate between two speeds.
+* - Blade speed never goes below a floor that keeps the cut clean, the faster the mower moves the higher the floor.
+*/
+class CutterGovernor {
+  public:
+    /**
+    * @param minSpeed lowest blade speed (%) that still gives a clean cut, when mower is standing still.
+    * @param maxSpeed normal blade speed (%).
+    */
+    CutterGovernor(uint8_t minSpeed, uint8_t maxSpeed);
+    /**
+    * Start over at max speed, e.g. when cutter starts.
+    */
+    void reset(uint32_t now);
+    /**
+    * Should be called each time a new load reading is available.
+    * @param load cutter load (0-100%).
+    * @param groundSpeed forward speed of mower (0-100%).
+    * @return blade speed (%) to use.
+    */
+    uint8_t update(uint32_t now, uint8_t load, uint8_t groundSpeed);
+    uint8_t getSpeed() const;
+    /**
+    * Lowest blade speed (%) allowed at a ground speed (0-100%).
+    */
+    uint8_t getFloor(uint8_t groundSpeed) const;
+    float getFilteredLoad() const;
+
+  private:
+    static const uint8_t LOW_LOAD = 15;             // Lower blade speed when filtered load (%) stays below this.
+    static const uint8_t HIGH_LOAD = 35;            // Go back to max blade speed as soon as load (%) is above this.
+    static const uint16_t HOLD_TIME = 3000;         // Load must stay low this long (ms) before lowering blade speed.
+    static const uint16_t RAISED_HOLD_TIME = 30000; // Same, but after we had to go back to max.
+    static const uint16_t STEP_INTERVAL = 1000;     // Time (ms) between each step down.
+    static const uint8_t STEP_DOWN = 5;             // Lower blade speed this much (%) each step.
+    static const uint16_t FILTER_TIME = 2000;       // Time constant (ms) of load filter.
+
+    uint8_t minSpeed;
+    uint8_t maxSpeed;
+    uint8_t speed;
+    float filteredLoad = 0;
+    uint32_t lastUpdate = 0;
+    uint32_t lowSince = 0;      // when filtered load went below LOW_LOAD, 0 if it's not.
+    uint32_t lastStep = 0;
+    uint32_t lastRaise = 0;
+    bool hasRaised = false;
+};
+
+#endif
@@ -0,0 +1,47 @@
+#include "cutter_jam_detector.h"
+#include "definitions.h"
+
+static constexpr float JAM_RPM_RATIO = 0.08;  // Blade turning slower than this part of no-load rpm counts as stopped.
+
+static_assert(JAM_RPM_RATIO < 1 - Definitions::CUTTER_LOAD_THRESHOLD / 100.0f, "Jam threshold must be above overload current, or thick grass would look like a jam.");
+
+/**
+ * Back-EMF is supply voltage times duty minus what is lost in the winding, and blade speed is proportional to it. Stall current is supply
+ * voltage over winding resistance, so when both are expressed in stall currents voltage and resistance cancel out.
+ */
+float CutterJamDetector::estimateRpm(float current, uint8_t speed) {
+  float stallCurrent = Definitions::CUTTER_MAX_CURRENT * speed / 100;
+
+  return Definitions::CUTTER_NOLOAD_RPM * (stallCurrent - current) / (Definitions::CUTTER_MAX_CURRENT - Definitions::CUTTER_NOLOAD_CURRENT);
+}
+
+void CutterJamDetector::reset() {
+  stoppedSamples = 0;
+  jammed = false;
+  jamCurrent = 0;
+}
+
+bool CutterJamDetector::update(float current, uint8_t speed) {
+  if (jammed) {
+    return true;
+  }
+
+  if (speed >= JAM_MIN_SPEED && estimateRpm(current, speed) < Definitions::CUTTER_NOLOAD_RPM * JAM_RPM_RATIO) {
+    if (++stoppedSamples >= JAM_SAMPLES) {
+      jamCurrent = current;
+      jammed = true;
+    }
+  } else {
+    stoppedSamples = 0;
+  }
+
+  return jammed;
+}
+
+bool CutterJamDetector::isJammed() const {
+  return jammed;
+}
+
+float CutterJamDetector::getJamCurrent() const {
+  return jamCurrent;
+}
@@ -0,0 +1,44 @@
+#ifndef _cutter_jam_detector_h
+#define _cutter_jam_detector_h
+
+#include <Arduino.h>
+
+/**
+* Detects a blade that has stopped while powered (e.g. stuck on a root or stone), from cutter current samples.
+*
+* Blade speed is estimated from back-EMF, the same way as Cutter::getRpm(). A blade working hard in thick grass still turns and keeps
+* current below stall current, a jammed blade does not. So it's only a jam when estimated speed stays close to zero for JAM_SAMPLES
+* samples in a row, a single sample showing the blade picking up speed again starts over.
+* At full speed this puts the jam threshold well above the current where the cutter counts as overloaded (CUTTER_LOAD_THRESHOLD),
+* heavy grass is handled by the overload check and never looks like a jam.
+*/
+class CutterJamDetector {
+  public:
+    static const uint8_t JAM_SAMPLES = 15;      // Blade must stay stopped this many samples in a row (30 ms at 500 Hz) to be a jam.
+    static const uint8_t JAM_MIN_SPEED = 20;    // Blade might not overcome friction below this speed (%), so don't look for jams.
+
+    /**
+    * Blade speed (rpm) estimated from cutter current (mA), at a blade speed setting (0-100%).
+    */
+    static float estimateRpm(float current, uint8_t speed);
+    void reset();
+    /**
+    * Should be called for each current sample.
+    * @param current cutter current (mA).
+    * @param speed blade speed setting (0-100%) while sample was taken.
+    * @return true if blade is jammed, stays true until reset.
+    */
+    bool update(float current, uint8_t speed);
+    bool isJammed() const;
+    /**
+    * Current (mA) of sample that made us decide blade was jammed.
+    */
+    float getJamCurrent() const;
+
+  private:
+    uint8_t stoppedSamples = 0;
+    bool jammed = false;
+    float jamCurrent = 0;
+};
+
+#endif
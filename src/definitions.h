@@ -2,14 +2,23 @@
 #define _definitions_h
 
 #include <Arduino.h>
+#include "hardware_profile.h"
 
+// Hardware profile to build for, see hardware_profile.h. Could be selected per build target with a build flag in platformio.ini.
+#ifndef HARDWARE_PROFILE
+#define HARDWARE_PROFILE HardwareProfiles::LIION_4S
+#endif
+
+/*
+  All constants are constexpr, so they are folded at compile time and don't take up any memory.
+*/
 namespace Definitions {
 
   /*
   Constants and other global stuff that you should probably never need to touch.
   */
-  extern const char* const APP_NAME;
-  extern const char* const APP_VERSION;
+  constexpr const char* APP_NAME = "liam-esp";
+  constexpr const char* APP_VERSION = "1.0.0";
 
   enum class MOWER_STATES {
                             DOCKED,     // mower is docked in its charging station and is fully charged
@@ -24,76 +33,173 @@ namespace Definitions {
                             TEST        // mower is in test mode.
                           };
 
-  extern const uint8_t SDA_PIN;
-  extern const uint8_t SCL_PIN;
-
-  extern const uint16_t DIGITAL_EXPANDER_ADDR;
-  extern const uint16_t DIGITAL_EXPANDER_INTERRUPT_PIN;
-
-  extern const uint16_t ADC1_ADDR;
-  extern const uint16_t ADC2_ADDR;
-
-  extern const float LORA_FREQ;
-  extern const uint8_t LORA_DIO0_PIN; // interrupt pin #1 ("RxDone", "TxDone", "CadDone")
-  extern const uint8_t LORA_DIO1_PIN; // interrupt pin #2 ("RxTimeout", "FhssChangeChannel", "CadDetected")
-
-  extern const uint8_t MOTOR_TIMER_13_BIT;
-  extern const uint16_t MOTOR_BASE_FREQ;  
-  extern const uint8_t LEFT_WHEEL_MOTOR_PIN;
-  extern const uint8_t LEFT_WHEEL_MOTOR_DIRECTION_PIN;
-  extern const uint8_t LEFT_WHEEL_MOTOR_LOAD_CHANNEL;
-  extern const uint8_t LEFT_WHEEL_ODOMETER_PIN;
-  extern const uint8_t LEFT_WHEEL_MOTOR_SPEED;
-  extern const bool LEFT_WHEEL_MOTOR_INVERTED;
-  extern const uint8_t RIGHT_WHEEL_MOTOR_PIN;
-  extern const uint8_t RIGHT_WHEEL_MOTOR_DIRECTION_PIN;
-  extern const uint8_t RIGHT_WHEEL_MOTOR_LOAD_CHANNEL;
-  extern const uint8_t RIGHT_WHEEL_ODOMETER_PIN;
-  extern const uint8_t RIGHT_WHEEL_MOTOR_SPEED;
-  extern const bool RIGHT_WHEEL_MOTOR_INVERTED;
-  extern const uint8_t WHEEL_MOTOR_MIN_SPEED;
-  extern const uint8_t WHEEL_MOTOR_TURN_SPEED;
-  extern const bool WHEEL_MOTOR_DECREASE_SPEED_AT_CUTTER_LOAD;  
-  extern const uint8_t LAUNCH_DISTANCE;
-  extern const uint16_t WHEEL_ODOMETERPULSES_PER_ROTATION;
-  extern const uint8_t WHEEL_DIAMETER;
-  extern const uint8_t WHEEL_PAIR_DISTANCE;
-
-  extern const uint8_t CUTTER_MOTOR_PIN;
-  extern const uint8_t CUTTER_BRAKE_PIN;
-  extern const uint8_t CUTTER_LOAD_CHANNEL;
-  extern const float CUTTER_LOAD_RESISTOR;
-  extern const float CUTTER_NOLOAD_CURRENT;
-  extern const float CUTTER_MAX_CURRENT;
-  extern const uint8_t CUTTER_MAX_SPEED;
-  extern const uint16_t CUTTER_LOAD_THRESHOLD;
-
-  extern const uint8_t EMERGENCY_STOP_PIN;
-
-  extern const uint8_t DOCKED_DETECTION_PIN;
-  extern const uint8_t BATTERY_SENSOR_CHANNEL;
-  extern const float BATTERY_FULLY_CHARGED;
-  extern const float BATTERY_EMPTY;
-  extern const float BATTERY_MULTIPLIER;
-  extern const float CHARGE_CURRENT_THRESHOLD;
-  extern const float CHARGE_SHUNT_VALUE;
-
-  extern const uint8_t TILT_ANGLE_MAX;
-
-  extern const uint8_t FACTORY_RESET_PIN;
-
-  extern const uint16_t MAX_LOGMESSAGES;
-
-  extern const uint8_t SONAR_FRONT_PING_PIN;
-  extern const uint8_t SONAR_FRONT_SENSE_PIN;
-  extern const uint16_t SONAR_MAXDISTANCE;
-  extern const uint16_t STUCK_RETRY_DELAY;
-
-  extern const uint8_t MOWER_WIDTH;
-  extern const uint8_t MOWER_LENGTH;
-  extern const uint8_t CUTTER_DIAMETER;
+  constexpr HardwareProfile PROFILE = HARDWARE_PROFILE;
+
+  /*
+    I2C pins
+  */
+  constexpr uint8_t SDA_PIN = PROFILE.pins.sda;
+  constexpr uint8_t SCL_PIN = PROFILE.pins.scl;
+
+  /*
+    I2C address for MCP23017 port expander
+  */
+  constexpr uint16_t DIGITAL_EXPANDER_ADDR = 0x20;
+  constexpr uint16_t DIGITAL_EXPANDER_INTERRUPT_PIN = PROFILE.pins.digitalExpanderInterrupt;
+
+  /*
+    I2C address for Analog to Digital Converters
+  */
+  constexpr uint16_t ADC1_ADDR = 0x48;
+  constexpr uint16_t ADC2_ADDR = 0x49;
+
+  /*
+    I2C address for u-blox GNSS module (default for all u-blox receivers)
+  */
+  constexpr uint16_t GPS_ADDR = 0x42;
+
+  /*
+    Frequency used for LoRa radio module, please select value based upon what LoRa module you are using and your country regulation:
+    https://github.com/jgromes/LoRaLib/wiki/Supported-LoRa-modules
+  */
+  constexpr float LORA_FREQ = 434.0;  // (in Megahertz)
+  /*
+    Max share of time (in percent) we are allowed to transmit on LoRa frequency, check your country regulation.
+    In Europe the 433.05-434.79 MHz band allows 10% duty cycle, while most of the 863-870 MHz band allows 1%.
+  */
+  constexpr float LORA_DUTY_CYCLE = 10.0;
+  /*
+    Max output power (in dBm) for LoRa radio, adaptive data rate will never go above this. Check your country regulation,
+    the 433.05-434.79 MHz band in Europe allows 10 mW (10 dBm) e.r.p.
+  */
+  constexpr int8_t LORA_MAX_POWER = 10;
+  /*
+    LoRa interrupt pins
+  */
+  constexpr uint8_t LORA_DIO0_PIN = PROFILE.pins.loraDio0; // interrupt pin #1 ("RxDone", "TxDone", "CadDone")
+  constexpr uint8_t LORA_DIO1_PIN = PROFILE.pins.loraDio1; // interrupt pin #2 ("RxTimeout", "FhssChangeChannel", "CadDetected")
+
+  /*
+    Generic motor PWM settings
+  */
+  constexpr uint8_t MOTOR_PWM_RESOLUTION = PROFILE.motor.pwmResolution;
+  constexpr uint16_t MOTOR_BASE_FREQ = PROFILE.motor.pwmFrequency;
+  constexpr uint32_t MOTOR_MAX_DUTY = PROFILE.motor.getMaxDuty();   // duty for full speed.
+
+  /*
+    Accelerometer/Gyro/Compass
+  */
+  constexpr uint8_t TILT_ANGLE_MAX = 35;    // Max angle (degrees) the mower is allowed to tilt, going above this value will stop mower and enter FLIPPED-state. This is a safety setting!
+
+  /*
+    Wheel motor settings
+  */
+  constexpr uint8_t LEFT_WHEEL_MOTOR_PIN = PROFILE.pins.leftWheelMotor;
+  constexpr uint8_t LEFT_WHEEL_MOTOR_DIRECTION_PIN = PROFILE.pins.leftWheelMotorDirection;
+  constexpr uint8_t LEFT_WHEEL_MOTOR_LOAD_CHANNEL = 1;  // Channel on ADC for measuring motor load.
+  constexpr uint8_t LEFT_WHEEL_ODOMETER_PIN = PROFILE.pins.leftWheelOdometer;
+  constexpr uint8_t LEFT_WHEEL_MOTOR_SPEED = 100;   // 0-100 (%), used to compensate for drifting motors, lower this value if mower drift to the right.
+  constexpr bool LEFT_WHEEL_MOTOR_INVERTED = false; // Set to "true" if left wheel runs backward when mower should be running forward.
+
+  constexpr uint8_t RIGHT_WHEEL_MOTOR_PIN = PROFILE.pins.rightWheelMotor;
+  constexpr uint8_t RIGHT_WHEEL_MOTOR_DIRECTION_PIN = PROFILE.pins.rightWheelMotorDirection;
+  constexpr uint8_t RIGHT_WHEEL_MOTOR_LOAD_CHANNEL = 2;  // Channel on ADC for measuring motor load.
+  constexpr uint8_t RIGHT_WHEEL_ODOMETER_PIN = PROFILE.pins.rightWheelOdometer;
+  constexpr uint8_t RIGHT_WHEEL_MOTOR_SPEED = 100;   // 0-100 (%), used to compensate for drifting motors, lower this value if mower drift to the left.
+  constexpr bool RIGHT_WHEEL_MOTOR_INVERTED = true;  // Set to "true" if right wheel runs backward when mower should be running forward.
+
+  constexpr float WHEEL_MOTOR_LOAD_RESISTOR = PROFILE.motor.wheelLoadResistor;
+  constexpr float WHEEL_MOTOR_NOLOAD_CURRENT = PROFILE.motor.wheelNoloadCurrent;
+  constexpr float WHEEL_MOTOR_MAX_CURRENT = PROFILE.motor.wheelMaxCurrent;
+
+  constexpr uint8_t WHEEL_MOTOR_MIN_SPEED = 20;    // 0-100 (%), set the minimum speed that the wheel motors should use. This is used in combination with e.g. WHEEL_MOTOR_DECREASE_SPEED_AT_CUTTER_LOAD.
+  constexpr uint8_t WHEEL_MOTOR_TURN_SPEED = 40;   // 0-100 (%), speed to use when turning.
+  constexpr bool WHEEL_MOTOR_DECREASE_SPEED_AT_CUTTER_LOAD = true;  // reduce forward movement of mower when there is a high load on cutter (like high grass)
+  constexpr uint16_t WHEEL_ODOMETERPULSES_PER_ROTATION = PROFILE.geometry.wheelOdometerPulsesPerRotation;
+  constexpr uint8_t WHEEL_DIAMETER = PROFILE.geometry.wheelDiameter;     // in millimeter
+  constexpr uint8_t WHEEL_PAIR_DISTANCE = PROFILE.geometry.wheelPairDistance; // distance measured between the wheel pairs, in centimeters
+  constexpr float WHEEL_PULSES_PER_CENTIMETER = PROFILE.geometry.getPulsesPerCentimeter();
+  constexpr float WHEEL_PULSES_PER_DEGREE = PROFILE.geometry.getPulsesPerDegree();   // turning on the spot.
+  constexpr float WHEEL_METER_PER_PULSE = 1 / (WHEEL_PULSES_PER_CENTIMETER * 100);
+
+  /*
+    Settings for "launching" mower from charging station
+  */
+  constexpr uint8_t LAUNCH_DISTANCE = 100;  // the distance the mower should back out of the charging station before turning around and begin mowing, in centimeters.
+
+  /*
+    Cutter settings
+  */
+  constexpr uint8_t CUTTER_MOTOR_PIN = PROFILE.pins.cutterMotor;      // Pin to PWM-control motor.
+  constexpr uint8_t CUTTER_BRAKE_PIN = PROFILE.pins.cutterBrake;      // Pin for braking cutter motor.
+  constexpr uint8_t CUTTER_LOAD_CHANNEL = 0;   // Channel on ADC for measuring cutter motor load.
+  constexpr float CUTTER_LOAD_RESISTOR = PROFILE.motor.cutterLoadResistor;
+  constexpr float CUTTER_NOLOAD_CURRENT = PROFILE.motor.cutterNoloadCurrent;
+  constexpr float CUTTER_MAX_CURRENT = PROFILE.motor.cutterMaxCurrent;
+  constexpr uint16_t CUTTER_NOLOAD_RPM = PROFILE.motor.cutterNoloadRpm;
+  constexpr uint8_t CUTTER_MAX_SPEED = 100;    // 1-100 (%), lower this value if cutter spinning too fast.
+  constexpr uint8_t CUTTER_MIN_SPEED = 60;     // 1-100 (%), lowest speed blade is slowed down to in sparse grass to save energy. Lower gives a ragged cut, set same as CUTTER_MAX_SPEED to always run at full speed.
+  // When the load on the cutter motor surpasses this limit, the cutter is working too hard cutting the grass (and we should reduce speed of wheels to compensate).
+  constexpr uint16_t CUTTER_LOAD_THRESHOLD = 80;
+
+  /*
+    Battery settings, chemistry is selected by hardware profile.
+  */
+  constexpr float BATTERY_FULLY_CHARGED = PROFILE.battery.fullyCharged;
+  constexpr float BATTERY_EMPTY = PROFILE.battery.empty;
+  constexpr float BATTERY_CAPACITY = PROFILE.battery.capacity;
+  constexpr const float* BATTERY_SOC_CURVE = PROFILE.battery.socCurve;
 
+  constexpr float BATTERY_MULTIPLIER = BATTERY_FULLY_CHARGED / 3.04;   // Battery voltage divided by ADC max value, used to calculate real battery voltage.
+  constexpr uint8_t BATTERY_SENSOR_CHANNEL = 3;    // Channel on ADC for measuring battery voltage.
+  constexpr uint8_t DOCKED_DETECTION_PIN = PROFILE.pins.dockedDetection;
 
+  /*
+    Charger Settings
+  */
+  constexpr float CHARGE_CURRENT_THRESHOLD = 100;    // Current going into the battery that are above this threshold will be interpreted as the battery is charging.
+  constexpr float CHARGE_SHUNT_VALUE = 0.1;          // Value of charge shunt resistor (in Ohm)
+
+  /*
+    Factory reset switch
+    Pulling this pin LOW will wipe Flash-memory from ALL settings and reboot mower.
+  */
+  constexpr uint8_t FACTORY_RESET_PIN = PROFILE.pins.factoryReset;
+
+  // Pull this pin LOW to emergency stop mower, pull HIGH to continue
+  constexpr uint8_t EMERGENCY_STOP_PIN = PROFILE.pins.emergencyStop;
+
+  // How many lines of log messages that are kept, increase to have longer log message history at the expense of higher memory consumption.
+  constexpr uint16_t MAX_LOGMESSAGES = 50;
+
+  // Pin used to send and detect a ultrasonic ping for obstacle detection.
+  // when viewing mower from above (facing the same direction as the mower).
+  constexpr uint8_t SONAR_FRONT_PING_PIN = PROFILE.pins.sonarFrontPing;
+  constexpr uint8_t SONAR_FRONT_SENSE_PIN = PROFILE.pins.sonarFrontSense;
+  // Distance ahead the mower should detect obstacles (in centimeters). Between 5-400cm.
+  constexpr uint16_t SONAR_MAXDISTANCE = 200;
+
+  // If mower is stuck because of a cutter fault, how long (in seconds) should it wait before it tries again? Set "0" for no retries.
+  // Other causes of getting stuck are handled by recovery manoeuvres right away (see StuckRecovery).
+  constexpr uint16_t STUCK_RETRY_DELAY = 20;
+
+  constexpr uint8_t MOWER_WIDTH = PROFILE.geometry.mowerWidth;
+  constexpr uint8_t MOWER_LENGTH = PROFILE.geometry.mowerLength;
+  constexpr uint8_t CUTTER_DIAMETER = PROFILE.geometry.cutterDiameter;
+
+  /*
+    Sanity checks, a bad profile or setting fails the build instead of the mower.
+  */
+  static_assert(MOTOR_PWM_RESOLUTION >= 8 && MOTOR_PWM_RESOLUTION <= 16, "Motor PWM resolution should be 8-16 bits.");
+  static_assert(WHEEL_DIAMETER > 0 && WHEEL_PAIR_DISTANCE > 0 && WHEEL_ODOMETERPULSES_PER_ROTATION > 0, "Wheel geometry is missing.");
+  static_assert(WHEEL_PULSES_PER_CENTIMETER > 0.1 && WHEEL_PULSES_PER_CENTIMETER < 100, "Odometer pulses per centimeter looks wrong, check wheel diameter and pulses per rotation.");
+  static_assert(WHEEL_PULSES_PER_DEGREE > 0.01 && WHEEL_PULSES_PER_DEGREE < 100, "Odometer pulses per degree looks wrong, check wheel pair distance.");
+  static_assert(BATTERY_EMPTY > 0 && BATTERY_EMPTY < BATTERY_FULLY_CHARGED, "Battery empty voltage should be below fully charged voltage.");
+  static_assert(BATTERY_CAPACITY > 0, "Battery capacity is missing.");
+  static_assert(PROFILE.battery.isSocCurveValid(), "Battery SoC curve should go from 0 to 1 and always increase.");
+  static_assert(CUTTER_MIN_SPEED > 0 && CUTTER_MIN_SPEED <= CUTTER_MAX_SPEED && CUTTER_MAX_SPEED <= 100, "Cutter speeds should be 1-100 and min not above max.");
+  static_assert(WHEEL_MOTOR_MIN_SPEED <= WHEEL_MOTOR_TURN_SPEED && WHEEL_MOTOR_TURN_SPEED <= 100, "Wheel speeds should be 0-100 and min not above turn speed.");
+  static_assert(CUTTER_NOLOAD_CURRENT < CUTTER_MAX_CURRENT && WHEEL_MOTOR_NOLOAD_CURRENT < WHEEL_MOTOR_MAX_CURRENT, "No-load current should be below max current.");
 };
 
 #endif
@@ -0,0 +1,155 @@
+#include "adaptive_data_rate.h"
+
+static const float LINK_MARGIN = 6.0;   // SNR (dB) we want above what the demodulator needs, to handle fading when mower moves around or turns.
+static const float HYSTERESIS = 3.0;    // Additional margin (dB) needed before we step to a faster data rate.
+
+// fastest first. SF6 is left out since it requires implicit header mode.
+const AdaptiveDataRate::dataRate AdaptiveDataRate::DATA_RATES[] = {
+  { 7, 250 },
+  { 7, 125 },
+  { 8, 125 },
+  { 9, 125 },
+  { 10, 125 },
+  { 11, 125 },
+  { 12, 125 }
+};
+const uint8_t AdaptiveDataRate::DATA_RATE_COUNT = sizeof(DATA_RATES) / sizeof(DATA_RATES[0]);
+
+AdaptiveDataRate::AdaptiveDataRate(int8_t minPower, int8_t maxPower, uint8_t codingRate, uint16_t preambleLength) :
+  minPower(minPower),
+  maxPower(maxPower),
+  codingRate(codingRate),
+  preambleLength(preambleLength) { }
+
+void AdaptiveDataRate::addSample(float snr) {
+  samples[sampleIndex] = snr;
+  sampleIndex = (sampleIndex + 1) % HISTORY_SIZE;
+
+  if (sampleCount < HISTORY_SIZE) {
+    sampleCount++;
+  }
+}
+
+void AdaptiveDataRate::reset() {
+  sampleCount = 0;
+  sampleIndex = 0;
+}
+
+float AdaptiveDataRate::getWorstSNR() const {
+  if (sampleCount == 0) {
+    return 0;
+  }
+
+  float worst = samples[0];
+  for (uint8_t i = 1; i < sampleCount; i++) {
+    worst = min(worst, samples[i]);
+  }
+
+  return worst;
+}
+
+float AdaptiveDataRate::getRequiredSNR(uint8_t spreadingFactor) {
+  // -7.5 dB for SF7, 2.5 dB lower for each step up to -20 dB for SF12.
+  return -7.5f - 2.5f * (spreadingFactor - 7);
+}
+
+RadioSettings AdaptiveDataRate::getFallbackSettings() const {
+  auto& rate = DATA_RATES[DATA_RATE_COUNT - 1];
+  RadioSettings settings = { rate.bandwidth, rate.spreadingFactor, codingRate, maxPower, preambleLength };
+
+  return settings;
+}
+
+bool AdaptiveDataRate::evaluate(const RadioSettings& current, RadioSettings& next) const {
+  if (sampleCount == 0) {
+    return false;
+  }
+
+  auto snr = getWorstSNR();
+  auto currentRate = findDataRate(current);
+  // settings not from our table, treat it as the slowest one so that we will work our way up.
+  if (currentRate < 0) {
+    currentRate = DATA_RATE_COUNT - 1;
+  }
+
+  // find fastest data rate that still has enough margin using max power.
+  int8_t targetRate = DATA_RATE_COUNT - 1;
+  for (uint8_t i = 0; i < DATA_RATE_COUNT; i++) {
+    float extraMargin = i < currentRate ? HYSTERESIS : 0;
+    if (getMargin(snr, current, i, maxPower) >= extraMargin) {
+      targetRate = i;
+      break;
+    }
+  }
+
+  int8_t targetPower;
+
+  if (targetRate < currentRate) {
+    // link is getting better, take it one step at a time.
+    targetRate = currentRate - 1;
+    targetPower = getLowestPower(snr, current, targetRate, HYSTERESIS);
+  } else {
+    // same or slower data rate, slower data rates and more output power are selected right away since we are about to lose the link.
+    targetPower = getLowestPower(snr, current, targetRate, 0);
+
+    if (targetRate == currentRate && targetPower <= current.power) {
+      // lower output power gently, and only with some extra margin.
+      targetPower = getLowestPower(snr, current, targetRate, HYSTERESIS);
+      targetPower = constrain(targetPower, current.power - POWER_STEP, current.power);
+    }
+  }
+
+  auto& rate = DATA_RATES[targetRate];
+
+  if (targetRate == currentRate && targetPower == current.power && current.codingRate == codingRate) {
+    return false;
+  }
+
+  // a few bad measurements is enough to make the link more robust, but we want a full history before we make it faster or weaker.
+  bool moreRobust = targetRate > currentRate || (targetRate == currentRate && targetPower > current.power);
+  if (sampleCount < HISTORY_SIZE && !moreRobust) {
+    return false;
+  }
+
+  next = current;
+  next.spreadingFactor = rate.spreadingFactor;
+  next.bandwidth = rate.bandwidth;
+  next.codingRate = codingRate;
+  next.power = targetPower;
+
+  return true;
+}
+
+int8_t AdaptiveDataRate::findDataRate(const RadioSettings& settings) const {
+  for (uint8_t i = 0; i < DATA_RATE_COUNT; i++) {
+    if (DATA_RATES[i].spreadingFactor == settings.spreadingFactor && DATA_RATES[i].bandwidth == settings.bandwidth) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+/**
+ * Estimate the SNR margin (dB) we would get if using another data rate and output power, based on SNR measured with current settings.
+ * Noise power is proportional to bandwidth, so halving the bandwidth gives 3 dB better SNR. Output power adds straight to SNR.
+ */
+float AdaptiveDataRate::getMargin(float snr, const RadioSettings& current, uint8_t dataRate, int8_t power) const {
+  auto& rate = DATA_RATES[dataRate];
+  float predicted = snr + 10 * log10f(current.bandwidth / rate.bandwidth) + (power - current.power);
+
+  return predicted - getRequiredSNR(rate.spreadingFactor) - LINK_MARGIN;
+}
+
+/**
+ * Lowest output power that gives us enough margin at the specified data rate, or max power if none does.
+ */
+int8_t AdaptiveDataRate::getLowestPower(float snr, const RadioSettings& current, uint8_t dataRate, float extraMargin) const {
+  for (int8_t power = minPower; power < maxPower; power += POWER_STEP) {
+    if (getMargin(snr, current, dataRate, power) >= extraMargin) {
+      return power;
+    }
+  }
+
+  return maxPower;
+}
@@ -0,0 +1,79 @@
+#ifndef _adaptive_data_rate_h
+#define _adaptive_data_rate_h
+
+#include <Arduino.h>
+#include "radio.h"
+
+/**
+* Chooses LoRa modulation settings from measured link quality (SNR), similar to the adaptive data rate used by LoRaWAN.
+* When the mower is close to the docking station we can use a fast data rate with low output power (less airtime, so more room within the duty cycle),
+* while far away we have to trade speed for range.
+*
+* Settings are picked from a table of data rates, fastest first. The fastest data rate that would still have LINK_MARGIN dB of SNR
+* above what the demodulator needs is selected, then output power is lowered as long as the margin holds.
+* To avoid flapping between settings, we only step one data rate faster at a time and require some extra margin (HYSTERESIS) to do so,
+* while a worsening link immediately drops to whatever data rate it can handle, without waiting for a full history of measurements.
+*/
+class AdaptiveDataRate {
+  public:
+    /**
+    * @param minPower lowest output power (dBm) to use.
+    * @param maxPower highest output power (dBm) to use, see your local regulations.
+    * @param codingRate coding rate (denominator, 5-8) to use for all data rates.
+    * @param preambleLength preamble length (symbols) to use for all data rates.
+    */
+    AdaptiveDataRate(int8_t minPower, int8_t maxPower, uint8_t codingRate = 5, uint16_t preambleLength = 8);
+    /**
+    * Add a SNR measurement (dB), taken with the settings currently in use.
+    */
+    void addSample(float snr);
+    /**
+    * Forget all measurements, should be called when settings has been changed since old measurements no longer applies.
+    */
+    void reset();
+    /**
+    * Check if other settings would suit the current link better.
+    * @param current settings currently in use.
+    * @param next settings to switch to, only set if true is returned.
+    * @return true if we should switch to other settings.
+    */
+    bool evaluate(const RadioSettings& current, RadioSettings& next) const;
+    /**
+    * The most robust settings (slowest data rate and highest output power), used at startup and when we have lost contact with peer.
+    * Both ends of the link must agree on these.
+    */
+    RadioSettings getFallbackSettings() const;
+    /**
+    * Returns lowest SNR (dB) of recent measurements, or 0 if we don't have any measurements yet.
+    */
+    float getWorstSNR() const;
+    /**
+    * Minimum SNR (dB) required by the demodulator for the specified spreading factor (from the SX1276/77/78/79 datasheet).
+    */
+    static float getRequiredSNR(uint8_t spreadingFactor);
+
+  private:
+    static const uint8_t HISTORY_SIZE = 8;  // Number of measurements to base decisions on, we use the worst one of these.
+    static const uint8_t POWER_STEP = 2;    // Output power is adjusted in steps of this size (dB).
+
+    struct dataRate {
+      uint8_t spreadingFactor;
+      float bandwidth;  // in kHz
+    };
+    static const dataRate DATA_RATES[];
+    static const uint8_t DATA_RATE_COUNT;
+
+    int8_t minPower;
+    int8_t maxPower;
+    uint8_t codingRate;
+    uint16_t preambleLength;
+    float samples[HISTORY_SIZE];
+    uint8_t sampleCount = 0;
+    uint8_t sampleIndex = 0;
+
+    int8_t findDataRate(const RadioSettings& settings) const;
+    float getMargin(float snr, const RadioSettings& current, uint8_t dataRate, int8_t power) const;
+    int8_t getLowestPower(float snr, const RadioSettings& current, uint8_t dataRate, float extraMargin) const;
+};
+
+#endif
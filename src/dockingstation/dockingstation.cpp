@@ -1,9 +1,9 @@
 #include <ArduinoLog.h>
-#include <pb_encode.h>
-#include <pb_decode.h>
+#include <SPIFFS.h>
 #include "dockingstation.h"
 #include "esp_log.h"
 #include "definitions.h"
+#include "configuration.h"
 #include "utils.h"
 #include "io_accelerometer/io_accelerometer.h"
 
@@ -12,123 +12,286 @@
 /**
 * Class used for all communication with the docking station, over a low bandwidth, long range LoRa-connection.
 */
-Dockingstation::Dockingstation(StateController& stateController, Resources& resources) :
+Dockingstation::Dockingstation(StateController& stateController, Resources& resources, StatusSnapshot& statusSnapshot, SemaphoreHandle_t i2cLock) :
   stateController(stateController),
-  resources(resources), lora(new LoRa(SS, Definitions::LORA_DIO0_PIN, Definitions::LORA_DIO1_PIN)) {
-  
+  resources(resources),
+  statusSnapshot(statusSnapshot),
+  // use the last two bytes of our MAC-address as link address, the first bytes are the same for all ESP32s.
+  link(radio, (uint16_t)(ESP.getEfuseMac() >> 32), DOCKINGSTATION_ADDRESS, Definitions::LORA_DUTY_CYCLE),
+  adaptiveDataRate(LORA_MIN_POWER, Definitions::LORA_MAX_POWER),
+  tdmaSchedule((uint16_t)(ESP.getEfuseMac() >> 32)),
+  rtcmInjector(Definitions::GPS_ADDR, i2cLock),
+  telemetryRing(SPIFFS, "/telemetry.bin", telemetryRecord::SIZE, TELEMETRY_CAPACITY),
+  // one batch per link frame, so that a lost frame only costs us a small retransmission.
+  telemetryBacklog(telemetryRing, LoraLink::MAX_PAYLOAD_SIZE - 1, [this](const uint8_t* data, size_t length, const TelemetryBacklog::DeliveredCallback& fn) {
+    uint8_t message[LoraLink::MAX_PAYLOAD_SIZE];
+    message[0] = static_cast<uint8_t>(LINK_MESSAGE::TELEMETRY);
+    memcpy(message + 1, data, length);
+
+    return link.send(message, length + 1, LINK_PRIORITY::BULK, fn);
+  }) {
+
+  link.onReceive([this](const uint8_t* data, size_t length, uint16_t source, LINK_PRIORITY priority) {
+    onMessage(data, length);
+  });
+
+  // other mowers may share the docking station, only transmit in our own time slot.
+  link.setTransmitGate([this](uint32_t duration, bool control, bool reply) {
+    return tdmaSchedule.canTransmit(millis(), duration, control, reply);
+  });
+}
+
+/**
+ * Push status to the docking station, if information has changed.
+ */
+void Dockingstation::pushNewStatus() {
+  // encode straight into the message buffer after the message type, only fields that have changed are included. Nothing to send if nothing has changed.
+  txBuffer[0] = static_cast<uint8_t>(LINK_MESSAGE::STATUS);
+  auto length = statusEncoder.encode(statusSnapshot.getStatus(), txBuffer + 1, sizeof(txBuffer) - 1, millis());
+
+  if (length > 0 && !link.send(txBuffer, length + 1, LINK_PRIORITY::BULK)) {
+    // docking station will miss fields, make sure it gets everything next time.
+    statusEncoder.requestKeyframe();
   }
+}
 
 /**
- * Collect status information from subsystems and push it to clients, if information has changed.
+ * Store telemetry record in flash while we can't reach the docking station, it will be uploaded once we are back in contact.
  */
-void Dockingstation::collectAndPushNewStatus() {
-  /*bool statusChanged = false;
-
-  auto orient = resources.accelerometer.getOrientation();
-  auto wheelStats = resources.wheelController.getStatus();
-  auto obstacleDistances = resources.sonar.getObstacleDistances();
-
-  currentStatus.state = stateController.getStateInstance()->getStateName();
-  currentStatus.batteryVoltage = resources.battery.getBatteryVoltage();
-  currentStatus.batteryLevel = resources.battery.getBatteryStatus();
-  currentStatus.batteryChargeCurrent = resources.battery.getChargeCurrent();
-  currentStatus.isCharging = resources.battery.isCharging();
-  currentStatus.lastFullyChargeTime = resources.battery.getLastFullyChargeTime();
-  currentStatus.lastChargeDuration = resources.battery.getLastChargeDuration();
-  currentStatus.cutterLoad = resources.cutter.getLoad();
-  currentStatus.cutterRotating = resources.cutter.isCutting();
-  currentStatus.leftWheelSpd = wheelStats.leftWheelSpeed;
-  currentStatus.rightWheelSpd = wheelStats.rightWheelSpeed;
-  currentStatus.obstacleLeftDistance = obstacleDistances.leftDistance;
-  currentStatus.obstacleFrontDistance = obstacleDistances.frontDistance;
-  currentStatus.obstacleRightDistance = obstacleDistances.rightDistance;
-  currentStatus.pitch = orient.pitch;
-  currentStatus.roll = orient.roll;
-  currentStatus.heading = orient.heading;	
-
-  if (currentStatus.state != stateController.getStateInstance()->getStateName() ||
-      currentStatus.batteryVoltage != resources.battery.getBatteryVoltage() ||
-      currentStatus.batteryLevel != resources.battery.getBatteryStatus() ||
-      currentStatus.batteryChargeCurrent != resources.battery.getChargeCurrent() ||
-      currentStatus.isCharging != resources.battery.isCharging() ||
-      currentStatus.lastFullyChargeTime != resources.battery.getLastFullyChargeTime() ||
-      currentStatus.lastChargeDuration != resources.battery.getLastChargeDuration() ||
-      currentStatus.cutterLoad != resources.cutter.getLoad() ||
-      currentStatus.cutterRotating != resources.cutter.isCutting() ||
-      currentStatus.leftWheelSpd != wheelStats.leftWheelSpeed ||
-      currentStatus.rightWheelSpd != wheelStats.rightWheelSpeed ||
-      currentStatus.obstacleLeftDistance != obstacleDistances.leftDistance ||
-      currentStatus.obstacleFrontDistance != obstacleDistances.frontDistance ||
-      currentStatus.obstacleRightDistance != obstacleDistances.rightDistance ||
-      currentStatus.pitch != orient.pitch ||
-      currentStatus.roll != orient.roll ||
-      currentStatus.heading != orient.heading
-    ) {
-    statusChanged = true;
-  }
-
-  // we have to check that we are connected before we try to get WiFi signal, otherwise it will freeze up.
-  if (WiFi.status() == WL_CONNECTED) {
-    auto wifiSignal = WiFi.RSSI();
-    
-    if (currentStatus.wifiSignal != wifiSignal) {
-      currentStatus.wifiSignal = wifiSignal;
-      statusChanged = true;
+void Dockingstation::storeTelemetry() {
+  auto& status = statusSnapshot.getStatus();
+  telemetryRecord record;
+
+  if (Utils::isTimeAvailable) {
+    record.time = time(nullptr);
+  } else {
+    record.time = status.uptime;
+    record.flags |= telemetryRecord::FLAG_UPTIME;
+  }
+
+  record.batteryVoltage = status.batteryVoltage * 1000;
+  record.chargeCurrent = status.batteryChargeCurrent;
+  record.heading = status.heading;
+  record.pitch = status.pitch;
+  record.roll = status.roll;
+  record.cutterLoad = status.cutterLoad;
+  record.batteryLevel = status.batteryLevel;
+  record.state = status.state;
+
+  if (status.isCharging) {
+    record.flags |= telemetryRecord::FLAG_CHARGING;
+  }
+  if (status.cutterRotating) {
+    record.flags |= telemetryRecord::FLAG_CUTTING;
+  }
+
+  telemetryBacklog.store(record);
+}
+
+/**
+ * Handle message received from docking station.
+ */
+void Dockingstation::onMessage(const uint8_t* data, size_t length) {
+  if (length == 0) {
+    return;
+  }
+
+  switch (static_cast<LINK_MESSAGE>(data[0])) {
+    case LINK_MESSAGE::SET_STATE: {
+      // state name is not null terminated.
+      String state;
+      state.reserve(length - 1);
+      for (size_t i = 1; i < length; i++) {
+        state += (char)data[i];
+      }
+      stateController.setUserChangableState(state);
+      break;
     }
+    case LINK_MESSAGE::EMERGENCY_STOP:
+      stateController.setState(Definitions::MOWER_STATES::STOP);
+      break;
+    case LINK_MESSAGE::BEACON: {
+      // beacon was sent at the start of the superframe, we got it after its time on air.
+      auto airtime = Radio::getAirtime(radio.getSettings(), LoraLink::HEADER_SIZE + length) / 1000;
+      tdmaSchedule.onBeacon(data + 1, length - 1, millis() - airtime);
+      break;
+    }
+    case LINK_MESSAGE::SIGN_ON_RESP:
+      tdmaSchedule.onSignOnResponse(data + 1, length - 1);
+      break;
+    case LINK_MESSAGE::RTCM:
+      rtcmInjector.inject(data + 1, length - 1);
+      break;
+    default:
+      Log.notice(F("Unknown message type %d from docking station" CR), data[0]);
+      break;
+  }
+}
+
+/**
+ * Ask docking station for a TDMA slot, the request will wait for the contention slot.
+ */
+void Dockingstation::signOn() {
+  if (signOnPending || !tdmaSchedule.needsSignOn(millis())) {
+    return;
   }
-  
-  // These change so often that we don't set statusChanged for these, otherwise we would push everytime.
-  currentStatus.uptime = (uint32_t)(esp_timer_get_time() / 1000000); // uptime in microseconds so we divide to seconds.
 
-  if (statusChanged) {
-    DynamicJsonBuffer jsonBuffer(380);
-    JsonObject& root = jsonBuffer.createObject();
-    statusToJson(currentStatus, root);
+  txBuffer[0] = static_cast<uint8_t>(LINK_MESSAGE::SIGN_ON);
+  auto length = tdmaSchedule.encodeSignOn(txBuffer + 1, sizeof(txBuffer) - 1, Configuration::config.mowerId.c_str(), Definitions::APP_VERSION);
 
-    resources.wlan.sendDataWebSocket("status", root);
+  if (length > 0) {
+    signOnPending = link.send(txBuffer, length + 1, LINK_PRIORITY::CONTROL, [this](bool success) {
+      signOnPending = false;
+    });
+  }
+}
 
-    // MQTT updates don't have to be "realtime", we can settle with an update every 10 sec to not spam server.
-    if (lastMQTT_push < currentStatus.uptime - 10) {
-      String jsonStr;
-      root.printTo(jsonStr);
-      resources.wlan.publish_mqtt(jsonStr.c_str(), "/status");
-      lastMQTT_push = currentStatus.uptime;
+/**
+ * Pick radio settings based upon how well we and the docking station hear each other.
+ * The mower decides and tells the docking station, both ends fall back to the most robust settings if they lose contact.
+ * While we follow a TDMA schedule all mowers must hear the beacons, so then the docking station decides data rate for everyone.
+ */
+void Dockingstation::adaptDataRate() {
+  auto fallback = adaptiveDataRate.getFallbackSettings();
+  auto& current = radio.getSettings();
+  RadioSettings next;
+
+  if (tdmaSchedule.isSynchronized(millis())) {
+    if (tdmaSchedule.getNextSettings(millis(), next) &&
+        (current.spreadingFactor != next.spreadingFactor || current.bandwidth != next.bandwidth || current.codingRate != next.codingRate || current.power != next.power)) {
+      next.preambleLength = current.preambleLength;
+      changeRadioSettings(next);
+    }
+    return;
+  }
+
+  if (!link.isConnected()) {
+    // docking station will also fall back when it stops hearing from us, so we meet again.
+    if (current.spreadingFactor != fallback.spreadingFactor || current.bandwidth != fallback.bandwidth || current.power != fallback.power) {
+      Log.notice(F("Lost LoRa link, falling back to SF%d" CR), fallback.spreadingFactor);
+      changeRadioSettings(fallback);
+    }
+    return;
+  }
+
+  auto& quality = link.getQuality();
+
+  if (quality.reports != lastQualityReports) {
+    lastQualityReports = quality.reports;
+    // the link is no better than its weakest direction.
+    adaptiveDataRate.addSample(min(quality.snr, quality.peerSnr));
+  }
+
+  if (radioSettingsPending || !adaptiveDataRate.evaluate(current, next)) {
+    return;
+  }
+
+  uint16_t bandwidth = roundf(next.bandwidth * 10);
+  uint8_t message[] = {
+    static_cast<uint8_t>(LINK_MESSAGE::RADIO_SETTINGS),
+    next.spreadingFactor,
+    (uint8_t)bandwidth,
+    (uint8_t)(bandwidth >> 8),
+    next.codingRate,
+    (uint8_t)next.power
+  };
+
+  radioSettingsPending = link.send(message, sizeof(message), LINK_PRIORITY::CONTROL, [this, next](bool success) {
+    radioSettingsPending = false;
+
+    // docking station switches as soon as it has acknowledged, if the acknowledgement was lost we will find each other again using the fallback settings.
+    if (success) {
+      changeRadioSettings(next);
     }
-  }*/
+  });
+}
+
+void Dockingstation::changeRadioSettings(const RadioSettings& settings) {
+  if (radio.applySettings(settings)) {
+    Log.trace(F("LoRa settings changed to SF%d, %d kHz, %d dBm (worst SNR %F dB)" CR), settings.spreadingFactor, (int)settings.bandwidth, settings.power, adaptiveDataRate.getWorstSNR());
+  }
+  // measurements taken with old settings don't apply anymore.
+  adaptiveDataRate.reset();
+}
+
+void Dockingstation::logStatistics() {
+  auto& stats = link.getStatistics();
+  auto bulkDelivered = stats.messagesDelivered[static_cast<uint8_t>(LINK_PRIORITY::BULK)];
+  auto controlDelivered = stats.messagesDelivered[static_cast<uint8_t>(LINK_PRIORITY::CONTROL)];
+
+  Log.trace(F("LoRa link: %s, %l frames sent, %l resent, airtime %l ms, %l/%l control/bulk messages delivered (avg %l/%l ms)" CR),
+            link.isConnected() ? "connected" : "disconnected",
+            stats.framesSent,
+            stats.framesRetransmitted,
+            stats.airtime,
+            controlDelivered,
+            bulkDelivered,
+            controlDelivered > 0 ? stats.messageLatency[static_cast<uint8_t>(LINK_PRIORITY::CONTROL)] / controlDelivered : 0,
+            bulkDelivered > 0 ? stats.messageLatency[static_cast<uint8_t>(LINK_PRIORITY::BULK)] / bulkDelivered : 0);
+  Log.trace(F("LoRa quality: SNR %F/%F dB, RSSI %F/%F dBm (mower/docking station)" CR), link.getQuality().snr, link.getQuality().peerSnr, link.getQuality().rssi, link.getQuality().peerRssi);
+  auto& rtcmStats = rtcmInjector.getStatistics();
+  if (rtcmStats.framesReceived > 0) {
+    Log.trace(F("RTCM corrections: age %l ms, %l B/s, %l frames injected, %l dropped, %l invalid, %l I2C errors" CR),
+              rtcmInjector.getCorrectionAge(),
+              rtcmInjector.getThroughput(),
+              rtcmStats.framesInjected,
+              rtcmStats.framesDropped,
+              rtcmStats.framesInvalid,
+              rtcmStats.writeErrors);
+  }
+  Log.trace(F("Status frames: %l bytes sent, %l bytes if sending full frames." CR), statusEncoder.getEncodedBytes(), statusEncoder.getFullFrameBytes());
+  auto& backlogStats = telemetryBacklog.getStatistics();
+  if (backlogStats.recordsStored > 0) {
+    Log.trace(F("Telemetry backlog: %l records waiting, %l uploaded (%l bytes, %l uncompressed)" CR), telemetryBacklog.getPending(), backlogStats.recordsUploaded, backlogStats.bytesSent, backlogStats.rawBytes);
+  }
 }
 
 void Dockingstation::start() {
-  // carrier frequency:           <Definitions::LORA_FREQ> MHz
-  // bandwidth:                   250.0 kHz
-  // spreading factor:            7
-  // coding rate:                 4
-  // sync word:                   0x12
-  // output power:                2 dBm
-  // current limit:               50 mA
-  // preamble length:             8 symbols
-  // amplifier gain:              1 (maximum gain)
-  int state = lora.begin(Definitions::LORA_FREQ, 250, 7, 4, 0x12, 2, 50, 8, 1);
-  if (state == ERR_NONE) {
+  // start with the most robust settings (SF12, 125 kHz, max power), that's what the docking station listens on until we have agreed on something faster.
+  if (radio.begin(adaptiveDataRate.getFallbackSettings())) {
     Log.notice(F("LoRa success!" CR));
-  } else {
-    Log.notice(F("LoRa failed, code %d" CR), state);
   }
 
+  // don't format on failure, the file system also holds the web interface.
+  if (!SPIFFS.begin() || !telemetryRing.begin()) {
+    Log.warning(F("Could not open telemetry backlog, telemetry will be lost when docking station is out of reach." CR));
+  }
+}
+
+void Dockingstation::process() {
+  link.process();
+  rtcmInjector.process();
+
+  // status frames dropped by the link will leave the docking station with stale fields, send everything next time.
+  auto failed = link.getStatistics().messagesFailed[static_cast<uint8_t>(LINK_PRIORITY::BULK)];
+  if (failed != lastFailedMessages) {
+    lastFailedMessages = failed;
+    statusEncoder.requestKeyframe();
+  }
 
-  // start scanning current channel
-  int scanresult = lora.scanChannel();
+  adaptDataRate();
+  signOn();
 
-  if(scanresult == PREAMBLE_DETECTED) {
-    // LoRa preamble was detected
-    Log.notice(F(" detected preamble!" CR));
+  if (millis() - lastStatusPush >= STATUS_PUSH_INTERVAL) {
+    lastStatusPush = millis();
+    pushNewStatus();
+  }
 
-  } else if(scanresult == CHANNEL_FREE) {
-    // no preamble was detected, channel is free
-    Log.notice(F(" channel is free!" CR));
+  if (millis() - lastTelemetryRecord >= TELEMETRY_INTERVAL) {
+    lastTelemetryRecord = millis();
 
+    if (!link.isConnected()) {
+      storeTelemetry();
+    }
   }
 
-//https://github.com/sandeepmistry/arduino-LoRa/blob/master/examples/LoRaDuplex/LoRaDuplex.ino
-//https://github.com/sandeepmistry/arduino-LoRa/blob/master/examples/LoRaDuplexCallback/LoRaDuplexCallback.ino
+  // backlog only goes out when the link has nothing else to do.
+  auto linkIdle = link.isConnected() && link.getQueueLength(LINK_PRIORITY::CONTROL) == 0 && link.getQueueLength(LINK_PRIORITY::BULK) == 0;
+  telemetryBacklog.process(millis(), linkIdle);
+
+  if (millis() - lastStatisticsTime >= STATISTICS_INTERVAL) {
+    lastStatisticsTime = millis();
+    logStatistics();
+  }
 }
 
@@ -2,22 +2,78 @@
 #define _liam_dockingstation_h
 
 #include <Arduino.h>
-#include <Ticker.h>
-#include <LoRaLib.h>
 #include "state_controller.h"
 #include "resources.h"
+#include "processable.h"
+#include "sx1278_radio.h"
+#include "lora_link.h"
+#include "adaptive_data_rate.h"
+#include "tdma_schedule.h"
+#include "rtcm.h"
+#include "status_encoder.h"
+#include "status_snapshot.h"
+#include "flash_ring.h"
+#include "telemetry_backlog.h"
 
-class Dockingstation {
+/**
+* Type of message sent over the LoRa link, always the first byte of a message.
+*/
+enum class LINK_MESSAGE : uint8_t {
+  STATUS = 1,         // mower -> docking station, delta encoded status frame (see status.proto).
+  SET_STATE = 2,      // docking station -> mower, followed by name of state to change to.
+  EMERGENCY_STOP = 3, // docking station -> mower
+  RADIO_SETTINGS = 4, // mower -> docking station, followed by spreading factor, bandwidth (uint16, in 100 Hz), coding rate and output power (int8). Both ends switch once the message has been acknowledged.
+  BEACON = 5,         // docking station -> all, broadcasted at start of each TDMA superframe (see tdma_schedule.h).
+  SIGN_ON = 6,        // mower -> docking station, followed by SignOn message (see sign_on.proto).
+  SIGN_ON_RESP = 7,   // docking station -> mower, followed by SignOnResp message (see sign_on_resp.proto).
+  RTCM = 8,          // docking station -> mower, followed by one or more complete RTCM 3 frames with GNSS corrections (see rtcm.h).
+  TELEMETRY = 9       // mower -> docking station, followed by a batch of telemetry records stored while the link was down (see telemetry_backlog.h).
+};
+
+class Dockingstation : public Processable {
   public:
-    Dockingstation(StateController& stateController, Resources& resources);
+    /**
+    * @param i2cLock mutex shared by everyone using the I2C bus, corrections are written to the GNSS module over it.
+    */
+    Dockingstation(StateController& stateController, Resources& resources, StatusSnapshot& statusSnapshot, SemaphoreHandle_t i2cLock);
     void start();
+    /* Internal use only! */
+    void process();
 
   private:
+    static const uint16_t DOCKINGSTATION_ADDRESS = 0x0000;  // Link address of docking station.
+    static const uint16_t STATUS_PUSH_INTERVAL = 1000;      // How often we check for status changes to push to docking station (in milliseconds).
+    static const uint32_t STATISTICS_INTERVAL = 60000;      // How often we log link statistics (in milliseconds).
+    static const int8_t LORA_MIN_POWER = 2;                 // Lowest output power (dBm) supported by SX1278 on PA_BOOST pin.
+    static const uint16_t TELEMETRY_INTERVAL = 10000;       // How often we store a telemetry record while link is down (in milliseconds).
+    static const uint16_t TELEMETRY_CAPACITY = 2048;        // Max number of records kept in flash, about 5.5 hours worth.
+
     StateController& stateController;
     Resources& resources;
-    Ticker pushNewInfoTicker;
-    SX1278 lora;
-    void collectAndPushNewStatus();
+    StatusSnapshot& statusSnapshot;
+    SX1278Radio radio;
+    LoraLink link;
+    StatusEncoder statusEncoder;
+    AdaptiveDataRate adaptiveDataRate;
+    uint32_t lastQualityReports = 0;
+    bool radioSettingsPending = false;
+    TdmaSchedule tdmaSchedule;
+    bool signOnPending = false;
+    RtcmInjector rtcmInjector;
+    FlashRing telemetryRing;
+    TelemetryBacklog telemetryBacklog;
+    uint32_t lastTelemetryRecord = 0;
+    uint8_t txBuffer[LoraLink::MAX_PAYLOAD_SIZE];
+    uint32_t lastStatusPush = 0;
+    uint32_t lastStatisticsTime = 0;
+    uint32_t lastFailedMessages = 0;
+    void pushNewStatus();
+    void onMessage(const uint8_t* data, size_t length);
+    void logStatistics();
+    void adaptDataRate();
+    void changeRadioSettings(const RadioSettings& settings);
+    void signOn();
+    void storeTelemetry();
 };
 
 #endif
@@ -0,0 +1,563 @@
+#include <ArduinoLog.h>
+#include "lora_link.h"
+
+static const uint8_t FLAG_TYPE_MASK = 0xC0;
+static const uint8_t FLAG_TYPE_DATA = 0x00;
+static const uint8_t FLAG_TYPE_ACK = 0x40;
+static const uint8_t FLAG_CONTROL = 0x20;   // frame belongs to a control message.
+static const uint8_t FLAG_MORE = 0x10;      // sender has more frames to send right after this one, wait with acknowledgement.
+
+static const uint8_t ACK_PAYLOAD_SIZE = 7;  // latest sequence number, a bitmap of the 32 latest sequence numbers (uint32), SNR (0.25 dB steps) and RSSI (negated dBm) of the latest frame.
+static const uint8_t ACK_DELAY = 10;        // give peer time (ms) to switch to receive before we acknowledge.
+
+LoraLink::LoraLink(Radio& radio, uint16_t localAddress, uint16_t peerAddress, float dutyCycle) :
+  radio(radio),
+  localAddress(localAddress),
+  peerAddress(peerAddress),
+  dutyCycle(dutyCycle) {
+
+  // start at a random sequence number, so that the peer don't mistake our frames for duplicates if we have restarted.
+  nextSequence = random(256);
+  airtimeBudget = getAirtimeBudgetMax();
+}
+
+bool LoraLink::send(const uint8_t* data, size_t length, LINK_PRIORITY priority, const DeliveredCallback& fn) {
+  if (length > MAX_MESSAGE_SIZE) {
+    Log.warning(F("Message too large for LoRa link (%d bytes)" CR), length);
+    return false;
+  }
+
+  auto& queue = queues[static_cast<uint8_t>(priority)];
+
+  if (queue.size() >= MAX_QUEUE_LENGTH) {
+    if (priority == LINK_PRIORITY::CONTROL) {
+      return false;
+    }
+    // bulk data is usually telemetry, newer is better than older.
+    auto dropped = queue.front().delivered;
+    queue.pop_front();
+    statistics.messagesFailed[static_cast<uint8_t>(priority)]++;
+
+    if (dropped != nullptr) {
+      dropped(false);
+    }
+  }
+
+  queue.emplace_back();
+  auto& message = queue.back();
+  message.id = nextMessageId++;
+  message.priority = priority;
+  message.queuedTime = millis();
+  message.data.assign(data, data + length);
+  message.fragmentCount = length == 0 ? 1 : (length + MAX_PAYLOAD_SIZE - 1) / MAX_PAYLOAD_SIZE;
+  message.nextFragment = 0;
+  message.pendingFragments = message.fragmentCount;
+  message.delivered = fn;
+
+  return true;
+}
+
+void LoraLink::onReceive(const MessageCallback& fn) {
+  receiveCallback = fn;
+}
+
+void LoraLink::setTransmitGate(const TransmitGate& fn) {
+  transmitGate = fn;
+}
+
+bool LoraLink::isConnected() const {
+  return hasPeerActivity && millis() - lastPeerActivity < LINK_TIMEOUT;
+}
+
+size_t LoraLink::getQueueLength(LINK_PRIORITY priority) const {
+  return queues[static_cast<uint8_t>(priority)].size();
+}
+
+const linkStatistics& LoraLink::getStatistics() const {
+  return statistics;
+}
+
+const linkQuality& LoraLink::getQuality() const {
+  return quality;
+}
+
+void LoraLink::process() {
+  updateBudget();
+
+  // radio is half-duplex, nothing more to do until we are done sending.
+  if (radio.isTransmitting()) {
+    return;
+  }
+
+  size_t length;
+  while ((length = radio.readPacket(rxBuffer, sizeof(rxBuffer))) > 0) {
+    handleFrame(rxBuffer, length);
+  }
+
+  auto now = millis();
+
+  reassemblies.remove_if([now](const rxMessage& message) {
+    return now - message.lastUpdate > REASSEMBLY_TIMEOUT;
+  });
+
+  if (ackPending) {
+    // peer is waiting for our acknowledgement (or still sending a burst of frames), don't start sending anything else.
+    if ((int32_t)(now - ackDue) >= 0) {
+      sendAck();
+    }
+    return;
+  }
+
+  // no acknowledgement in time, assume all frames in flight are lost.
+  if (waitingForAck && (int32_t)(now - ackDeadline) >= 0) {
+    waitingForAck = false;
+
+    for (auto& frame : window) {
+      if (frame.inUse && !frame.needsSending) {
+        scheduleRetransmit(frame);
+      }
+    }
+  }
+
+  // don't start sending again while peer is about to acknowledge, we would only collide with it.
+  if (waitingForAck && burstDone) {
+    return;
+  }
+
+  sendNextFrame();
+}
+
+void LoraLink::handleFrame(const uint8_t* frame, size_t length) {
+  if (length < HEADER_SIZE) {
+    return;
+  }
+
+  uint16_t destination = frame[0] | (frame[1] << 8);
+  uint16_t source = frame[2] | (frame[3] << 8);
+
+  if (destination != localAddress && destination != BROADCAST_ADDRESS) {
+    return;
+  }
+
+  if (peerAddress != BROADCAST_ADDRESS && source != peerAddress) {
+    return;
+  }
+
+  lastPeerActivity = millis();
+  hasPeerActivity = true;
+  quality.snr = radio.getLastSNR();
+  quality.rssi = radio.getLastRSSI();
+
+  switch (frame[4] & FLAG_TYPE_MASK) {
+    case FLAG_TYPE_DATA:
+      handleData(frame, length, source);
+      break;
+    case FLAG_TYPE_ACK:
+      if (destination == localAddress) {
+        handleAck(frame + HEADER_SIZE, length - HEADER_SIZE);
+      }
+      break;
+  }
+}
+
+void LoraLink::handleData(const uint8_t* frame, size_t length, uint16_t source) {
+  statistics.framesReceived++;
+
+  uint8_t flags = frame[4];
+  uint8_t sequence = frame[5];
+  uint8_t messageId = frame[6];
+  uint8_t fragment = frame[7] >> 4;
+  uint8_t fragmentCount = (frame[7] & 0x0F) + 1;
+  auto priority = flags & FLAG_CONTROL ? LINK_PRIORITY::CONTROL : LINK_PRIORITY::BULK;
+  auto payload = frame + HEADER_SIZE;
+  auto payloadLength = length - HEADER_SIZE;
+
+  // all fragments but the last one are full, anything else is broken (or hostile) and would write outside the reassembly buffer.
+  if (fragment >= fragmentCount || (fragment < fragmentCount - 1 && payloadLength != MAX_PAYLOAD_SIZE)) {
+    statistics.framesMalformed++;
+    return;
+  }
+
+  if (frame[0] == 0xFF && frame[1] == 0xFF) {
+    // broadcasts are never acknowledged, and can't be fragmented.
+    if (fragmentCount == 1) {
+      deliver(payload, payloadLength, source, priority);
+    }
+    return;
+  }
+
+  // keep track of the latest 32 sequence numbers received, to detect duplicates (when our acknowledgement was lost) and to acknowledge them.
+  bool duplicate = false;
+  int8_t diff = sequence - highestSequence;
+
+  if (!hasReceived || diff <= -32) {
+    // first frame, or peer has restarted.
+    hasReceived = true;
+    highestSequence = sequence;
+    receivedMask = 1;
+  } else if (diff > 0) {
+    receivedMask = diff >= 32 ? 0 : receivedMask << diff;
+    receivedMask |= 1;
+    highestSequence = sequence;
+  } else if (receivedMask & (1UL << -diff)) {
+    duplicate = true;
+  } else {
+    receivedMask |= 1UL << -diff;
+  }
+
+  ackPending = true;
+  ackDestination = source;
+  ackDue = millis() + (flags & FLAG_MORE ? getAckTimeout() : ACK_DELAY);
+
+  if (duplicate) {
+    statistics.framesDuplicate++;
+    return;
+  }
+
+  if (fragmentCount == 1) {
+    deliver(payload, payloadLength, source, priority);
+    return;
+  }
+
+  auto message = reassemblies.begin();
+  while (message != reassemblies.end() && (message->source != source || message->id != messageId || message->fragmentCount != fragmentCount)) {
+    ++message;
+  }
+
+  if (message == reassemblies.end()) {
+    if (reassemblies.size() >= MAX_REASSEMBLIES) {
+      reassemblies.pop_front();
+    }
+
+    reassemblies.emplace_back();
+    message = --reassemblies.end();
+    message->source = source;
+    message->id = messageId;
+    message->fragmentCount = fragmentCount;
+    message->receivedMask = 0;
+    message->length = 0;
+    message->priority = priority;
+    message->data.resize(fragmentCount * MAX_PAYLOAD_SIZE);
+  }
+
+  memcpy(message->data.data() + fragment * MAX_PAYLOAD_SIZE, payload, payloadLength);
+  message->receivedMask |= 1 << fragment;
+  message->lastUpdate = millis();
+
+  if (fragment == fragmentCount - 1) {
+    message->length = fragment * MAX_PAYLOAD_SIZE + payloadLength;
+  }
+
+  if (message->receivedMask == (1UL << fragmentCount) - 1) {
+    deliver(message->data.data(), message->length, source, message->priority);
+    reassemblies.erase(message);
+  }
+}
+
+void LoraLink::handleAck(const uint8_t* payload, size_t length) {
+  if (length < ACK_PAYLOAD_SIZE) {
+    return;
+  }
+
+  uint8_t highest = payload[0];
+  uint32_t mask = payload[1] | (payload[2] << 8) | (payload[3] << 16) | ((uint32_t)payload[4] << 24);
+
+  quality.peerSnr = (int8_t)payload[5] / 4.0f;
+  quality.peerRssi = -payload[6];
+  quality.reports++;
+
+  for (auto& frame : window) {
+    if (!frame.inUse) {
+      continue;
+    }
+
+    uint8_t age = highest - frame.sequence;
+    if (age < 32 && (mask & (1UL << age))) {
+      frameAcknowledged(frame);
+    }
+  }
+
+  // peer has received our whole burst (the radio is half-duplex), so anything not acknowledged is lost and could be resent right away.
+  waitingForAck = false;
+
+  for (auto& frame : window) {
+    if (frame.inUse && !frame.needsSending) {
+      scheduleRetransmit(frame);
+    }
+  }
+}
+
+void LoraLink::deliver(const uint8_t* data, size_t length, uint16_t source, LINK_PRIORITY priority) {
+  statistics.messagesReceived++;
+
+  if (receiveCallback != nullptr) {
+    receiveCallback(data, length, source, priority);
+  }
+}
+
+void LoraLink::frameAcknowledged(txFrame& frame) {
+  frame.inUse = false;
+  messageDone(frame.messageId, true);
+}
+
+void LoraLink::scheduleRetransmit(txFrame& frame) {
+  if (frame.transmissions >= MAX_TRANSMISSIONS) {
+    frame.inUse = false;
+    messageDone(frame.messageId, false);
+  } else {
+    frame.needsSending = true;
+  }
+}
+
+void LoraLink::messageDone(uint8_t messageId, bool success) {
+  for (auto message = activeMessages.begin(); message != activeMessages.end(); ++message) {
+    if (message->id != messageId) {
+      continue;
+    }
+
+    auto priority = static_cast<uint8_t>(message->priority);
+    // keep callback around, message is removed before we call it.
+    DeliveredCallback delivered;
+
+    if (!success) {
+      // no point in sending the rest of the message, peer will not be able to put it together anyway.
+      for (auto& frame : window) {
+        if (frame.inUse && frame.messageId == messageId) {
+          frame.inUse = false;
+        }
+      }
+
+      statistics.messagesFailed[priority]++;
+      delivered = message->delivered;
+      activeMessages.erase(message);
+    } else if (--message->pendingFragments == 0) {
+      statistics.messagesDelivered[priority]++;
+      statistics.messageLatency[priority] += millis() - message->queuedTime;
+      statistics.bytesDelivered[priority] += message->data.size();
+      delivered = message->delivered;
+      activeMessages.erase(message);
+    }
+
+    if (delivered != nullptr) {
+      delivered(success);
+    }
+
+    return;
+  }
+}
+
+bool LoraLink::sendAck() {
+  writeHeader(txBuffer, ackDestination, localAddress, FLAG_TYPE_ACK, 0, 0, 0, 1);
+  txBuffer[HEADER_SIZE] = highestSequence;
+  txBuffer[HEADER_SIZE + 1] = receivedMask;
+  txBuffer[HEADER_SIZE + 2] = receivedMask >> 8;
+  txBuffer[HEADER_SIZE + 3] = receivedMask >> 16;
+  txBuffer[HEADER_SIZE + 4] = receivedMask >> 24;
+  txBuffer[HEADER_SIZE + 5] = (int8_t)constrain(roundf(quality.snr * 4), -128, 127);
+  txBuffer[HEADER_SIZE + 6] = (uint8_t)constrain(roundf(-quality.rssi), 0, 255);
+
+  if (!transmit(txBuffer, HEADER_SIZE + ACK_PAYLOAD_SIZE, true)) {
+    return false;
+  }
+
+  ackPending = false;
+  statistics.acksSent++;
+
+  return true;
+}
+
+bool LoraLink::sendNextFrame() {
+  fillWindow();
+
+  // control frames first, then the oldest frame.
+  txFrame* next = nullptr;
+  uint8_t pending = 0;
+
+  for (auto& frame : window) {
+    if (!frame.inUse || !frame.needsSending) {
+      continue;
+    }
+
+    pending++;
+
+    if (next == nullptr) {
+      next = &frame;
+    } else {
+      bool frameIsControl = frame.data[4] & FLAG_CONTROL;
+      bool nextIsControl = next->data[4] & FLAG_CONTROL;
+      uint8_t frameAge = nextSequence - frame.sequence;
+      uint8_t nextAge = nextSequence - next->sequence;
+
+      if ((frameIsControl && !nextIsControl) || (frameIsControl == nextIsControl && frameAge > nextAge)) {
+        next = &frame;
+      }
+    }
+  }
+
+  if (next == nullptr) {
+    return false;
+  }
+
+  bool control = next->data[4] & FLAG_CONTROL;
+  // only ask peer to wait for more frames if we will be allowed to send one of them right after this one.
+  bool more = false;
+
+  for (auto& frame : window) {
+    if (pending < 2 || more) {
+      break;
+    }
+
+    if (&frame != next && frame.inUse && frame.needsSending) {
+      more = transmitGate == nullptr || transmitGate(getExchangeTime(next->length) + getExchangeTime(frame.length), frame.data[4] & FLAG_CONTROL, false);
+    }
+  }
+
+  if (more) {
+    next->data[4] |= FLAG_MORE;
+  } else {
+    next->data[4] &= ~FLAG_MORE;
+  }
+
+  if (!transmit(next->data, next->length, control)) {
+    return false;
+  }
+
+  if (next->transmissions > 0) {
+    statistics.framesRetransmitted++;
+  }
+
+  next->transmissions++;
+  next->needsSending = false;
+  waitingForAck = true;
+  burstDone = !more;
+  // a little random jitter, so that we don't keep colliding with someone else retransmitting at the same pace.
+  ackDeadline = millis() + Radio::getAirtime(radio.getSettings(), next->length) / 1000 + getAckTimeout() + random(TURNAROUND_TIME);
+
+  return true;
+}
+
+bool LoraLink::fillWindow() {
+  bool filled = false;
+  uint8_t used = 0;
+
+  for (auto& frame : window) {
+    if (frame.inUse) {
+      used++;
+    }
+  }
+
+  for (auto& frame : window) {
+    if (frame.inUse) {
+      continue;
+    }
+
+    // pick message to take next fragment from, control messages first and continue with partially sent messages before starting on new ones.
+    // the last free frame is kept for control messages, bulk frames that we are not allowed to send yet must not lock them out.
+    txMessage* message = nullptr;
+    uint8_t priorities = used < WINDOW_SIZE - 1 ? 2 : 1;
+
+    for (uint8_t priority = 0; priority < priorities && message == nullptr; priority++) {
+      for (auto& active : activeMessages) {
+        if (static_cast<uint8_t>(active.priority) == priority && active.nextFragment < active.fragmentCount) {
+          message = &active;
+          break;
+        }
+      }
+
+      if (message == nullptr && !queues[priority].empty()) {
+        activeMessages.push_back(std::move(queues[priority].front()));
+        queues[priority].pop_front();
+        message = &activeMessages.back();
+      }
+    }
+
+    if (message == nullptr) {
+      break;
+    }
+
+    uint16_t offset = message->nextFragment * MAX_PAYLOAD_SIZE;
+    uint8_t payloadLength = min((size_t)MAX_PAYLOAD_SIZE, message->data.size() - offset);
+    uint8_t flags = FLAG_TYPE_DATA | (message->priority == LINK_PRIORITY::CONTROL ? FLAG_CONTROL : 0);
+
+    writeHeader(frame.data, peerAddress, localAddress, flags, nextSequence, message->id, message->nextFragment, message->fragmentCount);
+    memcpy(frame.data + HEADER_SIZE, message->data.data() + offset, payloadLength);
+
+    frame.inUse = true;
+    frame.needsSending = true;
+    frame.sequence = nextSequence++;
+    frame.messageId = message->id;
+    frame.transmissions = 0;
+    frame.length = HEADER_SIZE + payloadLength;
+
+    message->nextFragment++;
+    used++;
+    filled = true;
+  }
+
+  return filled;
+}
+
+bool LoraLink::transmit(const uint8_t* frame, size_t length, bool control) {
+  bool reply = (frame[4] & FLAG_TYPE_MASK) == FLAG_TYPE_ACK;
+
+  if (transmitGate != nullptr && !transmitGate(reply ? Radio::getAirtime(radio.getSettings(), length) / 1000 : getExchangeTime(length), control, reply)) {
+    return false;
+  }
+
+  auto airtime = Radio::getAirtime(radio.getSettings(), length);
+  // keep a share of the budget for control messages, so that bulk data can't lock us out from e.g. emergency stops.
+  float reserve = control ? 0 : getAirtimeBudgetMax() * CONTROL_RESERVE / 100.0f;
+
+  if (airtimeBudget - airtime < reserve) {
+    statistics.dutyCycleDeferrals++;
+    return false;
+  }
+
+  if (!radio.startTransmit(frame, length)) {
+    return false;
+  }
+
+  airtimeBudget -= airtime;
+  statistics.airtime += airtime / 1000;
+  statistics.framesSent++;
+
+  return true;
+}
+
+void LoraLink::updateBudget() {
+  auto now = millis();
+  airtimeBudget += (now - lastBudgetUpdate) * 1000.0f * dutyCycle / 100.0f;
+  lastBudgetUpdate = now;
+
+  if (airtimeBudget > getAirtimeBudgetMax()) {
+    airtimeBudget = getAirtimeBudgetMax();
+  }
+}
+
+uint32_t LoraLink::getAirtimeBudgetMax() const {
+  return DUTY_CYCLE_PERIOD * 1000.0f * dutyCycle / 100.0f;
+}
+
+uint32_t LoraLink::getAckTimeout() const {
+  auto& settings = radio.getSettings();
+  return (Radio::getAirtime(settings, MAX_FRAME_SIZE) + Radio::getAirtime(settings, HEADER_SIZE + ACK_PAYLOAD_SIZE)) / 1000 + 2 * TURNAROUND_TIME;
+}
+
+/**
+ * Time (ms) from start of sending a data frame until peer's acknowledgement has been received.
+ */
+uint32_t LoraLink::getExchangeTime(size_t length) const {
+  auto& settings = radio.getSettings();
+  return (Radio::getAirtime(settings, length) + Radio::getAirtime(settings, HEADER_SIZE + ACK_PAYLOAD_SIZE)) / 1000 + ACK_DELAY + TURNAROUND_TIME;
+}
+
+void LoraLink::writeHeader(uint8_t* frame, uint16_t destination, uint16_t source, uint8_t flags, uint8_t sequence, uint8_t messageId, uint8_t fragment, uint8_t fragmentCount) {
+  frame[0] = destination;
+  frame[1] = destination >> 8;
+  frame[2] = source;
+  frame[3] = source >> 8;
+  frame[4] = flags;
+  frame[5] = sequence;
+  frame[6] = messageId;
+  frame[7] = (fragment << 4) | ((fragmentCount - 1) & 0x0F);
+}
@@ -0,0 +1,197 @@
+#ifndef _lora_link_h
+#define _lora_link_h
+
+#include <Arduino.h>
+#include <functional>
+#include <deque>
+#include <list>
+#include <vector>
+#include "radio.h"
+#include "processable.h"
+
+enum class LINK_PRIORITY : uint8_t {
+  CONTROL = 0,  // small and urgent messages, like emergency stop and state changes. Always sent before any bulk messages.
+  BULK = 1      // telemetry and other messages that can wait.
+};
+
+struct linkStatistics {
+  uint32_t framesSent = 0;
+  uint32_t framesRetransmitted = 0;
+  uint32_t framesReceived = 0;
+  uint32_t framesDuplicate = 0;
+  uint32_t framesMalformed = 0;          // frames dropped because their fragment header didn't make sense.
+  uint32_t acksSent = 0;
+  uint32_t messagesDelivered[2] = {0};   // per LINK_PRIORITY, messages acknowledged by peer.
+  uint32_t messagesFailed[2] = {0};      // per LINK_PRIORITY, messages dropped after too many retransmissions or when queue was full.
+  uint32_t messageLatency[2] = {0};      // per LINK_PRIORITY, sum of time (ms) from send() until acknowledged, divide with messagesDelivered for average.
+  uint32_t bytesDelivered[2] = {0};      // per LINK_PRIORITY
+  uint32_t messagesReceived = 0;
+  uint32_t airtime = 0;                  // total time on air (ms)
+  uint32_t dutyCycleDeferrals = 0;       // number of times we had to hold back a frame to stay within duty cycle.
+};
+
+struct linkQuality {
+  float snr = 0;          // signal-to-noise ratio (dB) of last frame received from peer.
+  float rssi = 0;         // signal strength (dBm) of last frame received from peer.
+  float peerSnr = 0;      // signal-to-noise ratio (dB) the peer reported for our last frame.
+  float peerRssi = 0;     // signal strength (dBm) the peer reported for our last frame.
+  uint32_t reports = 0;   // increased every time the peer reports how it hears us.
+};
+
+/**
+* Reliable link layer on top of a LoRa radio.
+* Messages are split into frames that fits into a single packet, each frame gets a sequence number and is resent until it's acknowledged by the peer.
+* A receiver acknowledges a burst of frames with a single selective acknowledgement (latest sequence number and a bitmap of the 31 before it), so only lost frames are resent.
+* The acknowledgement also reports the SNR and RSSI the receiver got, so both ends know the link quality in both directions.
+* Control messages always go before bulk messages, and a share of the duty cycle budget is reserved for control messages.
+*
+* Frame header (8 bytes):
+*   0-1 destination address, 2-3 source address, 4 flags, 5 sequence number, 6 message id, 7 fragment index (high nibble) and fragment count - 1 (low nibble)
+*/
+class LoraLink : public Processable {
+  public:
+    typedef std::function<void(const uint8_t* data, size_t length, uint16_t source, LINK_PRIORITY priority)> MessageCallback;
+    typedef std::function<void(bool success)> DeliveredCallback;
+    typedef std::function<bool(uint32_t duration, bool control, bool reply)> TransmitGate;
+
+    static const uint16_t BROADCAST_ADDRESS = 0xFFFF;
+    static const uint8_t HEADER_SIZE = 8;
+    static const uint8_t MAX_FRAME_SIZE = 255;
+    static const uint8_t MAX_PAYLOAD_SIZE = MAX_FRAME_SIZE - HEADER_SIZE;
+    static const uint8_t MAX_FRAGMENTS = 16;
+    static const uint16_t MAX_MESSAGE_SIZE = MAX_FRAGMENTS * MAX_PAYLOAD_SIZE;
+
+    /**
+    * @param radio radio used to send and receive frames.
+    * @param localAddress our own address.
+    * @param peerAddress address to send messages to.
+    * @param dutyCycle max share of time (in percent) we are allowed to transmit, see your local regulations.
+    */
+    LoraLink(Radio& radio, uint16_t localAddress, uint16_t peerAddress, float dutyCycle);
+    /**
+    * Queue a message for delivery to peer.
+    * @param fn [optional] callback that will be executed once the message has been acknowledged by peer, or given up on.
+    * @return false if message is too large or queue is full.
+    */
+    bool send(const uint8_t* data, size_t length, LINK_PRIORITY priority, const DeliveredCallback& fn = nullptr);
+    /**
+    * Register callback that will be called for each message received from the peer.
+    */
+    void onReceive(const MessageCallback& fn);
+    /**
+    * Register callback that decides if we may start a transmission now, e.g. to only send in our own time slot. Frames are held back until it returns true.
+    * The callback gets the time (ms) the exchange will take (including acknowledgement from peer), if it's a control frame, and if it's a reply (acknowledgement) to the peer.
+    */
+    void setTransmitGate(const TransmitGate& fn);
+    /**
+    * Returns if we have heard anything from the peer within the last LINK_TIMEOUT.
+    */
+    bool isConnected() const;
+    /**
+    * Number of messages waiting to be sent for the specified priority.
+    */
+    size_t getQueueLength(LINK_PRIORITY priority) const;
+    const linkStatistics& getStatistics() const;
+    const linkQuality& getQuality() const;
+    /* Internal use only! */
+    void process();
+
+  private:
+    static const uint8_t WINDOW_SIZE = 8;               // Max number of unacknowledged frames in flight.
+    static const uint8_t MAX_TRANSMISSIONS = 6;         // Give up on a frame after this many attempts.
+    static const uint8_t MAX_QUEUE_LENGTH = 10;         // Per priority, when full bulk messages drop the oldest message and control messages are refused.
+    static const uint8_t MAX_REASSEMBLIES = 3;          // How many partially received messages we keep track of.
+    static const uint16_t TURNAROUND_TIME = 30;         // Time (ms) for the peer to switch from receive to transmit.
+    static const uint16_t REASSEMBLY_TIMEOUT = 30000;   // Give up on partially received messages after this time (ms).
+    static const uint16_t LINK_TIMEOUT = 30000;         // Consider link down if we have not heard from peer within this time (ms).
+    static const uint32_t DUTY_CYCLE_PERIOD = 3600000;  // Duty cycle is calculated over this period (ms), usually one hour.
+    static const uint8_t CONTROL_RESERVE = 25;          // Share (%) of duty cycle budget that only control messages and acknowledgements may use.
+
+    struct txMessage {
+      uint8_t id;
+      LINK_PRIORITY priority;
+      uint32_t queuedTime;
+      std::vector<uint8_t> data;
+      uint8_t fragmentCount;
+      uint8_t nextFragment;
+      uint8_t pendingFragments;
+      DeliveredCallback delivered;
+    };
+
+    struct txFrame {
+      bool inUse = false;
+      bool needsSending = false;
+      uint8_t sequence;
+      uint8_t messageId;
+      uint8_t transmissions;
+      uint8_t length;
+      uint8_t data[MAX_FRAME_SIZE];
+    };
+
+    struct rxMessage {
+      uint16_t source;
+      uint8_t id;
+      uint8_t fragmentCount;
+      uint16_t receivedMask;
+      uint16_t length;
+      uint32_t lastUpdate;
+      LINK_PRIORITY priority;
+      std::vector<uint8_t> data;
+    };
+
+    Radio& radio;
+    uint16_t localAddress;
+    uint16_t peerAddress;
+    float dutyCycle;
+    MessageCallback receiveCallback;
+    TransmitGate transmitGate;
+    linkStatistics statistics;
+    linkQuality quality;
+
+    // sending
+    std::deque<txMessage> queues[2];
+    std::list<txMessage> activeMessages;  // messages that have been split into frames, waiting to be acknowledged.
+    txFrame window[WINDOW_SIZE];
+    uint8_t nextSequence;
+    uint8_t nextMessageId = 0;
+    uint32_t ackDeadline = 0;
+    bool waitingForAck = false;
+    bool burstDone = false;   // last frame sent told peer to acknowledge right away.
+    uint32_t lastPeerActivity = 0;
+    bool hasPeerActivity = false;
+
+    // receiving
+    bool hasReceived = false;
+    uint16_t ackDestination = 0;
+    uint8_t highestSequence = 0;
+    uint32_t receivedMask = 0;
+    bool ackPending = false;
+    uint32_t ackDue = 0;
+    std::list<rxMessage> reassemblies;
+
+    // duty cycle
+    float airtimeBudget;  // in microseconds
+    uint32_t lastBudgetUpdate = 0;
+
+    uint8_t rxBuffer[MAX_FRAME_SIZE];
+    uint8_t txBuffer[MAX_FRAME_SIZE];
+
+    void handleFrame(const uint8_t* frame, size_t length);
+    void handleData(const uint8_t* frame, size_t length, uint16_t source);
+    void handleAck(const uint8_t* payload, size_t length);
+    void deliver(const uint8_t* data, size_t length, uint16_t source, LINK_PRIORITY priority);
+    void frameAcknowledged(txFrame& frame);
+    void scheduleRetransmit(txFrame& frame);
+    void messageDone(uint8_t messageId, bool success);
+    bool sendAck();
+    bool sendNextFrame();
+    bool fillWindow();
+    bool transmit(const uint8_t* frame, size_t length, bool control);
+    void updateBudget();
+    uint32_t getAirtimeBudgetMax() const;
+    uint32_t getAckTimeout() const;
+    uint32_t getExchangeTime(size_t length) const;
+    static void writeHeader(uint8_t* frame, uint16_t destination, uint16_t source, uint8_t flags, uint8_t sequence, uint8_t messageId, uint8_t fragment, uint8_t fragmentCount);
+};
+
+#endif
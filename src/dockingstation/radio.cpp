@@ -0,0 +1,15 @@
+#include "radio.h"
+
+uint32_t Radio::getAirtime(const RadioSettings& settings, size_t length) {
+  float symbolTime = (1UL << settings.spreadingFactor) * 1000.0f / settings.bandwidth;  // in microseconds
+  // low data rate optimization is mandated when a symbol is longer than 16 ms.
+  int16_t lowDataRateOptimize = symbolTime > 16000 ? 1 : 0;
+
+  float preambleTime = (settings.preambleLength + 4.25f) * symbolTime;
+
+  int32_t bits = 8 * length - 4 * settings.spreadingFactor + 28 + 16;  // 16 bits of CRC, explicit header.
+  int32_t divisor = 4 * (settings.spreadingFactor - 2 * lowDataRateOptimize);
+  int32_t payloadSymbols = 8 + max((int32_t)ceilf((float)bits / divisor) * settings.codingRate, (int32_t)0);
+
+  return preambleTime + payloadSymbols * symbolTime;
+}
@@ -0,0 +1,63 @@
+#ifndef _radio_h
+#define _radio_h
+
+#include <Arduino.h>
+
+/**
+* LoRa modulation settings.
+*/
+struct RadioSettings {
+  float bandwidth;          // in kHz
+  uint8_t spreadingFactor;  // 6-12
+  uint8_t codingRate;       // denominator of coding rate, 5-8 (4/5 - 4/8)
+  int8_t power;             // output power in dBm
+  uint16_t preambleLength;  // in symbols
+};
+
+/**
+* Interface for a half-duplex packet radio, used by the link layer. Implemented by the SX1278 driver, but could be replaced by a stand-in when running on a computer.
+*/
+class Radio {
+  public:
+    /**
+    * Start sending a packet, the radio will be busy until isTransmitting() returns false.
+    * @return false if packet could not be sent.
+    */
+    virtual bool startTransmit(const uint8_t* data, size_t length) = 0;
+    /**
+    * Returns if we are currently busy sending a packet.
+    */
+    virtual bool isTransmitting() = 0;
+    /**
+    * Get next received packet, if any.
+    * @return length of packet copied into data, 0 if no packet has been received.
+    */
+    virtual size_t readPacket(uint8_t* data, size_t size) = 0;
+    /**
+    * Signal-to-noise ratio (dB) of last received packet.
+    */
+    virtual float getLastSNR() const = 0;
+    /**
+    * Received signal strength (dBm) of last received packet.
+    */
+    virtual float getLastRSSI() const = 0;
+    /**
+    * Currently used modulation settings.
+    */
+    virtual const RadioSettings& getSettings() const = 0;
+    /**
+    * Change modulation settings, radio will go back to listening for packets afterwards.
+    * @return false if settings could not be applied.
+    */
+    virtual bool applySettings(const RadioSettings& settings) = 0;
+
+    /**
+    * Calculate the time on air for a packet, using the formula from Semtech's "LoRa Modem Designer's Guide" (AN1200.13). Assumes explicit header and CRC enabled.
+    * @param settings modulation settings used for sending packet.
+    * @param length payload length in bytes.
+    * @return time on air in microseconds.
+    */
+    static uint32_t getAirtime(const RadioSettings& settings, size_t length);
+};
+
+#endif
@@ -0,0 +1,268 @@
+#include <ArduinoLog.h>
+#include <pb_encode.h>
+#include <pb_decode.h>
+#include "status_encoder.h"
+
+// Protobuf field numbers for fields that are not part of the status itself, see status.proto.
+static const uint32_t SEQUENCE_TAG = 1;
+static const uint32_t KEYFRAME_TAG = 2;
+
+// Deadband for fields that should never trigger a new frame by themselves, they are only sent in keyframes.
+static const int32_t KEYFRAME_ONLY = -1;
+
+enum FIELD_FORMAT {
+  UNSIGNED, // varint
+  SIGNED,   // zigzag encoded varint
+  BOOLEAN,  // varint
+  ANGLE     // varint, degrees that wrap around at 360
+};
+
+struct fieldDescriptor {
+  uint32_t tag;
+  FIELD_FORMAT format;
+  int32_t deadband;   // field must change more than this (in encoded units) to be sent in a delta frame.
+};
+
+// Must be in the same order as StatusEncoder::STATUS_FIELD, tags must match status.proto.
+static const fieldDescriptor FIELDS[StatusEncoder::FIELD_COUNT] = {
+  {  3, UNSIGNED, 0 },              // state
+  {  4, UNSIGNED, 50 },             // batteryVoltage (mV)
+  {  5, UNSIGNED, 1 },              // batteryLevel (%)
+  {  6, UNSIGNED, 50 },             // batteryChargeCurrent (mA)
+  {  7, BOOLEAN,  0 },              // isCharging
+  {  8, UNSIGNED, 0 },              // lastFullyChargeTime
+  {  9, UNSIGNED, 0 },              // lastChargeDuration
+  { 10, UNSIGNED, 5 },              // cutterLoad (%)
+  { 11, BOOLEAN,  0 },              // cutterRotating
+  { 12, UNSIGNED, KEYFRAME_ONLY },  // uptime, changes every second so we don't bother sending it in every frame.
+  { 13, SIGNED,   0 },              // leftWheelSpd (%)
+  { 14, SIGNED,   0 },              // rightWheelSpd (%)
+  { 15, SIGNED,   2 },              // pitch (degrees)
+  { 16, SIGNED,   2 },              // roll (degrees)
+  { 17, ANGLE,    5 },              // heading (degrees)
+  { 18, UNSIGNED, 10 },             // obstacleFrontDistance (cm)
+  { 19, UNSIGNED, KEYFRAME_ONLY },  // areaPerWh (0.01 m²/Wh), efficiency changes slowly so keyframes are often enough.
+  { 20, UNSIGNED, KEYFRAME_ONLY }   // whPerMowingHour (0.1 Wh/h)
+};
+
+static const uint32_t ALL_FIELDS = (1UL << StatusEncoder::FIELD_COUNT) - 1;
+
+static bool writeFrame(pb_ostream_t& stream, uint32_t sequence, bool keyframe, const int32_t* fields, uint32_t mask) {
+
+  if (!pb_encode_tag(&stream, PB_WT_VARINT, SEQUENCE_TAG) || !pb_encode_varint(&stream, sequence)) {
+    return false;
+  }
+
+  if (keyframe && (!pb_encode_tag(&stream, PB_WT_VARINT, KEYFRAME_TAG) || !pb_encode_varint(&stream, 1))) {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < StatusEncoder::FIELD_COUNT; i++) {
+    if ((mask & (1UL << i)) == 0) {
+      continue;
+    }
+
+    if (!pb_encode_tag(&stream, PB_WT_VARINT, FIELDS[i].tag)) {
+      return false;
+    }
+
+    bool success = FIELDS[i].format == SIGNED ? pb_encode_svarint(&stream, fields[i]) : pb_encode_varint(&stream, (uint32_t)fields[i]);
+    if (!success) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+StatusEncoder::StatusEncoder() {}
+
+size_t StatusEncoder::encode(const MowerStatus& status, uint8_t* buffer, size_t size, uint32_t now, bool forceKeyframe, uint32_t excludedFields) {
+  int32_t fields[FIELD_COUNT];
+  toFields(status, fields);
+
+  bool keyframe = forceKeyframe || keyframeRequested || now - lastKeyframeTime >= KEYFRAME_INTERVAL;
+  uint32_t mask = keyframe ? ALL_FIELDS : 0;
+
+  if (!keyframe) {
+    for (uint8_t i = 0; i < FIELD_COUNT; i++) {
+      if (hasChanged(i, lastSent[i], fields[i])) {
+        mask |= 1UL << i;
+      }
+    }
+  }
+
+  mask &= ~excludedFields;
+
+  // keep track of what it would have cost us to always send full frames, only used for statistics.
+  pb_ostream_t sizingStream = PB_OSTREAM_SIZING;
+  writeFrame(sizingStream, sequence, true, fields, ALL_FIELDS);
+  fullFrameBytes += sizingStream.bytes_written;
+
+  if (mask == 0) {
+    return 0;
+  }
+
+  pb_ostream_t stream = pb_ostream_from_buffer(buffer, size);
+  if (!writeFrame(stream, sequence, keyframe, fields, mask)) {
+    Log.warning(F("Failed to encode status frame: %s" CR), PB_GET_ERROR(&stream));
+    return 0;
+  }
+
+  // compare against the values we actually sent, otherwise slow changes could creep past the deadband without ever being sent.
+  for (uint8_t i = 0; i < FIELD_COUNT; i++) {
+    if (mask & (1UL << i)) {
+      lastSent[i] = fields[i];
+    }
+  }
+
+  if (keyframe) {
+    lastKeyframeTime = now;
+    keyframeRequested = false;
+  }
+
+  sequence++;
+  lastFieldMask = mask;
+  encodedBytes += stream.bytes_written;
+
+  return stream.bytes_written;
+}
+
+size_t StatusEncoder::encodeField(STATUS_FIELD field, const MowerStatus& status, uint8_t* buffer, size_t size) {
+  int32_t fields[FIELD_COUNT];
+  toFields(status, fields);
+
+  auto& descriptor = FIELDS[field];
+  pb_ostream_t stream = pb_ostream_from_buffer(buffer, size);
+  bool success = pb_encode_tag(&stream, PB_WT_VARINT, descriptor.tag) &&
+                 (descriptor.format == SIGNED ? pb_encode_svarint(&stream, fields[field]) : pb_encode_varint(&stream, (uint32_t)fields[field]));
+
+  return success ? stream.bytes_written : 0;
+}
+
+int32_t StatusEncoder::decode(const uint8_t* buffer, size_t size, MowerStatus& status, uint32_t* sequence) {
+  pb_istream_t stream = pb_istream_from_buffer(buffer, size);
+  pb_wire_type_t wireType;
+  uint32_t tag;
+  bool eof = false;
+  int32_t mask = 0;
+
+  while (pb_decode_tag(&stream, &wireType, &tag, &eof)) {
+
+    if (wireType != PB_WT_VARINT) {
+      // not something we know about, could be sent from a newer version. Skip it.
+      if (!pb_skip_field(&stream, wireType)) {
+        return -1;
+      }
+      continue;
+    }
+
+    int8_t field = -1;
+    for (uint8_t i = 0; i < FIELD_COUNT; i++) {
+      if (FIELDS[i].tag == tag) {
+        field = i;
+        break;
+      }
+    }
+
+    int32_t value;
+    if (field >= 0 && FIELDS[field].format == SIGNED) {
+      int64_t signedValue;
+      if (!pb_decode_svarint(&stream, &signedValue)) {
+        return -1;
+      }
+      value = signedValue;
+    } else {
+      uint64_t unsignedValue;
+      if (!pb_decode_varint(&stream, &unsignedValue)) {
+        return -1;
+      }
+      value = unsignedValue;
+    }
+
+    if (tag == SEQUENCE_TAG && sequence != nullptr) {
+      *sequence = value;
+    } else if (field >= 0) {
+      fromField(field, value, status);
+      mask |= 1UL << field;
+    }
+  }
+
+  return eof ? mask : -1;
+}
+
+void StatusEncoder::requestKeyframe() {
+  keyframeRequested = true;
+}
+
+uint32_t StatusEncoder::getLastFieldMask() const {
+  return lastFieldMask;
+}
+
+uint32_t StatusEncoder::getEncodedBytes() const {
+  return encodedBytes;
+}
+
+uint32_t StatusEncoder::getFullFrameBytes() const {
+  return fullFrameBytes;
+}
+
+void StatusEncoder::toFields(const MowerStatus& status, int32_t (&fields)[FIELD_COUNT]) {
+  fields[STATE] = status.state;
+  fields[BATTERY_VOLTAGE] = lroundf(status.batteryVoltage * 1000);
+  fields[BATTERY_LEVEL] = status.batteryLevel;
+  fields[BATTERY_CHARGE_CURRENT] = lroundf(status.batteryChargeCurrent);
+  fields[IS_CHARGING] = status.isCharging;
+  fields[LAST_FULLY_CHARGE_TIME] = status.lastFullyChargeTime;
+  fields[LAST_CHARGE_DURATION] = status.lastChargeDuration;
+  fields[CUTTER_LOAD] = status.cutterLoad;
+  fields[CUTTER_ROTATING] = status.cutterRotating;
+  fields[UPTIME] = status.uptime;
+  fields[LEFT_WHEEL_SPD] = status.leftWheelSpd;
+  fields[RIGHT_WHEEL_SPD] = status.rightWheelSpd;
+  fields[PITCH] = status.pitch;
+  fields[ROLL] = status.roll;
+  fields[HEADING] = status.heading;
+  fields[OBSTACLE_FRONT_DISTANCE] = status.obstacleFrontDistance;
+  fields[AREA_PER_WH] = lroundf(status.areaPerWh * 100);
+  fields[WH_PER_MOWING_HOUR] = lroundf(status.whPerMowingHour * 10);
+}
+
+void StatusEncoder::fromField(uint8_t field, int32_t value, MowerStatus& status) {
+  switch (field) {
+    case STATE: status.state = value; break;
+    case BATTERY_VOLTAGE: status.batteryVoltage = value / 1000.0f; break;
+    case BATTERY_LEVEL: status.batteryLevel = value; break;
+    case BATTERY_CHARGE_CURRENT: status.batteryChargeCurrent = value; break;
+    case IS_CHARGING: status.isCharging = value != 0; break;
+    case LAST_FULLY_CHARGE_TIME: status.lastFullyChargeTime = value; break;
+    case LAST_CHARGE_DURATION: status.lastChargeDuration = value; break;
+    case CUTTER_LOAD: status.cutterLoad = value; break;
+    case CUTTER_ROTATING: status.cutterRotating = value != 0; break;
+    case UPTIME: status.uptime = value; break;
+    case LEFT_WHEEL_SPD: status.leftWheelSpd = value; break;
+    case RIGHT_WHEEL_SPD: status.rightWheelSpd = value; break;
+    case PITCH: status.pitch = value; break;
+    case ROLL: status.roll = value; break;
+    case HEADING: status.heading = value; break;
+    case OBSTACLE_FRONT_DISTANCE: status.obstacleFrontDistance = value; break;
+    case AREA_PER_WH: status.areaPerWh = value / 100.0f; break;
+    case WH_PER_MOWING_HOUR: status.whPerMowingHour = value / 10.0f; break;
+  }
+}
+
+bool StatusEncoder::hasChanged(uint8_t field, int32_t lastValue, int32_t value) {
+  auto deadband = FIELDS[field].deadband;
+
+  if (deadband == KEYFRAME_ONLY) {
+    return false;
+  }
+
+  int32_t diff = abs(value - lastValue);
+  // heading 359 -> 2 is a change of 3 degrees, not 357.
+  if (FIELDS[field].format == ANGLE && diff > 180) {
+    diff = 360 - diff;
+  }
+
+  return diff > deadband;
+}
@@ -0,0 +1,113 @@
+#ifndef _status_encoder_h
+#define _status_encoder_h
+
+#include <Arduino.h>
+
+/**
+* Snapshot of the mower status, as it is sent to the docking station.
+*/
+struct MowerStatus {
+  uint8_t state = 0;
+  float batteryVoltage = 0;       // volt
+  uint8_t batteryLevel = 0;       // percent
+  float batteryChargeCurrent = 0; // milliampere
+  bool isCharging = false;
+  uint32_t lastFullyChargeTime = 0;
+  uint32_t lastChargeDuration = 0;
+  uint16_t batteryRemainingTime = 0;  // minutes, UINT16_MAX if not discharging
+  uint8_t cutterLoad = 0;
+  bool cutterRotating = false;
+  uint32_t uptime = 0;
+  int16_t leftWheelSpd = 0;
+  int16_t rightWheelSpd = 0;
+  int16_t pitch = 0;
+  int16_t roll = 0;
+  uint16_t heading = 0;
+  uint16_t obstacleFrontDistance = 0;
+  float areaPerWh = 0;            // m² mowed per Wh, since counters were cleared.
+  float whPerMowingHour = 0;      // Wh used per hour of mowing, since counters were cleared.
+};
+
+/**
+* Encodes MowerStatus into delta compressed protobuf frames (see status.proto), only fields that have changed beyond their deadband are included.
+*/
+class StatusEncoder {
+  public:
+    enum STATUS_FIELD {
+      STATE,
+      BATTERY_VOLTAGE,
+      BATTERY_LEVEL,
+      BATTERY_CHARGE_CURRENT,
+      IS_CHARGING,
+      LAST_FULLY_CHARGE_TIME,
+      LAST_CHARGE_DURATION,
+      CUTTER_LOAD,
+      CUTTER_ROTATING,
+      UPTIME,
+      LEFT_WHEEL_SPD,
+      RIGHT_WHEEL_SPD,
+      PITCH,
+      ROLL,
+      HEADING,
+      OBSTACLE_FRONT_DISTANCE,
+      AREA_PER_WH,
+      WH_PER_MOWING_HOUR,
+      FIELD_COUNT
+    };
+
+    StatusEncoder();
+    /**
+     * Encode a new frame directly into buffer.
+     * @param status current status of mower.
+     * @param buffer buffer to encode frame into, usually the radio's transmit buffer.
+     * @param size size of buffer.
+     * @param now current time in milliseconds, used to decide when it's time for a new keyframe.
+     * @param forceKeyframe always send all fields.
+     * @param excludedFields bitmask of fields (bit position = STATUS_FIELD) to leave out, e.g. to append them later with encodeField().
+     * @return length of encoded frame, 0 if nothing has changed (and no frame should be sent) or if buffer was too small.
+     */
+    size_t encode(const MowerStatus& status, uint8_t* buffer, size_t size, uint32_t now, bool forceKeyframe = false, uint32_t excludedFields = 0);
+    /**
+     * Encode a single field of status, to be appended to a frame.
+     * @return length of encoded field, 0 if buffer was too small.
+     */
+    static size_t encodeField(STATUS_FIELD field, const MowerStatus& status, uint8_t* buffer, size_t size);
+    /**
+     * Merge a received frame into status, fields not present in the frame are left untouched.
+     * @return bitmask of fields present in the frame (bit position = STATUS_FIELD), or -1 if frame was malformed.
+     */
+    static int32_t decode(const uint8_t* buffer, size_t size, MowerStatus& status, uint32_t* sequence = nullptr);
+    /**
+     * Make sure next frame will be a keyframe, e.g. when the docking station reports that it has lost track of us.
+     */
+    void requestKeyframe();
+    /**
+     * Bitmask of fields present in the last encoded frame (bit position = STATUS_FIELD).
+     */
+    uint32_t getLastFieldMask() const;
+    /**
+     * Total number of bytes encoded so far.
+     */
+    uint32_t getEncodedBytes() const;
+    /**
+     * Total number of bytes it would have taken to send a full frame every time encode() was called.
+     */
+    uint32_t getFullFrameBytes() const;
+
+  private:
+    static const uint32_t KEYFRAME_INTERVAL = 30000;  // Send all fields at least this often (in milliseconds).
+
+    int32_t lastSent[FIELD_COUNT] = {0};
+    uint32_t sequence = 0;
+    uint32_t lastKeyframeTime = 0;
+    uint32_t lastFieldMask = 0;
+    uint32_t encodedBytes = 0;
+    uint32_t fullFrameBytes = 0;
+    bool keyframeRequested = true;
+
+    static void toFields(const MowerStatus& status, int32_t (&fields)[FIELD_COUNT]);
+    static void fromField(uint8_t field, int32_t value, MowerStatus& status);
+    static bool hasChanged(uint8_t field, int32_t lastValue, int32_t value);
+};
+
+#endif
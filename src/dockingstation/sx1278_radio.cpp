@@ -0,0 +1,132 @@
+#include <ArduinoLog.h>
+#include "sx1278_radio.h"
+#include "definitions.h"
+
+volatile bool SX1278Radio::dio0Triggered = false;
+
+SX1278Radio::SX1278Radio() : lora(new LoRa(SS, Definitions::LORA_DIO0_PIN, Definitions::LORA_DIO1_PIN)) {}
+
+void IRAM_ATTR SX1278Radio::onDio0() {
+  dio0Triggered = true;
+}
+
+bool SX1278Radio::begin(const RadioSettings& settings) {
+  this->settings = settings;
+
+  // sync word:                   0x12
+  // current limit:               50 mA
+  // amplifier gain:              1 (maximum gain)
+  int state = lora.begin(Definitions::LORA_FREQ, settings.bandwidth, settings.spreadingFactor, settings.codingRate, 0x12, settings.power, 50, settings.preambleLength, 1);
+  if (state != ERR_NONE) {
+    Log.error(F("LoRa failed, code %d" CR), state);
+    return false;
+  }
+
+  lora.setDio0Action(onDio0);
+  lora.startReceive();
+
+  return true;
+}
+
+bool SX1278Radio::startTransmit(const uint8_t* data, size_t length) {
+  dio0Triggered = false;
+  auto state = lora.startTransmit(const_cast<uint8_t*>(data), length);
+
+  if (state != ERR_NONE) {
+    Log.warning(F("LoRa transmit failed, code %d" CR), state);
+    lora.startReceive();
+    return false;
+  }
+
+  transmitting = true;
+  transmitStarted = millis();
+  transmitTimeout = getAirtime(settings, length) / 1000 + TX_TIMEOUT_MARGIN;
+
+  return true;
+}
+
+bool SX1278Radio::isTransmitting() {
+  // DIO0 signals "TxDone" while we are sending, go back to listening for packets.
+  if (transmitting && dio0Triggered) {
+    dio0Triggered = false;
+    transmitting = false;
+    lora.startReceive();
+  } else if (transmitting && millis() - transmitStarted > transmitTimeout) {
+    // a missed interrupt would otherwise leave us deaf and mute for good.
+    Log.warning(F("LoRa transmit timed out after %l ms" CR), millis() - transmitStarted);
+    transmitting = false;
+    lora.startReceive();
+  }
+
+  return transmitting;
+}
+
+size_t SX1278Radio::readPacket(uint8_t* data, size_t size) {
+  // DIO0 signals "RxDone" while we are listening.
+  if (transmitting || !dio0Triggered) {
+    return 0;
+  }
+
+  dio0Triggered = false;
+
+  size_t length = lora.getPacketLength();
+  if (length > size) {
+    length = size;
+  }
+
+  auto state = lora.readData(data, length);
+  lastSNR = lora.getSNR();
+  lastRSSI = lora.getRSSI();
+  lora.startReceive();
+
+  if (state != ERR_NONE) {
+    // most likely a CRC error, the link layer will get it resent.
+    return 0;
+  }
+
+  return length;
+}
+
+bool SX1278Radio::applySettings(const RadioSettings& settings) {
+  transmitting = false;
+  dio0Triggered = false;
+
+  int state = lora.setBandwidth(settings.bandwidth);
+  if (state == ERR_NONE) {
+    state = lora.setSpreadingFactor(settings.spreadingFactor);
+  }
+  if (state == ERR_NONE) {
+    state = lora.setCodingRate(settings.codingRate);
+  }
+  if (state == ERR_NONE) {
+    state = lora.setOutputPower(settings.power);
+  }
+
+  if (state != ERR_NONE) {
+    Log.warning(F("Failed to change LoRa settings, code %d" CR), state);
+    // try to restore previous settings, so that we are in a known state.
+    lora.setBandwidth(this->settings.bandwidth);
+    lora.setSpreadingFactor(this->settings.spreadingFactor);
+    lora.setCodingRate(this->settings.codingRate);
+    lora.setOutputPower(this->settings.power);
+    lora.startReceive();
+    return false;
+  }
+
+  this->settings = settings;
+  lora.startReceive();
+
+  return true;
+}
+
+float SX1278Radio::getLastSNR() const {
+  return lastSNR;
+}
+
+float SX1278Radio::getLastRSSI() const {
+  return lastRSSI;
+}
+
+const RadioSettings& SX1278Radio::getSettings() const {
+  return settings;
+}
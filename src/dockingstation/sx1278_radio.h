@@ -0,0 +1,44 @@
+#ifndef _sx1278_radio_h
+#define _sx1278_radio_h
+
+#include <Arduino.h>
+#include <LoRaLib.h>
+#include "radio.h"
+
+/**
+* Radio implementation for the Semtech SX1278 LoRa modem, using interrupts on DIO0 to detect when a packet has been sent or received.
+*/
+class SX1278Radio : public Radio {
+  public:
+    SX1278Radio();
+    /**
+    * Initialize modem with the specified settings and start listening for packets.
+    * @return true if modem was successfully initialized.
+    */
+    bool begin(const RadioSettings& settings);
+    bool startTransmit(const uint8_t* data, size_t length);
+    bool isTransmitting();
+    size_t readPacket(uint8_t* data, size_t size);
+    float getLastSNR() const;
+    float getLastRSSI() const;
+    const RadioSettings& getSettings() const;
+    bool applySettings(const RadioSettings& settings);
+
+  private:
+    // extra time given the modem to report "TxDone", on top of the computed airtime.
+    static const uint16_t TX_TIMEOUT_MARGIN = 100;   // ms
+
+    // LoRaLib only supports a plain function as interrupt handler, so there can only be one instance of this class.
+    static volatile bool dio0Triggered;
+    static void IRAM_ATTR onDio0();
+
+    SX1278 lora;
+    RadioSettings settings;
+    bool transmitting = false;
+    uint32_t transmitStarted = 0;
+    uint32_t transmitTimeout = 0;
+    float lastSNR = 0;
+    float lastRSSI = 0;
+};
+
+#endif
@@ -0,0 +1,117 @@
+#include <ArduinoLog.h>
+#include "tdma_allocator.h"
+
+TdmaAllocator::TdmaAllocator(uint8_t slotCount, uint16_t slotLength, int8_t minPower, int8_t maxPower) :
+  slotCount(slotCount > tdmaBeacon::MAX_SLOTS ? tdmaBeacon::MAX_SLOTS : slotCount),
+  slotLength(slotLength),
+  adaptiveDataRate(minPower, maxPower) {
+
+  for (uint8_t i = 0; i < tdmaBeacon::MAX_SLOTS; i++) {
+    owners[i] = TdmaSchedule::FREE_SLOT;
+    lastHeard[i] = 0;
+  }
+
+  // mowers start out on the most robust settings.
+  settings = nextSettings = dataRate = adaptiveDataRate.getFallbackSettings();
+}
+
+uint8_t TdmaAllocator::assign(uint16_t address, uint32_t now) {
+  int8_t freeSlot = -1;
+
+  for (uint8_t i = 0; i < slotCount; i++) {
+    if (owners[i] == address) {
+      lastHeard[i] = now;
+      return i + 1;
+    }
+
+    if (freeSlot < 0 && owners[i] == TdmaSchedule::FREE_SLOT) {
+      freeSlot = i;
+    }
+  }
+
+  if (freeSlot < 0) {
+    return 0;
+  }
+
+  owners[freeSlot] = address;
+  lastHeard[freeSlot] = now;
+
+  return freeSlot + 1;
+}
+
+void TdmaAllocator::heard(uint16_t address, uint32_t now, float snr) {
+  for (uint8_t i = 0; i < slotCount; i++) {
+    if (owners[i] == address) {
+      lastHeard[i] = now;
+
+      // measurements from discovery superframes were taken with other settings.
+      if (settings.spreadingFactor == dataRate.spreadingFactor && settings.bandwidth == dataRate.bandwidth && settings.power == dataRate.power) {
+        adaptiveDataRate.addSample(snr);
+      }
+      return;
+    }
+  }
+}
+
+tdmaBeacon TdmaAllocator::nextBeacon(uint32_t now) {
+  tdmaBeacon beacon;
+  beacon.superframe = superframe++;
+  beacon.slotLength = slotLength;
+  beacon.slotCount = slotCount;
+
+  bool anyOwner = false;
+  bool lost = false;
+
+  for (uint8_t i = 0; i < slotCount; i++) {
+    if (owners[i] != TdmaSchedule::FREE_SLOT && now - lastHeard[i] > SLOT_TIMEOUT) {
+      owners[i] = TdmaSchedule::FREE_SLOT;
+    }
+    if (owners[i] != TdmaSchedule::FREE_SLOT) {
+      anyOwner = true;
+      lost = lost || now - lastHeard[i] > LOST_TIMEOUT;
+    }
+    beacon.slotOwners[i] = owners[i];
+  }
+
+  // what was announced in the previous beacon applies from now on.
+  settings = nextSettings;
+
+  auto fallback = adaptiveDataRate.getFallbackSettings();
+  RadioSettings next;
+
+  if (!anyOwner || lost) {
+    if (dataRate.spreadingFactor != fallback.spreadingFactor || dataRate.bandwidth != fallback.bandwidth || dataRate.power != fallback.power) {
+      Log.notice(F("TDMA channel back to SF%d, %s" CR), fallback.spreadingFactor, lost ? "lost a mower" : "no mowers");
+      dataRate = fallback;
+    }
+    adaptiveDataRate.reset();
+  } else if (adaptiveDataRate.evaluate(dataRate, next)) {
+    Log.notice(F("TDMA channel changes to SF%d, %d kHz, %d dBm (worst SNR %F dB)" CR), next.spreadingFactor, (int)next.bandwidth, next.power, adaptiveDataRate.getWorstSNR());
+    dataRate = next;
+    // measurements taken with old settings don't apply anymore.
+    adaptiveDataRate.reset();
+  }
+
+  nextSettings = superframe % DISCOVERY_INTERVAL == 0 ? fallback : dataRate;
+  beacon.nextSettings = nextSettings;
+
+  return beacon;
+}
+
+const RadioSettings& TdmaAllocator::getSettings() const {
+  return settings;
+}
+
+uint16_t TdmaAllocator::getSlotOwner(uint32_t offset) const {
+  uint8_t index = (offset % getSuperframeLength()) / slotLength;
+
+  if (index == 0 || index > slotCount) {
+    return TdmaSchedule::FREE_SLOT;
+  }
+
+  return owners[index - 1];
+}
+
+uint32_t TdmaAllocator::getSuperframeLength() const {
+  return (uint32_t)(slotCount + 2) * slotLength;
+}
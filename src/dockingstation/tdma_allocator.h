@@ -0,0 +1,70 @@
+#ifndef _tdma_allocator_h
+#define _tdma_allocator_h
+
+#include <Arduino.h>
+#include "tdma_schedule.h"
+#include "adaptive_data_rate.h"
+
+/**
+* Docking station side of the TDMA schedule (see tdma_schedule.h), keeps track of slots and picks the data rate for the channel.
+* Not used by the mower itself, it's left out of the mower build (see platformio.ini) and kept here next to TdmaSchedule since both
+* ends have to agree on the beacon.
+*
+* All mowers must hear the beacons, so the channel can be no faster than the weakest link allows. Link quality to every mower
+* feeds one AdaptiveDataRate, which therefore goes by the worst of them. The data rate is announced in each beacon and used from
+* the next superframe on.
+* A mower that has fallen back to the most robust settings (starting up, or lost after missing a change) can't hear us at a faster
+* data rate. Every DISCOVERY_INTERVAL superframe therefore uses the most robust settings, so such mowers can find the schedule again,
+* and if a mower with a slot goes quiet we fall back entirely and work our way up again.
+*/
+class TdmaAllocator {
+  public:
+    /**
+    * @param slotCount number of mower slots (max tdmaBeacon::MAX_SLOTS).
+    * @param slotLength length of each slot (ms), should fit a few frames and their acknowledgement with the slowest data rate.
+    * @param minPower lowest output power (dBm) to use.
+    * @param maxPower highest output power (dBm) to use, see your local regulations.
+    */
+    TdmaAllocator(uint8_t slotCount, uint16_t slotLength, int8_t minPower, int8_t maxPower);
+    /**
+    * Assign a slot to mower, mowers that already have a slot keep it.
+    * @return assigned slot, 0 if all slots are taken.
+    */
+    uint8_t assign(uint16_t address, uint32_t now);
+    /**
+    * Should be called for every frame heard from a mower, to keep its slot.
+    * @param snr link quality (dB) to mower, the worst of what we measure and what the mower reports.
+    */
+    void heard(uint16_t address, uint32_t now, float snr);
+    /**
+    * Build beacon for next superframe, slots of mowers we have not heard from within SLOT_TIMEOUT are released.
+    * Radio should be switched to getSettings() before the beacon is sent.
+    */
+    tdmaBeacon nextBeacon(uint32_t now);
+    /**
+    * Settings to use for the superframe of the latest beacon.
+    */
+    const RadioSettings& getSettings() const;
+    /**
+    * Returns address of mower owning the slot at the specified time since start of superframe, TdmaSchedule::FREE_SLOT for beacon, contention and unassigned slots.
+    */
+    uint16_t getSlotOwner(uint32_t offset) const;
+    uint32_t getSuperframeLength() const;
+
+  private:
+    static const uint32_t SLOT_TIMEOUT = 60000;     // Release slot if we have not heard from mower within this time (ms).
+    static const uint16_t LOST_TIMEOUT = 30000;     // Mower with a slot that has been quiet this long (ms) has fallen back to the most robust settings, same as link timeout.
+    static const uint8_t DISCOVERY_INTERVAL = 30;   // Every this many superframes runs at the most robust settings, so mowers listening on them can find us.
+
+    uint8_t slotCount;
+    uint16_t slotLength;
+    uint16_t superframe = 0;
+    uint16_t owners[tdmaBeacon::MAX_SLOTS];
+    uint32_t lastHeard[tdmaBeacon::MAX_SLOTS];
+    AdaptiveDataRate adaptiveDataRate;
+    RadioSettings settings;     // used in current superframe.
+    RadioSettings nextSettings; // announced in latest beacon.
+    RadioSettings dataRate;     // what the weakest mower can handle, used in all superframes but the discovery ones.
+};
+
+#endif
@@ -0,0 +1,259 @@
+#include <ArduinoLog.h>
+#include <pb_encode.h>
+#include <pb_decode.h>
+#include "tdma_schedule.h"
+
+// Protobuf field numbers, see sign_on.proto and sign_on_resp.proto.
+static const uint32_t SIGN_ON_ADDRESS_TAG = 1;
+static const uint32_t SIGN_ON_MOWER_ID_TAG = 2;
+static const uint32_t SIGN_ON_VERSION_TAG = 3;
+static const uint32_t SIGN_ON_RESP_ADDRESS_TAG = 1;
+static const uint32_t SIGN_ON_RESP_SLOT_TAG = 2;
+
+static const uint8_t BEACON_HEADER_SIZE = 10;
+
+const uint8_t tdmaBeacon::MAX_SLOTS;
+
+TdmaSchedule::TdmaSchedule(uint16_t localAddress) : localAddress(localAddress) { }
+
+void TdmaSchedule::onBeacon(const uint8_t* data, size_t length, uint32_t startTime) {
+  tdmaBeacon beacon;
+
+  if (!decodeBeacon(data, length, beacon)) {
+    Log.notice(F("Invalid TDMA beacon" CR));
+    return;
+  }
+
+  if (!hasBeacon) {
+    Log.notice(F("Following TDMA schedule from docking station, %d slots of %d ms" CR), beacon.slotCount, beacon.slotLength);
+  }
+
+  hasBeacon = true;
+  superframeStart = startTime;
+  superframe = beacon.superframe;
+  slotLength = beacon.slotLength;
+  slotCount = beacon.slotCount;
+  superframeLength = (uint32_t)(slotCount + 2) * slotLength;
+  nextSettings = beacon.nextSettings;
+
+  // beacon is the authority on who owns which slot, we may have been released after being out of reach.
+  uint8_t newSlot = 0;
+  for (uint8_t i = 0; i < slotCount; i++) {
+    if (beacon.slotOwners[i] == localAddress) {
+      newSlot = i + 1;
+      break;
+    }
+  }
+
+  if (newSlot != slot) {
+    Log.notice(F("TDMA slot changed from %d to %d" CR), slot, newSlot);
+    slot = newSlot;
+  }
+
+  signOnDelay = random(slotLength / 2);
+}
+
+void TdmaSchedule::onSignOnResponse(const uint8_t* data, size_t length) {
+  pb_istream_t stream = pb_istream_from_buffer(data, length);
+  pb_wire_type_t wireType;
+  uint32_t tag;
+  bool eof = false;
+  uint64_t address = FREE_SLOT;
+  uint64_t assignedSlot = 0;
+
+  while (pb_decode_tag(&stream, &wireType, &tag, &eof)) {
+    if (wireType == PB_WT_VARINT && tag == SIGN_ON_RESP_ADDRESS_TAG) {
+      if (!pb_decode_varint(&stream, &address)) {
+        return;
+      }
+    } else if (wireType == PB_WT_VARINT && tag == SIGN_ON_RESP_SLOT_TAG) {
+      if (!pb_decode_varint(&stream, &assignedSlot)) {
+        return;
+      }
+    } else if (!pb_skip_field(&stream, wireType)) {
+      return;
+    }
+  }
+
+  if (!eof || address != localAddress) {
+    return;
+  }
+
+  if (assignedSlot == 0 || assignedSlot > slotCount) {
+    Log.notice(F("Docking station has no free TDMA slot for us" CR));
+    return;
+  }
+
+  slot = assignedSlot;
+  Log.notice(F("Got TDMA slot %d" CR), slot);
+}
+
+bool TdmaSchedule::canTransmit(uint32_t now, uint32_t duration, bool control, bool reply) const {
+  if (!isSynchronized(now)) {
+    return true;
+  }
+
+  uint32_t remaining;
+  auto index = getSlotIndex(now, remaining);
+
+  // don't run into next slot.
+  if (duration + GUARD_TIME > remaining) {
+    return false;
+  }
+
+  if (slot != 0 && index == slot) {
+    return true;
+  }
+
+  // docking station sends its messages in the beacon slot, and answers sign on requests in the contention slot.
+  if (index == 0) {
+    return reply;
+  }
+
+  if (index == slotCount + 1) {
+    return reply || (slot == 0 && control && slotLength - remaining >= signOnDelay);
+  }
+
+  return false;
+}
+
+bool TdmaSchedule::isSynchronized(uint32_t now) const {
+  return hasBeacon && now - superframeStart < SYNC_TIMEOUT * superframeLength;
+}
+
+bool TdmaSchedule::needsSignOn(uint32_t now) const {
+  return isSynchronized(now) && slot == 0 && (!signOnSent || (uint16_t)(superframe - signOnSuperframe) >= SIGN_ON_RETRY);
+}
+
+bool TdmaSchedule::getNextSettings(uint32_t now, RadioSettings& settings) const {
+  if (!isSynchronized(now) || now - superframeStart < superframeLength) {
+    return false;
+  }
+
+  settings = nextSettings;
+
+  return true;
+}
+
+uint8_t TdmaSchedule::getSlot() const {
+  return slot;
+}
+
+size_t TdmaSchedule::encodeSignOn(uint8_t* buffer, size_t size, const char* mowerId, const char* version) {
+  pb_ostream_t stream = pb_ostream_from_buffer(buffer, size);
+
+  bool success = pb_encode_tag(&stream, PB_WT_VARINT, SIGN_ON_ADDRESS_TAG) &&
+                 pb_encode_varint(&stream, localAddress) &&
+                 pb_encode_tag(&stream, PB_WT_STRING, SIGN_ON_MOWER_ID_TAG) &&
+                 pb_encode_string(&stream, (const pb_byte_t*)mowerId, strlen(mowerId)) &&
+                 pb_encode_tag(&stream, PB_WT_STRING, SIGN_ON_VERSION_TAG) &&
+                 pb_encode_string(&stream, (const pb_byte_t*)version, strlen(version));
+
+  if (!success) {
+    return 0;
+  }
+
+  signOnSent = true;
+  signOnSuperframe = superframe;
+
+  return stream.bytes_written;
+}
+
+/**
+ * Which slot we are in right now, and how much time (ms) is left of it.
+ */
+uint8_t TdmaSchedule::getSlotIndex(uint32_t now, uint32_t& remaining) const {
+  uint32_t offset = (now - superframeStart) % superframeLength;
+  remaining = slotLength - offset % slotLength;
+
+  return offset / slotLength;
+}
+
+size_t TdmaSchedule::encodeBeacon(const tdmaBeacon& beacon, uint8_t* buffer, size_t size) {
+  size_t length = BEACON_HEADER_SIZE + 2 * beacon.slotCount;
+
+  if (beacon.slotCount > tdmaBeacon::MAX_SLOTS || size < length) {
+    return 0;
+  }
+
+  buffer[0] = beacon.superframe;
+  buffer[1] = beacon.superframe >> 8;
+  buffer[2] = beacon.slotLength;
+  buffer[3] = beacon.slotLength >> 8;
+  buffer[4] = beacon.slotCount;
+  buffer[5] = beacon.nextSettings.spreadingFactor;
+  uint16_t bandwidth = roundf(beacon.nextSettings.bandwidth * 10);
+  buffer[6] = bandwidth;
+  buffer[7] = bandwidth >> 8;
+  buffer[8] = beacon.nextSettings.codingRate;
+  buffer[9] = beacon.nextSettings.power;
+
+  for (uint8_t i = 0; i < beacon.slotCount; i++) {
+    buffer[BEACON_HEADER_SIZE + 2 * i] = beacon.slotOwners[i];
+    buffer[BEACON_HEADER_SIZE + 2 * i + 1] = beacon.slotOwners[i] >> 8;
+  }
+
+  return length;
+}
+
+bool TdmaSchedule::decodeBeacon(const uint8_t* data, size_t length, tdmaBeacon& beacon) {
+  if (length < BEACON_HEADER_SIZE) {
+    return false;
+  }
+
+  beacon.superframe = data[0] | (data[1] << 8);
+  beacon.slotLength = data[2] | (data[3] << 8);
+  beacon.slotCount = data[4];
+  beacon.nextSettings.spreadingFactor = data[5];
+  beacon.nextSettings.bandwidth = (data[6] | (data[7] << 8)) / 10.0f;
+  beacon.nextSettings.codingRate = data[8];
+  beacon.nextSettings.power = (int8_t)data[9];
+  beacon.nextSettings.preambleLength = 0;
+
+  if (beacon.slotLength == 0 || beacon.nextSettings.spreadingFactor < 6 || beacon.nextSettings.spreadingFactor > 12 || beacon.nextSettings.bandwidth == 0 || beacon.slotCount > tdmaBeacon::MAX_SLOTS || length < (size_t)(BEACON_HEADER_SIZE + 2 * beacon.slotCount)) {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < beacon.slotCount; i++) {
+    beacon.slotOwners[i] = data[BEACON_HEADER_SIZE + 2 * i] | (data[BEACON_HEADER_SIZE + 2 * i + 1] << 8);
+  }
+
+  return true;
+}
+
+size_t TdmaSchedule::encodeSignOnResponse(uint16_t address, uint8_t slot, uint8_t* buffer, size_t size) {
+  pb_ostream_t stream = pb_ostream_from_buffer(buffer, size);
+
+  if (!pb_encode_tag(&stream, PB_WT_VARINT, SIGN_ON_RESP_ADDRESS_TAG) || !pb_encode_varint(&stream, address)) {
+    return 0;
+  }
+
+  if (slot > 0 && (!pb_encode_tag(&stream, PB_WT_VARINT, SIGN_ON_RESP_SLOT_TAG) || !pb_encode_varint(&stream, slot))) {
+    return 0;
+  }
+
+  return stream.bytes_written;
+}
+
+bool TdmaSchedule::decodeSignOn(const uint8_t* data, size_t length, uint16_t& address) {
+  pb_istream_t stream = pb_istream_from_buffer(data, length);
+  pb_wire_type_t wireType;
+  uint32_t tag;
+  bool eof = false;
+  bool hasAddress = false;
+
+  while (pb_decode_tag(&stream, &wireType, &tag, &eof)) {
+    if (wireType == PB_WT_VARINT && tag == SIGN_ON_ADDRESS_TAG) {
+      uint64_t value;
+      if (!pb_decode_varint(&stream, &value)) {
+        return false;
+      }
+      address = value;
+      hasAddress = true;
+    } else if (!pb_skip_field(&stream, wireType)) {
+      return false;
+    }
+  }
+
+  return eof && hasAddress;
+}
@@ -0,0 +1,113 @@
+#ifndef _tdma_schedule_h
+#define _tdma_schedule_h
+
+#include <Arduino.h>
+#include "radio.h"
+
+/**
+* Beacon broadcasted by the docking station at the start of each superframe.
+*/
+struct tdmaBeacon {
+  static const uint8_t MAX_SLOTS = 8;
+
+  uint16_t superframe;              // increased by one for each superframe.
+  uint16_t slotLength;              // in milliseconds
+  uint8_t slotCount;                // number of mower slots.
+  RadioSettings nextSettings;       // modulation everyone uses from next superframe on, preamble length is not included.
+  uint16_t slotOwners[MAX_SLOTS];   // link address of mower owning each mower slot, FREE_SLOT if not assigned.
+};
+
+/**
+* Time-division multiple access for several mowers sharing one docking station channel.
+*
+* The docking station divides time into superframes, each made up of equally long slots:
+*   slot 0                    beacon from docking station, marks the start of the superframe and tells which mower owns which slot.
+*                             The docking station sends its own messages after the beacon, mowers may only acknowledge them.
+*   slot 1 -> slotCount       one slot per mower, only the owner (and the docking station, when acknowledging) may transmit.
+*   slot slotCount + 1        contention slot, mowers without a slot sign on here (SignOn/SignOnResp, see sign_on.proto).
+*
+* Since every mower only transmits in its own slot there are no collisions, and total throughput grows with the number of mowers.
+* As long as we have not heard any beacon (e.g. docking station without TDMA support) or have lost track of them, we transmit freely.
+*
+* All mowers have to hear the beacons, so the docking station picks one data rate for everyone (see TdmaAllocator) and announces it
+* in each beacon. Both ends switch when the superframe ends, a mower missing the announcement loses the schedule and falls back to the
+* most robust settings until it hears a beacon again.
+*
+* Beacon (after message type):
+*   0-1 superframe, 2-3 slot length (ms), 4 slot count, 5 spreading factor, 6-7 bandwidth (in 100 Hz), 8 coding rate, 9 output power (int8)
+*   of next superframe, then slot count * owner address (uint16), all little endian.
+*/
+class TdmaSchedule {
+  public:
+    static const uint16_t FREE_SLOT = 0xFFFF;
+
+    TdmaSchedule(uint16_t localAddress);
+    /**
+    * Handle beacon received from docking station.
+    * @param startTime time (millis) when docking station started sending beacon, i.e. start of superframe.
+    */
+    void onBeacon(const uint8_t* data, size_t length, uint32_t startTime);
+    /**
+    * Handle response to our sign on request.
+    */
+    void onSignOnResponse(const uint8_t* data, size_t length);
+    /**
+    * Returns if we may start a transmission now.
+    * @param duration time (ms) needed, including any reply we expect.
+    * @param control if transmission belongs to a control message (sign on requests and their acknowledgements may go in the contention slot).
+    * @param reply if transmission is a reply to the docking station (acknowledgement), these may also go in the beacon and contention slots.
+    */
+    bool canTransmit(uint32_t now, uint32_t duration, bool control, bool reply) const;
+    /**
+    * Returns if we follow a schedule from the docking station.
+    */
+    bool isSynchronized(uint32_t now) const;
+    /**
+    * Returns if we should send a sign on request, we are following a schedule but have no slot.
+    */
+    bool needsSignOn(uint32_t now) const;
+    /**
+    * Returns settings announced by docking station, once the superframe they were announced in has ended.
+    * @return false if we are not following a schedule or we are still in the superframe of the announcement.
+    */
+    bool getNextSettings(uint32_t now, RadioSettings& settings) const;
+    /**
+    * Returns our slot, 0 if we don't have one.
+    */
+    uint8_t getSlot() const;
+    /**
+    * Encode a SignOn message (sign_on.proto) for this mower, needsSignOn() will return false until it's time to try again.
+    * @return length of message, 0 if it didn't fit in buffer.
+    */
+    size_t encodeSignOn(uint8_t* buffer, size_t size, const char* mowerId, const char* version);
+
+    static size_t encodeBeacon(const tdmaBeacon& beacon, uint8_t* buffer, size_t size);
+    static bool decodeBeacon(const uint8_t* data, size_t length, tdmaBeacon& beacon);
+    static size_t encodeSignOnResponse(uint16_t address, uint8_t slot, uint8_t* buffer, size_t size);
+    /**
+    * Decode SignOn message, only the address is of interest for slot assignment.
+    */
+    static bool decodeSignOn(const uint8_t* data, size_t length, uint16_t& address);
+
+  private:
+    static const uint8_t GUARD_TIME = 20;           // Margin (ms) to end of slot, covers clock drift and processing delays.
+    static const uint8_t SYNC_TIMEOUT = 4;          // Consider schedule lost after missing this many beacons in a row.
+    static const uint16_t SIGN_ON_RETRY = 2;        // Wait this many superframes for a response before trying again.
+
+    uint16_t localAddress;
+    bool hasBeacon = false;
+    uint32_t superframeStart = 0;
+    uint32_t superframeLength = 0;
+    uint16_t superframe = 0;
+    uint16_t slotLength = 0;
+    uint8_t slotCount = 0;
+    uint8_t slot = 0;
+    RadioSettings nextSettings;
+    uint16_t signOnDelay = 0;   // random delay (ms) into contention slot before we send sign on request, so that mowers starting together don't keep colliding.
+    uint16_t signOnSuperframe = 0;
+    bool signOnSent = false;
+
+    uint8_t getSlotIndex(uint32_t now, uint32_t& remaining) const;
+};
+
+#endif
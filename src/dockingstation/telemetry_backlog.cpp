@@ -0,0 +1,231 @@
+#include <ArduinoLog.h>
+#include <pb_encode.h>
+#include <pb_decode.h>
+#include "telemetry_backlog.h"
+
+TelemetryBacklog::TelemetryBacklog(FlashRing& ring, size_t maxBatchSize, const SendCallback& fn) :
+  ring(ring),
+  maxBatchSize(maxBatchSize),
+  sendCallback(fn),
+  batch(maxBatchSize) { }
+
+void TelemetryBacklog::store(const telemetryRecord& record) {
+  uint8_t buffer[telemetryRecord::SIZE];
+  encodeRecord(record, buffer);
+
+  if (ring.push(buffer)) {
+    statistics.recordsStored++;
+  }
+}
+
+void TelemetryBacklog::process(uint32_t now, bool linkIdle) {
+  // refill bucket, it holds at most one full batch so that we can't build up a burst while the link is down.
+  tokens += (now - lastRefill) * RATE / 1000.0f;
+  if (tokens > maxBatchSize) {
+    tokens = maxBatchSize;
+  }
+  lastRefill = now;
+
+  if (!linkIdle || inFlight || ring.size() == 0 || tokens < maxBatchSize) {
+    return;
+  }
+
+  telemetryRecord records[MAX_BATCH_RECORDS];
+  uint8_t count = 0;
+  auto first = ring.getFirst();
+
+  while (count < MAX_BATCH_RECORDS && count < ring.size()) {
+    uint8_t buffer[telemetryRecord::SIZE];
+
+    if (!ring.read(count, buffer)) {
+      break;
+    }
+    decodeRecord(buffer, records[count++]);
+  }
+
+  uint8_t encoded;
+  auto length = encodeBatch(records, count, batch.data(), batch.size(), encoded);
+
+  if (encoded == 0) {
+    return;
+  }
+
+  inFlight = true;
+
+  bool queued = sendCallback(batch.data(), length, [this, first, encoded, length](bool success) {
+    inFlight = false;
+
+    if (!success) {
+      // records are still in flash, they will go in a later batch.
+      statistics.batchesFailed++;
+      return;
+    }
+
+    ring.discardUntil(first + encoded);
+    statistics.batchesSent++;
+    statistics.recordsUploaded += encoded;
+    statistics.bytesSent += length;
+    statistics.rawBytes += encoded * telemetryRecord::SIZE;
+
+    if (ring.size() == 0) {
+      Log.notice(F("Telemetry backlog uploaded" CR));
+    }
+  });
+
+  if (!queued) {
+    inFlight = false;
+    return;
+  }
+
+  tokens -= length;
+}
+
+uint32_t TelemetryBacklog::getPending() const {
+  return ring.size();
+}
+
+const backlogStatistics& TelemetryBacklog::getStatistics() const {
+  return statistics;
+}
+
+void TelemetryBacklog::encodeRecord(const telemetryRecord& record, uint8_t* buffer) {
+  buffer[0] = record.time;
+  buffer[1] = record.time >> 8;
+  buffer[2] = record.time >> 16;
+  buffer[3] = record.time >> 24;
+  buffer[4] = record.batteryVoltage;
+  buffer[5] = record.batteryVoltage >> 8;
+  buffer[6] = record.chargeCurrent;
+  buffer[7] = record.chargeCurrent >> 8;
+  buffer[8] = record.heading;
+  buffer[9] = record.heading >> 8;
+  buffer[10] = record.pitch;
+  buffer[11] = record.roll;
+  buffer[12] = record.cutterLoad;
+  buffer[13] = record.batteryLevel;
+  buffer[14] = record.state;
+  buffer[15] = record.flags;
+}
+
+void TelemetryBacklog::decodeRecord(const uint8_t* buffer, telemetryRecord& record) {
+  record.time = buffer[0] | (buffer[1] << 8) | (buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+  record.batteryVoltage = buffer[4] | (buffer[5] << 8);
+  record.chargeCurrent = buffer[6] | (buffer[7] << 8);
+  record.heading = buffer[8] | (buffer[9] << 8);
+  record.pitch = buffer[10];
+  record.roll = buffer[11];
+  record.cutterLoad = buffer[12];
+  record.batteryLevel = buffer[13];
+  record.state = buffer[14];
+  record.flags = buffer[15];
+}
+
+size_t TelemetryBacklog::encodeBatch(const telemetryRecord* records, uint8_t count, uint8_t* buffer, size_t size, uint8_t& encoded) {
+  encoded = 0;
+
+  if (size < 1) {
+    return 0;
+  }
+
+  int32_t previous[FIELD_COUNT] = {0};
+  size_t length = 1;
+
+  for (uint8_t i = 0; i < count; i++) {
+    int32_t fields[FIELD_COUNT];
+    toFields(records[i], fields);
+
+    uint32_t mask = 0;
+    for (uint8_t field = 0; field < FIELD_COUNT; field++) {
+      if (fields[field] != previous[field]) {
+        mask |= 1 << field;
+      }
+    }
+
+    pb_ostream_t stream = pb_ostream_from_buffer(buffer + length, size - length);
+    bool success = pb_encode_varint(&stream, mask);
+
+    for (uint8_t field = 0; field < FIELD_COUNT && success; field++) {
+      if (mask & (1 << field)) {
+        success = pb_encode_svarint(&stream, fields[field] - previous[field]);
+      }
+    }
+
+    if (!success) {
+      // record didn't fit, it goes in next batch.
+      break;
+    }
+
+    length += stream.bytes_written;
+    encoded++;
+    memcpy(previous, fields, sizeof(previous));
+  }
+
+  buffer[0] = encoded;
+
+  return length;
+}
+
+bool TelemetryBacklog::decodeBatch(const uint8_t* data, size_t length, telemetryRecord* records, uint8_t maxCount, uint8_t& count) {
+  count = 0;
+
+  if (length < 1) {
+    return false;
+  }
+
+  pb_istream_t stream = pb_istream_from_buffer(data + 1, length - 1);
+  int32_t fields[FIELD_COUNT] = {0};
+
+  for (uint8_t i = 0; i < data[0]; i++) {
+    uint64_t mask;
+
+    if (!pb_decode_varint(&stream, &mask)) {
+      return false;
+    }
+
+    for (uint8_t field = 0; field < FIELD_COUNT; field++) {
+      if (mask & (1 << field)) {
+        int64_t delta;
+
+        if (!pb_decode_svarint(&stream, &delta)) {
+          return false;
+        }
+        fields[field] += delta;
+      }
+    }
+
+    if (count < maxCount) {
+      fromFields(fields, records[count++]);
+    }
+  }
+
+  return stream.bytes_left == 0;
+}
+
+/**
+ * Fields in order of how often they change, so that the field mask usually fits in a single byte.
+ */
+void TelemetryBacklog::toFields(const telemetryRecord& record, int32_t (&fields)[FIELD_COUNT]) {
+  fields[0] = record.time;
+  fields[1] = record.batteryVoltage;
+  fields[2] = record.chargeCurrent;
+  fields[3] = record.heading;
+  fields[4] = record.pitch;
+  fields[5] = record.roll;
+  fields[6] = record.cutterLoad;
+  fields[7] = record.batteryLevel;
+  fields[8] = record.state;
+  fields[9] = record.flags;
+}
+
+void TelemetryBacklog::fromFields(const int32_t (&fields)[FIELD_COUNT], telemetryRecord& record) {
+  record.time = fields[0];
+  record.batteryVoltage = fields[1];
+  record.chargeCurrent = fields[2];
+  record.heading = fields[3];
+  record.pitch = fields[4];
+  record.roll = fields[5];
+  record.cutterLoad = fields[6];
+  record.batteryLevel = fields[7];
+  record.state = fields[8];
+  record.flags = fields[9];
+}
@@ -0,0 +1,104 @@
+#ifndef _telemetry_backlog_h
+#define _telemetry_backlog_h
+
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+#include "flash_ring.h"
+
+/**
+* Telemetry sample kept while we can't reach the docking station.
+*/
+struct telemetryRecord {
+  static const uint8_t SIZE = 16;             // Size when stored in flash.
+  static const uint8_t FLAG_CHARGING = 0x01;
+  static const uint8_t FLAG_CUTTING = 0x02;
+  static const uint8_t FLAG_UPTIME = 0x04;    // time is seconds since boot, we had no clock.
+
+  uint32_t time = 0;            // seconds since epoch (or since boot, see FLAG_UPTIME).
+  uint16_t batteryVoltage = 0;  // millivolt
+  int16_t chargeCurrent = 0;    // milliampere
+  uint16_t heading = 0;         // degrees
+  int8_t pitch = 0;             // degrees
+  int8_t roll = 0;              // degrees
+  uint8_t cutterLoad = 0;       // percent
+  uint8_t batteryLevel = 0;     // percent
+  uint8_t state = 0;            // Definitions::MOWER_STATES
+  uint8_t flags = 0;
+};
+
+struct backlogStatistics {
+  uint32_t recordsStored = 0;
+  uint32_t recordsUploaded = 0;
+  uint32_t batchesSent = 0;
+  uint32_t batchesFailed = 0;
+  uint32_t bytesSent = 0;
+  uint32_t rawBytes = 0;      // what the uploaded records take uncompressed, compare with bytesSent.
+};
+
+/**
+* Store-and-forward of telemetry while the link to the docking station is down.
+* Records are stored in a ring on flash, and uploaded in compressed batches once the link is back. Uploads are rate limited (token bucket)
+* and only done when the link has nothing else to send, so the backlog never delays live status or control messages.
+* A batch is removed from flash first when the docking station has acknowledged it.
+*
+* Batch: record count (uint8), then for each record a field mask (varint, bit position = field in the order of telemetryRecord),
+* followed by the fields in the mask as the difference from the previous record (zigzag varint). Fields that have not changed are left out,
+* so most records only take a few bytes.
+*/
+class TelemetryBacklog {
+  public:
+    typedef std::function<void(bool success)> DeliveredCallback;
+    /**
+    * Send batch to docking station, fn should be called once delivered (or given up on).
+    * @return false if batch could not be queued.
+    */
+    typedef std::function<bool(const uint8_t* data, size_t length, const DeliveredCallback& fn)> SendCallback;
+
+    static const uint8_t MAX_BATCH_RECORDS = 32;
+
+    /**
+    * @param ring ring to store records in, must have record size telemetryRecord::SIZE.
+    * @param maxBatchSize max size of a batch, preferably what fits in a single link frame.
+    */
+    TelemetryBacklog(FlashRing& ring, size_t maxBatchSize, const SendCallback& fn);
+    void store(const telemetryRecord& record);
+    /**
+    * Upload next batch, if there is anything to upload and budget allows.
+    * @param linkIdle if link is up and has nothing else to send.
+    */
+    void process(uint32_t now, bool linkIdle);
+    uint32_t getPending() const;
+    const backlogStatistics& getStatistics() const;
+
+    static void encodeRecord(const telemetryRecord& record, uint8_t* buffer);
+    static void decodeRecord(const uint8_t* buffer, telemetryRecord& record);
+    /**
+    * Compress as many records as fits into buffer.
+    * @param encoded number of records that fit.
+    * @return length of batch.
+    */
+    static size_t encodeBatch(const telemetryRecord* records, uint8_t count, uint8_t* buffer, size_t size, uint8_t& encoded);
+    /**
+    * @param count number of records decoded (at most maxCount).
+    */
+    static bool decodeBatch(const uint8_t* data, size_t length, telemetryRecord* records, uint8_t maxCount, uint8_t& count);
+
+  private:
+    static const uint16_t RATE = 20;  // Max upload rate (bytes/second), keep this well below what the slowest data rate can do.
+    static const uint8_t FIELD_COUNT = 10;
+
+    FlashRing& ring;
+    size_t maxBatchSize;
+    SendCallback sendCallback;
+    std::vector<uint8_t> batch;
+    float tokens = 0;
+    uint32_t lastRefill = 0;
+    bool inFlight = false;
+    backlogStatistics statistics;
+
+    static void toFields(const telemetryRecord& record, int32_t (&fields)[FIELD_COUNT]);
+    static void fromFields(const int32_t (&fields)[FIELD_COUNT], telemetryRecord& record);
+};
+
+#endif
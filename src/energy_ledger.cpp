@@ -0,0 +1,178 @@
+#include <ArduinoLog.h>
+#include "energy_ledger.h"
+#include "configuration.h"
+
+// Must be in the same order as Definitions::MOWER_STATES.
+static const char* const STATE_NAMES[EnergyLedger::STATE_COUNT] = {
+  "DOCKED", "LAUNCHING", "MOWING", "DOCKING", "CHARGING", "STUCK", "FLIPPED", "MANUAL", "STOP", "TEST"
+};
+
+// Must be in the same order as EnergyLedger::ACTIVITY.
+static const char* const ACTIVITY_NAMES[EnergyLedger::ACTIVITY_COUNT] = {
+  "cutting", "driving", "turning", "electronics"
+};
+
+EnergyLedger::EnergyLedger(Battery& battery, WheelController& wheelController, Cutter& cutter, PoseEstimator& poseEstimator) :
+  battery(battery),
+  wheelController(wheelController),
+  cutter(cutter),
+  poseEstimator(poseEstimator) { }
+
+void EnergyLedger::start() {
+  Configuration::preferences.begin("liam-esp", false);
+
+  energyCounters stored;
+  if (Configuration::preferences.getBytesLength("energy") == sizeof(stored) &&
+      Configuration::preferences.getBytes("energy", &stored, sizeof(stored)) == sizeof(stored) &&
+      stored.version == COUNTERS_VERSION) {
+    counters = stored;
+  }
+
+  lastUpdate = millis();
+  lastSave = lastUpdate;
+  lastTravelled = poseEstimator.getTravelled();
+
+  Log.notice(F("Energy used: %F Wh, %F m2 mowed" CR), getTotalEnergy(), getMowedArea());
+}
+
+void EnergyLedger::setState(Definitions::MOWER_STATES state) {
+  // book what has been used so far on the state we are leaving.
+  update();
+  this->state = static_cast<uint8_t>(state);
+  save();
+}
+
+double EnergyLedger::getEnergy(Definitions::MOWER_STATES state, ACTIVITY activity) const {
+  return counters.energy[static_cast<uint8_t>(state)][activity];
+}
+
+double EnergyLedger::getEnergy(Definitions::MOWER_STATES state) const {
+  double energy = 0;
+
+  for (uint8_t activity = 0; activity < ACTIVITY_COUNT; activity++) {
+    energy += counters.energy[static_cast<uint8_t>(state)][activity];
+  }
+
+  return energy;
+}
+
+double EnergyLedger::getTime(Definitions::MOWER_STATES state) const {
+  return counters.time[static_cast<uint8_t>(state)];
+}
+
+double EnergyLedger::getTotalEnergy() const {
+  double energy = 0;
+
+  for (uint8_t state = 0; state < STATE_COUNT; state++) {
+    energy += getEnergy(static_cast<Definitions::MOWER_STATES>(state));
+  }
+
+  return energy;
+}
+
+double EnergyLedger::getChargedEnergy() const {
+  return counters.charged;
+}
+
+double EnergyLedger::getMowedArea() const {
+  return counters.mowedArea;
+}
+
+float EnergyLedger::getAreaPerWh() const {
+  auto energy = getEnergy(Definitions::MOWER_STATES::MOWING);
+
+  return energy > 0 ? counters.mowedArea / energy : 0;
+}
+
+float EnergyLedger::getWhPerMowingHour() const {
+  auto time = getTime(Definitions::MOWER_STATES::MOWING);
+
+  return time > 0 ? getEnergy(Definitions::MOWER_STATES::MOWING) / (time / 3600) : 0;
+}
+
+void EnergyLedger::printJson(Print& output) const {
+  output.print(F("{\"states\":{"));
+
+  for (uint8_t state = 0; state < STATE_COUNT; state++) {
+    if (state > 0) {
+      output.print(',');
+    }
+
+    output.print('"');
+    output.print(STATE_NAMES[state]);
+    output.print(F("\":{\"time\":"));
+    output.print(counters.time[state], 0);
+
+    for (uint8_t activity = 0; activity < ACTIVITY_COUNT; activity++) {
+      output.print(F(",\""));
+      output.print(ACTIVITY_NAMES[activity]);
+      output.print(F("\":"));
+      output.print(counters.energy[state][activity], 2);
+    }
+
+    output.print('}');
+  }
+
+  output.print(F("},\"total\":"));
+  output.print(getTotalEnergy(), 2);
+  output.print(F(",\"charged\":"));
+  output.print(counters.charged, 2);
+  output.print(F(",\"mowedArea\":"));
+  output.print(counters.mowedArea, 1);
+  output.print(F(",\"areaPerWh\":"));
+  output.print(getAreaPerWh(), 2);
+  output.print(F(",\"whPerMowingHour\":"));
+  output.print(getWhPerMowingHour(), 1);
+  output.print('}');
+}
+
+void EnergyLedger::reset() {
+  counters = energyCounters();
+  save();
+  Log.notice(F("Energy counters cleared." CR));
+}
+
+void EnergyLedger::process() {
+  if (millis() - lastUpdate < UPDATE_INTERVAL) {
+    return;
+  }
+
+  update();
+
+  if (millis() - lastSave >= SAVE_INTERVAL * 1000UL) {
+    save();
+  }
+}
+
+void EnergyLedger::update() {
+  auto now = millis();
+  float seconds = (now - lastUpdate) / 1000.0f;
+  lastUpdate = now;
+
+  auto& load = battery.getLoad();
+  auto wheelStats = wheelController.getStatus();
+  // mA over time into Wh.
+  double toWh = battery.getBatteryVoltage() * seconds / 3600 / 1000;
+  // a wheel standing still or going backwards while the other goes forward, the mower is turning rather than going anywhere.
+  bool turning = wheelStats.leftWheelSpeed * wheelStats.rightWheelSpeed <= 0 && wheelStats.leftWheelSpeed != wheelStats.rightWheelSpeed;
+
+  auto& energy = counters.energy[state];
+  energy[CUTTING] += load.cutter * toWh;
+  energy[turning ? TURNING : DRIVING] += load.wheels * toWh;
+  energy[ELECTRONICS] += load.electronics * toWh;
+  counters.time[state] += seconds;
+  counters.charged += battery.getChargeCurrent() * toWh;
+
+  auto travelled = poseEstimator.getTravelled();
+  if (state == static_cast<uint8_t>(Definitions::MOWER_STATES::MOWING) && cutter.isCutting() && !turning) {
+    counters.mowedArea += (travelled - lastTravelled) * Definitions::CUTTER_DIAMETER / 100.0f;
+  }
+  lastTravelled = travelled;
+}
+
+void EnergyLedger::save() {
+  lastSave = millis();
+
+  Configuration::preferences.begin("liam-esp", false);
+  Configuration::preferences.putBytes("energy", &counters, sizeof(counters));
+}
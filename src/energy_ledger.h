@@ -0,0 +1,112 @@
+#ifndef _energy_ledger_h
+#define _energy_ledger_h
+
+#include <Arduino.h>
+#include "definitions.h"
+#include "battery.h"
+#include "wheel_controller.h"
+#include "cutter.h"
+#include "pose_estimator.h"
+#include "processable.h"
+
+/**
+* Keeps account of where the energy goes, so that tuning changes can be judged on real data.
+*
+* Measured power is integrated into counters per mower state (mowing, docking, stuck, docked standby...) and per activity
+* (cutter, wheels driving straight or in curves, wheels turning on the spot, and electronics). Counters are persisted to flash, so
+* they keep adding up over the whole season.
+* Efficiency is derived from the counters: area mowed per Wh, and Wh per hour of mowing.
+*/
+class EnergyLedger : public Processable {
+  public:
+    enum ACTIVITY {
+      CUTTING,
+      DRIVING,
+      TURNING,      // turning on the spot, or with one wheel standing still.
+      ELECTRONICS,
+      ACTIVITY_COUNT
+    };
+
+    static const uint8_t STATE_COUNT = static_cast<uint8_t>(Definitions::MOWER_STATES::TEST) + 1;
+
+    EnergyLedger(Battery& battery, WheelController& wheelController, Cutter& cutter, PoseEstimator& poseEstimator);
+    /**
+    * Load counters from flash.
+    */
+    void start();
+    /**
+    * Should be called when mower changes state.
+    */
+    void setState(Definitions::MOWER_STATES state);
+    /**
+    * Energy (Wh) used by an activity in a state.
+    */
+    double getEnergy(Definitions::MOWER_STATES state, ACTIVITY activity) const;
+    /**
+    * Energy (Wh) used by all activities in a state.
+    */
+    double getEnergy(Definitions::MOWER_STATES state) const;
+    /**
+    * Seconds spent in a state.
+    */
+    double getTime(Definitions::MOWER_STATES state) const;
+    /**
+    * Energy (Wh) used in all states.
+    */
+    double getTotalEnergy() const;
+    /**
+    * Energy (Wh) from the charger.
+    */
+    double getChargedEnergy() const;
+    /**
+    * Area (m²) the cutter has passed over while mowing. Areas mowed more than once are counted every time.
+    */
+    double getMowedArea() const;
+    /**
+    * Area mowed (m²) per Wh used while mowing, 0 if we have not mowed yet.
+    */
+    float getAreaPerWh() const;
+    /**
+    * Energy (Wh) used per hour of mowing (i.e. average power while mowing), 0 if we have not mowed yet.
+    */
+    float getWhPerMowingHour() const;
+    /**
+    * Write all counters and efficiency as JSON (for /api/v1/energy).
+    */
+    void printJson(Print& output) const;
+    /**
+    * Clear all counters, e.g. after changing hardware.
+    */
+    void reset();
+    /* Internal use only! */
+    void process();
+
+  private:
+    static const uint16_t UPDATE_INTERVAL = 1000;   // How often (ms) power is integrated, battery updates its readings once a second.
+    static const uint16_t SAVE_INTERVAL = 600;      // Save counters to flash this often (seconds), and on every state change.
+    static const uint8_t COUNTERS_VERSION = 1;      // Increase when energyCounters changes, old counters are then thrown away.
+
+    struct energyCounters {
+      uint8_t version = COUNTERS_VERSION;
+      // doubles, a float starts rounding away the mWh added every second once a counter reaches a few kWh.
+      double energy[STATE_COUNT][ACTIVITY_COUNT] = {{0}};   // Wh
+      double time[STATE_COUNT] = {0};                       // seconds
+      double charged = 0;                                   // Wh
+      double mowedArea = 0;                                 // m²
+    };
+
+    Battery& battery;
+    WheelController& wheelController;
+    Cutter& cutter;
+    PoseEstimator& poseEstimator;
+    energyCounters counters;
+    uint8_t state = 0;
+    uint32_t lastUpdate = 0;
+    uint32_t lastSave = 0;
+    float lastTravelled = 0;
+
+    void update();
+    void save();
+};
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef _fast_math_h
+#define _fast_math_h
+
+#include <Arduino.h>
+#include <string.h>
+
+/**
+* Fast approximations of the maths functions used in control paths (sensor fusion, pose, planning), where a tiny error is fine but
+* the libm versions are slow. Max errors are measured against libm (in double) over the whole input range.
+*/
+namespace FastMath {
+
+  static const float HALF_PI_F = 1.57079632679f;
+  static const float PI_F = 3.14159265359f;
+  static const float INV_PI_F = 0.31830988618f;
+  // PI split in two, so that range reduction doesn't lose precision.
+  static const float PI_HIGH = 3.140625f;
+  static const float PI_LOW = 9.67653589793e-4f;
+
+  /**
+   * 1 / sqrt(x), for x > 0. Max relative error 4.8e-6 (x from 1e-37 to 1e37).
+   */
+  inline float invSqrt(float x) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    bits = 0x5f375a86 - (bits >> 1);
+    float y;
+    memcpy(&y, &bits, sizeof(y));
+
+    // two Newton-Raphson steps.
+    float halfX = 0.5f * x;
+    y = y * (1.5f - halfX * y * y);
+    y = y * (1.5f - halfX * y * y);
+
+    return y;
+  }
+
+  /**
+   * Square root, 0 for x <= 0. Max relative error 4.8e-6.
+   */
+  inline float sqrt(float x) {
+    return x > 0 ? x * invSqrt(x) : 0;
+  }
+
+  /**
+   * Arc tangent (radians), max error 1.2e-5 rad.
+   */
+  inline float atan(float x) {
+    bool inverted = x > 1 || x < -1;
+    if (inverted) {
+      x = 1 / x;
+    }
+
+    float x2 = x * x;
+    float result = x * (0.9998660f + x2 * (-0.3302995f + x2 * (0.1801410f + x2 * (-0.0851330f + x2 * 0.0208351f))));
+
+    if (inverted) {
+      result = (x > 0 ? HALF_PI_F : -HALF_PI_F) - result;
+    }
+
+    return result;
+  }
+
+  /**
+   * Angle (radians, -PI to PI) of point x, y. Max error 1.2e-5 rad, 0 if both are 0.
+   */
+  inline float atan2(float y, float x) {
+    if (x == 0) {
+      return y > 0 ? HALF_PI_F : (y < 0 ? -HALF_PI_F : 0);
+    }
+
+    float angle = atan(y / x);
+
+    if (x < 0) {
+      angle += y < 0 ? -PI_F : PI_F;
+    }
+
+    return angle;
+  }
+
+  /**
+   * Arc sine (radians), x is clamped to -1 to 1. Max error 7.3e-6 rad.
+   */
+  inline float asin(float x) {
+    float a = x < 0 ? -x : x;
+
+    if (a >= 1) {
+      return x > 0 ? HALF_PI_F : -HALF_PI_F;
+    }
+
+    // Abramowitz & Stegun 4.4.46, no division needed.
+    float result = HALF_PI_F - sqrt(1 - a) * (1.5707963050f + a * (-0.2145988016f + a * (0.0889789874f + a * (-0.0501743046f +
+                   a * (0.0308918810f + a * (-0.0170881256f + a * (0.0066700901f + a * -0.0012624911f)))))));
+
+    return x < 0 ? -result : result;
+  }
+
+  /**
+   * Polynomial for sine, x from -PI/2 to PI/2.
+   */
+  inline float sinReduced(float x) {
+    float x2 = x * x;
+
+    return x * (0.99999660f + x2 * (-0.16664824f + x2 * (0.00830629f + x2 * -0.00018363f)));
+  }
+
+  /**
+   * Sine, max error 7.5e-7 for |x| up to 100 PI, precision slowly drops above that.
+   */
+  inline float sin(float x) {
+    // x = k * PI + r, sin(x) = sin(r) with sign flipped for odd k.
+    float k = floorf(x * INV_PI_F + 0.5f);
+    float r = (x - k * PI_HIGH) - k * PI_LOW;
+
+    return (int32_t)k & 1 ? -sinReduced(r) : sinReduced(r);
+  }
+
+  /**
+   * Cosine, max error 7.5e-7 for |x| up to 100 PI, precision slowly drops above that.
+   */
+  inline float cos(float x) {
+    // x = (k + 1/2) * PI + r, cos(x) = -sin(r) with sign flipped for odd k.
+    float k = floorf(x * INV_PI_F);
+    float r = (x - (k + 0.5f) * PI_HIGH) - (k + 0.5f) * PI_LOW;
+
+    return (int32_t)k & 1 ? sinReduced(r) : -sinReduced(r);
+  }
+}
+
+#endif
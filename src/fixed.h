@@ -0,0 +1,148 @@
+#ifndef _fixed_h
+#define _fixed_h
+
+#include <stdint.h>
+#include <type_traits>
+
+/**
+* Signed fixed-point number in Q-format, IntBits integer bits and FracBits fractional bits (plus a sign bit).
+* E.g. Fixed<15, 16> is Q15.16, range -32768 to 32767.99998 with a resolution of 1/65536.
+*
+* Only integer instructions are used, so it's safe to use in an ISR (floating point there would require saving the FPU context).
+* Arithmetic saturates instead of wrapping around, an overflowing value stops at max()/min(), and so does division by zero.
+* Conversion from float is constexpr, so constants are converted at compile time.
+*/
+template <uint8_t IntBits, uint8_t FracBits>
+class Fixed {
+  static_assert(IntBits + FracBits <= 31, "Fixed needs a sign bit, IntBits + FracBits must be 31 or less.");
+
+  public:
+    typedef typename std::conditional<IntBits + FracBits < 16, int16_t, int32_t>::type raw_type;
+    // big enough for the product of two raw values.
+    typedef typename std::conditional<IntBits + FracBits < 16, int32_t, int64_t>::type wide_type;
+
+    static constexpr raw_type RAW_MAX = (raw_type)(((wide_type)1 << (IntBits + FracBits)) - 1);
+    static constexpr raw_type RAW_MIN = -RAW_MAX - 1;
+    static constexpr wide_type ONE = (wide_type)1 << FracBits;
+
+    constexpr Fixed() : raw(0) { }
+
+    static constexpr Fixed fromRaw(raw_type raw) {
+      return Fixed(raw, 0);
+    }
+
+    static constexpr Fixed fromInt(int32_t value) {
+      return Fixed(saturate((wide_type)value * ONE), 0);
+    }
+
+    /**
+    * Rounded to nearest, out of range values saturate.
+    */
+    static constexpr Fixed fromFloat(float value) {
+      return Fixed(saturateFloat(value * ONE), 0);
+    }
+
+    static constexpr Fixed max() {
+      return Fixed(RAW_MAX, 0);
+    }
+
+    static constexpr Fixed min() {
+      return Fixed(RAW_MIN, 0);
+    }
+
+    constexpr raw_type getRaw() const {
+      return raw;
+    }
+
+    constexpr float toFloat() const {
+      return (float)raw / ONE;
+    }
+
+    /**
+    * Rounded to nearest, halfway rounds up.
+    */
+    constexpr int32_t toInt() const {
+      return (int32_t)(((wide_type)raw + ONE / 2) >> FracBits);
+    }
+
+    /**
+    * Rounded down.
+    */
+    constexpr int32_t floor() const {
+      return (int32_t)(raw >> FracBits);
+    }
+
+    /**
+    * Same value in another Q-format, rounded to nearest and saturated if it doesn't fit.
+    */
+    template <uint8_t ToIntBits, uint8_t ToFracBits>
+    constexpr Fixed<ToIntBits, ToFracBits> convert() const {
+      return Fixed<ToIntBits, ToFracBits>::fromRaw(Fixed<ToIntBits, ToFracBits>::saturate(ToFracBits >= FracBits ?
+        (int64_t)raw * ((int64_t)1 << (ToFracBits - FracBits)) :
+        ((int64_t)raw + ((int64_t)1 << (FracBits - ToFracBits - 1))) >> (FracBits - ToFracBits)));
+    }
+
+    constexpr Fixed operator-() const {
+      return Fixed(saturate(-(wide_type)raw), 0);
+    }
+
+    constexpr Fixed operator+(Fixed other) const {
+      return Fixed(saturate((wide_type)raw + other.raw), 0);
+    }
+
+    constexpr Fixed operator-(Fixed other) const {
+      return Fixed(saturate((wide_type)raw - other.raw), 0);
+    }
+
+    constexpr Fixed operator*(Fixed other) const {
+      return Fixed(saturate(((wide_type)raw * other.raw + ONE / 2) >> FracBits), 0);
+    }
+
+    constexpr Fixed operator*(int32_t factor) const {
+      return Fixed(saturate((int64_t)raw * factor), 0);
+    }
+
+    constexpr Fixed operator/(Fixed other) const {
+      return other.raw == 0 ? (raw < 0 ? min() : max()) : Fixed(saturate(divide((wide_type)raw * ONE, other.raw)), 0);
+    }
+
+    constexpr Fixed operator/(int32_t divisor) const {
+      return divisor == 0 ? (raw < 0 ? min() : max()) : Fixed(saturate(divide(raw, divisor)), 0);
+    }
+
+    Fixed& operator+=(Fixed other) { return *this = *this + other; }
+    Fixed& operator-=(Fixed other) { return *this = *this - other; }
+    Fixed& operator*=(Fixed other) { return *this = *this * other; }
+    Fixed& operator/=(Fixed other) { return *this = *this / other; }
+
+    constexpr bool operator==(Fixed other) const { return raw == other.raw; }
+    constexpr bool operator!=(Fixed other) const { return raw != other.raw; }
+    constexpr bool operator<(Fixed other) const { return raw < other.raw; }
+    constexpr bool operator<=(Fixed other) const { return raw <= other.raw; }
+    constexpr bool operator>(Fixed other) const { return raw > other.raw; }
+    constexpr bool operator>=(Fixed other) const { return raw >= other.raw; }
+
+    static constexpr raw_type saturate(int64_t value) {
+      return value > RAW_MAX ? RAW_MAX : (value < RAW_MIN ? RAW_MIN : (raw_type)value);
+    }
+
+    static constexpr raw_type saturateFloat(float value) {
+      return value >= (float)RAW_MAX ? RAW_MAX : (value <= (float)RAW_MIN ? RAW_MIN : (raw_type)(value + (value < 0 ? -0.5f : 0.5f)));
+    }
+
+  private:
+    raw_type raw;
+
+    constexpr Fixed(raw_type raw, int) : raw(raw) { }
+
+    // rounded to nearest, C++ division truncates towards zero.
+    static constexpr int64_t divide(int64_t dividend, int64_t divisor) {
+      return (dividend < 0 ? dividend - (divisor < 0 ? -divisor : divisor) / 2 : dividend + (divisor < 0 ? -divisor : divisor) / 2) / divisor;
+    }
+};
+
+template <uint8_t IntBits, uint8_t FracBits> constexpr typename Fixed<IntBits, FracBits>::raw_type Fixed<IntBits, FracBits>::RAW_MAX;
+template <uint8_t IntBits, uint8_t FracBits> constexpr typename Fixed<IntBits, FracBits>::raw_type Fixed<IntBits, FracBits>::RAW_MIN;
+template <uint8_t IntBits, uint8_t FracBits> constexpr typename Fixed<IntBits, FracBits>::wide_type Fixed<IntBits, FracBits>::ONE;
+
+#endif
@@ -0,0 +1,192 @@
+#include <ArduinoLog.h>
+#include "flash_ring.h"
+
+static void writeUint32(uint8_t* buffer, uint32_t value) {
+  buffer[0] = value;
+  buffer[1] = value >> 8;
+  buffer[2] = value >> 16;
+  buffer[3] = value >> 24;
+}
+
+static uint32_t readUint32(const uint8_t* buffer) {
+  return buffer[0] | (buffer[1] << 8) | (buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
+
+FlashRing::FlashRing(fs::FS& fs, const char* path, uint16_t recordSize, uint32_t capacity) :
+  fs(fs),
+  path(path),
+  recordSize(recordSize),
+  capacity(capacity) { }
+
+bool FlashRing::begin() {
+  if (fs.exists(path)) {
+    file = fs.open(path, "r+");
+    uint8_t header[HEADER_SIZE];
+
+    if (file && file.read(header, HEADER_SIZE) == HEADER_SIZE &&
+        readUint32(header) == MAGIC && readUint32(header + 4) == recordSize && readUint32(header + 8) == capacity) {
+
+      first = readUint32(header + 12);
+      recover();
+      Log.notice(F("Opened %s, %l records waiting" CR), path, count);
+
+      return true;
+    }
+
+    file.close();
+    Log.notice(F("%s is invalid or has other settings, creating new." CR), path);
+  }
+
+  return create();
+}
+
+bool FlashRing::push(const uint8_t* record) {
+  if (!file) {
+    return false;
+  }
+
+  if (count == capacity) {
+    first++;
+    count--;
+    overwritten++;
+  }
+
+  uint8_t sequence[SEQUENCE_SIZE];
+  writeUint32(sequence, first + count + 1);
+
+  if (!file.seek(getOffset(first + count)) || file.write(sequence, SEQUENCE_SIZE) != SEQUENCE_SIZE ||
+      file.write(record, recordSize) != recordSize) {
+    return false;
+  }
+
+  file.flush();
+  count++;
+
+  return true;
+}
+
+bool FlashRing::read(uint32_t position, uint8_t* record) {
+  if (!file || position >= count) {
+    return false;
+  }
+
+  return file.seek(getOffset(first + position) + SEQUENCE_SIZE) && file.read(record, recordSize) == recordSize;
+}
+
+void FlashRing::discardUntil(uint32_t index) {
+  // indexes wrap around, so compare the distance instead of the values.
+  int32_t distance = index - first;
+
+  if (!file || distance <= 0) {
+    return;
+  }
+
+  if ((uint32_t)distance > count) {
+    distance = count;
+  }
+
+  first += distance;
+  count -= distance;
+  writeHeader();
+}
+
+uint32_t FlashRing::size() const {
+  return count;
+}
+
+uint32_t FlashRing::getFirst() const {
+  return first;
+}
+
+uint32_t FlashRing::getOverwritten() const {
+  return overwritten;
+}
+
+bool FlashRing::create() {
+  file = fs.open(path, "w+");
+
+  if (!file) {
+    Log.warning(F("Could not create %s" CR), path);
+    return false;
+  }
+
+  first = 0;
+  count = 0;
+
+  if (!writeHeader()) {
+    return false;
+  }
+
+  // allocate the whole file up front, so we don't run out of space later on.
+  uint8_t empty[32] = {0};
+  uint32_t remaining = (uint32_t)(SEQUENCE_SIZE + recordSize) * capacity;
+
+  while (remaining > 0) {
+    size_t chunk = remaining < sizeof(empty) ? remaining : sizeof(empty);
+
+    if (file.write(empty, chunk) != chunk) {
+      Log.warning(F("Not enough space for %s" CR), path);
+      file.close();
+      return false;
+    }
+    remaining -= chunk;
+  }
+
+  file.flush();
+
+  return true;
+}
+
+/**
+ * Find the newest record from the sequence numbers, and from there how far back records are intact (at most back to first, from header).
+ */
+void FlashRing::recover() {
+  uint32_t end = first;
+
+  for (uint32_t slot = 0; slot < capacity; slot++) {
+    auto sequence = readSequence(slot);
+
+    // sequence numbers wrap around, so compare the distance instead of the values.
+    if (sequence != 0 && (sequence - 1) % capacity == slot && (int32_t)(sequence - end) > 0) {
+      end = sequence;
+    }
+  }
+
+  count = 0;
+  while (count < capacity && end - count != first && readSequence((end - count - 1) % capacity) == end - count) {
+    count++;
+  }
+
+  first = end - count;
+}
+
+bool FlashRing::writeHeader() {
+  uint8_t header[HEADER_SIZE];
+
+  writeUint32(header, MAGIC);
+  writeUint32(header + 4, recordSize);
+  writeUint32(header + 8, capacity);
+  writeUint32(header + 12, first);
+
+  if (!file.seek(0) || file.write(header, HEADER_SIZE) != HEADER_SIZE) {
+    return false;
+  }
+
+  file.flush();
+
+  return true;
+}
+
+uint32_t FlashRing::readSequence(uint32_t slot) {
+  uint8_t sequence[SEQUENCE_SIZE];
+
+  if (!file.seek(HEADER_SIZE + slot * (SEQUENCE_SIZE + recordSize)) || file.read(sequence, SEQUENCE_SIZE) != SEQUENCE_SIZE) {
+    return 0;
+  }
+
+  return readUint32(sequence);
+}
+
+uint32_t FlashRing::getOffset(uint32_t index) const {
+  return HEADER_SIZE + (index % capacity) * (SEQUENCE_SIZE + recordSize);
+}
@@ -0,0 +1,74 @@
+#ifndef _flash_ring_h
+#define _flash_ring_h
+
+#include <Arduino.h>
+#include <FS.h>
+
+/**
+* Ring buffer of fixed size records, kept in a file on flash (e.g. SPIFFS) so that it survives a restart.
+* When full, the oldest record is overwritten.
+*
+* Records are numbered with an ever increasing index, the oldest record kept has index getFirst().
+* This lets a reader remove exactly the records it has handled with discardUntil(), even if older records have been overwritten in the meantime.
+*
+* Each record is stored with its sequence number (index + 1), so pushing a record only writes its own slot. The header is written when records
+* are discarded, the end of the ring is found on begin() by scanning the sequence numbers. Writing the header on every push would wear
+* the same flash page once per record.
+*
+* File: header (magic, record size, capacity, first index, all uint32 little endian), then capacity slots of sequence number (uint32, 0 = empty) and record.
+*/
+class FlashRing {
+  public:
+    /**
+    * @param fs file system to store ring in, must already be mounted.
+    * @param path name of file.
+    * @param recordSize size (bytes) of each record.
+    * @param capacity max number of records.
+    */
+    FlashRing(fs::FS& fs, const char* path, uint16_t recordSize, uint32_t capacity);
+    /**
+    * Open file, or create it if it doesn't exist or was created with other settings.
+    * @return false if file could not be opened or created.
+    */
+    bool begin();
+    /**
+    * Add a record at the end of the ring, overwriting the oldest record if full.
+    */
+    bool push(const uint8_t* record);
+    /**
+    * Read record at position (0 = oldest) into buffer (recordSize bytes).
+    */
+    bool read(uint32_t position, uint8_t* record);
+    /**
+    * Remove all records with an index lower than the specified index.
+    */
+    void discardUntil(uint32_t index);
+    uint32_t size() const;
+    uint32_t getFirst() const;
+    /**
+    * Number of records overwritten before they were read, since start.
+    */
+    uint32_t getOverwritten() const;
+
+  private:
+    static const uint32_t MAGIC = 0x32524C46;   // "FLR2"
+    static const uint8_t HEADER_SIZE = 16;
+    static const uint8_t SEQUENCE_SIZE = 4;
+
+    fs::FS& fs;
+    const char* path;
+    uint16_t recordSize;
+    uint32_t capacity;
+    uint32_t first = 0;
+    uint32_t count = 0;
+    uint32_t overwritten = 0;
+    File file;
+
+    bool create();
+    void recover();
+    bool writeHeader();
+    uint32_t readSequence(uint32_t slot);
+    uint32_t getOffset(uint32_t index) const;
+};
+
+#endif
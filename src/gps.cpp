@@ -1,5 +1,6 @@
 #include <ArduinoLog.h>
 #include "gps.h"
+#include "lttb.h"
 #include "definitions.h"
 
 // RTK baserad GPS. Här finns karta över närliggande stationer: http://www.epncb.oma.be/_networkdata/data_access/real_time/map.php
@@ -14,12 +15,15 @@
 //https://github.com/Ultimaker/CuraEngine/blob/master/src/slicer.cpp
 //https://github.com/Ultimaker/CuraEngine/blob/master/src/infill.cpp
 
-GPS::GPS() {}
+GPS::GPS(SemaphoreHandle_t busLock) : busLock(busLock) {}
 
 void GPS::init()
 {
+  xSemaphoreTake(busLock, portMAX_DELAY);
+
   if (gps.begin() == false) //Connect to the Ublox module using Wire port
   {
+    xSemaphoreGive(busLock);
     Log.warning(F("Ublox GPS not detected at default I2C address. Please check wiring, and restart mower!"));
     while (1)
       ;
@@ -40,6 +44,8 @@ void GPS::init()
   byte rate = gps.getNavigationFrequency();
   Serial.print("Current update rate:");
   Serial.println(rate);
+
+  xSemaphoreGive(busLock);
 }
 
 void GPS::start()
@@ -48,6 +54,7 @@ void GPS::start()
   if (millis() - lastTime > 1000)
   {
     lastTime = millis(); //Update the timer
+    xSemaphoreTake(busLock, portMAX_DELAY);
 
     /* Note: Long/lat are large numbers because they are * 10^9. To convert lat/long
     to something google maps understands simply divide the numbers by 100,000,000. We
@@ -110,6 +117,8 @@ void GPS::start()
     Serial.print(horizontalAccuracy);
     Serial.println(F("mm"));
 
+    xSemaphoreGive(busLock);
+
     // https://github.com/sparkfun/SparkFun_Ublox_Arduino_Library/blob/master/examples/Example13_PVT/Example1_AutoPVT/Example1_AutoPVT.ino
     // https://github.com/sparkfun/SparkFun_Ublox_Arduino_Library/commit/63fb62ebd12c46c062d059c0fabe309f2d280098
   }
@@ -119,3 +128,57 @@ const std::deque<gpsPosition> &GPS::getGpsPositionHistory() const
 {
   return gpsPosistionSamples;
 }
+
+/**
+ * Write position history as JSON (for /api/v1/history/position).
+ * @param points downsample track to this many positions, 0 to get all positions.
+ */
+void GPS::printPositionHistory(Print& output, uint16_t points) const
+{
+  Lttb lttb(gpsPosistionSamples.size(), points);
+
+  if (points > 0 && lttb.isDownsampling())
+  {
+    // picking by area in the lat/lng plane keeps the positions where the track turns.
+    // Relative to first position, lat/lng don't fit in a float.
+    auto& origin = gpsPosistionSamples.front();
+
+    for (auto& sample : gpsPosistionSamples)
+    {
+      lttb.addAverage(sample.lng - origin.lng, sample.lat - origin.lat);
+    }
+    for (auto& sample : gpsPosistionSamples)
+    {
+      lttb.addCandidate(sample.lng - origin.lng, sample.lat - origin.lat);
+    }
+  }
+
+  output.print(F("{\"samples\":["));
+
+  uint32_t index = 0;
+  bool first = true;
+
+  for (auto& sample : gpsPosistionSamples)
+  {
+    if (points > 0 && !lttb.isSelected(index++))
+    {
+      continue;
+    }
+
+    if (!first)
+    {
+      output.print(',');
+    }
+    first = false;
+
+    output.print(F("{\"t\":"));
+    output.print(sample.time);
+    output.print(F(",\"lt\":"));
+    output.print(sample.lat);
+    output.print(F(",\"lg\":"));
+    output.print(sample.lng);
+    output.print('}');
+  }
+
+  output.print(F("]}"));
+}
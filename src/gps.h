@@ -4,6 +4,8 @@
 #include <Arduino.h>
 #include "SparkFun_Ublox_Arduino_Library.h"
 #include <deque>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 struct gpsPosition {
   uint32_t time;
@@ -13,13 +15,18 @@ struct gpsPosition {
 
 class GPS {
   public:
-    GPS();
+    /**
+    * @param busLock mutex shared by everyone using the I2C bus.
+    */
+    GPS(SemaphoreHandle_t busLock);
     void init();
     void start();
     const std::deque<gpsPosition>& getGpsPositionHistory() const;
+    void printPositionHistory(Print& output, uint16_t points = 0) const;
   private:
     static const uint16_t MAX_SAMPLES = 100;   // How much history are we going to keep? set too high will consume excessive memory and we may get out-of-memory related errors.
     SFE_UBLOX_GPS gps;
+    SemaphoreHandle_t busLock;
     long lastTime = 0; //Simple local timer. TODO: remove this when done debugging.
     std::deque<gpsPosition> gpsPosistionSamples;
     gpsPosition lastMowingPosition;
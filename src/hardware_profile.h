@@ -0,0 +1,140 @@
+#ifndef _hardware_profile_h
+#define _hardware_profile_h
+
+#include <Arduino.h>
+
+/**
+* Everything that differs between mower builds (geometry, motors, battery chemistry and pins) is collected in a hardware profile.
+* Profiles are constexpr, so all constants derived from them (PWM duty scale, odometer pulses per centimeter/degree, battery curve...)
+* are computed at compile time. Select profile with a build flag in platformio.ini, e.g. build_flags = -D HARDWARE_PROFILE=HardwareProfiles::NIMH_12S
+*/
+struct HardwareProfile {
+
+  struct Geometry {
+    uint8_t wheelDiameter;                  // in millimeter
+    uint8_t wheelPairDistance;              // distance measured between the wheel pairs, in centimeters
+    uint16_t wheelOdometerPulsesPerRotation;// number of odometer pulses from motor that equals a full rotation of the shaft (check with motor manufacturer).
+    uint8_t mowerWidth;                     // Total width of mower (in centimeters)
+    uint8_t mowerLength;                    // Total length of mower (in centimeters)
+    uint8_t cutterDiameter;                 // Diameter of cutter disc (in centimeters)
+
+    constexpr float getWheelCircumference() const {   // in centimeters
+      return wheelDiameter * PI / 10;
+    }
+
+    constexpr float getPulsesPerCentimeter() const {
+      return wheelOdometerPulsesPerRotation / getWheelCircumference();
+    }
+
+    /**
+    * Odometer pulses (of one wheel) for turning the mower one degree on the spot.
+    */
+    constexpr float getPulsesPerDegree() const {
+      return wheelPairDistance * PI / 360 * getPulsesPerCentimeter();
+    }
+  };
+
+  struct Motor {
+    uint8_t pwmResolution;          // bits of precision for motor PWM timer.
+    uint16_t pwmFrequency;          // motor PWM base frequency (Hz).
+    float wheelLoadResistor;        // Size of shunt resistor connected in serial with each wheel motor, in Ohm.
+    float wheelNoloadCurrent;       // Milliampere of each wheel motor when wheel spins freely, see motor specs for no-load current. (used to detect spinning wheels)
+    float wheelMaxCurrent;          // Max milliampere of each wheel motor, see motor specs for stall current. (used to detect stalled wheels)
+    float cutterLoadResistor;       // Size of shunt resistor connected in serial with cutter motor, in Ohm.
+    float cutterNoloadCurrent;      // Milliampere of cutter motor when no load is applied, see motor specs for no-load current. (used for calculating cutter load percentage)
+    float cutterMaxCurrent;         // Max milliampere of cutter motor, see motor specs for stall current. (used to calculate cutter load percentage)
+    uint16_t cutterNoloadRpm;       // Speed of cutter motor when no load is applied, see motor specs. (used to estimate blade speed)
+
+    /**
+    * Duty for full speed, e.g. 8191 from 2 ^ 13 - 1.
+    */
+    constexpr uint32_t getMaxDuty() const {
+      return (1UL << pwmResolution) - 1;
+    }
+  };
+
+  struct Battery {
+    static const uint8_t SOC_CURVE_POINTS = 11;
+
+    float fullyCharged;             // in volt. e.g. 4.2 volt * 4 cells = 16.8 volt.
+    float empty;                    // in volt, leave a few volts above completely discharged to give us enough power to get us back to the charger.
+    float capacity;                 // usable capacity in milliampere-hours (mAh), between fullyCharged and empty.
+    // Open circuit voltage at 0%, 10%, ..., 100% SoC, as share of the range between empty and full voltage.
+    float socCurve[SOC_CURVE_POINTS];
+
+    constexpr bool isSocCurveValid(uint8_t i = 1) const {
+      return i >= SOC_CURVE_POINTS ? socCurve[0] == 0 && socCurve[SOC_CURVE_POINTS - 1] == 1 :
+             socCurve[i] > socCurve[i - 1] && isSocCurveValid(i + 1);
+    }
+  };
+
+  struct Pins {
+    uint8_t sda;
+    uint8_t scl;
+    uint8_t digitalExpanderInterrupt;
+    uint8_t loraDio0;
+    uint8_t loraDio1;
+    uint8_t leftWheelMotor;
+    uint8_t leftWheelMotorDirection;
+    uint8_t leftWheelOdometer;
+    uint8_t rightWheelMotor;
+    uint8_t rightWheelMotorDirection;
+    uint8_t rightWheelOdometer;
+    uint8_t cutterMotor;
+    uint8_t cutterBrake;
+    uint8_t dockedDetection;
+    uint8_t factoryReset;
+    uint8_t emergencyStop;
+    uint8_t sonarFrontPing;
+    uint8_t sonarFrontSense;
+  };
+
+  const char* name;
+  Geometry geometry;
+  Motor motor;
+  Battery battery;
+  Pins pins;
+};
+
+//
+// NOTE! If changing pin definitions, please read up on pins that could be used on the ESP32 (some are special): https://randomnerdtutorials.com/esp32-pinout-reference-gpios/
+//
+namespace HardwareProfiles {
+
+  constexpr HardwareProfile::Geometry LIAM_GEOMETRY = {190, 27, 90, 30, 40, 10};
+
+  constexpr HardwareProfile::Motor LIAM_MOTORS = {13, 5000, 0.1, 150, 2000, 0.1, 200, 3100, 3300};
+
+  constexpr HardwareProfile::Pins LIAM_PINS = {
+    21, 22,   // I2C, could be any free and suitable pins. We use default 21 and 22 here.
+    34,       // MCP23017 port expander interrupt
+    17, 33,   // LoRa interrupts
+    27, 25, 5,  // left wheel motor, direction and odometer
+    32, 26, 4,  // right wheel motor, direction and odometer
+    2, 4,     // cutter motor PWM and brake
+    35,       // docked detection
+    0,        // factory reset, pulling this pin LOW will wipe Flash-memory from ALL settings and reboot mower.
+    36,       // emergency stop, pull LOW to stop mower and HIGH to continue.
+    16, 39    // front sonar ping and sense
+  };
+
+  // Lithium-ion / LiPo  http://batteryuniversity.com/learn/article/types_of_lithium_ion
+  // Normally a fully charged cell is 4.2 volt and quickly drops down to 3.6 volt, as battery is closing depleated it will drop from 3.6 down to 2.5 volt.
+  // 2.5 volts should be considered an completely discharged cell, below that will damage the cell.
+  // It drops fast when almost empty and is pretty flat in the middle.
+  constexpr HardwareProfile::Battery LIION_4S_BATTERY = {16.8, 12.0, 4400, {0, 0.500, 0.567, 0.617, 0.650, 0.683, 0.725, 0.767, 0.817, 0.892, 1}};
+
+  // Nickel–metal hydride / NiMH. http://batteryuniversity.com/learn/article/charging_nickel_metal_hydride
+  // Very flat in the middle, drops sharply at both ends.
+  constexpr HardwareProfile::Battery NIMH_12S_BATTERY = {14.5, 11.5, 4400, {0, 0.350, 0.450, 0.500, 0.540, 0.575, 0.610, 0.650, 0.700, 0.790, 1}};
+
+  // Lead-acid. http://www.solarnavigator.net/battery_charging.htm
+  // Voltage falls almost linearly with SoC.
+  constexpr HardwareProfile::Battery LEAD_ACID_12V_BATTERY = {13.3, 11.9, 4400, {0, 0.150, 0.270, 0.380, 0.480, 0.570, 0.660, 0.740, 0.820, 0.900, 1}};
+
+  constexpr HardwareProfile LIION_4S = {"liion-4s", LIAM_GEOMETRY, LIAM_MOTORS, LIION_4S_BATTERY, LIAM_PINS};
+  constexpr HardwareProfile NIMH_12S = {"nimh-12s", LIAM_GEOMETRY, LIAM_MOTORS, NIMH_12S_BATTERY, LIAM_PINS};
+  constexpr HardwareProfile LEAD_ACID_12V = {"lead-acid-12v", LIAM_GEOMETRY, LIAM_MOTORS, LEAD_ACID_12V_BATTERY, LIAM_PINS};
+}
+
+#endif
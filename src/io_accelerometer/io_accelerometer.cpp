@@ -4,11 +4,12 @@
 #include "definitions.h"
 #include "io_accelerometer.h"
 #include "utils.h"
+#include "fast_math.h"
 
 // https://github.com/sparkfun/ESP32_Motion_Shield/tree/master/Software
 // https://learn.sparkfun.com/tutorials/esp32-thing-motion-shield-hookup-guide/using-the-imu
 
-IO_Accelerometer::IO_Accelerometer(TwoWire& w): _Wire(w) {
+IO_Accelerometer::IO_Accelerometer(TwoWire& w, SemaphoreHandle_t busLock): _Wire(w), busLock(busLock) {
 
   // the device's communication mode and addresses:
   imu.settings.device.commInterface = IMU_MODE_I2C;
@@ -18,14 +19,18 @@ IO_Accelerometer::IO_Accelerometer(TwoWire& w): _Wire(w) {
 
 void IO_Accelerometer::start() {
 
-  if (!imu.begin()) {
+  xSemaphoreTake(busLock, portMAX_DELAY);
+  available = imu.begin();
+  if (available) {
+    imu.calibrate(true);
+    //imu.calibrateMag(true);   //TODO: check why this crashes with: Guru Meditation Error: Core  1 panic'ed (StoreProhibited). Exception was unhandled.
+  }
+  xSemaphoreGive(busLock);
+
+  if (!available) {
     Log.error(F("Failed to initialize gyro/accelerometer/compass, check connections!"));
   } else {
     Log.notice(F("Gyro/accelerometer/compass init success." CR));
-    available = true;
-
-    imu.calibrate(true);
-    //imu.calibrateMag(true);   //TODO: check why this crashes with: Guru Meditation Error: Core  1 panic'ed (StoreProhibited). Exception was unhandled.
 
     sensorReadingTicker.attach_ms<IO_Accelerometer*>(20, [](IO_Accelerometer* instance) {
       instance->getReadings();
@@ -41,6 +46,10 @@ const Orientation& IO_Accelerometer::getOrientation() const {
   return currentOrientation;
 }
 
+const Motion& IO_Accelerometer::getMotion() const {
+  return currentMotion;
+}
+
 bool IO_Accelerometer::isFlipped() const {
   if (available == false) {
     return false;
@@ -51,7 +60,9 @@ bool IO_Accelerometer::isFlipped() const {
 
 void IO_Accelerometer::getReadings() {
   
-  if (available) {    
+  // we are running in the timer task, skip this reading if someone else is using the bus rather than holding up other timers.
+  // Filter integrates over the time since last reading, so a skipped reading only costs a little precision.
+  if (available && xSemaphoreTake(busLock, 0) == pdTRUE) {
     // Update the sensor values whenever new data is available
     if ( imu.accelAvailable() ) {
       // To read from the accelerometer, first call the
@@ -81,6 +92,8 @@ void IO_Accelerometer::getReadings() {
       mz = imu.calcMag(imu.mz);      
     }
 
+    xSemaphoreGive(busLock);
+
     for (uint8_t i = 0; i < 10; i++) { // iterate a fixed number of times per data read cycle
       now = micros();
  
@@ -90,16 +103,17 @@ void IO_Accelerometer::getReadings() {
       filter.madgwickQuaternionUpdate(deltaTime, -ax, +ay, +az, gx, -gy, -gz, my, -mx, mz);
     }
 
-    auto quaternion = filter.getQuaternions();
+    auto rotation = filter.getQuaternions().toMatrix();
 
-    auto a12 = 2.0f * (quaternion.q2 * quaternion.q3 + quaternion.q1 * quaternion.q4);
-    auto a22 = quaternion.q1 * quaternion.q1 + quaternion.q2 * quaternion.q2 - quaternion.q3 * quaternion.q3 - quaternion.q4 * quaternion.q4;
-    auto a31 = 2.0f * (quaternion.q1 * quaternion.q2 + quaternion.q3 * quaternion.q4);
-    auto a32 = 2.0f * (quaternion.q2 * quaternion.q4 - quaternion.q1 * quaternion.q3);
-    auto a33 = quaternion.q1 * quaternion.q1 - quaternion.q2 * quaternion.q2 - quaternion.q3 * quaternion.q3 + quaternion.q4 * quaternion.q4;
-    auto pitch = -asinf(a32);
-    auto roll  = atan2f(a31, a33);
-    auto yaw   = atan2f(a12, a22);
+    auto a12 = rotation(1, 0);
+    auto a22 = rotation(0, 0);
+    auto a31 = rotation(2, 1);
+    auto a32 = rotation(2, 0);
+    auto a33 = rotation(2, 2);
+    // approximations are within 0.001 degrees, far below what we round to.
+    auto pitch = -FastMath::asin(a32);
+    auto roll  = FastMath::atan2(a31, a33);
+    auto yaw   = FastMath::atan2(a12, a22);
 
     // Convert everything from radians to degrees:
     pitch *= 180.0f / PI;
@@ -112,10 +126,11 @@ void IO_Accelerometer::getReadings() {
       yaw += 360.0f; // Ensure yaw stays between 0 and 360
     }
     
-    // acceleration without gravity involved, could be used to detect when we bump into obstacles.
-    //auto lin_ax1 = ax + a31;
-    //auto lin_ay1 = ay + a32;
-    //auto lin_az1 = az - a33;
+    // acceleration without gravity involved, could also be used to detect when we bump into obstacles.
+    currentMotion.forwardAcceleration = ax + a31;
+    currentMotion.sidewaysAcceleration = ay + a32;
+    // filter gets gyro z inverted, so do we.
+    currentMotion.yawRate = -gz * 180.0f / PI;
 
     currentOrientation.roll = roundf(roll);
     currentOrientation.pitch = roundf(pitch);
@@ -3,6 +3,8 @@
 
 #include <Wire.h>
 #include <Ticker.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include <SparkFunLSM9DS1.h>
 #include "madgwick_filters.h"
 
@@ -12,12 +14,25 @@ struct Orientation {
   uint16_t heading = 0;
 };
 
+struct Motion {
+  float yawRate = 0;              // degrees/second, positive when turning right (heading increasing).
+  float forwardAcceleration = 0;  // g, without gravity.
+  float sidewaysAcceleration = 0; // g, without gravity.
+};
+
 class IO_Accelerometer {
   public:
-    IO_Accelerometer(TwoWire& w);
+    /**
+    * @param busLock mutex shared by everyone using the I2C bus.
+    */
+    IO_Accelerometer(TwoWire& w, SemaphoreHandle_t busLock);
     bool isAvailable() const;
     bool isFlipped() const;
     const Orientation& getOrientation() const;
+    /**
+    * How mower is moving right now, used to tell if wheels really take us anywhere.
+    */
+    const Motion& getMotion() const;
     void start();
 
   private:
@@ -29,8 +44,10 @@ class IO_Accelerometer {
    
     LSM9DS1 imu;
     TwoWire& _Wire;
+    SemaphoreHandle_t busLock;
     Ticker sensorReadingTicker;
     Orientation currentOrientation;
+    Motion currentMotion;
     MadgwickFilters filter;
 
     bool available = false;
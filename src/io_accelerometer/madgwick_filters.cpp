@@ -9,6 +9,7 @@
 // but is much less computationally intensive---it can be performed on a 3.3 V Pro Mini operating at 8 MHz!
 
 #include "madgwick_filters.h"
+#include "fast_math.h"
 
 MadgwickFilters::MadgwickFilters() {
 
@@ -28,7 +29,7 @@ MadgwickFilters::MadgwickFilters() {
  */
 __attribute__((optimize("O3"))) void MadgwickFilters::madgwickQuaternionUpdate(float deltaTime, float ax, float ay, float az, float gx, float gy, float gz, float mx, float my, float mz) {
 
-  float q1 = quaternion.q1, q2 = quaternion.q2, q3 = quaternion.q3, q4 = quaternion.q4;   // short name local variable for readability
+  float q1 = quaternion.w(), q2 = quaternion.x(), q3 = quaternion.y(), q4 = quaternion.z();   // short name local variable for readability
   float norm;
   float hx, hy, _2bx, _2bz;
   float s1, s2, s3, s4;
@@ -59,17 +60,17 @@ __attribute__((optimize("O3"))) void MadgwickFilters::madgwickQuaternionUpdate(f
   float q4q4 = q4 * q4;
 
   // Normalise accelerometer measurement
-  norm = sqrtf(ax * ax + ay * ay + az * az);
+  norm = ax * ax + ay * ay + az * az;
   if (norm == 0.0f) return; // handle NaN
-  norm = 1.0f/norm;
+  norm = FastMath::invSqrt(norm);
   ax *= norm;
   ay *= norm;
   az *= norm;
 
   // Normalise magnetometer measurement
-  norm = sqrtf(mx * mx + my * my + mz * mz);
+  norm = mx * mx + my * my + mz * mz;
   if (norm == 0.0f) return; // handle NaN
-  norm = 1.0f/norm;
+  norm = FastMath::invSqrt(norm);
   mx *= norm;
   my *= norm;
   mz *= norm;
@@ -81,7 +82,7 @@ __attribute__((optimize("O3"))) void MadgwickFilters::madgwickQuaternionUpdate(f
   _2q2mx = 2.0f * q2 * mx;
   hx = mx * q1q1 - _2q1my * q4 + _2q1mz * q3 + mx * q2q2 + _2q2 * my * q3 + _2q2 * mz * q4 - mx * q3q3 - mx * q4q4;
   hy = _2q1mx * q4 + my * q1q1 - _2q1mz * q2 + _2q2mx * q3 - my * q2q2 + my * q3q3 + _2q3 * mz * q4 - my * q4q4;
-  _2bx = sqrtf(hx * hx + hy * hy);
+  _2bx = FastMath::sqrt(hx * hx + hy * hy);
   _2bz = -_2q1mx * q3 + _2q1my * q2 + mz * q1q1 + _2q2mx * q4 - mz * q2q2 + _2q3 * my * q4 - mz * q3q3 + mz * q4q4;
   _4bx = 2.0f * _2bx;
   _4bz = 2.0f * _2bz;
@@ -91,8 +92,7 @@ __attribute__((optimize("O3"))) void MadgwickFilters::madgwickQuaternionUpdate(f
   s2 = _2q4 * (2.0f * q2q4 - _2q1q3 - ax) + _2q1 * (2.0f * q1q2 + _2q3q4 - ay) - 4.0f * q2 * (1.0f - 2.0f * q2q2 - 2.0f * q3q3 - az) + _2bz * q4 * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - mx) + (_2bx * q3 + _2bz * q1) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - my) + (_2bx * q4 - _4bz * q2) * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
   s3 = -_2q1 * (2.0f * q2q4 - _2q1q3 - ax) + _2q4 * (2.0f * q1q2 + _2q3q4 - ay) - 4.0f * q3 * (1.0f - 2.0f * q2q2 - 2.0f * q3q3 - az) + (-_4bx * q3 - _2bz * q1) * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - mx) + (_2bx * q2 + _2bz * q4) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - my) + (_2bx * q1 - _4bz * q3) * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
   s4 = _2q2 * (2.0f * q2q4 - _2q1q3 - ax) + _2q3 * (2.0f * q1q2 + _2q3q4 - ay) + (-_4bx * q4 + _2bz * q2) * (_2bx * (0.5f - q3q3 - q4q4) + _2bz * (q2q4 - q1q3) - mx) + (-_2bx * q1 + _2bz * q3) * (_2bx * (q2q3 - q1q4) + _2bz * (q1q2 + q3q4) - my) + _2bx * q2 * (_2bx * (q1q3 + q2q4) + _2bz * (0.5f - q2q2 - q3q3) - mz);
-  norm = sqrtf(s1 * s1 + s2 * s2 + s3 * s3 + s4 * s4);    // normalise step magnitude
-  norm = 1.0f/norm;
+  norm = FastMath::invSqrt(s1 * s1 + s2 * s2 + s3 * s3 + s4 * s4);    // normalise step magnitude
   s1 *= norm;
   s2 *= norm;
   s3 *= norm;
@@ -109,15 +109,11 @@ __attribute__((optimize("O3"))) void MadgwickFilters::madgwickQuaternionUpdate(f
   q2 += qDot2 * deltaTime;
   q3 += qDot3 * deltaTime;
   q4 += qDot4 * deltaTime;
-  norm = sqrtf(q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4);    // normalise quaternion
-  norm = 1.0f/norm;
-  quaternion.q1 = q1 * norm;
-  quaternion.q2 = q2 * norm;
-  quaternion.q3 = q3 * norm;
-  quaternion.q4 = q4 * norm;
+  norm = FastMath::invSqrt(q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4);    // normalise quaternion
+  quaternion = imu::Quaternion(q1, q2, q3, q4).scale(norm);
 
 }
 
-const Quaternion& MadgwickFilters::getQuaternions() const {
+const imu::Quaternion& MadgwickFilters::getQuaternions() const {
   return quaternion;
 }
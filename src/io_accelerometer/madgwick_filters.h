@@ -10,25 +10,19 @@
 #define madgwick_filters_h
 
 #include <Arduino.h>
-
-struct Quaternion {
-  float q1 = 1.0f;
-  float q2 = 0.0f;
-  float q3 = 0.0f;
-  float q4 = 0.0f;
-};
+#include "quaternion.h"
 
 class MadgwickFilters {
   private:
     float GyroMeasError = PI * (40.0f / 180.0f);        // gyroscope measurement error in rads/s (start at 40 deg/s)
     float beta = sqrtf(3.0f / 4.0f) * GyroMeasError;    // compute beta
-    Quaternion quaternion;
+    imu::Quaternion quaternion;
 
     
   public:
     MadgwickFilters();
     __attribute__((optimize("O3"))) void madgwickQuaternionUpdate(float deltaTime, float ax, float ay, float az, float gx, float gy, float gz, float mx, float my, float mz);
-    const Quaternion& getQuaternions() const;
+    const imu::Quaternion& getQuaternions() const;
 };
 
 #endif
\ No newline at end of file
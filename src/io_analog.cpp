@@ -6,7 +6,7 @@
 // http://henrysbench.capnfatz.com/henrys-bench/arduino-voltage-measurements/arduino-ads1115-module-getting-started-tutorial/
 // https://learn.adafruit.com/adafruit-4-channel-adc-breakouts/arduino-code
 
-IO_Analog::IO_Analog() : adc1(Definitions::ADC1_ADDR), adc2(Definitions::ADC2_ADDR) {
+IO_Analog::IO_Analog(SemaphoreHandle_t busLock) : adc1(Definitions::ADC1_ADDR), adc2(Definitions::ADC2_ADDR), lock(busLock) {
 
   // The ADC input range (or gain) can be changed via the following
   // functions, but be careful never to exceed VDD +0.3V max, or to
@@ -17,6 +17,7 @@ IO_Analog::IO_Analog() : adc1(Definitions::ADC1_ADDR), adc2(Definitions::ADC2_AD
   // adc.setGain(GAIN_TWOTHIRDS);  // 2/3x gain +/- 6.144V  1 bit = 3mV      0.1875mV (default)
   // adc.setGain(GAIN_ONE);        // 1x gain   +/- 4.096V  1 bit = 2mV      0.125mV
   adc1.setGain(GAIN_TWO);          // 2x gain   +/- 2.048V  1 bit = 1mV      0.0625mV
+  adc1.setSPS(ADS1115_DR_860SPS);  // fastest rate, cutter current is sampled at high rate to catch a jammed blade.
   // adc.setGain(GAIN_FOUR);       // 4x gain   +/- 1.024V  1 bit = 0.5mV    0.03125mV
   // adc.setGain(GAIN_EIGHT);      // 8x gain   +/- 0.512V  1 bit = 0.25mV   0.015625mV
   // adc.setGain(GAIN_SIXTEEN);    // 16x gain  +/- 0.256V  1 bit = 0.125mV  0.0078125mV
@@ -27,12 +28,70 @@ IO_Analog::IO_Analog() : adc1(Definitions::ADC1_ADDR), adc2(Definitions::ADC2_AD
 
 float IO_Analog::getVoltageAdc1(uint8_t channel) {
 
-  return adc1.readADC_SingleEnded_V(channel);
+  float voltage;
+  xSemaphoreTake(lock, portMAX_DELAY);
+
+  if (channel == continuousChannel && (int32_t)(micros() - continuousReadyAt) >= 0) {
+    voltage = ((float) adc1.getLastConversionResults()) * adc1.voltsPerBit();
+  } else {
+    // a single conversion changes the channel, sampling has to wait until continuous mode is back on the right channel.
+    voltage = adc1.readADC_SingleEnded_V(channel);
+
+    if (continuousChannel != NO_CHANNEL) {
+      adc1.startContinuous_SingleEnded(continuousChannel);
+      continuousReadyAt = micros() + CONVERSION_TIME;
+    }
+  }
+
+  xSemaphoreGive(lock);
+
+  return voltage;
+
+}
+
+void IO_Analog::startContinuousAdc1(uint8_t channel) {
+
+  xSemaphoreTake(lock, portMAX_DELAY);
+  continuousChannel = channel;
+  adc1.startContinuous_SingleEnded(channel);
+  continuousReadyAt = micros() + CONVERSION_TIME;
+  xSemaphoreGive(lock);
+
+}
+
+void IO_Analog::stopContinuousAdc1() {
+
+  // ADC keeps converting until next single conversion is requested, that does no harm.
+  xSemaphoreTake(lock, portMAX_DELAY);
+  continuousChannel = NO_CHANNEL;
+  xSemaphoreGive(lock);
+
+}
+
+bool IO_Analog::readContinuousAdc1(float& voltage) {
+
+  // someone else is using the bus (e.g. reading another channel, or another device), skip this sample rather than holding up the timer task.
+  if (xSemaphoreTake(lock, 0) != pdTRUE) {
+    return false;
+  }
+
+  bool fresh = continuousChannel != NO_CHANNEL && (int32_t)(micros() - continuousReadyAt) >= 0;
+  if (fresh) {
+    voltage = ((float) adc1.getLastConversionResults()) * adc1.voltsPerBit();
+  }
+
+  xSemaphoreGive(lock);
+
+  return fresh;
 
 }
 
 float IO_Analog::getChargeCurrent() {
 
-  return ((float) adc2.getLastConversionResults()) * adc2.voltsPerBit() / Definitions::CHARGE_SHUNT_VALUE;
+  xSemaphoreTake(lock, portMAX_DELAY);
+  float current = ((float) adc2.getLastConversionResults()) * adc2.voltsPerBit() / Definitions::CHARGE_SHUNT_VALUE;
+  xSemaphoreGive(lock);
+
+  return current;
 
 }
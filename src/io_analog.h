@@ -3,25 +3,49 @@
 
 #include <Arduino.h>
 #include <Adafruit_ADS1015.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include "definitions.h"
 
 
 /**
 * Analog to Digital converter, used to read battery voltage, charge voltage, cutter motor load, and more.
+* Readings are taken both from the main loop and from timers (that run in a task of their own), so all access to the ADCs goes through the
+* I2C bus lock, which every other device on the bus takes too.
 */
 class IO_Analog {
   public:
-    IO_Analog();
+    /**
+    * @param busLock mutex shared by everyone using the I2C bus.
+    */
+    IO_Analog(SemaphoreHandle_t busLock);
 
     /**
     * Get the voltage readings from the specified channel of ADC #1.
     */
     float getVoltageAdc1(uint8_t channel);
+    /**
+    * Let ADC #1 convert the specified channel over and over, so that it can be sampled at high rate (up to 860 samples/second).
+    * Reading other channels still works, but pauses sampling for a couple of milliseconds.
+    */
+    void startContinuousAdc1(uint8_t channel);
+    void stopContinuousAdc1();
+    /**
+    * Get latest conversion of the channel started with startContinuousAdc1(). Never waits, so it's safe to call from a timer.
+    * @return false if there is no fresh conversion of that channel, e.g. because another channel is being read.
+    */
+    bool readContinuousAdc1(float& voltage);
     float getChargeCurrent();
 
   private:
+    static const uint8_t NO_CHANNEL = 0xFF;
+    static const uint16_t CONVERSION_TIME = 1300;   // Time (us) for one conversion at 860 samples/second, with some margin.
+
     Adafruit_ADS1115 adc1;
     Adafruit_ADS1115 adc2;
+    SemaphoreHandle_t lock;                 // I2C bus lock, held while talking to an ADC.
+    uint8_t continuousChannel = NO_CHANNEL;
+    uint32_t continuousReadyAt = 0;         // micros() when first conversion after (re)starting continuous mode is done.
 };
 
 #endif
@@ -4,15 +4,19 @@
 
 // Useful MCP23017 information: https://www.best-microcontroller-projects.com/mcp23017.html
 
-IO_Digital::IO_Digital(TwoWire& w): _Wire(w), device(Definitions::DIGITAL_EXPANDER_ADDR, w) {
+IO_Digital::IO_Digital(TwoWire& w, SemaphoreHandle_t busLock): _Wire(w), busLock(busLock), device(Definitions::DIGITAL_EXPANDER_ADDR, w) {
 
+  xSemaphoreTake(busLock, portMAX_DELAY);
   device.init();
   device.interruptMode(MCP23017_INTMODE::OR);
+  xSemaphoreGive(busLock);
 
 }
 
 void IO_Digital::setPinMode(uint8_t pin, bool input) {
+  xSemaphoreTake(busLock, portMAX_DELAY);
   device.pinMode(pin, input);
+  xSemaphoreGive(busLock);
 }
 
 void IO_Digital::digitalWrite(uint8_t pin, bool state) {
@@ -31,10 +35,16 @@ mcp.init();
     mcp.clearInterrupts();
     attachInterrupt(1, userInput, FALLING);
     */
+  xSemaphoreTake(busLock, portMAX_DELAY);
   device.digitalWrite(pin, state);
+  xSemaphoreGive(busLock);
 }
 
 bool IO_Digital::digitalRead(uint8_t pin) {
-  return device.digitalRead(pin);
+  xSemaphoreTake(busLock, portMAX_DELAY);
+  bool state = device.digitalRead(pin);
+  xSemaphoreGive(busLock);
+
+  return state;
 }
 
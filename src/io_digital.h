@@ -3,16 +3,25 @@
 
 #include <Wire.h>
 #include <MCP23017.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
+/**
+* Port expander (MCP23017) on the I2C bus, every access holds the bus lock since timers read other devices on the bus from a task of their own.
+*/
 class IO_Digital {
   public:
-    IO_Digital(TwoWire& w);
+    /**
+    * @param busLock mutex shared by everyone using the I2C bus.
+    */
+    IO_Digital(TwoWire& w, SemaphoreHandle_t busLock);
     void setPinMode(uint8_t pin, bool input);
     void digitalWrite(uint8_t pin, bool state);
     bool digitalRead(uint8_t pin);
 
   private:
     TwoWire& _Wire;
+    SemaphoreHandle_t busLock;
     MCP23017 device;
 };
 
@@ -0,0 +1,144 @@
+#include <ArduinoLog.h>
+#include "joystick_channel.h"
+
+JoystickChannel::JoystickChannel(WheelController& wheelController) : wheelController(wheelController) { }
+
+bool JoystickChannel::onFrame(const uint8_t* data, size_t length) {
+  if (length < FRAME_SIZE || data[0] != JOYSTICK_FRAME) {
+    return false;
+  }
+
+  uint16_t sequence = data[1] | (data[2] << 8);
+
+  if (hasSequence) {
+    // sequence numbers wrap around, so compare the distance instead of the values.
+    int16_t distance = sequence - lastSequence;
+
+    if (distance <= 0) {
+      statistics.framesOutOfOrder++;
+      return false;
+    }
+
+    statistics.framesLost += distance - 1;
+  }
+
+  auto now = millis();
+
+  if (hasSequence && !timedOut && now - lastFrameTime > statistics.maxFrameInterval) {
+    statistics.maxFrameInterval = now - lastFrameTime;
+  }
+
+  hasSequence = true;
+  lastSequence = sequence;
+  lastFrameTime = now;
+  timedOut = false;
+  commandPending = true;
+  statistics.framesReceived++;
+
+  int8_t speed = constrain((int8_t)data[3], -100, 100);
+  int8_t turnrate = constrain((int8_t)data[4], -100, 100);
+
+  // same mixing as WheelController::forward(), inner wheel is slowed down when turning.
+  targetLeft = speed;
+  targetRight = speed;
+  if (turnrate < 0) {
+    targetLeft = speed * (100 + turnrate) / 100.0f;
+  } else if (turnrate > 0) {
+    targetRight = speed * (100 - turnrate) / 100.0f;
+  }
+
+  return true;
+}
+
+void JoystickChannel::onDisconnect() {
+  if (currentLeft != 0 || currentRight != 0 || targetLeft != 0 || targetRight != 0) {
+    Log.notice(F("Joystick client disconnected, stopping." CR));
+    stop();
+  }
+}
+
+void JoystickChannel::reset() {
+  targetLeft = 0;
+  targetRight = 0;
+  currentLeft = 0;
+  currentRight = 0;
+  hasSequence = false;
+  timedOut = false;
+  commandPending = false;
+  lastProcessTime = millis();
+}
+
+bool JoystickChannel::hasTimedOut() const {
+  return timedOut;
+}
+
+const joystickStatistics& JoystickChannel::getStatistics() const {
+  return statistics;
+}
+
+void JoystickChannel::process() {
+  auto now = millis();
+  auto elapsed = now - lastProcessTime;
+  lastProcessTime = now;
+
+  if (timedOut) {
+    return;
+  }
+
+  if (hasSequence && now - lastFrameTime > DEADMAN_TIMEOUT) {
+    if (currentLeft != 0 || currentRight != 0 || targetLeft != 0 || targetRight != 0) {
+      Log.notice(F("No joystick setpoint for %l ms, stopping." CR), now - lastFrameTime);
+      statistics.deadmanStops++;
+      stop();
+    }
+    return;
+  }
+
+  float maxStep = ACCELERATION * elapsed / 1000.0f;
+  auto left = slew(currentLeft, targetLeft, maxStep);
+  auto right = slew(currentRight, targetRight, maxStep);
+
+  // only bother the wheels when the output actually changes.
+  if ((int8_t)left != (int8_t)currentLeft || (int8_t)right != (int8_t)currentRight || commandPending) {
+    wheelController.drive((int8_t)left, (int8_t)right);
+  }
+
+  currentLeft = left;
+  currentRight = right;
+
+  if (commandPending) {
+    commandPending = false;
+
+    auto latency = now - lastFrameTime;
+    statistics.commandLatency += latency;
+    statistics.commands++;
+    if (latency > statistics.maxCommandLatency) {
+      statistics.maxCommandLatency = latency;
+    }
+  }
+}
+
+/**
+ * Stop right away, ramping down is not an option when we have lost contact with the one driving.
+ */
+void JoystickChannel::stop() {
+  targetLeft = 0;
+  targetRight = 0;
+  currentLeft = 0;
+  currentRight = 0;
+  timedOut = true;
+  commandPending = false;
+  wheelController.stop();
+}
+
+float JoystickChannel::slew(float current, float target, float maxStep) {
+  if (target > current + maxStep) {
+    return current + maxStep;
+  }
+
+  if (target < current - maxStep) {
+    return current - maxStep;
+  }
+
+  return target;
+}
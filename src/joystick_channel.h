@@ -0,0 +1,78 @@
+#ifndef _joystick_channel_h
+#define _joystick_channel_h
+
+#include <Arduino.h>
+#include "wheel_controller.h"
+#include "processable.h"
+
+struct joystickStatistics {
+  uint32_t framesReceived = 0;
+  uint32_t framesOutOfOrder = 0;  // arrived after a newer setpoint, ignored.
+  uint32_t framesLost = 0;        // gaps in sequence numbers.
+  uint32_t deadmanStops = 0;      // times wheels were stopped because setpoints stopped coming.
+  uint32_t maxFrameInterval = 0;  // longest time (ms) between two setpoints while driving.
+  uint32_t commandLatency = 0;    // sum of time (ms) from setpoint received until applied to wheels, divide with commands for average.
+  uint32_t maxCommandLatency = 0;
+  uint32_t commands = 0;
+};
+
+/**
+* Lightweight channel for driving the mower with a joystick in MANUAL mode.
+* The client streams setpoints (20-50 per second) as small binary frames, these are applied to the wheels with limited acceleration,
+* so that a jerky joystick doesn't make the mower jump. If setpoints stop coming (client lost connection, browser tab in background, ...)
+* the dead-man timeout stops the wheels within DEADMAN_TIMEOUT of the last setpoint.
+*
+* Frame: message type (uint8, JOYSTICK_FRAME), sequence number (uint16, little endian), speed (int8, -100 -> 100, negative to drive backward),
+* turnrate (int8, -100 -> 100, negative to turn left).
+*/
+class JoystickChannel : public Processable {
+  public:
+    static const uint8_t JOYSTICK_FRAME = 1;
+    static const uint8_t FRAME_SIZE = 5;
+    static const uint16_t DEADMAN_TIMEOUT = 300;  // Stop wheels if no setpoint has been received within this time (ms).
+
+    JoystickChannel(WheelController& wheelController);
+    /**
+    * Handle frame received from client.
+    * @return false if frame was malformed or out of order.
+    */
+    bool onFrame(const uint8_t* data, size_t length);
+    /**
+    * Should be called when the client disconnects, wheels are stopped right away.
+    */
+    void onDisconnect();
+    /**
+    * Forget current setpoint and sequence number, should be called when entering manual mode.
+    */
+    void reset();
+    /**
+    * Returns true if wheels have been stopped by the dead-man timeout (or a disconnect), until next setpoint is received.
+    */
+    bool hasTimedOut() const;
+    const joystickStatistics& getStatistics() const;
+    /**
+    * Apply latest setpoint to wheels, should only be called when in manual mode.
+    */
+    void process();
+
+  private:
+    static const uint16_t ACCELERATION = 250;   // Max change of wheel speed (percent per second).
+
+    WheelController& wheelController;
+    float targetLeft = 0;
+    float targetRight = 0;
+    float currentLeft = 0;
+    float currentRight = 0;
+    uint16_t lastSequence = 0;
+    bool hasSequence = false;
+    bool timedOut = false;
+    bool commandPending = false;
+    uint32_t lastFrameTime = 0;
+    uint32_t lastProcessTime = 0;
+    joystickStatistics statistics;
+
+    void stop();
+    static float slew(float current, float target, float maxStep);
+};
+
+#endif
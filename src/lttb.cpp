@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <math.h>
+#include "lttb.h"
+
+Lttb::Lttb(uint32_t total, uint16_t points) :
+  total(total),
+  points(points < 3 ? 3 : points) {
+
+  if (isDownsampling()) {
+    // first and last point have their own buckets.
+    averages.resize(this->points - 2, { 0, 0, 0 });
+    selected.reserve(this->points);
+  }
+}
+
+bool Lttb::isDownsampling() const {
+  return total > points;
+}
+
+void Lttb::addAverage(float x, float y) {
+  auto index = averaged++;
+
+  if (!isDownsampling() || index >= total) {
+    return;
+  }
+
+  if (index == total - 1) {
+    last = { x, y, 1 };
+  } else if (index > 0) {
+    // running average, a sum of large values (e.g. timestamps) would lose precision in a float.
+    auto& bucket = averages[getBucket(index)];
+    bucket.count++;
+    bucket.x += (x - bucket.x) / bucket.count;
+    bucket.y += (y - bucket.y) / bucket.count;
+  }
+}
+
+void Lttb::addCandidate(float x, float y) {
+  auto index = candidates++;
+
+  if (!isDownsampling() || index >= total) {
+    return;
+  }
+
+  if (index == 0) {
+    select(index, x, y);
+    return;
+  }
+
+  if (index == total - 1) {
+    select(bestIndex, bestX, bestY);
+    select(index, x, y);
+    return;
+  }
+
+  auto bucket = getBucket(index);
+
+  if (bucket != currentBucket) {
+    if (currentBucket >= 0) {
+      select(bestIndex, bestX, bestY);
+    }
+    currentBucket = bucket;
+    bestArea = -1;
+  }
+
+  auto& next = bucket + 1 < (int32_t)averages.size() ? averages[bucket + 1] : last;
+  // twice the area of triangle (selected, candidate, next), only used for comparison.
+  float area = fabs((selectedX - next.x) * (y - selectedY) - (selectedX - x) * (next.y - selectedY));
+
+  if (area > bestArea) {
+    bestArea = area;
+    bestIndex = index;
+    bestX = x;
+    bestY = y;
+  }
+}
+
+bool Lttb::isSelected(uint32_t index) const {
+  if (!isDownsampling()) {
+    return true;
+  }
+
+  return std::binary_search(selected.begin(), selected.end(), index);
+}
+
+uint16_t Lttb::getBucket(uint32_t index) const {
+  // points between first and last are spread evenly over buckets.
+  return (uint64_t)(index - 1) * averages.size() / (total - 2);
+}
+
+void Lttb::select(uint32_t index, float x, float y) {
+  selected.push_back(index);
+  selectedX = x;
+  selectedY = y;
+}
@@ -0,0 +1,69 @@
+#ifndef _lttb_h
+#define _lttb_h
+
+#include <Arduino.h>
+#include <vector>
+
+/**
+* Largest-Triangle-Three-Buckets downsampling (Sveinn Steinarsson, 2013). Picks the points that keep the visual shape of a series,
+* so a chart of a few hundred points looks like a chart of the whole series.
+*
+* Points are split into buckets, first and last point are always kept. From each bucket the point that forms the largest triangle with
+* the point picked from the previous bucket and the average of the next bucket is picked.
+*
+* Works on a stream of points in two passes, so the series never has to be in memory at once:
+* 1. add all points with addAverage(), to get the average of each bucket.
+* 2. add the same points again with addCandidate(), to pick one point per bucket.
+* Memory use only depends on the number of points we want, not the length of the series.
+*/
+class Lttb {
+  public:
+    /**
+    * @param total number of points in series.
+    * @param points number of points we want (at least 3).
+    */
+    Lttb(uint32_t total, uint16_t points);
+    /**
+    * false if series already is small enough, then all points are selected and there is no need to do any passes.
+    */
+    bool isDownsampling() const;
+    /**
+    * First pass, add points in order.
+    */
+    void addAverage(float x, float y);
+    /**
+    * Second pass, add same points in same order.
+    */
+    void addCandidate(float x, float y);
+    /**
+    * After second pass, check if point at index (0 = first point in series) was picked.
+    */
+    bool isSelected(uint32_t index) const;
+
+  private:
+    struct bucketAverage {
+      float x;
+      float y;
+      uint32_t count;
+    };
+
+    uint32_t total;
+    uint16_t points;
+    std::vector<bucketAverage> averages;
+    std::vector<uint32_t> selected;
+    bucketAverage last = { 0, 0, 0 };
+    uint32_t averaged = 0;
+    uint32_t candidates = 0;
+    int32_t currentBucket = -1;
+    float bestArea = 0;
+    uint32_t bestIndex = 0;
+    float bestX = 0;
+    float bestY = 0;
+    float selectedX = 0;
+    float selectedY = 0;
+
+    uint16_t getBucket(uint32_t index) const;
+    void select(uint32_t index, float x, float y);
+};
+
+#endif
@@ -18,7 +18,16 @@
 #include "sonar.h"
 #include "state_controller.h"
 #include "mowing_schedule.h"
+#include "joystick_channel.h"
+#include "slip_estimator.h"
+#include "pose_estimator.h"
+#include "return_planner.h"
+#include "energy_ledger.h"
+#include "wheel_monitor.h"
+#include "stuck_recovery.h"
+#include "status_snapshot.h"
 #include "dockingstation/dockingstation.h"
+#include "telemetry_hub.h"
 
 /*
  * Software for controlling a LIAM robotmower using a ESP-32 microcontroller.
@@ -33,20 +42,31 @@ const uint32_t LOOP_DELAY_WARNING_COOLDOWN = 10000000; // 10 sec
 
 // Setup references between all classes.
 LogStore logstore;
-IO_Analog io_analog;
-IO_Digital io_digital(Wire);
-IO_Accelerometer io_accelerometer(Wire);
+// every device is on the same I2C bus, and timers (running in a task of their own) read some of them while the main loop uses others.
+SemaphoreHandle_t i2cLock = xSemaphoreCreateMutex();
+IO_Analog io_analog(i2cLock);
+IO_Digital io_digital(Wire, i2cLock);
+IO_Accelerometer io_accelerometer(Wire, i2cLock);
 Wheel leftWheel(1, Definitions::LEFT_WHEEL_MOTOR_PIN, Definitions::LEFT_WHEEL_MOTOR_DIRECTION_PIN, Definitions::LEFT_WHEEL_ODOMETER_PIN, Definitions::LEFT_WHEEL_MOTOR_INVERTED, Definitions::LEFT_WHEEL_MOTOR_SPEED);
 Wheel rightWheel(2, Definitions::RIGHT_WHEEL_MOTOR_PIN, Definitions::RIGHT_WHEEL_MOTOR_DIRECTION_PIN, Definitions::RIGHT_WHEEL_ODOMETER_PIN, Definitions::RIGHT_WHEEL_MOTOR_INVERTED, Definitions::RIGHT_WHEEL_MOTOR_SPEED);
 WheelController wheelController(leftWheel, rightWheel);
 Cutter cutter(io_analog);
-GPS gps;
+GPS gps(i2cLock);
 Sonar sonar;
 Battery battery(io_analog, Wire);
 MowingSchedule mowingSchedule;
-Resources resources(wheelController, cutter, battery, gps, sonar, io_accelerometer, logstore, mowingSchedule);
+JoystickChannel joystick(wheelController);
+SlipEstimator slipEstimator(leftWheel, rightWheel, io_accelerometer);
+PoseEstimator poseEstimator(leftWheel, rightWheel, io_accelerometer, slipEstimator);
+ReturnPlanner returnPlanner(battery, poseEstimator);
+EnergyLedger energyLedger(battery, wheelController, cutter, poseEstimator);
+WheelMonitor wheelMonitor(io_analog, leftWheel, rightWheel, slipEstimator);
+StuckRecovery stuckRecovery(wheelController, wheelMonitor, poseEstimator);
+Resources resources(wheelController, cutter, battery, gps, sonar, io_accelerometer, logstore, mowingSchedule, joystick, returnPlanner, energyLedger, wheelMonitor, slipEstimator, stuckRecovery);
 StateController stateController(resources);
-Dockingstation dockingstation(stateController, resources);
+StatusSnapshot statusSnapshot;
+Dockingstation dockingstation(stateController, resources, statusSnapshot, i2cLock);
+TelemetryHub telemetryHub;
 
 uint64_t loopDelayWarningTime;
 
@@ -61,8 +81,10 @@ void scan_I2C() {
 
   for (address = 1; address < 127; address++ ) {
 
+    xSemaphoreTake(i2cLock, portMAX_DELAY);
     Wire.beginTransmission(address);
     error = Wire.endTransmission();
+    xSemaphoreGive(i2cLock);
 
     if (error == 0) {
       Log.notice(F("I2C device found at address %X" CR), address);
@@ -83,6 +105,71 @@ void check_SPI() {
   Log.notice(F("SPI pins, MOSI: %d, MISO: %d, SCK: %d, SS: %d." CR), MOSI, MISO, SCK, SS);
 }
 
+/**
+ * Collect status from all subsystems, once per tick for everyone reporting it (REST, WebSocket, MQTT and LoRa).
+ */
+void setupStatus() {
+  statusSnapshot.onCollect([](MowerStatus& status, const char*& stateName) {
+    auto& orient = io_accelerometer.getOrientation();
+    auto wheelStats = wheelController.getStatus();
+    auto obstacleDistances = sonar.getObstacleDistances();
+    auto stateInstance = stateController.getStateInstance();
+
+    stateName = stateInstance->getStateName();
+    status.state = static_cast<uint8_t>(stateInstance->getState());
+    status.batteryVoltage = battery.getBatteryVoltage();
+    status.batteryLevel = battery.getBatteryStatus();
+    status.batteryChargeCurrent = battery.getChargeCurrent();
+    status.isCharging = battery.isCharging();
+    status.lastFullyChargeTime = battery.getLastFullyChargeTime();
+    status.lastChargeDuration = battery.getLastChargeDuration();
+    status.batteryRemainingTime = battery.getRemainingMinutes();
+    status.cutterLoad = cutter.getLoad();
+    status.cutterRotating = cutter.isCutting();
+    status.uptime = (uint32_t)(esp_timer_get_time() / 1000000); // uptime in microseconds so we divide to seconds.
+    status.leftWheelSpd = wheelStats.leftWheelSpeed;
+    status.rightWheelSpd = wheelStats.rightWheelSpeed;
+    status.pitch = orient.pitch;
+    status.roll = orient.roll;
+    status.heading = orient.heading;
+    status.obstacleFrontDistance = obstacleDistances.frontDistance;
+    status.areaPerWh = energyLedger.getAreaPerWh();
+    status.whPerMowingHour = energyLedger.getWhPerMowingHour();
+  });
+}
+
+/**
+ * Register what is sent on each telemetry topic, frames are shared by all clients subscribing to the topic.
+ * Clients are added by the web server's WebSocket handler, through telemetryHub.addClient()/handleMessage()/onSend().
+ */
+void setupTelemetry() {
+  telemetryHub.setSerializer(TELEMETRY_TOPIC::STATUS, [](uint8_t* buffer, size_t size) -> size_t {
+    // web clients may connect at any time, so always send all fields.
+    return statusSnapshot.writeProtobuf(buffer, size);
+  });
+
+  telemetryHub.setSerializer(TELEMETRY_TOPIC::POSE, [](uint8_t* buffer, size_t size) {
+    auto& orient = io_accelerometer.getOrientation();
+    auto wheelStats = wheelController.getStatus();
+
+    return TelemetryHub::encodePose(buffer, size, millis(), orient.heading, orient.pitch, orient.roll, wheelStats.leftWheelSpeed, wheelStats.rightWheelSpeed);
+  });
+
+  // each client has its own position in the log, a slow client gets the lines it missed on its next turn.
+  telemetryHub.setDeltaSerializer(TELEMETRY_TOPIC::LOG, [](uint8_t* buffer, size_t size, uint16_t& lastLogId) -> size_t {
+    auto logMessages = logstore.getLogMessages();
+    if (logMessages.total == lastLogId) {
+      return 0;
+    }
+
+    return TelemetryHub::encodeLog(buffer, size, logMessages.messages, lastLogId);
+  }, []() -> uint16_t {
+    // new clients get all lines still kept.
+    auto logMessages = logstore.getLogMessages();
+    return logMessages.messages.empty() ? logMessages.total : logMessages.messages.front().id - 1;
+  });
+}
+
 /**
  * Here we setup initial stuff, this is only run once.
  */
@@ -125,6 +212,15 @@ void setup() {
   gps.start();
   battery.start();
   mowingSchedule.start();
+  energyLedger.start();
+  stuckRecovery.start();
+  setupStatus();
+  setupTelemetry();
+
+  stateController.onStateChanged([](AbstractState* state) {
+    energyLedger.setState(state->getState());
+    stuckRecovery.setState(state->getState());
+  });
 
   auto lastState = Configuration::config.lastState;
   // initialize state controller, assume we are DOCKED unless there is a saved state.
@@ -163,9 +259,20 @@ void loop() {
     sonar.process();
     stateController.getStateInstance()->process();
     wheelController.process();
+    wheelMonitor.process();
+    stuckRecovery.process();
     cutter.process();
+    slipEstimator.process();
+    poseEstimator.process();
+    returnPlanner.process();
   }
 
+  battery.process();
+  energyLedger.process();
+  statusSnapshot.process();
+  dockingstation.process();
+  telemetryHub.process();
+
   uint64_t currentTime = esp_timer_get_time();
   uint32_t loopDelay = currentTime - loopStartTime;
 
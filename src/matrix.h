@@ -0,0 +1,137 @@
+/*
+    Inertial Measurement Unit Maths Library, square matrix.
+    Same license as vector.h (GNU General Public License, version 3 or later).
+*/
+
+#ifndef IMUMATH_MATRIX_HPP
+#define IMUMATH_MATRIX_HPP
+
+#include "vector.h"
+
+
+namespace imu
+{
+
+// Row-major N x N matrix of floats, see vector.h for how operations are unrolled.
+template <uint8_t N> class Matrix
+{
+    typedef typename detail::MakeIndices<N>::type rows;
+    typedef typename detail::MakeIndices<N * N>::type cells;
+
+public:
+    constexpr Matrix() : p_mat{} {}
+
+    template <typename... T>
+    constexpr Matrix(detail::Elements, T... values) : p_mat{static_cast<float>(values)...} {}
+
+    static constexpr Matrix identity()
+    {
+        return identity(cells());
+    }
+
+    float& operator ()(int row, int col) &
+    {
+        return p_mat[row * N + col];
+    }
+
+    constexpr float operator ()(int row, int col) const &
+    {
+        return p_mat[row * N + col];
+    }
+
+    constexpr Vector<N> row_to_vector(int row) const
+    {
+        return row_to_vector(row, rows());
+    }
+
+    constexpr Vector<N> col_to_vector(int col) const
+    {
+        return col_to_vector(col, rows());
+    }
+
+    constexpr Matrix transpose() const
+    {
+        return transpose(cells());
+    }
+
+    constexpr Matrix operator+(const Matrix& m) const
+    {
+        return add(m, 1.0f, cells());
+    }
+
+    constexpr Matrix operator-(const Matrix& m) const
+    {
+        return add(m, -1.0f, cells());
+    }
+
+    constexpr Matrix operator*(float scalar) const
+    {
+        return scale(scalar, cells());
+    }
+
+    constexpr Vector<N> operator*(const Vector<N>& v) const
+    {
+        return multiply(v, rows());
+    }
+
+    constexpr Matrix operator*(const Matrix& m) const
+    {
+        return multiply(m, cells());
+    }
+
+
+private:
+    float p_mat[N * N];
+
+    template <uint8_t... I>
+    static constexpr Matrix identity(detail::Indices<I...>)
+    {
+        return Matrix(detail::Elements(), (I / N == I % N ? 1.0f : 0.0f)...);
+    }
+
+    template <uint8_t... I>
+    constexpr Vector<N> row_to_vector(int row, detail::Indices<I...>) const
+    {
+        return Vector<N>(detail::Elements(), p_mat[row * N + I]...);
+    }
+
+    template <uint8_t... I>
+    constexpr Vector<N> col_to_vector(int col, detail::Indices<I...>) const
+    {
+        return Vector<N>(detail::Elements(), p_mat[I * N + col]...);
+    }
+
+    template <uint8_t... I>
+    constexpr Matrix transpose(detail::Indices<I...>) const
+    {
+        return Matrix(detail::Elements(), p_mat[(I % N) * N + I / N]...);
+    }
+
+    template <uint8_t... I>
+    constexpr Matrix add(const Matrix& m, float sign, detail::Indices<I...>) const
+    {
+        return Matrix(detail::Elements(), p_mat[I] + sign * m.p_mat[I]...);
+    }
+
+    template <uint8_t... I>
+    constexpr Matrix scale(float scalar, detail::Indices<I...>) const
+    {
+        return Matrix(detail::Elements(), p_mat[I] * scalar...);
+    }
+
+    template <uint8_t... I>
+    constexpr Vector<N> multiply(const Vector<N>& v, detail::Indices<I...>) const
+    {
+        return Vector<N>(detail::Elements(), detail::Dot<0, N>::of(p_mat + I * N, 1, v.data(), 1)...);
+    }
+
+    template <uint8_t... I>
+    constexpr Matrix multiply(const Matrix& m, detail::Indices<I...>) const
+    {
+        return Matrix(detail::Elements(), detail::Dot<0, N>::of(p_mat + (I / N) * N, 1, m.p_mat + I % N, N)...);
+    }
+};
+
+} // namespace
+
+#endif
@@ -70,19 +70,27 @@ void MowingSchedule::setManualMowingOverride(bool enable) {
  * Check if the mower should mow now, according to the mowing schedule and the current time.
  */
 bool MowingSchedule::isTimeToMow() {
+  return getRemainingMinutes() > 0;
+}
+
+/**
+ * Get minutes left until mowing should stop according to the mowing schedule, 0 if it's not time to mow. When manually launched there is no end, UINT16_MAX is returned.
+ */
+uint16_t MowingSchedule::getRemainingMinutes() {
 
   if (manualMowingOverride) {
-    return true;
+    return UINT16_MAX;
   }
   
   struct tm timeinfo;
 
   if (!getLocalTime(&timeinfo, 200)) { // tries for 200 ms
-    return false;
+    return 0;
   }
 
   // fix day-of-week to follow ISO-8601
   int8_t dayOfWeek = timeinfo.tm_wday == 0 ? 6 : timeinfo.tm_wday - 1;
+  int remaining = 0;
 
   for (auto schedule : mowingSchedule) {
 
@@ -91,13 +99,14 @@ bool MowingSchedule::isTimeToMow() {
       int startTimeInMinutes = schedule.startTime.substring(0, 2).toInt() * 60 + schedule.startTime.substring(3).toInt(); // turn string, like "08:45", into minutes.
       int stopTimeInMinutes = schedule.stopTime.substring(0, 2).toInt() * 60 + schedule.stopTime.substring(3).toInt();
 
-      if (currentTimeInMinutes >= startTimeInMinutes && currentTimeInMinutes < stopTimeInMinutes) {
-        return true;
+      // schedules may overlap, go with the one ending last.
+      if (currentTimeInMinutes >= startTimeInMinutes && currentTimeInMinutes < stopTimeInMinutes && stopTimeInMinutes - currentTimeInMinutes > remaining) {
+        remaining = stopTimeInMinutes - currentTimeInMinutes;
       }
     }
   }
 
-  return false;
+  return remaining;
 }
 
 void MowingSchedule::start() {
@@ -19,6 +19,7 @@ class MowingSchedule {
     void removeScheduleEntry(uint8_t position);
     void setManualMowingOverride(bool enable);
     bool isTimeToMow();
+    uint16_t getRemainingMinutes();
     void start();
     
   private:
@@ -0,0 +1,56 @@
+#include "mqtt_publisher.h"
+
+MqttPublisher::MqttPublisher(StatusSnapshot& statusSnapshot, MqttTransport& transport, const String& baseTopic) :
+  statusSnapshot(statusSnapshot),
+  queue(transport),
+  stateTopic(baseTopic + "/state"),
+  statusTopic(baseTopic + "/status") {
+}
+
+void MqttPublisher::onStateChanged(const char* state) {
+  queue.enqueue(stateTopic, state, true, false);
+  // don't wait for next process(), a state change is what subscribers care most about.
+  queue.process(millis());
+}
+
+const mqttStatistics& MqttPublisher::getStatistics() const {
+  return queue.getStatistics();
+}
+
+size_t MqttPublisher::getQueueLength() const {
+  return queue.getLength();
+}
+
+void MqttPublisher::process() {
+  auto now = millis();
+  auto& status = statusSnapshot.getStatus();
+  auto sinceLast = now - lastPublishTime;
+
+  if (!hasPublished || sinceLast >= MAX_INTERVAL || (sinceLast >= MIN_INTERVAL && hasChanged(status))) {
+    // status JSON is shared with everyone else reporting status, no need to build our own.
+    queue.enqueue(statusTopic, statusSnapshot.getJson(), false, true);
+    lastPublished = status;
+    lastPublishTime = now;
+    hasPublished = true;
+  }
+
+  queue.process(now);
+}
+
+/**
+ * Returns true if any value has changed more than its deadband since last published.
+ */
+bool MqttPublisher::hasChanged(const MowerStatus& status) const {
+  return status.state != lastPublished.state ||
+         status.isCharging != lastPublished.isCharging ||
+         status.cutterRotating != lastPublished.cutterRotating ||
+         abs(status.batteryVoltage - lastPublished.batteryVoltage) >= 0.05f ||
+         abs(status.batteryChargeCurrent - lastPublished.batteryChargeCurrent) >= 20 ||
+         abs(status.batteryLevel - lastPublished.batteryLevel) >= 1 ||
+         abs(status.cutterLoad - lastPublished.cutterLoad) >= 5 ||
+         abs(status.leftWheelSpd - lastPublished.leftWheelSpd) >= 5 ||
+         abs(status.rightWheelSpd - lastPublished.rightWheelSpd) >= 5 ||
+         abs(status.pitch - lastPublished.pitch) >= 3 ||
+         abs(status.roll - lastPublished.roll) >= 3 ||
+         abs((int16_t)(status.heading - lastPublished.heading + 540) % 360 - 180) >= 10;
+}
@@ -0,0 +1,46 @@
+#ifndef _mqtt_publisher_h
+#define _mqtt_publisher_h
+
+#include <Arduino.h>
+#include "status_snapshot.h"
+#include "processable.h"
+#include "mqtt_queue.h"
+
+/**
+* Publishes mower status to a MQTT broker (e.g. for home automation).
+*
+* State transitions are published right away, as a retained message on <base topic>/state.
+* Numeric values are batched into one JSON message on <base topic>/status (same content as the REST status), published as soon as any value
+* has changed more than its deadband, but not more often than MIN_INTERVAL. When nothing changes we only publish every MAX_INTERVAL,
+* so the rate adapts to what the mower is doing: a docked mower is quiet, while a mowing one reports often.
+*
+* All messages are QoS 1, see MqttQueue.
+*/
+class MqttPublisher : public Processable {
+  public:
+    MqttPublisher(StatusSnapshot& statusSnapshot, MqttTransport& transport, const String& baseTopic);
+    /**
+    * Should be called when mower changes state.
+    */
+    void onStateChanged(const char* state);
+    const mqttStatistics& getStatistics() const;
+    size_t getQueueLength() const;
+    /* Internal use only! */
+    void process();
+
+  private:
+    static const uint16_t MIN_INTERVAL = 2000;    // Never publish status more often than this (ms).
+    static const uint32_t MAX_INTERVAL = 60000;   // Always publish status at least this often (ms).
+
+    StatusSnapshot& statusSnapshot;
+    MqttQueue queue;
+    String stateTopic;
+    String statusTopic;
+    MowerStatus lastPublished;
+    uint32_t lastPublishTime = 0;
+    bool hasPublished = false;
+
+    bool hasChanged(const MowerStatus& status) const;
+};
+
+#endif
@@ -0,0 +1,132 @@
+#include "mqtt_queue.h"
+
+MqttQueue::MqttQueue(MqttTransport& transport) : transport(transport) {
+
+  transport.onAck([this](uint16_t packetId) {
+    // called from the transport's task, leave the queue alone and let the main loop have it.
+    portENTER_CRITICAL(&ackFifoMux);
+    if (ackFifoLength < ACK_FIFO_SIZE) {
+      ackFifo[(ackFifoStart + ackFifoLength) % ACK_FIFO_SIZE] = packetId;
+      ackFifoLength++;
+    }
+    portEXIT_CRITICAL(&ackFifoMux);
+  });
+}
+
+void MqttQueue::enqueue(const String& topic, const String& payload, bool retain, bool isStatus) {
+  size_t size = topic.length() + payload.length();
+
+  // make room, dropping old status messages before anything else. Messages waiting for acknowledgement are dropped last.
+  while (!queue.empty() && (queue.size() >= MAX_QUEUE_LENGTH || statistics.queueBytes + size > MAX_QUEUE_BYTES)) {
+    auto victim = queue.end();
+
+    for (auto it = queue.begin(); it != queue.end(); ++it) {
+      if (it->isStatus && it->packetId == 0) {
+        victim = it;
+        break;
+      }
+    }
+
+    if (victim == queue.end()) {
+      victim = queue.begin();
+    }
+
+    statistics.dropped++;
+    remove(victim);
+  }
+
+  message msg;
+  msg.topic = topic;
+  msg.payload = payload;
+  msg.retain = retain;
+  msg.isStatus = isStatus;
+  msg.packetId = 0;
+  msg.sentTime = 0;
+  queue.push_back(msg);
+
+  statistics.queueBytes += size;
+  if (statistics.queueBytes > statistics.maxQueueBytes) {
+    statistics.maxQueueBytes = statistics.queueBytes;
+  }
+}
+
+void MqttQueue::process(uint32_t now) {
+  handleAcks();
+  sendQueued(now);
+}
+
+const mqttStatistics& MqttQueue::getStatistics() const {
+  return statistics;
+}
+
+size_t MqttQueue::getLength() const {
+  return queue.size();
+}
+
+void MqttQueue::handleAcks() {
+  while (true) {
+    uint16_t packetId = 0;
+
+    portENTER_CRITICAL(&ackFifoMux);
+    bool hasAck = ackFifoLength > 0;
+    if (hasAck) {
+      packetId = ackFifo[ackFifoStart];
+      ackFifoStart = (ackFifoStart + 1) % ACK_FIFO_SIZE;
+      ackFifoLength--;
+    }
+    portEXIT_CRITICAL(&ackFifoMux);
+
+    if (!hasAck) {
+      return;
+    }
+
+    // a late acknowledgement of a resent message finds nothing, the first one already removed it.
+    for (auto it = queue.begin(); it != queue.end(); ++it) {
+      if (it->packetId == packetId) {
+        statistics.acknowledged++;
+        remove(it);
+        break;
+      }
+    }
+  }
+}
+
+void MqttQueue::remove(std::deque<message>::iterator it) {
+  statistics.queueBytes -= it->topic.length() + it->payload.length();
+  queue.erase(it);
+}
+
+void MqttQueue::sendQueued(uint32_t now) {
+  if (!transport.isConnected()) {
+    return;
+  }
+
+  uint8_t inFlight = 0;
+
+  // messages go out in order, retransmissions included.
+  for (auto& msg : queue) {
+    if (inFlight >= MAX_IN_FLIGHT) {
+      return;
+    }
+
+    if (msg.packetId != 0 && now - msg.sentTime < ACK_TIMEOUT) {
+      inFlight++;
+      continue;
+    }
+
+    if (msg.packetId != 0) {
+      statistics.retries++;
+    }
+
+    auto packetId = transport.publish(msg.topic.c_str(), msg.payload.c_str(), 1, msg.retain);
+    if (packetId == 0) {
+      // transport is busy, try again next time.
+      return;
+    }
+
+    msg.packetId = packetId;
+    msg.sentTime = now;
+    statistics.published++;
+    inFlight++;
+  }
+}
@@ -0,0 +1,84 @@
+#ifndef _mqtt_queue_h
+#define _mqtt_queue_h
+
+#include <Arduino.h>
+#include <functional>
+#include <deque>
+
+/**
+* Connection to a MQTT broker, implemented by whatever MQTT client library is used (its publish and "on publish acknowledged" functions map straight onto this).
+*/
+class MqttTransport {
+  public:
+    typedef std::function<void(uint16_t packetId)> AckCallback;
+
+    virtual bool isConnected() = 0;
+    /**
+    * Publish message.
+    * @return packet id for QoS 1 messages (which will later be acknowledged), 1 for QoS 0 messages, or 0 if the message could not be sent.
+    */
+    virtual uint16_t publish(const char* topic, const char* payload, uint8_t qos, bool retain) = 0;
+    /**
+    * Register callback that should be called when the broker acknowledges a QoS 1 message.
+    * Async clients call it from their network task, not from the main loop.
+    */
+    virtual void onAck(const AckCallback& fn) = 0;
+};
+
+struct mqttStatistics {
+  uint32_t published = 0;     // messages handed to transport, including retries.
+  uint32_t acknowledged = 0;
+  uint32_t retries = 0;       // messages sent again since broker didn't acknowledge them in time.
+  uint32_t dropped = 0;       // messages thrown away since queue was full.
+  uint32_t queueBytes = 0;    // memory held by queued messages right now.
+  uint32_t maxQueueBytes = 0;
+};
+
+/**
+* Bounded queue of QoS 1 messages, kept until acknowledged by the broker, also while we are offline.
+* When the queue is full, the oldest status message is dropped first since a newer one will replace it anyway.
+*
+* Acknowledgements arrive on the transport's task, they are only put in a small FIFO there and handled by process() in the main loop,
+* so the queue itself is only ever touched from the main loop.
+*/
+class MqttQueue {
+  public:
+    MqttQueue(MqttTransport& transport);
+    void enqueue(const String& topic, const String& payload, bool retain, bool isStatus);
+    /**
+    * Handle acknowledgements and send queued messages (and resend those not acknowledged in time).
+    */
+    void process(uint32_t now);
+    const mqttStatistics& getStatistics() const;
+    size_t getLength() const;
+
+  private:
+    static const uint16_t ACK_TIMEOUT = 10000;    // Resend message if broker has not acknowledged it within this time (ms).
+    static const uint8_t MAX_QUEUE_LENGTH = 20;
+    static const uint16_t MAX_QUEUE_BYTES = 4096;
+    static const uint8_t MAX_IN_FLIGHT = 4;       // Max number of unacknowledged messages.
+    static const uint8_t ACK_FIFO_SIZE = 8;       // Acknowledgements waiting for main loop. If it overflows the message is just resent, which QoS 1 allows.
+
+    struct message {
+      String topic;
+      String payload;
+      bool retain;
+      bool isStatus;
+      uint16_t packetId;    // 0 = not sent yet.
+      uint32_t sentTime;
+    };
+
+    MqttTransport& transport;
+    std::deque<message> queue;
+    mqttStatistics statistics;
+    uint16_t ackFifo[ACK_FIFO_SIZE];
+    uint8_t ackFifoStart = 0;
+    uint8_t ackFifoLength = 0;
+    portMUX_TYPE ackFifoMux = portMUX_INITIALIZER_UNLOCKED;
+
+    void handleAcks();
+    void remove(std::deque<message>::iterator it);
+    void sendQueued(uint32_t now);
+};
+
+#endif
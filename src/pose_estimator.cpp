@@ -0,0 +1,57 @@
+#include "pose_estimator.h"
+#include "definitions.h"
+#include "fast_math.h"
+
+PoseEstimator::PoseEstimator(Wheel& leftWheel, Wheel& rightWheel, IO_Accelerometer& accelerometer, SlipEstimator& slipEstimator) :
+  leftWheel(leftWheel),
+  rightWheel(rightWheel),
+  accelerometer(accelerometer),
+  slipEstimator(slipEstimator) { }
+
+void PoseEstimator::reset() {
+  pose.position = imu::Vector<2>();
+  lastLeftOdometer = leftWheel.getOdometer();
+  lastRightOdometer = rightWheel.getOdometer();
+}
+
+const Pose& PoseEstimator::getPose() const {
+  return pose;
+}
+
+float PoseEstimator::getDistanceToDock() const {
+  return pose.position.magnitude();
+}
+
+float PoseEstimator::getTravelled() const {
+  return travelled;
+}
+
+void PoseEstimator::process() {
+  if (millis() - lastUpdate < UPDATE_INTERVAL) {
+    return;
+  }
+  lastUpdate = millis();
+
+  auto leftOdometer = leftWheel.getOdometer();
+  auto rightOdometer = rightWheel.getOdometer();
+
+  // odometers only count pulses, so direction comes from what the wheels are told to do.
+  float left = (leftOdometer - lastLeftOdometer) * Definitions::WHEEL_METER_PER_PULSE * (leftWheel.getSpeed() < 0 ? -1 : 1);
+  float right = (rightOdometer - lastRightOdometer) * Definitions::WHEEL_METER_PER_PULSE * (rightWheel.getSpeed() < 0 ? -1 : 1);
+  lastLeftOdometer = leftOdometer;
+  lastRightOdometer = rightOdometer;
+
+  // a slipping wheel turns more than it takes us, only count the part that grips.
+  if (slipEstimator.isSlipping()) {
+    left *= 1 - slipEstimator.getSlip(SlipEstimator::LEFT);
+    right *= 1 - slipEstimator.getSlip(SlipEstimator::RIGHT);
+  }
+
+  // when turning on the spot the wheels cancel each other out.
+  float distance = (left + right) / 2;
+  pose.heading = accelerometer.getOrientation().heading;
+  float heading = pose.heading * DEG_TO_RAD;
+
+  pose.position += imu::Vector<2>(FastMath::sin(heading), FastMath::cos(heading)) * distance;
+  travelled += fabsf(distance);
+}
@@ -0,0 +1,54 @@
+#ifndef _pose_estimator_h
+#define _pose_estimator_h
+
+#include <Arduino.h>
+#include "wheel.h"
+#include "io_accelerometer/io_accelerometer.h"
+#include "slip_estimator.h"
+#include "vector.h"
+#include "processable.h"
+
+struct Pose {
+  imu::Vector<2> position;  // meters east (x) and north (y) of docking station.
+  uint16_t heading = 0;     // degrees
+};
+
+/**
+* Keeps track of where the mower is relative to the docking station (dead reckoning), using distance from the wheel odometers and heading from the compass.
+* When wheels slip the odometers overstate the distance, so it's scaled down by how much SlipEstimator says each wheel slips.
+* Small errors add up over time, so the position is only a rough estimate after a long mowing session. It's reset every time the mower is docked.
+*/
+class PoseEstimator : public Processable {
+  public:
+    PoseEstimator(Wheel& leftWheel, Wheel& rightWheel, IO_Accelerometer& accelerometer, SlipEstimator& slipEstimator);
+    /**
+    * Mower is at docking station.
+    */
+    void reset();
+    const Pose& getPose() const;
+    /**
+    * Straight line distance to docking station (meters).
+    */
+    float getDistanceToDock() const;
+    /**
+    * Total distance travelled since start (meters).
+    */
+    float getTravelled() const;
+    /* Internal use only! */
+    void process();
+
+  private:
+    static const uint8_t UPDATE_INTERVAL = 50;  // How often (ms) odometers are read.
+
+    Wheel& leftWheel;
+    Wheel& rightWheel;
+    IO_Accelerometer& accelerometer;
+    SlipEstimator& slipEstimator;
+    Pose pose;
+    float travelled = 0;
+    uint32_t lastLeftOdometer = 0;
+    uint32_t lastRightOdometer = 0;
+    uint32_t lastUpdate = 0;
+};
+
+#endif
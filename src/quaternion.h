@@ -0,0 +1,118 @@
+/*
+    Inertial Measurement Unit Maths Library, quaternion.
+    Same license as vector.h (GNU General Public License, version 3 or later).
+*/
+
+#ifndef IMUMATH_QUATERNION_HPP
+#define IMUMATH_QUATERNION_HPP
+
+#include "vector.h"
+#include "matrix.h"
+
+
+namespace imu
+{
+
+// Rotation quaternion, w is the scalar part. Default is no rotation.
+class Quaternion
+{
+public:
+    constexpr Quaternion() : _w(1.0f), _x(0.0f), _y(0.0f), _z(0.0f) {}
+
+    constexpr Quaternion(float w, float x, float y, float z) : _w(w), _x(x), _y(y), _z(z) {}
+
+    constexpr Quaternion(float w, const Vector<3>& vec) : _w(w), _x(vec.x()), _y(vec.y()), _z(vec.z()) {}
+
+    float& w() & { return _w; }
+    float& x() & { return _x; }
+    float& y() & { return _y; }
+    float& z() & { return _z; }
+    constexpr float w() const & { return _w; }
+    constexpr float x() const & { return _x; }
+    constexpr float y() const & { return _y; }
+    constexpr float z() const & { return _z; }
+
+    constexpr float dot(const Quaternion& q) const
+    {
+        return _w * q._w + _x * q._x + _y * q._y + _z * q._z;
+    }
+
+    float magnitude() const
+    {
+        return sqrtf(dot(*this));
+    }
+
+    void normalize()
+    {
+        float mag = magnitude();
+        if (isnan(mag) || mag == 0.0f)
+            return;
+
+        *this = scale(1.0f / mag);
+    }
+
+    constexpr Quaternion conjugate() const
+    {
+        return Quaternion(_w, -_x, -_y, -_z);
+    }
+
+    constexpr Vector<3> vector() const
+    {
+        return Vector<3>(_x, _y, _z);
+    }
+
+    constexpr Quaternion scale(float scalar) const
+    {
+        return Quaternion(_w * scalar, _x * scalar, _y * scalar, _z * scalar);
+    }
+
+    constexpr Quaternion operator+(const Quaternion& q) const
+    {
+        return Quaternion(_w + q._w, _x + q._x, _y + q._y, _z + q._z);
+    }
+
+    constexpr Quaternion operator-(const Quaternion& q) const
+    {
+        return Quaternion(_w - q._w, _x - q._x, _y - q._y, _z - q._z);
+    }
+
+    constexpr Quaternion operator*(float scalar) const
+    {
+        return scale(scalar);
+    }
+
+    // Hamilton product, rotation q followed by this.
+    constexpr Quaternion operator*(const Quaternion& q) const
+    {
+        return Quaternion(
+            _w * q._w - _x * q._x - _y * q._y - _z * q._z,
+            _w * q._x + _x * q._w + _y * q._z - _z * q._y,
+            _w * q._y - _x * q._z + _y * q._w + _z * q._x,
+            _w * q._z + _x * q._y - _y * q._x + _z * q._w
+        );
+    }
+
+    // Rotation matrix of a unit quaternion.
+    constexpr Matrix<3> toMatrix() const
+    {
+        return Matrix<3>(detail::Elements(),
+            1.0f - 2.0f * (_y * _y + _z * _z), 2.0f * (_x * _y - _w * _z), 2.0f * (_x * _z + _w * _y),
+            2.0f * (_x * _y + _w * _z), 1.0f - 2.0f * (_x * _x + _z * _z), 2.0f * (_y * _z - _w * _x),
+            2.0f * (_x * _z - _w * _y), 2.0f * (_y * _z + _w * _x), 1.0f - 2.0f * (_x * _x + _y * _y)
+        );
+    }
+
+    // Rotate a vector by a unit quaternion.
+    constexpr Vector<3> rotateVector(const Vector<3>& v) const
+    {
+        return toMatrix() * v;
+    }
+
+
+private:
+    float _w, _x, _y, _z;
+};
+
+} // namespace
+
+#endif
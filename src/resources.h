@@ -10,6 +10,12 @@
 #include "io_accelerometer/io_accelerometer.h"
 #include "log_store.h"
 #include "mowing_schedule.h"
+#include "joystick_channel.h"
+#include "return_planner.h"
+#include "energy_ledger.h"
+#include "wheel_monitor.h"
+#include "slip_estimator.h"
+#include "stuck_recovery.h"
 
 
 /**
@@ -25,7 +31,13 @@ class Resources {
                            Sonar& sonar,
                            IO_Accelerometer& accelerometer,
                            LogStore& logStore,
-                           MowingSchedule& mowingSchedule)
+                           MowingSchedule& mowingSchedule,
+                           JoystickChannel& joystick,
+                           ReturnPlanner& returnPlanner,
+                           EnergyLedger& energyLedger,
+                           WheelMonitor& wheelMonitor,
+                           SlipEstimator& slipEstimator,
+                           StuckRecovery& stuckRecovery)
                            : wheelController(wheelController),
                              cutter(cutter),
                              battery(battery),
@@ -33,7 +45,13 @@ class Resources {
                              sonar(sonar),
                              accelerometer(accelerometer),
                              logStore(logStore),
-                             mowingSchedule(mowingSchedule) { }
+                             mowingSchedule(mowingSchedule),
+                             joystick(joystick),
+                             returnPlanner(returnPlanner),
+                             energyLedger(energyLedger),
+                             wheelMonitor(wheelMonitor),
+                             slipEstimator(slipEstimator),
+                             stuckRecovery(stuckRecovery) { }
 
     WheelController& wheelController;
     Cutter& cutter;
@@ -43,6 +61,12 @@ class Resources {
     IO_Accelerometer& accelerometer;
     LogStore& logStore;
     MowingSchedule& mowingSchedule;
+    JoystickChannel& joystick;
+    ReturnPlanner& returnPlanner;
+    EnergyLedger& energyLedger;
+    WheelMonitor& wheelMonitor;
+    SlipEstimator& slipEstimator;
+    StuckRecovery& stuckRecovery;
 };
 
 #endif
@@ -0,0 +1,51 @@
+#include <ArduinoLog.h>
+#include "return_planner.h"
+
+ReturnPlanner::ReturnPlanner(Battery& battery, PoseEstimator& poseEstimator) :
+  battery(battery),
+  poseEstimator(poseEstimator),
+  energyPerMeter(INITIAL_ENERGY_PER_METER / 1000.0f) { }
+
+void ReturnPlanner::reset() {
+  poseEstimator.reset();
+  // don't count energy used while docked.
+  sampleStartDistance = poseEstimator.getTravelled();
+  sampleStartEnergy = battery.getEnergyUsed();
+}
+
+bool ReturnPlanner::shouldReturn() const {
+  return battery.getRemainingEnergy() <= getReturnEnergy();
+}
+
+float ReturnPlanner::getEnergyPerMeter() const {
+  return energyPerMeter;
+}
+
+float ReturnPlanner::getReturnEnergy() const {
+  return getReturnEnergy(poseEstimator.getDistanceToDock(), energyPerMeter);
+}
+
+float ReturnPlanner::getReturnEnergy(float distance, float energyPerMeter) {
+  float pathLength = distance * PATH_FACTOR / 100;
+
+  return pathLength * energyPerMeter * (100 + ENERGY_MARGIN) / 100 + RESERVE_ENERGY / 1000.0f;
+}
+
+void ReturnPlanner::process() {
+  auto travelled = poseEstimator.getTravelled();
+  auto energyUsed = battery.getEnergyUsed();
+
+  if (travelled - sampleStartDistance < SAMPLE_DISTANCE) {
+    return;
+  }
+
+  // energy used while standing still or turning is counted too, it's part of the cost of getting somewhere.
+  float measured = (energyUsed - sampleStartEnergy) / (travelled - sampleStartDistance);
+
+  if (measured > 0) {
+    energyPerMeter += (measured - energyPerMeter) * 0.2f;
+  }
+
+  sampleStartDistance = travelled;
+  sampleStartEnergy = energyUsed;
+}
@@ -0,0 +1,56 @@
+#ifndef _return_planner_h
+#define _return_planner_h
+
+#include <Arduino.h>
+#include "battery.h"
+#include "pose_estimator.h"
+#include "processable.h"
+
+/**
+* Decides when the mower must head back to the docking station, based on how far away it is instead of a fixed battery voltage.
+* Energy used per meter travelled is measured continuously (it varies with grass, slopes and battery age), and the energy needed to get home is
+* the path length home times that, plus a margin. As long as the battery has more than that left we keep mowing.
+*
+* There is no path planner yet, so path length is the straight line distance to the docking station times PATH_FACTOR.
+*/
+class ReturnPlanner : public Processable {
+  public:
+    ReturnPlanner(Battery& battery, PoseEstimator& poseEstimator);
+    /**
+    * Mower is at docking station, start over.
+    */
+    void reset();
+    /**
+    * Returns true when remaining battery energy is just enough to get back to docking station.
+    */
+    bool shouldReturn() const;
+    /**
+    * Measured energy per meter (Wh/m).
+    */
+    float getEnergyPerMeter() const;
+    /**
+    * Energy needed to get back to docking station from current position, margin included (Wh).
+    */
+    float getReturnEnergy() const;
+    /**
+    * Energy needed to travel distance (meters) straight line, margin included (Wh).
+    */
+    static float getReturnEnergy(float distance, float energyPerMeter);
+    /* Internal use only! */
+    void process();
+
+  private:
+    static const uint8_t SAMPLE_DISTANCE = 5;                // Measure energy use over this many meters.
+    static const uint16_t INITIAL_ENERGY_PER_METER = 40;     // Energy use (mWh/m) until we have measured it.
+    static const uint8_t PATH_FACTOR = 150;                  // Path home compared to straight line distance (%), mower has to go around obstacles.
+    static const uint8_t ENERGY_MARGIN = 30;                 // Extra energy (%) on top of estimate, for uphill, wet grass and the like.
+    static const uint16_t RESERVE_ENERGY = 2000;             // Energy (mWh) always kept for finding and entering docking station.
+
+    Battery& battery;
+    PoseEstimator& poseEstimator;
+    float energyPerMeter;
+    float sampleStartDistance = 0;
+    float sampleStartEnergy = 0;
+};
+
+#endif
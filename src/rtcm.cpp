@@ -0,0 +1,299 @@
+#include <ArduinoLog.h>
+#include <Wire.h>
+#include <algorithm>
+#include "rtcm.h"
+
+namespace Rtcm {
+
+  uint32_t crc24q(const uint8_t* data, size_t length, uint32_t crc) {
+    for (size_t i = 0; i < length; i++) {
+      crc ^= (uint32_t)data[i] << 16;
+
+      for (uint8_t bit = 0; bit < 8; bit++) {
+        crc <<= 1;
+        if (crc & 0x1000000) {
+          crc ^= 0x1864CFB;
+        }
+      }
+    }
+
+    return crc & 0xFFFFFF;
+  }
+
+  uint16_t getMessageType(const uint8_t* frame) {
+    return (frame[HEADER_SIZE] << 4) | (frame[HEADER_SIZE + 1] >> 4);
+  }
+
+  size_t getFrameLength(const uint8_t* data, size_t length) {
+    if (length < HEADER_SIZE + CRC_SIZE || data[0] != PREAMBLE || (data[1] & 0xFC) != 0) {
+      return 0;
+    }
+
+    size_t payloadLength = ((data[1] & 0x03) << 8) | data[2];
+    size_t frameLength = HEADER_SIZE + payloadLength + CRC_SIZE;
+
+    if (payloadLength < 2 || length < frameLength) {
+      return 0;
+    }
+
+    uint32_t crc = (data[frameLength - 3] << 16) | (data[frameLength - 2] << 8) | data[frameLength - 1];
+
+    return crc24q(data, frameLength - CRC_SIZE) == crc ? frameLength : 0;
+  }
+}
+
+RtcmParser::RtcmParser(const FrameCallback& fn) : frameCallback(fn) {
+  buffer.reserve(Rtcm::MAX_FRAME_SIZE);
+}
+
+void RtcmParser::parse(const uint8_t* data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    parse(data[i]);
+  }
+}
+
+void RtcmParser::parse(uint8_t data) {
+  if (buffer.empty() && data != Rtcm::PREAMBLE) {
+    return;
+  }
+
+  buffer.push_back(data);
+
+  if (buffer.size() == Rtcm::HEADER_SIZE) {
+    if ((buffer[1] & 0xFC) != 0) {
+      // not a frame after all, the preamble byte could be data in some other message.
+      buffer.clear();
+      return;
+    }
+    expectedLength = Rtcm::HEADER_SIZE + (((buffer[1] & 0x03) << 8) | buffer[2]) + Rtcm::CRC_SIZE;
+  }
+
+  if (buffer.size() < Rtcm::HEADER_SIZE || buffer.size() < expectedLength) {
+    return;
+  }
+
+  if (Rtcm::getFrameLength(buffer.data(), buffer.size()) == expectedLength) {
+    frameCallback(buffer.data(), buffer.size(), Rtcm::getMessageType(buffer.data()));
+    buffer.clear();
+    return;
+  }
+
+  invalidFrames++;
+
+  // look for the next preamble within what we got, it could be the start of a real frame.
+  auto next = std::find(buffer.begin() + 1, buffer.end(), Rtcm::PREAMBLE);
+  std::vector<uint8_t> rest(next, buffer.end());
+  buffer.clear();
+
+  for (auto b : rest) {
+    parse(b);
+  }
+}
+
+uint32_t RtcmParser::getInvalidFrames() const {
+  return invalidFrames;
+}
+
+RtcmFilter::RtcmFilter(const std::vector<uint16_t>& allowedTypes) : allowedTypes(allowedTypes) { }
+
+bool RtcmFilter::accept(const uint8_t* frame, size_t length, uint32_t now) {
+  auto type = Rtcm::getMessageType(frame);
+
+  if (std::find(allowedTypes.begin(), allowedTypes.end(), type) == allowedTypes.end()) {
+    droppedFrames++;
+    droppedBytes += length;
+    return false;
+  }
+
+  if (!isStatic(type)) {
+    return true;
+  }
+
+  // frame CRC is a good enough fingerprint of its content.
+  uint32_t crc = (frame[length - 3] << 16) | (frame[length - 2] << 8) | frame[length - 1];
+
+  for (auto& message : staticMessages) {
+    if (message.type != type) {
+      continue;
+    }
+
+    if (message.crc == crc && now - message.lastSent < STATIC_INTERVAL) {
+      droppedFrames++;
+      droppedBytes += length;
+      return false;
+    }
+
+    message.crc = crc;
+    message.lastSent = now;
+    return true;
+  }
+
+  staticMessages.push_back({ type, crc, now });
+
+  return true;
+}
+
+uint32_t RtcmFilter::getDroppedFrames() const {
+  return droppedFrames;
+}
+
+uint32_t RtcmFilter::getDroppedBytes() const {
+  return droppedBytes;
+}
+
+bool RtcmFilter::isStatic(uint16_t type) {
+  // 1005/1006 base station position, 1007/1008/1033 antenna and receiver description, 1230 GLONASS code-phase biases.
+  return type == 1005 || type == 1006 || type == 1007 || type == 1008 || type == 1033 || type == 1230;
+}
+
+RtcmBatcher::RtcmBatcher(size_t maxSize, const BatchCallback& fn) :
+  maxSize(maxSize),
+  batchCallback(fn) {
+
+  batch.reserve(maxSize);
+}
+
+void RtcmBatcher::add(const uint8_t* frame, size_t length, uint32_t now) {
+  if (length + 1 > maxSize) {
+    Log.warning(F("RTCM frame too large for link (%d bytes)" CR), length);
+    return;
+  }
+
+  if (batch.size() + length > maxSize) {
+    flush();
+  }
+
+  if (batch.empty()) {
+    batch.push_back(sequence);
+  }
+
+  batch.insert(batch.end(), frame, frame + length);
+  lastAdd = now;
+}
+
+void RtcmBatcher::process(uint32_t now) {
+  if (!batch.empty() && now - lastAdd >= BURST_GAP) {
+    flush();
+    sequence++;
+  }
+}
+
+void RtcmBatcher::flush() {
+  if (!batch.empty()) {
+    batchCallback(batch.data(), batch.size());
+    batch.clear();
+  }
+}
+
+RtcmInjector::RtcmInjector(uint16_t address, SemaphoreHandle_t busLock) : address(address), busLock(busLock) { }
+
+void RtcmInjector::inject(const uint8_t* data, size_t length) {
+  if (length == 0) {
+    return;
+  }
+
+  // the link may deliver a retransmitted batch after newer ones, don't feed the GNSS module with observations from an older epoch.
+  int8_t age = lastSequence - data[0];
+  if (hasFrame && age > 0 && getCorrectionAge() < STALE_TIMEOUT) {
+    statistics.batchesStale++;
+    return;
+  }
+
+  lastSequence = data[0];
+  size_t offset = 1;
+
+  while (offset < length) {
+    auto frameLength = Rtcm::getFrameLength(data + offset, length - offset);
+
+    if (frameLength == 0) {
+      // rest of message can't be trusted.
+      statistics.framesInvalid++;
+      return;
+    }
+
+    statistics.framesReceived++;
+    lastFrameTime = millis();
+    hasFrame = true;
+
+    // only queue whole frames, the GNSS module will throw away a frame that is cut short anyway.
+    if ((size_t)(BUFFER_SIZE - count) < frameLength) {
+      statistics.framesDropped++;
+    } else {
+      for (size_t i = 0; i < frameLength; i++) {
+        buffer[(head + count + i) % BUFFER_SIZE] = data[offset + i];
+      }
+      count += frameLength;
+    }
+
+    offset += frameLength;
+  }
+}
+
+uint32_t RtcmInjector::getCorrectionAge() const {
+  return hasFrame ? millis() - lastFrameTime : UINT32_MAX;
+}
+
+uint32_t RtcmInjector::getThroughput() const {
+  return throughput;
+}
+
+const rtcmStatistics& RtcmInjector::getStatistics() const {
+  return statistics;
+}
+
+void RtcmInjector::process() {
+  auto now = millis();
+
+  if (now - periodStart >= THROUGHPUT_PERIOD) {
+    throughput = periodBytes * 1000 / (now - periodStart);
+    periodBytes = 0;
+    periodStart = now;
+  }
+
+  if (count == 0 || now - lastChunkTime < CHUNK_INTERVAL) {
+    return;
+  }
+
+  // u-blox modules treat a single byte write as setting register address, so never leave just one byte for next time.
+  uint8_t chunk = min(count, (uint16_t)CHUNK_SIZE);
+  if (count - chunk == 1) {
+    chunk--;
+  }
+
+  // a timer might be reading another device, don't wait for it.
+  if (xSemaphoreTake(busLock, 0) != pdTRUE) {
+    return;
+  }
+
+  Wire.beginTransmission(address);
+  for (uint8_t i = 0; i < chunk; i++) {
+    Wire.write(buffer[(head + i) % BUFFER_SIZE]);
+  }
+  auto result = Wire.endTransmission();
+  xSemaphoreGive(busLock);
+
+  lastChunkTime = now;
+
+  if (result != 0) {
+    // try again next time, module might be busy.
+    statistics.writeErrors++;
+    return;
+  }
+
+  // buffer only holds complete frames back to back, so we can follow them by their headers.
+  for (uint8_t i = 0; i < chunk; i++) {
+    if (frameBytesLeft == 0) {
+      uint16_t position = head + i;
+      frameBytesLeft = Rtcm::HEADER_SIZE + (((buffer[(position + 1) % BUFFER_SIZE] & 0x03) << 8) | buffer[(position + 2) % BUFFER_SIZE]) + Rtcm::CRC_SIZE;
+    }
+
+    if (--frameBytesLeft == 0) {
+      statistics.framesInjected++;
+    }
+  }
+
+  head = (head + chunk) % BUFFER_SIZE;
+  count -= chunk;
+  statistics.bytesInjected += chunk;
+  periodBytes += chunk;
+}
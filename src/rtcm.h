@@ -0,0 +1,178 @@
+#ifndef _rtcm_h
+#define _rtcm_h
+
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "processable.h"
+
+/**
+* RTCM 3 correction messages, sent from the GNSS base station in the docking station to the ZED-F9P in the mower (over LoRa) for centimeter precision.
+*
+* Frame: 0xD3, 6 reserved bits + 10 bits payload length, payload (starting with 12 bits message type), 24 bits CRC-24Q over header and payload.
+*/
+namespace Rtcm {
+  static const uint8_t PREAMBLE = 0xD3;
+  static const uint8_t HEADER_SIZE = 3;
+  static const uint8_t CRC_SIZE = 3;
+  static const uint16_t MAX_PAYLOAD_SIZE = 1023;
+  static const uint16_t MAX_FRAME_SIZE = HEADER_SIZE + MAX_PAYLOAD_SIZE + CRC_SIZE;
+
+  uint32_t crc24q(const uint8_t* data, size_t length, uint32_t crc = 0);
+  /**
+  * Returns message type of a complete frame.
+  */
+  uint16_t getMessageType(const uint8_t* frame);
+  /**
+  * Returns length of the frame at start of data, 0 if it's not a complete and valid frame.
+  */
+  size_t getFrameLength(const uint8_t* data, size_t length);
+}
+
+/**
+* Finds RTCM 3 frames in a stream of bytes, e.g. from a serial port. Bytes that are not part of a valid frame (like NMEA or UBX messages) are skipped.
+*/
+class RtcmParser {
+  public:
+    typedef std::function<void(const uint8_t* frame, size_t length, uint16_t messageType)> FrameCallback;
+
+    RtcmParser(const FrameCallback& fn);
+    void parse(const uint8_t* data, size_t length);
+    void parse(uint8_t data);
+    uint32_t getInvalidFrames() const;
+
+  private:
+    FrameCallback frameCallback;
+    std::vector<uint8_t> buffer;
+    size_t expectedLength = 0;
+    uint32_t invalidFrames = 0;
+};
+
+/**
+* Docking station side, decides which frames that are worth sending over our narrow LoRa link.
+* Observation messages are always sent, while static messages (base station position and antenna description) are only sent
+* when they have changed or every STATIC_INTERVAL, since the base station seldom moves.
+*/
+class RtcmFilter {
+  public:
+    /**
+    * @param allowedTypes message types to forward, anything else is dropped (e.g. legacy observations when MSM messages are used).
+    */
+    RtcmFilter(const std::vector<uint16_t>& allowedTypes);
+    bool accept(const uint8_t* frame, size_t length, uint32_t now);
+    uint32_t getDroppedFrames() const;
+    uint32_t getDroppedBytes() const;
+
+  private:
+    static const uint32_t STATIC_INTERVAL = 30000;  // How often (ms) unchanged static messages are resent, so that a mower that just started will get them.
+
+    struct staticMessage {
+      uint16_t type;
+      uint32_t crc;
+      uint32_t lastSent;
+    };
+
+    std::vector<uint16_t> allowedTypes;
+    std::vector<staticMessage> staticMessages;
+    uint32_t droppedFrames = 0;
+    uint32_t droppedBytes = 0;
+
+    static bool isStatic(uint16_t type);
+};
+
+/**
+* Docking station side, packs frames into as few link messages as possible without holding them back.
+* The base station sends all messages of an epoch in one go, so we send a batch when it's full or when the burst is over.
+*
+* Batch: epoch sequence number (uint8, same for all batches of an epoch), then one or more complete frames.
+*/
+class RtcmBatcher {
+  public:
+    typedef std::function<void(const uint8_t* data, size_t length)> BatchCallback;
+
+    /**
+    * @param maxSize max size of a batch (including sequence number), frames are never split.
+    */
+    RtcmBatcher(size_t maxSize, const BatchCallback& fn);
+    void add(const uint8_t* frame, size_t length, uint32_t now);
+    /**
+    * Send anything waiting, if the burst is over.
+    */
+    void process(uint32_t now);
+
+  private:
+    static const uint8_t BURST_GAP = 20;  // No new frame within this time (ms) means that the epoch is complete.
+
+    size_t maxSize;
+    BatchCallback batchCallback;
+    std::vector<uint8_t> batch;
+    uint8_t sequence = 0;
+    uint32_t lastAdd = 0;
+
+    void flush();
+};
+
+struct rtcmStatistics {
+  uint32_t framesReceived = 0;
+  uint32_t framesInvalid = 0;
+  uint32_t framesDropped = 0;     // could not fit in buffer, GNSS module is not keeping up.
+  uint32_t batchesStale = 0;      // arrived after a newer batch (link retransmission), corrections are too old to be useful.
+  uint32_t framesInjected = 0;
+  uint32_t bytesInjected = 0;
+  uint32_t writeErrors = 0;       // failed I2C writes.
+};
+
+/**
+* Mower side, writes correction frames received from docking station to the u-blox module over I2C.
+* Data is written in small chunks (one per process() call), so that we don't hold the I2C bus long enough to starve the other devices on it.
+* A chunk is only written when the bus lock is free, otherwise it waits for next process().
+*/
+class RtcmInjector : public Processable {
+  public:
+    /**
+    * @param busLock mutex shared by everyone using the I2C bus.
+    */
+    RtcmInjector(uint16_t address, SemaphoreHandle_t busLock);
+    /**
+    * Queue corrections for the GNSS module, data should be a batch from RtcmBatcher.
+    */
+    void inject(const uint8_t* data, size_t length);
+    /**
+    * Time (ms) since we last received a valid correction frame, UINT32_MAX if we never have.
+    * The ZED-F9P will drop RTK fix if this gets too high (default max age 30 seconds).
+    */
+    uint32_t getCorrectionAge() const;
+    /**
+    * Corrections written to GNSS module (bytes/second), averaged over last THROUGHPUT_PERIOD.
+    */
+    uint32_t getThroughput() const;
+    const rtcmStatistics& getStatistics() const;
+    /* Internal use only! */
+    void process();
+
+  private:
+    static const uint16_t BUFFER_SIZE = 2048;         // A few epochs worth of corrections.
+    static const uint8_t CHUNK_SIZE = 32;             // Max bytes written in one I2C transaction.
+    static const uint8_t CHUNK_INTERVAL = 2;          // Min time (ms) between I2C transactions.
+    static const uint16_t THROUGHPUT_PERIOD = 10000;  // Period (ms) throughput is calculated over.
+    static const uint16_t STALE_TIMEOUT = 10000;      // Accept any batch sequence number if we have not got anything within this time (ms), docking station might have restarted.
+
+    uint16_t address;
+    SemaphoreHandle_t busLock;
+    uint8_t buffer[BUFFER_SIZE];
+    uint16_t head = 0;
+    uint16_t count = 0;
+    uint16_t frameBytesLeft = 0;  // bytes left to write of the frame at head of buffer.
+    uint32_t lastFrameTime = 0;
+    bool hasFrame = false;
+    uint8_t lastSequence = 0;
+    uint32_t lastChunkTime = 0;
+    uint32_t periodStart = 0;
+    uint32_t periodBytes = 0;
+    uint32_t throughput = 0;
+    rtcmStatistics statistics;
+};
+
+#endif
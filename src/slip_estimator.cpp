@@ -0,0 +1,116 @@
+#include <ArduinoLog.h>
+#include "slip_estimator.h"
+#include "definitions.h"
+
+static const float HALF_TRACK = Definitions::WHEEL_PAIR_DISTANCE / 100.0f / 2;   // meters from center of mower to each wheel.
+static const float GRAVITY = 9.81;        // m/s² per g
+static const float MIN_WHEEL_SPEED = 0.05;  // Below this wheel speed (m/s) slip ratio means nothing, pulses are too few.
+static const float SLIP_THRESHOLD = 0.3;  // Slip ratio above this is more than grass normally gives.
+
+SlipEstimator::SlipEstimator(Wheel& leftWheel, Wheel& rightWheel, IO_Accelerometer& accelerometer) :
+  leftWheel(leftWheel),
+  rightWheel(rightWheel),
+  accelerometer(accelerometer) { }
+
+float SlipEstimator::getSlip(WHEEL wheel) const {
+  return slip[wheel];
+}
+
+float SlipEstimator::getSpeed() const {
+  return speed;
+}
+
+bool SlipEstimator::isSlipping() const {
+  return slippingSince > 0 && millis() - slippingSince >= SLIP_TIME;
+}
+
+void SlipEstimator::process() {
+  auto now = millis();
+
+  if (now - lastUpdate < UPDATE_INTERVAL) {
+    return;
+  }
+
+  float dt = (now - lastUpdate) / 1000.0f;
+  lastUpdate = now;
+
+  if (dt > 1) {
+    // first update, or we have not been called for a while. Start over.
+    lastOdometer[LEFT] = leftWheel.getOdometer();
+    lastOdometer[RIGHT] = rightWheel.getOdometer();
+    slip[LEFT] = slip[RIGHT] = 0;
+    slippingSince = inertialSince = 0;
+    speed = filteredSpeed = 0;
+    startedAt = now;
+
+    return;
+  }
+
+  // odometers only count pulses, so direction comes from what the wheels are told to do.
+  Wheel* wheels[WHEEL_COUNT] = { &leftWheel, &rightWheel };
+  float filter = dt * 1000 < WHEEL_FILTER_TIME ? dt * 1000 / WHEEL_FILTER_TIME : 1;
+  for (uint8_t i = 0; i < WHEEL_COUNT; i++) {
+    auto odometer = wheels[i]->getOdometer();
+    float measured = (odometer - lastOdometer[i]) * Definitions::WHEEL_METER_PER_PULSE / dt * (wheels[i]->getSpeed() < 0 ? -1 : 1);
+    lastOdometer[i] = odometer;
+    wheelSpeed[i] += (measured - wheelSpeed[i]) * filter;
+  }
+
+  if (!accelerometer.isAvailable()) {
+    speed = filteredSpeed = (wheelSpeed[LEFT] + wheelSpeed[RIGHT]) / 2;
+    return;
+  }
+
+  auto& motion = accelerometer.getMotion();
+  // gyro and accelerometer are filtered the same way as wheel speeds, so that they lag just as much.
+  yawRate += (motion.yawRate * DEG_TO_RAD - yawRate) * filter;
+  float turnSpeed = yawRate * HALF_TRACK;   // turning right means left wheel has further to go.
+
+  // forward speed of mower according to each wheel, given how fast the gyro says we turn. A slipping wheel always claims more speed than
+  // we really have, so trust the one claiming the least.
+  float fromLeft = wheelSpeed[LEFT] - turnSpeed;
+  float fromRight = wheelSpeed[RIGHT] + turnSpeed;
+  float fromOdometry = abs(fromLeft) < abs(fromRight) ? fromLeft : fromRight;
+
+  // when both wheels spin, even the one claiming the least is wrong. Pulling towards it would make the spinning look like real speed.
+  if (slip[LEFT] <= SLIP_THRESHOLD || slip[RIGHT] <= SLIP_THRESHOLD) {
+    inertialSince = 0;
+  } else if (inertialSince == 0) {
+    inertialSince = now;
+  }
+  bool useOdometry = inertialSince == 0 || now - inertialSince >= MAX_INERTIAL_TIME;
+
+  // complementary filter, accelerometer for quick changes and odometry in the long run. Accelerometer bias (e.g. from slope) is learned
+  // from the difference, but not while both wheels spin since odometry is wrong then. Waiting for any slip to end is not enough, an estimate
+  // that is far off makes the wheels look like they skid and would never learn its way back.
+  float error = fromOdometry - speed;
+  speed += ((motion.forwardAcceleration - accelerationBias) * GRAVITY + (useOdometry ? error * 2000 / CORRECTION_TIME : 0)) * dt;
+  if (inertialSince == 0) {
+    accelerationBias -= error / GRAVITY * 1000000 / CORRECTION_TIME / CORRECTION_TIME * dt;
+  }
+  filteredSpeed += (speed - filteredSpeed) * filter;
+
+  // accelerometer bias has to be learned before we can say anything about slip.
+  if (now - startedAt < SETTLE_TIME) {
+    return;
+  }
+
+  float expected[WHEEL_COUNT] = { filteredSpeed + turnSpeed, filteredSpeed - turnSpeed };
+  bool slipping = false;
+  for (uint8_t i = 0; i < WHEEL_COUNT; i++) {
+    if (abs(wheelSpeed[i]) < MIN_WHEEL_SPEED) {
+      slip[i] = 0;
+      continue;
+    }
+
+    slip[i] = constrain((wheelSpeed[i] - expected[i]) / wheelSpeed[i], -1, 1);
+    slipping |= abs(slip[i]) > SLIP_THRESHOLD;
+  }
+
+  if (!slipping) {
+    slippingSince = 0;
+  } else if (slippingSince == 0) {
+    slippingSince = now;
+    Log.trace(F("Wheels slipping, left %F right %F." CR), slip[LEFT], slip[RIGHT]);
+  }
+}
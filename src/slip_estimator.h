@@ -0,0 +1,67 @@
+#ifndef _slip_estimator_h
+#define _slip_estimator_h
+
+#include <Arduino.h>
+#include "wheel.h"
+#include "io_accelerometer/io_accelerometer.h"
+#include "processable.h"
+
+/**
+* Finds out how much the wheels slip on wet or sloped grass, by checking odometry against the gyro/accelerometer.
+*
+* Forward speed of mower is estimated by integrating the accelerometer, and pulled towards the speed the odometers agree on. Together with the
+* yaw rate from the gyro this gives how fast each wheel should be turning, and slip is how much faster (or slower) it really turns.
+* The accelerometer drifts, so the estimate is pulled back to odometry within a second or so and its bias is learned while a wheel grips.
+* While both wheels spin odometry is wrong, then the estimate runs on the accelerometer alone for up to MAX_INERTIAL_TIME, long enough for
+* WheelMonitor to see wheels that spin without taking us anywhere. One wheel slipping more than the other is seen for as long as it lasts.
+*/
+class SlipEstimator : public Processable {
+  public:
+    enum WHEEL {
+      LEFT,
+      RIGHT,
+      WHEEL_COUNT
+    };
+
+    SlipEstimator(Wheel& leftWheel, Wheel& rightWheel, IO_Accelerometer& accelerometer);
+    /**
+    * Slip ratio of a wheel, 0 when wheel rolls as it should. Positive when wheel turns faster than mower moves (spinning), negative when it turns
+    * slower (skidding). 1 is a wheel spinning on the spot.
+    */
+    float getSlip(WHEEL wheel) const;
+    /**
+    * Forward speed (m/s) of mower as measured by accelerometer and odometry.
+    */
+    float getSpeed() const;
+    /**
+    * A wheel has slipped more than what's normal on grass for a while.
+    */
+    bool isSlipping() const;
+    /* Internal use only! */
+    void process();
+
+  private:
+    static const uint8_t UPDATE_INTERVAL = 100;     // How often (ms) slip is calculated.
+    static const uint16_t WHEEL_FILTER_TIME = 200;  // Time constant (ms) of wheel speed filter, odometers only give a few pulses per update.
+    static const uint16_t CORRECTION_TIME = 1000;   // Time constant (ms) for pulling speed estimate back to odometry, and learning accelerometer bias.
+    static const uint16_t SLIP_TIME = 500;          // Slip must stay above threshold this long (ms) to count as slipping.
+    static const uint16_t SETTLE_TIME = 5000;       // Time (ms) to learn accelerometer bias after starting over.
+    static const uint16_t MAX_INERTIAL_TIME = 2000; // Max time (ms) to go on accelerometer alone while both wheels spin, it drifts.
+
+    Wheel& leftWheel;
+    Wheel& rightWheel;
+    IO_Accelerometer& accelerometer;
+    uint32_t lastUpdate = 0;
+    uint32_t lastOdometer[WHEEL_COUNT] = {0};
+    float wheelSpeed[WHEEL_COUNT] = {0};  // m/s, filtered.
+    float slip[WHEEL_COUNT] = {0};
+    float speed = 0;                      // m/s, forward speed of mower.
+    float filteredSpeed = 0;              // m/s, same as speed but lagging like wheel speeds.
+    float yawRate = 0;                    // rad/s, filtered.
+    float accelerationBias = 0;           // g
+    uint32_t slippingSince = 0;           // 0 if not slipping.
+    uint32_t inertialSince = 0;           // 0 if odometry is trusted.
+    uint32_t startedAt = 0;
+};
+
+#endif
@@ -0,0 +1,135 @@
+#include "soc_estimator.h"
+
+SocEstimator::SocEstimator(float capacity, float emptyVoltage, float fullVoltage, const float* curve) :
+  capacity(capacity),
+  emptyVoltage(emptyVoltage),
+  fullVoltage(fullVoltage),
+  curve(curve),
+  resistance(INITIAL_RESISTANCE / 1000.0f) { }
+
+void SocEstimator::reset(float voltage) {
+  soc = voltageToSoc(voltage);
+  openCircuitVoltage = voltage;
+  averageCurrent = 0;
+  hasUpdate = false;
+}
+
+void SocEstimator::update(uint32_t now, float voltage, float current) {
+  if (!hasUpdate) {
+    lastUpdate = now;
+    lastVoltage = voltage;
+    lastCurrent = current;
+    hasUpdate = true;
+    return;
+  }
+
+  float dt = (now - lastUpdate) / 1000.0f;
+
+  if (dt <= 0) {
+    return;
+  }
+
+  // a load step tells us how much the voltage sags per ampere.
+  float step = current - lastCurrent;
+  if (dt <= MAX_UPDATE_GAP && abs(step) >= MIN_CURRENT_STEP) {
+    float measured = (lastVoltage - voltage) / step * 1000;
+
+    if (measured > 0 && measured < MAX_RESISTANCE / 1000.0f) {
+      resistance += (measured - resistance) * 0.1f;
+    }
+  }
+
+  // count charge, using average of current since last update.
+  float averageSinceLast = (current + lastCurrent) / 2;
+  soc -= averageSinceLast * dt / 3600 / capacity;
+
+  if (averageSinceLast > 0) {
+    energyUsed += (voltage + lastVoltage) / 2 * averageSinceLast / 1000 * dt / 3600;
+  }
+
+  // correct drift with load compensated voltage, it's trusted less when there is a lot of load since resistance is an estimate.
+  openCircuitVoltage = voltage + current / 1000 * resistance;
+  float timeConstant = abs(current) < REST_CURRENT ? VOLTAGE_TIME_CONSTANT : VOLTAGE_TIME_CONSTANT * 4;
+  float gain = dt < timeConstant ? dt / timeConstant : 1;
+  soc += (voltageToSoc(openCircuitVoltage) - soc) * gain;
+
+  if (soc < 0) {
+    soc = 0;
+  } else if (soc > 1) {
+    soc = 1;
+  }
+
+  float averageGain = dt < AVERAGE_TIME ? dt / AVERAGE_TIME : 1;
+  averageCurrent += (current - averageCurrent) * averageGain;
+
+  if (current >= REST_CURRENT) {
+    float workGain = dt < WORK_AVERAGE_TIME ? dt / WORK_AVERAGE_TIME : 1;
+    workCurrent = workCurrent == 0 ? current : workCurrent + (current - workCurrent) * workGain;
+  }
+
+  lastUpdate = now;
+  lastVoltage = voltage;
+  lastCurrent = current;
+}
+
+void SocEstimator::setFull() {
+  soc = 1;
+}
+
+float SocEstimator::getStateOfCharge() const {
+  return soc;
+}
+
+float SocEstimator::getOpenCircuitVoltage() const {
+  return openCircuitVoltage;
+}
+
+float SocEstimator::getInternalResistance() const {
+  return resistance;
+}
+
+float SocEstimator::getAverageCurrent() const {
+  return averageCurrent;
+}
+
+float SocEstimator::getWorkCurrent() const {
+  return workCurrent;
+}
+
+/**
+ * Voltage drops as battery is used, assume we get the average of current voltage and empty voltage for the remaining charge.
+ */
+float SocEstimator::getRemainingEnergy() const {
+  return soc * capacity / 1000 * (openCircuitVoltage + emptyVoltage) / 2;
+}
+
+float SocEstimator::getEnergyUsed() const {
+  return energyUsed;
+}
+
+uint16_t SocEstimator::getRemainingMinutes() const {
+  if (averageCurrent < REST_CURRENT) {
+    return UINT16_MAX;
+  }
+
+  float minutes = soc * capacity / averageCurrent * 60;
+
+  return minutes < UINT16_MAX ? minutes : UINT16_MAX;
+}
+
+float SocEstimator::voltageToSoc(float voltage) const {
+  float level = (voltage - emptyVoltage) / (fullVoltage - emptyVoltage);
+
+  if (level <= curve[0]) {
+    return 0;
+  }
+
+  for (uint8_t i = 1; i < CURVE_POINTS; i++) {
+    if (level < curve[i]) {
+      // interpolate between the two closest points on curve.
+      return (i - 1 + (level - curve[i - 1]) / (curve[i] - curve[i - 1])) / (CURVE_POINTS - 1);
+    }
+  }
+
+  return 1;
+}
@@ -0,0 +1,101 @@
+#ifndef _soc_estimator_h
+#define _soc_estimator_h
+
+#include <Arduino.h>
+#include "hardware_profile.h"
+
+/**
+* Estimates battery state of charge (SoC) by counting the charge going in and out of the battery (coulomb counting).
+* Counting drifts over time, so it's slowly pulled towards what the battery voltage says. Voltage sags under load, so before it's used
+* it's compensated with an estimate of the battery internal resistance: open circuit voltage = voltage + current * resistance.
+* The resistance is learned from how much the voltage changes when the load changes (e.g. cutter starting).
+*
+* Voltage to SoC uses a discharge curve for the battery chemistry (see HardwareProfile), scaled between the empty and full voltage.
+*/
+class SocEstimator {
+  public:
+    /**
+    * @param capacity usable battery capacity (mAh).
+    * @param emptyVoltage open circuit voltage at 0% SoC.
+    * @param fullVoltage open circuit voltage at 100% SoC.
+    * @param curve open circuit voltage at 0%, 10%, ..., 100% SoC, as share of the range between empty and full voltage (CURVE_POINTS values).
+    */
+    SocEstimator(float capacity, float emptyVoltage, float fullVoltage, const float* curve);
+    /**
+    * Start over from a battery voltage, should be measured with little or no load.
+    */
+    void reset(float voltage);
+    /**
+    * Should be called regularly (about once a second) with latest measurements.
+    * @param current battery current in milliampere, positive when discharging and negative when charging.
+    */
+    void update(uint32_t now, float voltage, float current);
+    /**
+    * Charger says battery is full, no need to guess.
+    */
+    void setFull();
+    /**
+    * State of charge, 0-1.
+    */
+    float getStateOfCharge() const;
+    /**
+    * Estimated battery voltage without any load.
+    */
+    float getOpenCircuitVoltage() const;
+    /**
+    * Estimated internal resistance (ohm).
+    */
+    float getInternalResistance() const;
+    /**
+    * Average discharge current the last minute (milliampere).
+    */
+    float getAverageCurrent() const;
+    /**
+    * Average discharge current while working (milliampere), kept when battery is resting or charging. 0 if we have not been working yet.
+    */
+    float getWorkCurrent() const;
+    /**
+    * Energy left until battery is empty (Wh).
+    */
+    float getRemainingEnergy() const;
+    /**
+    * Total energy taken from battery since start (Wh).
+    */
+    float getEnergyUsed() const;
+    /**
+    * Minutes left until battery is empty at the current average discharge, or UINT16_MAX if not discharging.
+    */
+    uint16_t getRemainingMinutes() const;
+    /**
+    * SoC (0-1) of a battery at rest with this voltage.
+    */
+    float voltageToSoc(float voltage) const;
+
+  private:
+    static const uint16_t INITIAL_RESISTANCE = 150;  // Internal resistance (milliohm) used until we have measured it.
+    static const uint16_t MAX_RESISTANCE = 1000;     // Ignore resistance measurements above this (milliohm), that is a measurement error.
+    static const uint16_t MIN_CURRENT_STEP = 500;    // How much current needs to change between two updates (mA) to measure internal resistance.
+    static const uint16_t REST_CURRENT = 300;        // Below this current (mA) the battery is considered resting and voltage is trusted the most.
+    static const uint16_t VOLTAGE_TIME_CONSTANT = 900;  // How fast (seconds) counted charge is pulled towards voltage based SoC when resting, four times slower under load.
+    static const uint8_t AVERAGE_TIME = 60;          // Time (seconds) to average discharge current over.
+    static const uint16_t WORK_AVERAGE_TIME = 600;   // Time (seconds) to average discharge current over when working.
+    static const uint8_t MAX_UPDATE_GAP = 5;         // Updates further apart than this (seconds) are not used to measure internal resistance.
+    static const uint8_t CURVE_POINTS = HardwareProfile::Battery::SOC_CURVE_POINTS;
+
+    float capacity;
+    float emptyVoltage;
+    float fullVoltage;
+    const float* curve;
+    float soc = 0;
+    float resistance;
+    float openCircuitVoltage = 0;
+    float averageCurrent = 0;
+    float workCurrent = 0;
+    float energyUsed = 0;
+    float lastVoltage = 0;
+    float lastCurrent = 0;
+    uint32_t lastUpdate = 0;
+    bool hasUpdate = false;
+};
+
+#endif
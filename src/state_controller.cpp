@@ -39,7 +39,9 @@ void StateController::setState(Definitions::MOWER_STATES newState) {
     Configuration::config.lastState = currentStateInstance->getStateName();
     Configuration::save();
 
-    //resources.wlan.publish_mqtt(currentStateInstance->getStateName(), "/state");
+    for (auto& fn : stateChangedCallbacks) {
+      fn(currentStateInstance);
+    }
   }
 }
 
@@ -94,3 +96,7 @@ bool StateController::setUserChangableState(String newState) {
 AbstractState* StateController::getStateInstance() {
   return currentStateInstance;
 }
+
+void StateController::onStateChanged(const StateChangedCallback& fn) {
+  stateChangedCallbacks.push_back(fn);
+}
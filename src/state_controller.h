@@ -6,10 +6,13 @@
 #include "definitions.h"
 #include "resources.h"
 #include <string>
+#include <functional>
 #include "states/abstract_state.h"
 
 class StateController {
   public:
+    typedef std::function<void(AbstractState* state)> StateChangedCallback;
+
     StateController(Resources& resources);
 
     /**
@@ -32,9 +35,15 @@ class StateController {
     */
     AbstractState* getStateInstance();
 
+    /**
+    * Register callback that will be called every time the mower enters a new state.
+    */
+    void onStateChanged(const StateChangedCallback& fn);
+
   private:
     AbstractState* currentStateInstance;
     Resources& resources;
+    std::vector<StateChangedCallback> stateChangedCallbacks;
     // https://stackoverflow.com/questions/18837857/cant-use-enum-class-as-unordered-map-key
     struct EnumClassHash {
         template <typename T>
@@ -1,5 +1,8 @@
+#include <ArduinoLog.h>
 #include "charging.h"
 #include "state_controller.h"
+#include "configuration.h"
+#include "charge_model.h"
 
 Charging::Charging(Definitions::MOWER_STATES myState, StateController& stateController, Resources& resources) : AbstractState(myState, stateController, resources) {
 
@@ -8,6 +11,8 @@ Charging::Charging(Definitions::MOWER_STATES myState, StateController& stateCont
 void Charging::selected(Definitions::MOWER_STATES lastState) {
   resources.cutter.stop(true);
   resources.wheelController.stop();
+  lastDepartureCheck = millis();
+  Log.notice(F("Fully charged in about %d minutes." CR), resources.battery.getMinutesToFull());
 }
 
 void Charging::process() {
@@ -16,5 +21,34 @@ void Charging::process() {
     stateController.setState(Definitions::MOWER_STATES::DOCKED);
     return;
   }
-  
+
+  // Only check if we should leave early every ten seconds, for performance reasons.
+  if (lastDepartureCheck + 10000 < millis()) {
+    lastDepartureCheck = millis();
+
+    if (shouldDepart()) {
+      Log.notice(F("Leaving at %d%% battery, gives more mowing than waiting for full charge." CR), resources.battery.getBatteryStatus());
+      stateController.setState(Definitions::MOWER_STATES::LAUNCHING);
+    }
+  }
+}
+
+/**
+ * Charging gets slow at the end (CV phase). If there is not much left of the mowing schedule, leaving with a partially charged battery
+ * (and coming back for another partial charge) could give more mowing than waiting for a full charge.
+ */
+bool Charging::shouldDepart() {
+  auto& battery = resources.battery;
+  auto departureLevel = Configuration::config.departureLevel;
+  auto level = battery.getBatteryStatus();
+
+  if (departureLevel >= 100 || level < departureLevel || battery.getMowingTime(100) == 0 || !resources.mowingSchedule.isTimeToMow()) {
+    return false;
+  }
+
+  auto window = resources.mowingSchedule.getRemainingMinutes();
+  auto partial = ChargeModel::getMowingInWindow(window, 0, battery.getMowingTime(level), battery.getChargeTime(0, departureLevel), battery.getMowingTime(departureLevel));
+  auto full = ChargeModel::getMowingInWindow(window, battery.getMinutesToFull(), battery.getMowingTime(100), battery.getChargeTime(0, 100), battery.getMowingTime(100));
+
+  return partial > full;
 }
@@ -15,6 +15,10 @@ class Charging : public AbstractState {
     }
     void selected(Definitions::MOWER_STATES lastState);
     void process();
+
+  private:
+    long lastDepartureCheck = 0;
+    bool shouldDepart();
 };
 
 #endif
@@ -9,6 +9,7 @@ void Docked::selected(Definitions::MOWER_STATES lastState) {
   resources.cutter.stop(true);
   resources.wheelController.stop();
   resources.mowingSchedule.setManualMowingOverride(false);  // if docked then reset mowing override so that it will only launch on schedule.
+  resources.returnPlanner.reset();  // we know exactly where we are.
   lastShouldMowCheck = millis();
 }
 
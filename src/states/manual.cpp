@@ -7,20 +7,16 @@ Manual::Manual(Definitions::MOWER_STATES myState, StateController& stateControll
 
 void Manual::selected(Definitions::MOWER_STATES lastState) {
   dockedDetectedTime = 0;
+  resources.joystick.reset();
 }
 
 void Manual::process() {
-  // if we drive manually and get disconnected from mower or mower loose WiFi connectivity, then stop mower from driving further.
-  /*if (resources.wlan.getConnectedWebsocketClientsCount() == 0) {
-    
-    resources.cutter.stop();
-
-    auto wheelStatus = resources.wheelController.getStatus();
+  resources.joystick.process();
 
-    if (wheelStatus.leftWheelSpeed != 0 || wheelStatus.rightWheelSpeed != 0) {
-      resources.wheelController.stop(true);
-    }
-  }*/
+  // if we drive manually and lose contact with the one driving, then stop mower from driving further. Wheels are already stopped by the joystick channel.
+  if (resources.joystick.hasTimedOut() && resources.cutter.isCutting()) {
+    resources.cutter.stop();
+  }
 
   // if we have parked in dockingstation manually and mower detects it's docked, then enter docked-state after a short timeout.
   if (resources.battery.isDocked() && dockedDetectedTime == 0) {
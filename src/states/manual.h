@@ -6,6 +6,7 @@
 
 /**
 * State the mower enters when it has been set to manual driving mode from REST-API. User then has to change state again to resume automation.
+* Mower is driven with setpoints streamed over the joystick channel (see joystick_channel.h).
 */
 class Manual : public AbstractState {
   public:
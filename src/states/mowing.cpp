@@ -11,6 +11,7 @@ void Mowing::selected(Definitions::MOWER_STATES lastState) {
   delay(2000);
   resources.wheelController.forward(0, 100, true);
   lastShouldMowCheck = millis();
+  turning = false;
 }
 
 void Mowing::process() {
@@ -20,6 +21,13 @@ void Mowing::process() {
     return;
   }
 
+  // go home while we still have enough energy to get there, the further away we are the earlier we leave.
+  if (resources.returnPlanner.shouldReturn()) {
+    Log.notice(F("Battery is just enough to get back to docking station (%F Wh), docking." CR), resources.returnPlanner.getReturnEnergy());
+    stateController.setState(Definitions::MOWER_STATES::DOCKING);
+    return;
+  }
+
   // Only check time to mow every other second, for performance reasons.
   if (lastShouldMowCheck + 2000 < millis()) {
     if (!resources.mowingSchedule.isTimeToMow()) {
@@ -31,11 +39,57 @@ void Mowing::process() {
   }
 
   if (resources.cutter.isFuseblown()) {
-    stateController.setState(Definitions::MOWER_STATES::STUCK);
+    stuck(StuckRecovery::CAUSE::CUTTER_FAULT);
     Log.warning(F("Non-working cutter has been detected, loose wire or blown fuse?" CR));
     return;
   }
 
+  if (resources.cutter.isJammed()) {
+    stuck(StuckRecovery::CAUSE::CUTTER_JAM);
+    Log.warning(F("Cutter blade got stuck, something in the grass?" CR));
+    return;
+  }
+
+  if (resources.cutter.isBladeMissing()) {
+    auto rpm = resources.cutter.getRpm();
+    stuck(StuckRecovery::CAUSE::BLADE_MISSING);
+    Log.warning(F("Cutter spins too easily (%d rpm), loose or missing blade?" CR), rpm);
+    return;
+  }
+
+  if (resources.wheelMonitor.isStalled()) {
+    // no bumper, but both wheels stalling at once means we have driven into something.
+    auto bump = resources.wheelMonitor.getTraction(WheelMonitor::LEFT) == WheelMonitor::STALLED && resources.wheelMonitor.getTraction(WheelMonitor::RIGHT) == WheelMonitor::STALLED;
+    stuck(bump ? StuckRecovery::CAUSE::BUMP : StuckRecovery::CAUSE::WHEEL_STALL);
+    return;
+  }
+
+  if (resources.wheelMonitor.isSpinning()) {
+    stuck(StuckRecovery::CAUSE::WHEEL_SPIN);
+    return;
+  }
+
+  if (turning) {
+    if (millis() - turnStarted > SLIP_TURN_TIMEOUT) {
+      Log.warning(F("Could not turn away from slipping wheels." CR));
+      stuck(StuckRecovery::CAUSE::SLIP);
+    }
+
+    return;
+  }
+
+  // wheels slipping on wet or sloped grass, head somewhere else before we dig ruts.
+  if (resources.slipEstimator.isSlipping() && millis() - turnStarted > SLIP_TURN_INTERVAL) {
+    Log.notice(F("Wheels slipping, changing heading." CR));
+    turnAway();
+    return;
+  }
+
+  // the faster we go, the faster the blade must spin for a clean cut.
+  auto wheelStats = resources.wheelController.getStatus();
+  auto groundSpeed = (wheelStats.leftWheelSpeed + wheelStats.rightWheelSpeed) / 2;
+  resources.cutter.setGroundSpeed(groundSpeed > 0 ? groundSpeed : 0);
+
   if (resources.cutter.isOverloaded()) {
     if (resources.wheelController.decreaseForwardSpeed()) {
       Log.verbose(F("Cutter overloaded, decreased speed of wheels."));
@@ -46,3 +100,25 @@ void Mowing::process() {
     }
   }
 }
+
+/**
+ * Head off in a new direction.
+ */
+void Mowing::turnAway() {
+  turning = true;
+  turnStarted = millis();
+
+  int16_t direction = random(90, 181) * (random(2) == 0 ? -1 : 1);
+  resources.wheelController.turn(direction, [this](void) -> void {
+    resources.wheelController.forward(0, 100, true);
+    turning = false;
+  });
+}
+
+/**
+ * Let StuckRecovery know why we are stuck, it will try to get us going again.
+ */
+void Mowing::stuck(StuckRecovery::CAUSE cause) {
+  resources.stuckRecovery.setCause(cause);
+  stateController.setState(Definitions::MOWER_STATES::STUCK);
+}
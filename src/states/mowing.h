@@ -18,7 +18,15 @@ class Mowing : public AbstractState {
     void process();
   
   private:
+    static const uint16_t SLIP_TURN_TIMEOUT = 10000;  // Give up on a turn that hasn't finished within this time (ms), wheels are probably stuck for real.
+    static const uint16_t SLIP_TURN_INTERVAL = 10000; // Drive at least this long (ms) after a turn before turning away from slipping wheels again.
+
     long lastShouldMowCheck = 0;
+    bool turning = false;
+    uint32_t turnStarted = 0;
+
+    void turnAway();
+    void stuck(StuckRecovery::CAUSE cause);
 };
 
 #endif
@@ -6,15 +6,17 @@ Stuck::Stuck(Definitions::MOWER_STATES myState, StateController& stateController
 }
 
 void Stuck::selected(Definitions::MOWER_STATES lastState) {
-    previousState = lastState;
+    // after a restart we don't know what we were doing before getting stuck, mowing will take us home if it's not time to mow.
+    previousState = lastState == Definitions::MOWER_STATES::STUCK ? Definitions::MOWER_STATES::MOWING : lastState;
     resources.cutter.stop(true);
     resources.wheelController.stop(false);
-    retryTimer = millis();
+    resources.stuckRecovery.begin();
 }
 
 void Stuck::process() {
 
-    if (Definitions::STUCK_RETRY_DELAY > 0 && (millis() - retryTimer > Definitions::STUCK_RETRY_DELAY * 1000)) {
+    // if recovery escalates we stay here, waiting for someone to help us.
+    if (resources.stuckRecovery.getResult() == StuckRecovery::RESULT::RECOVERED) {
         stateController.setState(previousState);
     }
     
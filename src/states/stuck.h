@@ -6,7 +6,8 @@
 
 /**
 * State the mower enters when it is stuck somewhere and failes to operate properly.
-* It may be stuck in a hole in the lawn, or under a obstacle, or there may be some other hardware issues, in either way it require some kind of human intervention.
+* It may be stuck in a hole in the lawn, or under a obstacle, or there may be some other hardware issues. We first try to get free by ourselves
+* (see StuckRecovery), if that doesn't work it require some kind of human intervention.
 * This is a state that should not occur under normal conditions.
 */
 class Stuck : public AbstractState {
@@ -20,7 +21,6 @@ class Stuck : public AbstractState {
 
   private:
     Definitions::MOWER_STATES previousState;
-    unsigned long retryTimer = 0; // when did we last try if we are still stuck?
 };
 
 #endif
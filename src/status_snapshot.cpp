@@ -0,0 +1,160 @@
+#include <ArduinoJson.h>
+#include "status_snapshot.h"
+
+StatusSnapshot::StatusSnapshot() :
+  // version starts over at each boot, so make sure a client doesn't mistake an old entity tag for a new one.
+  bootId(esp_random()) {
+
+  protobuf.reserve(PROTOBUF_SIZE);
+}
+
+void StatusSnapshot::onCollect(const Collector& fn) {
+  collector = fn;
+}
+
+uint32_t StatusSnapshot::getVersion() const {
+  return version;
+}
+
+const MowerStatus& StatusSnapshot::getStatus() const {
+  return status;
+}
+
+const char* StatusSnapshot::getStateName() const {
+  return stateName;
+}
+
+String StatusSnapshot::getETag() const {
+  return "\"" + String(bootId, HEX) + "-" + String(version) + "\"";
+}
+
+bool StatusSnapshot::isNotModified(const String& ifNoneMatch) const {
+  return ifNoneMatch.length() > 0 && ifNoneMatch.indexOf(getETag()) >= 0;
+}
+
+String StatusSnapshot::getJson() {
+  if (hasJson) {
+    return withUptime(json);
+  }
+
+  DynamicJsonBuffer jsonBuffer(600);
+  JsonObject& root = jsonBuffer.createObject();
+
+  root["state"] = stateName;
+  root["batteryVoltage"] = status.batteryVoltage;
+  root["batteryLevel"] = status.batteryLevel;
+  root["batteryChargeCurrent"] = status.batteryChargeCurrent;
+  root["isCharging"] = status.isCharging;
+  root["lastFullyChargeTime"] = status.lastFullyChargeTime;
+  root["lastChargeDuration"] = status.lastChargeDuration;
+  root["batteryRemainingTime"] = status.batteryRemainingTime;
+  root["cutterLoad"] = status.cutterLoad;
+  root["cutterRotating"] = status.cutterRotating;
+  root["leftWheelSpd"] = status.leftWheelSpd;
+  root["rightWheelSpd"] = status.rightWheelSpd;
+  root["pitch"] = status.pitch;
+  root["roll"] = status.roll;
+  root["heading"] = status.heading;
+  root["obstacleFrontDistance"] = status.obstacleFrontDistance;
+  root["areaPerWh"] = status.areaPerWh;
+  root["whPerMowingHour"] = status.whPerMowingHour;
+
+  json = "";
+  root.printTo(json);
+  hasJson = true;
+  encodeCount++;
+
+  return withUptime(json);
+}
+
+/**
+ * Add uptime as last member of JSON object.
+ */
+String StatusSnapshot::withUptime(const String& body) const {
+  String result = body.substring(0, body.length() - 1);
+  result += ",\"uptime\":";
+  result += status.uptime;
+  result += '}';
+
+  return result;
+}
+
+size_t StatusSnapshot::writeProtobuf(uint8_t* buffer, size_t size) {
+  if (!hasProtobuf) {
+    protobuf.resize(PROTOBUF_SIZE);
+    auto length = encoder.encode(status, protobuf.data(), protobuf.size(), millis(), true, 1UL << StatusEncoder::UPTIME);
+    protobuf.resize(length);
+    hasProtobuf = true;
+    encodeCount++;
+  }
+
+  if (protobuf.size() > size) {
+    return 0;
+  }
+
+  // fields may come in any order, so uptime is simply appended.
+  memcpy(buffer, protobuf.data(), protobuf.size());
+  auto length = StatusEncoder::encodeField(StatusEncoder::UPTIME, status, buffer + protobuf.size(), size - protobuf.size());
+
+  return length > 0 ? protobuf.size() + length : 0;
+}
+
+uint32_t StatusSnapshot::getEncodeCount() const {
+  return encodeCount;
+}
+
+/**
+ * Round values to what the sensors resolve (10 mV, 10 mA) and what we report, otherwise noise or every tick of mowing would be a new version.
+ */
+void StatusSnapshot::roundToResolution(MowerStatus& status) {
+  status.batteryVoltage = roundf(status.batteryVoltage * 100) / 100;
+  // adding 0 turns -0 into 0, which would be reported as "-0".
+  status.batteryChargeCurrent = roundf(status.batteryChargeCurrent / 10) * 10 + 0.0f;
+  status.areaPerWh = roundf(status.areaPerWh * 100) / 100;
+  status.whPerMowingHour = roundf(status.whPerMowingHour * 10) / 10;
+}
+
+bool StatusSnapshot::isEqual(const MowerStatus& a, const MowerStatus& b) {
+  return a.state == b.state &&
+         a.batteryVoltage == b.batteryVoltage &&
+         a.batteryLevel == b.batteryLevel &&
+         a.batteryChargeCurrent == b.batteryChargeCurrent &&
+         a.isCharging == b.isCharging &&
+         a.lastFullyChargeTime == b.lastFullyChargeTime &&
+         a.lastChargeDuration == b.lastChargeDuration &&
+         a.batteryRemainingTime == b.batteryRemainingTime &&
+         a.cutterLoad == b.cutterLoad &&
+         a.cutterRotating == b.cutterRotating &&
+         a.leftWheelSpd == b.leftWheelSpd &&
+         a.rightWheelSpd == b.rightWheelSpd &&
+         a.pitch == b.pitch &&
+         a.roll == b.roll &&
+         a.heading == b.heading &&
+         a.obstacleFrontDistance == b.obstacleFrontDistance &&
+         a.areaPerWh == b.areaPerWh &&
+         a.whPerMowingHour == b.whPerMowingHour;
+}
+
+void StatusSnapshot::process() {
+  if (!collector || millis() - lastUpdate < UPDATE_INTERVAL) {
+    return;
+  }
+
+  lastUpdate = millis();
+
+  MowerStatus newStatus;
+  collector(newStatus, stateName);
+  roundToResolution(newStatus);
+
+  if (version > 0 && isEqual(status, newStatus)) {
+    // not part of the version, added to encodings when they are written.
+    status.uptime = newStatus.uptime;
+    return;
+  }
+
+  status = newStatus;
+  version++;
+  // encodings belong to the old version, rebuild them when someone asks for them.
+  hasJson = false;
+  hasProtobuf = false;
+}
@@ -0,0 +1,85 @@
+#ifndef _status_snapshot_h
+#define _status_snapshot_h
+
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+#include "processable.h"
+#include "dockingstation/status_encoder.h"
+
+/**
+* Status of the mower, collected from all subsystems once per tick and shared by everyone reporting it (REST, WebSocket, MQTT and LoRa).
+* Every time the status changes it gets a new version. Encodings (JSON and protobuf) are built on first request and then reused until next version,
+* so no matter how many clients are polling, the mower does the same amount of work per tick.
+* Uptime changes every second and is not part of the version (it would make every second a new version), it's kept current in getStatus()
+* and added when an encoding is written.
+* Battery voltage and charge current are rounded to what the sensors resolve before comparing, so noise does not make a new version.
+* What is collected and from where is up to the Collector, see main.cpp.
+*/
+class StatusSnapshot : public Processable {
+  public:
+    /**
+    * Collect status from all subsystems.
+    * @param stateName set to name of current state.
+    */
+    typedef std::function<void(MowerStatus& status, const char*& stateName)> Collector;
+
+    StatusSnapshot();
+    /**
+    * Register what collects the status, nothing is collected until then.
+    */
+    void onCollect(const Collector& fn);
+    /**
+    * Increased by one every time status changes, uptime does not count.
+    */
+    uint32_t getVersion() const;
+    const MowerStatus& getStatus() const;
+    const char* getStateName() const;
+    /**
+    * Entity tag of current version, for HTTP ETag/If-None-Match. Unique across restarts.
+    * Clients getting "304 Not Modified" should count uptime from their last full response.
+    */
+    String getETag() const;
+    /**
+    * Returns true if the If-None-Match header from a client matches current version, and a "304 Not Modified" could be sent instead.
+    */
+    bool isNotModified(const String& ifNoneMatch) const;
+    /**
+    * Current status as JSON, field names as in the REST API (/api/v1/status).
+    */
+    String getJson();
+    /**
+    * Write current status as a Status keyframe (see dockingstation/status.proto).
+    * @return length of keyframe, 0 if buffer was too small.
+    */
+    size_t writeProtobuf(uint8_t* buffer, size_t size);
+    /**
+    * Number of times an encoding has been built, compare with the number of requests to see how much is saved.
+    */
+    uint32_t getEncodeCount() const;
+    /* Internal use only! */
+    void process();
+
+  private:
+    static const uint8_t UPDATE_INTERVAL = 100;   // How often (ms) status is collected from subsystems.
+    static const uint8_t PROTOBUF_SIZE = 128;     // Max size of a Status keyframe.
+
+    Collector collector;
+    MowerStatus status;
+    const char* stateName = "";
+    uint32_t version = 0;
+    uint32_t bootId;
+    uint32_t lastUpdate = 0;
+    String json;
+    bool hasJson = false;
+    std::vector<uint8_t> protobuf;
+    bool hasProtobuf = false;
+    StatusEncoder encoder;
+    uint32_t encodeCount = 0;
+
+    String withUptime(const String& body) const;
+    static void roundToResolution(MowerStatus& status);
+    static bool isEqual(const MowerStatus& a, const MowerStatus& b);
+};
+
+#endif
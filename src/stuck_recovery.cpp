@@ -0,0 +1,421 @@
+#include <ArduinoLog.h>
+#include "stuck_recovery.h"
+#include "configuration.h"
+
+static const float PRIOR_STRENGTH = 2;  // How many attempts in a cell it takes before they count as much as what we know from all cells.
+static const float RANK_WEIGHT = 0.02;  // Score bonus per rank, so manoeuvres are tried in listed order until we have learned better.
+
+// Must be in the same order as StuckRecovery::CAUSE.
+static const char* const CAUSE_NAMES[StuckRecovery::CAUSE_COUNT] = {
+  "unknown", "bump", "wheelStall", "wheelSpin", "slip", "cutterJam", "cutterFault", "bladeMissing"
+};
+
+// Must be in the same order as StuckRecovery::MANOEUVRE.
+static const char* const MANOEUVRE_NAMES[StuckRecovery::MANOEUVRE_COUNT] = {
+  "reverseTurn", "rocking", "wiggle", "reverseTrack", "wait"
+};
+
+const StuckRecovery::step StuckRecovery::MANOEUVRES[MANOEUVRE_COUNT][MAX_STEPS] = {
+  // REVERSE_TURN
+  { {BACKWARD, 30}, {TURN_RANDOM, 0}, {END, 0} },
+  // ROCKING
+  { {PUSH_BACKWARD, 400}, {PUSH_FORWARD, 400}, {PUSH_BACKWARD, 400}, {PUSH_FORWARD, 400}, {BACKWARD, 30}, {TURN_RANDOM, 0}, {END, 0} },
+  // WIGGLE
+  { {TURN, -20}, {TURN, 40}, {TURN, -20}, {BACKWARD, 20}, {TURN_RANDOM, 0}, {END, 0} },
+  // REVERSE_TRACK, we mostly drive straight so backing straight is going back along the track we came.
+  { {BACKWARD, 60}, {TURN_RANDOM, 0}, {END, 0} },
+  // WAIT
+  { {PAUSE, 0}, {END, 0} }
+};
+
+// Manoeuvres worth trying for each cause, best first. Must be in the same order as StuckRecovery::CAUSE, -1 ends a list.
+const int8_t StuckRecovery::CAUSE_MANOEUVRES[CAUSE_COUNT][MANOEUVRE_COUNT] = {
+  { REVERSE_TURN, WIGGLE, ROCKING, REVERSE_TRACK, -1 },  // UNKNOWN
+  { REVERSE_TURN, REVERSE_TRACK, WIGGLE, -1 },           // BUMP
+  { ROCKING, REVERSE_TURN, WIGGLE, REVERSE_TRACK, -1 },  // WHEEL_STALL
+  { ROCKING, WIGGLE, REVERSE_TRACK, -1 },                // WHEEL_SPIN
+  { WIGGLE, REVERSE_TRACK, ROCKING, -1 },                // SLIP
+  { REVERSE_TURN, REVERSE_TRACK, -1 },                   // CUTTER_JAM, back away from whatever got into the blade.
+  { WAIT, -1 },                                          // CUTTER_FAULT, a tripped motor driver may come back after cooling down.
+  { -1 }                                                 // BLADE_MISSING
+};
+
+StuckRecovery::StuckRecovery(WheelController& wheelController, WheelMonitor& wheelMonitor, PoseEstimator& poseEstimator) :
+  wheelController(wheelController),
+  wheelMonitor(wheelMonitor),
+  poseEstimator(poseEstimator) { }
+
+void StuckRecovery::start() {
+  Configuration::preferences.begin("liam-esp", false);
+
+  recoveryStats stored;
+  if (Configuration::preferences.getBytesLength("recovery") == sizeof(stored) &&
+      Configuration::preferences.getBytes("recovery", &stored, sizeof(stored)) == sizeof(stored) &&
+      stored.version == STATS_VERSION) {
+    stats = stored;
+  }
+
+  Log.notice(F("Stuck %d times, recovered %d times, escalated %d times" CR), stats.events, stats.recovered, stats.escalations);
+}
+
+void StuckRecovery::setCause(CAUSE cause) {
+  this->cause = cause;
+}
+
+StuckRecovery::CAUSE StuckRecovery::getCause() const {
+  return cause;
+}
+
+void StuckRecovery::begin() {
+  auto now = millis();
+  active = true;
+  stuckSince = now;
+  manoeuvre = -1;
+  wheelController.stop(false);
+
+  if (result == RECOVERED && now - recoveredAt < RESTUCK_TIME) {
+    // same event as last time, go on with the manoeuvres we have not tried yet.
+    Log.notice(F("Stuck again right after recovering, %s did not work." CR), MANOEUVRE_NAMES[lastManoeuvre]);
+    unlearnSuccess(lastCause, lastManoeuvre);
+    if (stats.recovered > 0) {
+      stats.recovered--;
+    }
+  } else {
+    tried = 0;
+    cellIndex = findCell();
+    stats.events++;
+    stats.causes[cause]++;
+  }
+
+  lastCause = cause;
+  result = RECOVERING;
+  Log.notice(F("Stuck (%s), trying to recover." CR), CAUSE_NAMES[cause]);
+
+  auto next = selectManoeuvre();
+  if (next < 0) {
+    result = ESCALATED;
+    stats.escalations++;
+    save();
+    Log.warning(F("No way to recover from this by ourselves, waiting for help." CR));
+  } else {
+    startManoeuvre(next);
+  }
+}
+
+StuckRecovery::RESULT StuckRecovery::getResult() const {
+  return result;
+}
+
+void StuckRecovery::setState(Definitions::MOWER_STATES state) {
+  if (!active || state == Definitions::MOWER_STATES::STUCK) {
+    return;
+  }
+
+  active = false;
+  stats.timeLost += (millis() - stuckSince) / 1000.0f;
+  cause = UNKNOWN;
+
+  // left STUCK some other way (e.g. user stopped us), whatever we were doing doesn't count.
+  if (result == RECOVERING) {
+    wheelController.stop(false);
+    manoeuvre = -1;
+    result = IDLE;
+  }
+
+  save();
+}
+
+void StuckRecovery::printJson(Print& output) const {
+  output.print(F("{\"events\":"));
+  output.print(stats.events);
+  output.print(F(",\"recovered\":"));
+  output.print(stats.recovered);
+  output.print(F(",\"escalations\":"));
+  output.print(stats.escalations);
+  output.print(F(",\"timeLost\":"));
+  output.print(stats.timeLost, 0);
+  output.print(F(",\"timeLostPerEvent\":"));
+  output.print(stats.events > 0 ? stats.timeLost / stats.events : 0, 1);
+  output.print(F(",\"causes\":{"));
+
+  for (uint8_t cause = 0; cause < CAUSE_COUNT; cause++) {
+    if (cause > 0) {
+      output.print(',');
+    }
+
+    output.print('"');
+    output.print(CAUSE_NAMES[cause]);
+    output.print(F("\":{\"events\":"));
+    output.print(stats.causes[cause]);
+
+    for (uint8_t manoeuvre = 0; manoeuvre < MANOEUVRE_COUNT; manoeuvre++) {
+      output.print(F(",\""));
+      output.print(MANOEUVRE_NAMES[manoeuvre]);
+      output.print(F("\":{\"attempts\":"));
+      output.print(stats.attempts[cause][manoeuvre]);
+      output.print(F(",\"successes\":"));
+      output.print(stats.successes[cause][manoeuvre]);
+      output.print('}');
+    }
+
+    output.print('}');
+  }
+
+  output.print(F("}}"));
+}
+
+void StuckRecovery::reset() {
+  stats.events = 0;
+  stats.recovered = 0;
+  stats.escalations = 0;
+  stats.timeLost = 0;
+  for (auto& count : stats.causes) {
+    count = 0;
+  }
+
+  save();
+  Log.notice(F("Stuck counters cleared." CR));
+}
+
+void StuckRecovery::process() {
+  if (result != RECOVERING || manoeuvre < 0) {
+    return;
+  }
+
+  auto& current = MANOEUVRES[manoeuvre][stepIndex];
+  auto elapsed = millis() - stepStarted;
+  bool done = false;
+
+  switch (current.action) {
+    case PAUSE:
+      done = elapsed >= Definitions::STUCK_RETRY_DELAY * 1000UL;
+      break;
+    case PUSH_FORWARD:
+    case PUSH_BACKWARD:
+      // not getting anywhere is what we expect, so don't bother about stalled wheels.
+      done = elapsed >= (uint32_t)current.value;
+      break;
+    default:
+      if (stepDone) {
+        done = true;
+      } else if (elapsed > STEP_TIMEOUT) {
+        Log.notice(F("Recovery step timed out." CR));
+        finishManoeuvre(false);
+        return;
+      } else if (elapsed > STEP_SETTLE_TIME && (wheelMonitor.isStalled() || wheelMonitor.isSpinning())) {
+        finishManoeuvre(false);
+        return;
+      }
+      break;
+  }
+
+  if (!done) {
+    return;
+  }
+
+  stepIndex++;
+  if (MANOEUVRES[manoeuvre][stepIndex].action == END) {
+    finishManoeuvre(true);
+  } else {
+    startStep();
+  }
+}
+
+/**
+ * Best manoeuvre for the cause that we have not tried yet, -1 if there are none left.
+ */
+int8_t StuckRecovery::selectManoeuvre() const {
+  int8_t best = -1;
+  float bestScore = 0;
+
+  for (uint8_t rank = 0; rank < MANOEUVRE_COUNT; rank++) {
+    auto candidate = CAUSE_MANOEUVRES[cause][rank];
+    if (candidate < 0) {
+      break;
+    }
+
+    if (tried & (1 << candidate)) {
+      continue;
+    }
+
+    // retries switched off.
+    if (candidate == WAIT && Definitions::STUCK_RETRY_DELAY == 0) {
+      continue;
+    }
+
+    auto score = getScore(candidate, rank);
+    if (best < 0 || score > bestScore) {
+      best = candidate;
+      bestScore = score;
+    }
+  }
+
+  return best;
+}
+
+/**
+ * Expected success rate of a manoeuvre here. What we know about the manoeuvre in all locations is the starting point, and results in this cell
+ * take over as they add up.
+ */
+float StuckRecovery::getScore(uint8_t manoeuvre, uint8_t rank) const {
+  float globalRate = (stats.successes[cause][manoeuvre] + 1.0f) / (stats.attempts[cause][manoeuvre] + 2.0f);
+  auto& here = stats.cells[cellIndex];
+  float cellRate = (here.successes[manoeuvre] + PRIOR_STRENGTH * globalRate) / (here.attempts[manoeuvre] + PRIOR_STRENGTH);
+
+  return cellRate + RANK_WEIGHT * (MANOEUVRE_COUNT - rank);
+}
+
+void StuckRecovery::startManoeuvre(uint8_t manoeuvre) {
+  Log.notice(F("Trying to recover with %s." CR), MANOEUVRE_NAMES[manoeuvre]);
+
+  tried |= 1 << manoeuvre;
+  this->manoeuvre = manoeuvre;
+  stepIndex = 0;
+  startStep();
+}
+
+void StuckRecovery::startStep() {
+  auto& current = MANOEUVRES[manoeuvre][stepIndex];
+  auto done = [this](void) -> void {
+    stepDone = true;
+  };
+
+  stepDone = false;
+  stepStarted = millis();
+
+  switch (current.action) {
+    case FORWARD:
+      wheelController.forward(0, SPEED, false, current.value, done);
+      break;
+    case BACKWARD:
+      wheelController.backward(0, SPEED, false, current.value, done);
+      break;
+    case TURN:
+      wheelController.turn(current.value, done);
+      break;
+    case TURN_RANDOM:
+      wheelController.turn(random(90, 181) * (random(2) == 0 ? -1 : 1), done);
+      break;
+    case PUSH_FORWARD:
+      wheelController.drive(100, 100);
+      break;
+    case PUSH_BACKWARD:
+      wheelController.drive(-100, -100);
+      break;
+    default:
+      wheelController.stop(false);
+      break;
+  }
+}
+
+void StuckRecovery::finishManoeuvre(bool success) {
+  wheelController.stop(false);
+  learn(manoeuvre, success);
+
+  if (success) {
+    Log.notice(F("Recovered with %s." CR), MANOEUVRE_NAMES[manoeuvre]);
+    result = RECOVERED;
+    recoveredAt = millis();
+    lastManoeuvre = manoeuvre;
+    manoeuvre = -1;
+    stats.recovered++;
+    save();
+
+    return;
+  }
+
+  Log.notice(F("Could not recover with %s." CR), MANOEUVRE_NAMES[manoeuvre]);
+  manoeuvre = -1;
+
+  auto next = selectManoeuvre();
+  if (next < 0) {
+    result = ESCALATED;
+    stats.escalations++;
+    save();
+    Log.warning(F("Tried everything, still stuck. Waiting for help." CR));
+  } else {
+    startManoeuvre(next);
+  }
+}
+
+void StuckRecovery::learn(uint8_t manoeuvre, bool success) {
+  auto& here = stats.cells[cellIndex];
+
+  if (here.attempts[manoeuvre] >= MAX_CELL_ATTEMPTS) {
+    for (uint8_t i = 0; i < MANOEUVRE_COUNT; i++) {
+      here.attempts[i] /= 2;
+      here.successes[i] /= 2;
+    }
+  }
+
+  here.attempts[manoeuvre]++;
+  if (stats.attempts[cause][manoeuvre] < UINT16_MAX) {
+    stats.attempts[cause][manoeuvre]++;
+  }
+
+  if (success) {
+    here.successes[manoeuvre]++;
+    if (stats.successes[cause][manoeuvre] < UINT16_MAX) {
+      stats.successes[cause][manoeuvre]++;
+    }
+  }
+}
+
+void StuckRecovery::unlearnSuccess(CAUSE cause, uint8_t manoeuvre) {
+  auto& here = stats.cells[cellIndex];
+
+  if (here.successes[manoeuvre] > 0) {
+    here.successes[manoeuvre]--;
+  }
+
+  if (stats.successes[cause][manoeuvre] > 0) {
+    stats.successes[cause][manoeuvre]--;
+  }
+}
+
+/**
+ * Cell of the lawn we are in, the least recently used cell is taken over if we have not been stuck here before.
+ */
+uint8_t StuckRecovery::findCell() {
+  auto& position = poseEstimator.getPose().position;
+  int8_t x = constrain(floorf(position.x() / CELL_SIZE), INT8_MIN, INT8_MAX);
+  int8_t y = constrain(floorf(position.y() / CELL_SIZE), INT8_MIN, INT8_MAX);
+  uint8_t found = 0;
+
+  for (uint8_t i = 0; i < CELL_COUNT; i++) {
+    auto& candidate = stats.cells[i];
+
+    if (candidate.lastUsed > 0 && candidate.x == x && candidate.y == y) {
+      found = i;
+      break;
+    }
+
+    if (candidate.lastUsed < stats.cells[found].lastUsed) {
+      found = i;
+    }
+  }
+
+  auto& here = stats.cells[found];
+  if (here.lastUsed == 0 || here.x != x || here.y != y) {
+    here = cell();
+    here.x = x;
+    here.y = y;
+  }
+
+  stats.useCounter++;
+  if (stats.useCounter == 0) {
+    // wrapped around, start over so that least recently used still makes sense.
+    for (auto& c : stats.cells) {
+      c.lastUsed = c.lastUsed > 0 ? 1 : 0;
+    }
+    stats.useCounter = 2;
+  }
+  here.lastUsed = stats.useCounter;
+
+  return found;
+}
+
+void StuckRecovery::save() {
+  Configuration::preferences.begin("liam-esp", false);
+  Configuration::preferences.putBytes("recovery", &stats, sizeof(stats));
+}
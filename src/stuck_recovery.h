@@ -0,0 +1,164 @@
+#ifndef _stuck_recovery_h
+#define _stuck_recovery_h
+
+#include <Arduino.h>
+#include "definitions.h"
+#include "wheel_controller.h"
+#include "wheel_monitor.h"
+#include "pose_estimator.h"
+#include "processable.h"
+
+/**
+* Tries to get the mower going again when it's stuck, instead of waiting and then blindly repeating what got us stuck.
+*
+* There is a small library of recovery manoeuvres (reverse and turn, rocking, wiggle, reverse along the track we came), each cause of
+* getting stuck (bump, stalled or spinning wheel, slip, jammed cutter...) has its own ranked list of manoeuvres worth trying.
+* Manoeuvres are tried one at a time until one gets us free, if none of them does we escalate and wait for a human to help us.
+*
+* How often a manoeuvre works is learned per cause and per location (a grid of cells over the pose estimate), so a manoeuvre that keeps
+* failing in a corner of the lawn gets tried later there next time. Getting stuck again shortly after a recovery means it didn't really work,
+* the recovery is then counted as failed and we go on with the next manoeuvre in the list.
+*/
+class StuckRecovery : public Processable {
+  public:
+    enum CAUSE {
+      UNKNOWN,
+      BUMP,           // driven into something, both wheels stalled.
+      WHEEL_STALL,
+      WHEEL_SPIN,
+      SLIP,
+      CUTTER_JAM,
+      CUTTER_FAULT,   // blown fuse or loose wire.
+      BLADE_MISSING,  // nothing we can do about it ourselves.
+      CAUSE_COUNT
+    };
+
+    enum MANOEUVRE {
+      REVERSE_TURN,   // back up a bit and head off in a new direction.
+      ROCKING,        // short pushes back and forth to get out of a hole, then reverse and turn.
+      WIGGLE,         // turn left and right to free a wheel, then reverse and turn.
+      REVERSE_TRACK,  // back up a longer distance along the track we came, then turn.
+      WAIT,           // stand still for STUCK_RETRY_DELAY, letting an overheated cutter cool down.
+      MANOEUVRE_COUNT
+    };
+
+    enum RESULT {
+      IDLE,
+      RECOVERING,
+      RECOVERED,
+      ESCALATED       // all manoeuvres failed, human intervention needed.
+    };
+
+    StuckRecovery(WheelController& wheelController, WheelMonitor& wheelMonitor, PoseEstimator& poseEstimator);
+    /**
+    * Load learned success rates and counters from flash.
+    */
+    void start();
+    /**
+    * Tell why we are stuck, should be called just before entering STUCK-state.
+    */
+    void setCause(CAUSE cause);
+    CAUSE getCause() const;
+    /**
+    * Start recovering, called by STUCK-state when selected.
+    */
+    void begin();
+    RESULT getResult() const;
+    /**
+    * Should be called when mower changes state.
+    */
+    void setState(Definitions::MOWER_STATES state);
+    /**
+    * Write counters (events, recoveries, escalations, time lost) and learned success rates as JSON (for /api/v1/recovery).
+    */
+    void printJson(Print& output) const;
+    /**
+    * Clear counters, learned success rates are kept.
+    */
+    void reset();
+    /* Internal use only! */
+    void process();
+
+  private:
+    static const uint16_t STEP_TIMEOUT = 5000;        // A step not done within this time (ms) has failed.
+    static const uint8_t STEP_SETTLE_TIME = 100;      // Don't trust WheelMonitor this long (ms) after a step started, it may not have seen the new speed yet.
+    static const uint8_t SPEED = 50;                  // Speed (%) used when backing up or driving forward.
+    static const uint16_t RESTUCK_TIME = 15000;       // Stuck again within this time (ms) after a recovery means it didn't work.
+    static const uint8_t CELL_SIZE = 3;               // Size (meters) of each location cell success rates are learned for.
+    static const uint8_t CELL_COUNT = 32;             // Number of cells remembered, least recently used cell is forgotten first.
+    static const uint8_t MAX_CELL_ATTEMPTS = 200;     // Halve a cell's counts when attempts reach this, so old results fade away.
+    static const uint8_t STATS_VERSION = 1;           // Increase when recoveryStats changes, old stats are then thrown away.
+
+    enum ACTION {
+      END,
+      FORWARD,        // value = distance (cm).
+      BACKWARD,       // value = distance (cm).
+      TURN,           // value = degrees, negative is left.
+      TURN_RANDOM,    // turn 90-180 degrees in a random direction.
+      PUSH_FORWARD,   // full speed for value ms, not reaching anywhere is expected.
+      PUSH_BACKWARD,  // full speed for value ms.
+      PAUSE           // stand still for STUCK_RETRY_DELAY.
+    };
+
+    struct step {
+      ACTION action;
+      int16_t value;
+    };
+
+    struct cell {
+      int8_t x = 0;
+      int8_t y = 0;
+      uint16_t lastUsed = 0;    // 0 if cell is unused.
+      uint8_t attempts[MANOEUVRE_COUNT] = {0};
+      uint8_t successes[MANOEUVRE_COUNT] = {0};
+    };
+
+    struct recoveryStats {
+      uint8_t version = STATS_VERSION;
+      uint16_t useCounter = 0;
+      // per cause, over all locations.
+      uint16_t attempts[CAUSE_COUNT][MANOEUVRE_COUNT] = {{0}};
+      uint16_t successes[CAUSE_COUNT][MANOEUVRE_COUNT] = {{0}};
+      cell cells[CELL_COUNT];
+      // counters, cleared by reset().
+      uint32_t events = 0;
+      uint32_t recovered = 0;
+      uint32_t escalations = 0;
+      uint32_t causes[CAUSE_COUNT] = {0};
+      float timeLost = 0;       // seconds spent in STUCK-state.
+    };
+
+    static const uint8_t MAX_STEPS = 8;
+    static const step MANOEUVRES[MANOEUVRE_COUNT][MAX_STEPS];
+    static const int8_t CAUSE_MANOEUVRES[CAUSE_COUNT][MANOEUVRE_COUNT];
+
+    WheelController& wheelController;
+    WheelMonitor& wheelMonitor;
+    PoseEstimator& poseEstimator;
+    recoveryStats stats;
+    CAUSE cause = UNKNOWN;
+    RESULT result = IDLE;
+    bool active = false;        // in STUCK-state.
+    uint32_t stuckSince = 0;
+    uint8_t tried = 0;          // bitmask of manoeuvres tried this event.
+    uint8_t cellIndex = 0;
+    int8_t manoeuvre = -1;      // manoeuvre running, -1 if none.
+    uint8_t stepIndex = 0;
+    uint32_t stepStarted = 0;
+    bool stepDone = false;
+    uint32_t recoveredAt = 0;
+    uint8_t lastManoeuvre = 0;  // manoeuvre that got us free last time.
+    CAUSE lastCause = UNKNOWN;
+
+    int8_t selectManoeuvre() const;
+    float getScore(uint8_t manoeuvre, uint8_t rank) const;
+    void startManoeuvre(uint8_t manoeuvre);
+    void startStep();
+    void finishManoeuvre(bool success);
+    void learn(uint8_t manoeuvre, bool success);
+    void unlearnSuccess(CAUSE cause, uint8_t manoeuvre);
+    uint8_t findCell();
+    void save();
+};
+
+#endif
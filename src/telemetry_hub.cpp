@@ -0,0 +1,252 @@
+#include <ArduinoLog.h>
+#include <ArduinoJson.h>
+#include "telemetry_hub.h"
+
+static const char* const TOPIC_NAMES[] = { "status", "pose", "map_tiles", "log" };
+
+TelemetryHub::TelemetryHub() {
+  clients.reserve(MAX_CLIENTS);
+}
+
+void TelemetryHub::setSerializer(TELEMETRY_TOPIC topic, const TopicSerializer& fn) {
+  if (topic < TELEMETRY_TOPIC::COUNT) {
+    serializers[static_cast<uint8_t>(topic)] = fn;
+  }
+}
+
+void TelemetryHub::setDeltaSerializer(TELEMETRY_TOPIC topic, const DeltaSerializer& fn, const CursorSource& start) {
+  if (topic < TELEMETRY_TOPIC::COUNT) {
+    deltaSerializers[static_cast<uint8_t>(topic)] = fn;
+    cursorSources[static_cast<uint8_t>(topic)] = start;
+  }
+}
+
+void TelemetryHub::onSend(const SendCallback& fn) {
+  sendCallback = fn;
+}
+
+bool TelemetryHub::addClient(uint32_t clientId) {
+  if (findClient(clientId) != nullptr) {
+    return true;
+  }
+
+  if (clients.size() >= MAX_CLIENTS) {
+    Log.notice(F("Too many telemetry clients, ignoring client %l" CR), clientId);
+    return false;
+  }
+
+  client newClient;
+  newClient.id = clientId;
+  for (uint8_t i = 0; i < TOPIC_COUNT; i++) {
+    newClient.interval[i] = 0;
+    newClient.lastSent[i] = 0;
+    newClient.cursor[i] = 0;
+  }
+  clients.push_back(newClient);
+
+  return true;
+}
+
+void TelemetryHub::removeClient(uint32_t clientId) {
+  for (auto it = clients.begin(); it != clients.end(); ++it) {
+    if (it->id == clientId) {
+      clients.erase(it);
+      return;
+    }
+  }
+}
+
+bool TelemetryHub::subscribe(uint32_t clientId, TELEMETRY_TOPIC topic, uint16_t interval) {
+  auto c = findClient(clientId);
+
+  if (c == nullptr || topic >= TELEMETRY_TOPIC::COUNT) {
+    return false;
+  }
+
+  auto index = static_cast<uint8_t>(topic);
+  if (!serializers[index] && !deltaSerializers[index]) {
+    return false;
+  }
+
+  // a cursor of 0 would be more than half the id range behind once the log has passed 32767 lines, and nothing would look new.
+  if (deltaSerializers[index] && c->interval[index] == 0 && interval > 0) {
+    c->cursor[index] = cursorSources[index]();
+  }
+
+  c->interval[index] = interval;
+  if (interval > 0 && interval < MIN_INTERVAL) {
+    c->interval[index] = MIN_INTERVAL;
+  }
+  // send first frame on next tick, client should not have to wait a whole interval.
+  c->lastSent[index] = millis() - c->interval[index];
+
+  return true;
+}
+
+bool TelemetryHub::handleMessage(uint32_t clientId, const char* message) {
+  DynamicJsonBuffer jsonBuffer(200);
+  JsonObject& root = jsonBuffer.parseObject(message);
+
+  if (!root.success() || root["type"].as<String>() != "subscribe" || !root.containsKey("payload")) {
+    return false;
+  }
+
+  JsonObject& payload = root["payload"].as<JsonObject>();
+  TELEMETRY_TOPIC topic;
+
+  if (!payload.success() || !parseTopic(payload["topic"].as<String>().c_str(), topic)) {
+    return false;
+  }
+
+  return subscribe(clientId, topic, payload["interval"].as<uint16_t>());
+}
+
+uint32_t TelemetryHub::getFramesSerialized() const {
+  return framesSerialized;
+}
+
+uint32_t TelemetryHub::getFramesSent() const {
+  return framesSent;
+}
+
+uint32_t TelemetryHub::getFramesDropped() const {
+  return framesDropped;
+}
+
+uint32_t TelemetryHub::getBytesSent() const {
+  return bytesSent;
+}
+
+bool TelemetryHub::parseTopic(const char* name, TELEMETRY_TOPIC& topic) {
+  for (uint8_t i = 0; i < TOPIC_COUNT; i++) {
+    if (strcmp(name, TOPIC_NAMES[i]) == 0) {
+      topic = static_cast<TELEMETRY_TOPIC>(i);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+size_t TelemetryHub::encodePose(uint8_t* buffer, size_t size, uint32_t time, uint16_t heading, int16_t pitch, int16_t roll, int16_t leftWheelSpeed, int16_t rightWheelSpeed) {
+  if (size < 14) {
+    return 0;
+  }
+
+  buffer[0] = time;
+  buffer[1] = time >> 8;
+  buffer[2] = time >> 16;
+  buffer[3] = time >> 24;
+  buffer[4] = heading;
+  buffer[5] = heading >> 8;
+  buffer[6] = pitch;
+  buffer[7] = pitch >> 8;
+  buffer[8] = roll;
+  buffer[9] = roll >> 8;
+  buffer[10] = leftWheelSpeed;
+  buffer[11] = leftWheelSpeed >> 8;
+  buffer[12] = rightWheelSpeed;
+  buffer[13] = rightWheelSpeed >> 8;
+
+  return 14;
+}
+
+TelemetryHub::client* TelemetryHub::findClient(uint32_t clientId) {
+  for (auto& c : clients) {
+    if (c.id == clientId) {
+      return &c;
+    }
+  }
+
+  return nullptr;
+}
+
+/**
+ * Add frame header in front of payload in buffer.
+ */
+size_t TelemetryHub::writeFrame(uint8_t topic, size_t length) {
+  buffer[0] = topic;
+  buffer[1] = sequence[topic];
+  buffer[2] = sequence[topic] >> 8;
+  sequence[topic]++;
+  framesSerialized++;
+
+  return length + FRAME_HEADER_SIZE;
+}
+
+bool TelemetryHub::send(client& c, size_t length) {
+  if (!sendCallback(c.id, buffer, length)) {
+    framesDropped++;
+    return false;
+  }
+
+  framesSent++;
+  bytesSent += length;
+
+  return true;
+}
+
+void TelemetryHub::process() {
+  auto now = millis();
+
+  if (clients.empty() || !sendCallback || now - lastTick < TICK_INTERVAL) {
+    return;
+  }
+
+  lastTick = now;
+
+  for (uint8_t topic = 0; topic < TOPIC_COUNT; topic++) {
+    size_t length = 0;
+    bool serialized = false;
+    // delta topics: cursor the frame in buffer was serialized from, and where it leaves the client.
+    uint16_t frameCursor = 0;
+    uint16_t nextCursor = 0;
+
+    for (auto& c : clients) {
+      if (c.interval[topic] == 0 || now - c.lastSent[topic] < c.interval[topic]) {
+        continue;
+      }
+
+      if (deltaSerializers[topic]) {
+        // clients in step get the same frame, others get one of their own.
+        if (!serialized || c.cursor[topic] != frameCursor) {
+          serialized = true;
+          frameCursor = nextCursor = c.cursor[topic];
+          length = deltaSerializers[topic](buffer + FRAME_HEADER_SIZE, sizeof(buffer) - FRAME_HEADER_SIZE, nextCursor);
+          if (length > 0) {
+            length = writeFrame(topic, length);
+          }
+        }
+
+        if (length == 0) {
+          continue;
+        }
+
+        c.lastSent[topic] = now;
+
+        // cursor stays put if frame was dropped, so client gets the same lines again next time instead of losing them.
+        if (send(c, length)) {
+          c.cursor[topic] = nextCursor;
+        }
+
+        continue;
+      }
+
+      // serialize lazily, only when the first client due for an update is found. All other clients get the same frame.
+      if (!serialized) {
+        serialized = true;
+        length = serializers[topic](buffer + FRAME_HEADER_SIZE, sizeof(buffer) - FRAME_HEADER_SIZE);
+
+        if (length == 0) {
+          break;
+        }
+
+        length = writeFrame(topic, length);
+      }
+
+      // keep the client's own pace, even if the frame could not be delivered. A slow client should not be flooded with retries.
+      c.lastSent[topic] = now;
+      send(c, length);
+    }
+  }
+}
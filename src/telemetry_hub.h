@@ -0,0 +1,164 @@
+#ifndef _telemetry_hub_h
+#define _telemetry_hub_h
+
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+#include "processable.h"
+
+/**
+* Topics a client can subscribe to, always the first byte of a telemetry frame.
+*/
+enum class TELEMETRY_TOPIC : uint8_t {
+  STATUS = 0,     // full status frame (Status message, see dockingstation/status.proto).
+  POSE = 1,       // orientation and wheel speeds, for the map and joystick views (see TelemetryHub::encodePose()).
+  MAP_TILES = 2,  // map tiles, reserved until the mower keeps a map.
+  LOG = 3,        // new log lines (see TelemetryHub::encodeLog()).
+  COUNT
+};
+
+/**
+* Binary telemetry stream to web clients (over WebSocket).
+* Each client subscribes to the topics it's interested in, at the rate it wants. On each tick a frame is serialized at most once per topic,
+* and the same frame is then sent to every client that is due for an update, so the work done by the mower does not grow with the number of clients.
+* Delta topics (like LOG) only send what is new to each client, every client has its own cursor that only moves on when a frame was delivered.
+* Clients that are in step share a frame, a client that is behind gets one of its own.
+*
+* Frame: topic (uint8), sequence number (uint16, increased by one for each frame of that topic), then topic specific payload. All little endian.
+*
+* Clients subscribe by sending a JSON text message: {"type":"subscribe","payload":{"topic":"pose","interval":100}}, interval 0 unsubscribes.
+* The hub doesn't know anything about the transport used, frames are handed over to the SendCallback.
+*/
+class TelemetryHub : public Processable {
+  public:
+    /**
+    * Serialize payload of a topic into buffer.
+    * @return length of payload, 0 if there is nothing to send (or it did not fit).
+    */
+    typedef std::function<size_t(uint8_t* buffer, size_t size)> TopicSerializer;
+    /**
+    * Serialize what is new since cursor into buffer, for delta topics.
+    * @param cursor position of client (e.g. id of last log line sent), should be moved to what was included.
+    * @return length of payload, 0 if there is nothing new.
+    */
+    typedef std::function<size_t(uint8_t* buffer, size_t size, uint16_t& cursor)> DeltaSerializer;
+    /**
+    * Cursor a client starts from when it subscribes to a delta topic, e.g. id of the line just before the oldest log line kept.
+    */
+    typedef std::function<uint16_t(void)> CursorSource;
+    /**
+    * Send frame to client.
+    * @return false if frame could not be sent (e.g. client's send queue is full), it will then be counted as dropped.
+    */
+    typedef std::function<bool(uint32_t clientId, const uint8_t* data, size_t length)> SendCallback;
+
+    static const uint16_t MIN_INTERVAL = 50;   // Fastest update rate (ms) a client may subscribe to.
+    static const uint16_t BUFFER_SIZE = 512;   // Max size of a frame.
+
+    TelemetryHub();
+    /**
+    * Register serializer for a topic, topics without a serializer can't be subscribed to.
+    */
+    void setSerializer(TELEMETRY_TOPIC topic, const TopicSerializer& fn);
+    /**
+    * Register serializer for a delta topic, each client gets what is new to it.
+    * @param start where a newly subscribed client's cursor starts.
+    */
+    void setDeltaSerializer(TELEMETRY_TOPIC topic, const DeltaSerializer& fn, const CursorSource& start);
+    void onSend(const SendCallback& fn);
+    /**
+    * Should be called when a client has connected, it will not receive anything until it subscribes to a topic.
+    */
+    bool addClient(uint32_t clientId);
+    void removeClient(uint32_t clientId);
+    /**
+    * Subscribe client to topic.
+    * @param interval how often (ms) client wants updates, 0 to unsubscribe. Limited to MIN_INTERVAL.
+    * @return false if client or topic is unknown.
+    */
+    bool subscribe(uint32_t clientId, TELEMETRY_TOPIC topic, uint16_t interval);
+    /**
+    * Handle text message from client (JSON, see class description).
+    * @return true if message was a valid subscription request.
+    */
+    bool handleMessage(uint32_t clientId, const char* message);
+    uint32_t getFramesSerialized() const;
+    uint32_t getFramesSent() const;
+    uint32_t getFramesDropped() const;
+    uint32_t getBytesSent() const;
+
+    static bool parseTopic(const char* name, TELEMETRY_TOPIC& topic);
+    /**
+    * Pose payload: time (uint32, ms since boot), heading (uint16, degrees), pitch (int16, degrees), roll (int16, degrees),
+    * left and right wheel speed (int16, percent).
+    */
+    static size_t encodePose(uint8_t* buffer, size_t size, uint32_t time, uint16_t heading, int16_t pitch, int16_t roll, int16_t leftWheelSpeed, int16_t rightWheelSpeed);
+    /**
+    * Log payload: one or more lines, each line is its id (uint16) followed by length (uint8) and the text (not null terminated).
+    * Only lines with an id after lastId are included, as many as fits. Clients can detect missed lines by gaps in the ids.
+    * @param lastId id of last line already sent, updated to the id of the last line included.
+    */
+    template<typename T>
+    static size_t encodeLog(uint8_t* buffer, size_t size, const T& lines, uint16_t& lastId);
+
+    /* Internal use only! */
+    void process();
+
+  private:
+    static const uint8_t MAX_CLIENTS = 8;
+    static const uint8_t TICK_INTERVAL = 20;    // How often (ms) we check which clients are due for an update.
+    static const uint8_t FRAME_HEADER_SIZE = 3;
+    static const uint8_t TOPIC_COUNT = static_cast<uint8_t>(TELEMETRY_TOPIC::COUNT);
+
+    struct client {
+      uint32_t id;
+      uint16_t interval[TOPIC_COUNT];   // 0 = not subscribed.
+      uint32_t lastSent[TOPIC_COUNT];
+      uint16_t cursor[TOPIC_COUNT];     // delta topics only.
+    };
+
+    TopicSerializer serializers[TOPIC_COUNT];
+    DeltaSerializer deltaSerializers[TOPIC_COUNT];
+    CursorSource cursorSources[TOPIC_COUNT];
+    SendCallback sendCallback;
+    std::vector<client> clients;
+    uint16_t sequence[TOPIC_COUNT] = {0};
+    uint8_t buffer[BUFFER_SIZE];
+    uint32_t lastTick = 0;
+    uint32_t framesSerialized = 0;
+    uint32_t framesSent = 0;
+    uint32_t framesDropped = 0;
+    uint32_t bytesSent = 0;
+
+    client* findClient(uint32_t clientId);
+    bool send(client& c, size_t length);
+    size_t writeFrame(uint8_t topic, size_t length);
+};
+
+template<typename T>
+size_t TelemetryHub::encodeLog(uint8_t* buffer, size_t size, const T& lines, uint16_t& lastId) {
+  size_t length = 0;
+
+  for (const auto& line : lines) {
+    // ids wrap around, so compare the distance instead of the values.
+    if ((int16_t)(line.id - lastId) <= 0) {
+      continue;
+    }
+
+    size_t textLength = line.message.length() > 255 ? 255 : line.message.length();
+    if (length + 3 + textLength > size) {
+      break;
+    }
+
+    buffer[length++] = line.id;
+    buffer[length++] = line.id >> 8;
+    buffer[length++] = textLength;
+    memcpy(buffer + length, line.message.c_str(), textLength);
+    length += textLength;
+    lastId = line.id;
+  }
+
+  return length;
+}
+
+#endif
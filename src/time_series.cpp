@@ -0,0 +1,379 @@
+#include <ArduinoLog.h>
+#include "time_series.h"
+#include "lttb.h"
+
+static const uint8_t NO_WINDOW = 0xFF;
+
+TimeSeries::TimeSeries(FlashRing& ring, uint16_t blockSize, uint8_t fields) :
+  ring(ring),
+  blockSize(blockSize),
+  fields(fields),
+  block(blockSize),
+  previous(fields),
+  leading(fields),
+  trailing(fields) {
+
+  startBlock();
+}
+
+void TimeSeries::begin() {
+  storedSamples = 0;
+
+  for (uint32_t i = 0; i < ring.size(); i++) {
+    storedSamples += readBlockCount(i);
+  }
+}
+
+void TimeSeries::add(uint32_t time, const float* values) {
+  if (count > 0 && bitPosition + getMaxSampleBits() > blockSize * 8) {
+    sealBlock();
+    startBlock();
+  }
+
+  if (count == 0) {
+    // first sample of block is stored as is.
+    writeBits(time, 32);
+
+    for (uint8_t i = 0; i < fields; i++) {
+      previous[i] = floatToBits(values[i]);
+      writeBits(previous[i], 32);
+    }
+
+    lastTime = time;
+    lastDelta = 0;
+    count++;
+
+    return;
+  }
+
+  int32_t delta = time - lastTime;
+  int32_t deltaOfDelta = delta - lastDelta;
+
+  if (deltaOfDelta == 0) {
+    writeBits(0, 1);
+  } else if (deltaOfDelta >= -63 && deltaOfDelta <= 64) {
+    writeBits(0b10, 2);
+    writeBits(deltaOfDelta + 63, 7);
+  } else if (deltaOfDelta >= -255 && deltaOfDelta <= 256) {
+    writeBits(0b110, 3);
+    writeBits(deltaOfDelta + 255, 9);
+  } else if (deltaOfDelta >= -2047 && deltaOfDelta <= 2048) {
+    writeBits(0b1110, 4);
+    writeBits(deltaOfDelta + 2047, 12);
+  } else {
+    writeBits(0b1111, 4);
+    writeBits(deltaOfDelta, 32);
+  }
+
+  lastTime = time;
+  lastDelta = delta;
+
+  for (uint8_t i = 0; i < fields; i++) {
+    auto bits = floatToBits(values[i]);
+    auto xored = bits ^ previous[i];
+    previous[i] = bits;
+
+    if (xored == 0) {
+      writeBits(0, 1);
+      continue;
+    }
+
+    auto leadingZeros = countLeadingZeros(xored);
+    auto trailingZeros = countTrailingZeros(xored);
+
+    if (leading[i] != NO_WINDOW && leadingZeros >= leading[i] && trailingZeros >= trailing[i]) {
+      // changed bits fit inside the same window as last time, no need to store where the window is.
+      writeBits(0b10, 2);
+      writeBits(xored >> trailing[i], 32 - leading[i] - trailing[i]);
+    } else {
+      uint8_t length = 32 - leadingZeros - trailingZeros;
+
+      writeBits(0b11, 2);
+      writeBits(leadingZeros, 5);
+      writeBits(length - 1, 5);
+      writeBits(xored >> trailingZeros, length);
+      leading[i] = leadingZeros;
+      trailing[i] = trailingZeros;
+    }
+  }
+
+  count++;
+}
+
+uint32_t TimeSeries::size() const {
+  return storedSamples + count;
+}
+
+uint32_t TimeSeries::getUsedBytes() const {
+  return ring.size() * blockSize + (bitPosition + 7) / 8;
+}
+
+uint8_t TimeSeries::getFields() const {
+  return fields;
+}
+
+TimeSeries::Reader TimeSeries::getReader() {
+  return Reader(*this);
+}
+
+void TimeSeries::printJson(Print& output, const char* const* names, const uint8_t* decimals, uint16_t points, uint8_t selectField) {
+  std::vector<float> values(fields);
+  // samples could be added while we are printing, make sure all passes see the same samples.
+  auto total = size();
+  Lttb lttb(total, points);
+
+  if (points > 0 && lttb.isDownsampling()) {
+    uint32_t firstTime = 0;
+
+    for (uint8_t pass = 0; pass < 2; pass++) {
+      auto reader = getReader();
+      uint32_t time;
+
+      for (uint32_t index = 0; index < total && reader.next(time, values.data()); index++) {
+        if (index == 0) {
+          firstTime = time;
+        }
+
+        // relative time, epoch seconds don't fit in a float.
+        if (pass == 0) {
+          lttb.addAverage(time - firstTime, values[selectField]);
+        } else {
+          lttb.addCandidate(time - firstTime, values[selectField]);
+        }
+      }
+    }
+  }
+
+  // field -1 is time.
+  for (int8_t field = -1; field < fields; field++) {
+    auto reader = getReader();
+    uint32_t time;
+    bool first = true;
+
+    output.print(field < 0 ? F("{\"time\":[") : F(",\""));
+    if (field >= 0) {
+      output.print(names[field]);
+      output.print(F("\":["));
+    }
+
+    for (uint32_t index = 0; index < total && reader.next(time, values.data()); index++) {
+      if (points > 0 && !lttb.isSelected(index)) {
+        continue;
+      }
+
+      if (!first) {
+        output.print(',');
+      }
+      first = false;
+
+      if (field < 0) {
+        output.print(time);
+      } else {
+        output.print(values[field], decimals[field]);
+      }
+    }
+
+    output.print(']');
+  }
+
+  output.print('}');
+}
+
+void TimeSeries::writeBits(uint32_t value, uint8_t length) {
+  for (int8_t i = length - 1; i >= 0; i--) {
+    auto mask = 0x80 >> (bitPosition % 8);
+
+    if (value & ((uint32_t)1 << i)) {
+      block[bitPosition / 8] |= mask;
+    } else {
+      block[bitPosition / 8] &= ~mask;
+    }
+    bitPosition++;
+  }
+}
+
+void TimeSeries::sealBlock() {
+  block[0] = count;
+  block[1] = count >> 8;
+  block[2] = bitPosition;
+  block[3] = bitPosition >> 8;
+
+  // if ring is full the oldest block is overwritten, so we have to know how many samples we lose.
+  uint16_t oldestCount = ring.size() > 0 ? readBlockCount(0) : 0;
+  auto overwritten = ring.getOverwritten();
+
+  if (!ring.push(block.data())) {
+    Log.warning(F("Could not store time series block, %d samples lost." CR), count);
+    return;
+  }
+
+  if (ring.getOverwritten() != overwritten) {
+    storedSamples -= oldestCount;
+  }
+  storedSamples += count;
+}
+
+void TimeSeries::startBlock() {
+  memset(block.data(), 0, block.size());
+  bitPosition = BLOCK_HEADER_SIZE * 8;
+  count = 0;
+
+  for (uint8_t i = 0; i < fields; i++) {
+    leading[i] = NO_WINDOW;
+    trailing[i] = 0;
+  }
+}
+
+uint16_t TimeSeries::readBlockCount(uint32_t position) {
+  std::vector<uint8_t> buffer(blockSize);
+
+  if (!ring.read(position, buffer.data())) {
+    return 0;
+  }
+
+  return buffer[0] | (buffer[1] << 8);
+}
+
+/**
+ * Worst case size of a sample: largest timestamp encoding, and all values changed with a new window.
+ */
+uint16_t TimeSeries::getMaxSampleBits() const {
+  return 4 + 32 + fields * (2 + 5 + 5 + 32);
+}
+
+uint32_t TimeSeries::floatToBits(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+
+  return bits;
+}
+
+float TimeSeries::bitsToFloat(uint32_t bits) {
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+
+  return value;
+}
+
+uint8_t TimeSeries::countLeadingZeros(uint32_t value) {
+  return value == 0 ? 32 : __builtin_clz(value);
+}
+
+uint8_t TimeSeries::countTrailingZeros(uint32_t value) {
+  return value == 0 ? 32 : __builtin_ctz(value);
+}
+
+TimeSeries::Reader::Reader(TimeSeries& series) :
+  series(series),
+  buffer(series.blockSize),
+  previous(series.fields),
+  leading(series.fields),
+  trailing(series.fields),
+  blockIndex(series.ring.getFirst()) { }
+
+bool TimeSeries::Reader::next(uint32_t& time, float* values) {
+  while (sample >= count) {
+    if (done || !loadNextBlock()) {
+      done = true;
+      return false;
+    }
+  }
+
+  if (sample == 0) {
+    lastTime = readBits(32);
+    lastDelta = 0;
+
+    for (uint8_t i = 0; i < series.fields; i++) {
+      previous[i] = readBits(32);
+      leading[i] = NO_WINDOW;
+      trailing[i] = 0;
+    }
+  } else {
+    int32_t deltaOfDelta;
+
+    if (readBits(1) == 0) {
+      deltaOfDelta = 0;
+    } else if (readBits(1) == 0) {
+      deltaOfDelta = (int32_t)readBits(7) - 63;
+    } else if (readBits(1) == 0) {
+      deltaOfDelta = (int32_t)readBits(9) - 255;
+    } else if (readBits(1) == 0) {
+      deltaOfDelta = (int32_t)readBits(12) - 2047;
+    } else {
+      deltaOfDelta = readBits(32);
+    }
+
+    lastDelta += deltaOfDelta;
+    lastTime += lastDelta;
+
+    for (uint8_t i = 0; i < series.fields; i++) {
+      if (readBits(1) == 0) {
+        continue;
+      }
+
+      if (readBits(1) == 0) {
+        uint8_t length = 32 - leading[i] - trailing[i];
+        previous[i] ^= readBits(length) << trailing[i];
+      } else {
+        leading[i] = readBits(5);
+        uint8_t length = readBits(5) + 1;
+        trailing[i] = 32 - leading[i] - length;
+        previous[i] ^= readBits(length) << trailing[i];
+      }
+    }
+  }
+
+  time = lastTime;
+  for (uint8_t i = 0; i < series.fields; i++) {
+    values[i] = bitsToFloat(previous[i]);
+  }
+  sample++;
+
+  return true;
+}
+
+bool TimeSeries::Reader::loadNextBlock() {
+  if (inCurrentBlock) {
+    return false;
+  }
+
+  auto& ring = series.ring;
+
+  // blocks could have been overwritten since we started reading, then skip to oldest still around.
+  if ((int32_t)(blockIndex - ring.getFirst()) < 0) {
+    blockIndex = ring.getFirst();
+  }
+
+  uint32_t position = blockIndex - ring.getFirst();
+
+  if (position < ring.size()) {
+    blockIndex++;
+    count = ring.read(position, buffer.data()) ? buffer[0] | (buffer[1] << 8) : 0;
+  } else {
+    // copy, so that samples added while we are reading don't mess things up.
+    inCurrentBlock = true;
+    memcpy(buffer.data(), series.block.data(), buffer.size());
+    count = series.count;
+  }
+
+  sample = 0;
+  bitPosition = BLOCK_HEADER_SIZE * 8;
+
+  return true;
+}
+
+uint32_t TimeSeries::Reader::readBits(uint8_t length) {
+  uint32_t value = 0;
+
+  for (uint8_t i = 0; i < length; i++) {
+    // corrupt block, don't read outside of it.
+    if (bitPosition >= buffer.size() * 8) {
+      return 0;
+    }
+
+    value = (value << 1) | ((buffer[bitPosition / 8] >> (7 - bitPosition % 8)) & 1);
+    bitPosition++;
+  }
+
+  return value;
+}
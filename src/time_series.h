@@ -0,0 +1,119 @@
+#ifndef _time_series_h
+#define _time_series_h
+
+#include <Arduino.h>
+#include <vector>
+#include "flash_ring.h"
+
+/**
+* Compressed store of time series samples, each sample is a timestamp and a fixed number of float values (e.g. voltage, current and SoC).
+* Compressed the same way as Facebook's Gorilla database does it, since samples are taken at regular intervals and values change slowly:
+* - timestamps are stored as the difference between consecutive time deltas (delta-of-delta), which is 0 for regular samples and takes a single bit.
+* - values are XOR:ed with the previous value of the same field. Unchanged values take a single bit, values that change a little only store the
+*   bits that differ.
+*
+* Samples are written into fixed size blocks. The block being written is kept in RAM, full blocks are moved to a ring on flash (oldest block is
+* overwritten when ring is full). Every block starts over with uncompressed values, so it can be decoded on its own.
+*
+* Block: sample count (uint16), used bits (uint16), then the compressed bit stream.
+*/
+class TimeSeries {
+  public:
+    /**
+    * Reads samples from oldest to newest, decoding one block at a time.
+    */
+    class Reader {
+      public:
+        /**
+        * Read next sample.
+        * @param values buffer for values, must fit as many values as the series has fields.
+        * @return false if there are no more samples.
+        */
+        bool next(uint32_t& time, float* values);
+
+      private:
+        friend class TimeSeries;
+        Reader(TimeSeries& series);
+
+        TimeSeries& series;
+        std::vector<uint8_t> buffer;
+        std::vector<uint32_t> previous;
+        std::vector<uint8_t> leading;
+        std::vector<uint8_t> trailing;
+        uint32_t blockIndex;        // absolute index in ring, or one past last when reading block in RAM.
+        bool inCurrentBlock = false;
+        bool done = false;
+        uint16_t sample = 0;
+        uint16_t count = 0;
+        uint32_t bitPosition = 0;
+        uint32_t lastTime = 0;
+        int32_t lastDelta = 0;
+
+        bool loadNextBlock();
+        uint32_t readBits(uint8_t length);
+    };
+
+    /**
+    * @param ring ring (on flash) for full blocks.
+    * @param blockSize size of a block (bytes), must be the same as record size of ring.
+    * @param fields number of values per sample.
+    */
+    TimeSeries(FlashRing& ring, uint16_t blockSize, uint8_t fields);
+    /**
+    * Count samples already stored in ring, ring must have been opened.
+    */
+    void begin();
+    /**
+    * @param time seconds, must never decrease.
+    */
+    void add(uint32_t time, const float* values);
+    /**
+    * Number of samples stored.
+    */
+    uint32_t size() const;
+    /**
+    * Bytes used by stored samples, compare with size() * (4 + 4 * fields) for compression ratio.
+    */
+    uint32_t getUsedBytes() const;
+    uint8_t getFields() const;
+    Reader getReader();
+    /**
+    * Write samples as JSON, one array per field: {"time":[...],"<name of field 1>":[...],...}.
+    * Samples are decoded straight into output, one field at a time, so only one block (and the
+    * downsampling state, which depends on number of points) is kept in memory no matter how much history there is.
+    * @param names name of each field.
+    * @param decimals number of decimals to print for each field.
+    * @param points downsample to this many samples (see Lttb), 0 to get all samples.
+    * @param selectField field that decides which samples are kept when downsampling.
+    */
+    void printJson(Print& output, const char* const* names, const uint8_t* decimals, uint16_t points = 0, uint8_t selectField = 0);
+
+  private:
+    static const uint8_t BLOCK_HEADER_SIZE = 4;
+
+    FlashRing& ring;
+    uint16_t blockSize;
+    uint8_t fields;
+    std::vector<uint8_t> block;
+    std::vector<uint32_t> previous;
+    std::vector<uint8_t> leading;
+    std::vector<uint8_t> trailing;
+    uint16_t count = 0;
+    uint32_t bitPosition = 0;
+    uint32_t lastTime = 0;
+    int32_t lastDelta = 0;
+    uint32_t storedSamples = 0;   // samples in ring.
+
+    void writeBits(uint32_t value, uint8_t length);
+    void sealBlock();
+    void startBlock();
+    uint16_t readBlockCount(uint32_t position);
+    uint16_t getMaxSampleBits() const;
+
+    static uint32_t floatToBits(float value);
+    static float bitsToFloat(uint32_t bits);
+    static uint8_t countLeadingZeros(uint32_t value);
+    static uint8_t countTrailingZeros(uint32_t value);
+};
+
+#endif
@@ -22,7 +22,6 @@
 #ifndef IMUMATH_VECTOR_HPP
 #define IMUMATH_VECTOR_HPP
 
-#include <string.h>
 #include <stdint.h>
 #include <math.h>
 
@@ -30,82 +29,83 @@
 namespace imu
 {
 
-template <uint8_t N> class Vector
+/*
+    Everything is float, the ESP32 FPU is single precision and does doubles in software.
+
+    Element-wise operations are expanded at compile time over the element indices (no loops), so they are unrolled no matter what
+    optimization level we build with, and most of them are constexpr.
+*/
+namespace detail
 {
-public:
-    Vector()
-    {
-        memset(p_vec, 0, sizeof(double)*N);
-    }
 
-    Vector(double a)
-    {
-        memset(p_vec, 0, sizeof(double)*N);
-        p_vec[0] = a;
-    }
+template <uint8_t... I> struct Indices {};
 
-    Vector(double a, double b)
-    {
-        memset(p_vec, 0, sizeof(double)*N);
-        p_vec[0] = a;
-        p_vec[1] = b;
-    }
+template <uint8_t N, uint8_t... I> struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
 
-    Vector(double a, double b, double c)
-    {
-        memset(p_vec, 0, sizeof(double)*N);
-        p_vec[0] = a;
-        p_vec[1] = b;
-        p_vec[2] = c;
-    }
+template <uint8_t... I> struct MakeIndices<0, I...>
+{
+    typedef Indices<I...> type;
+};
 
-    Vector(double a, double b, double c, double d)
+// Sum of a[i * strideA] * b[i * strideB] for i in [I, N).
+template <uint8_t I, uint8_t N> struct Dot
+{
+    static constexpr float of(const float* a, uint8_t strideA, const float* b, uint8_t strideB)
     {
-        memset(p_vec, 0, sizeof(double)*N);
-        p_vec[0] = a;
-        p_vec[1] = b;
-        p_vec[2] = c;
-        p_vec[3] = d;
+        return a[I * strideA] * b[I * strideB] + Dot<I + 1, N>::of(a, strideA, b, strideB);
     }
+};
 
-    Vector(const Vector<N> &v)
+template <uint8_t N> struct Dot<N, N>
+{
+    static constexpr float of(const float*, uint8_t, const float*, uint8_t)
     {
-        for (int x = 0; x < N; x++)
-            p_vec[x] = v.p_vec[x];
+        return 0.0f;
     }
+};
 
-    ~Vector()
-    {
-    }
+// Used to select the constructor taking all elements.
+struct Elements {};
 
-    uint8_t n() { return N; }
+} // namespace detail
 
-    double magnitude() const
-    {
-        double res = 0;
-        for (int i = 0; i < N; i++)
-            res += p_vec[i] * p_vec[i];
+template <uint8_t N> class Vector
+{
+    typedef typename detail::MakeIndices<N>::type indices;
+
+public:
+    constexpr Vector() : p_vec{} {}
+
+    constexpr Vector(float a) : p_vec{a} {}
+
+    constexpr Vector(float a, float b) : p_vec{a, b} {}
+
+    constexpr Vector(float a, float b, float c) : p_vec{a, b, c} {}
 
-        return sqrt(res);
+    constexpr Vector(float a, float b, float c, float d) : p_vec{a, b, c, d} {}
+
+    template <typename... T>
+    constexpr Vector(detail::Elements, T... values) : p_vec{static_cast<float>(values)...} {}
+
+    constexpr uint8_t n() const { return N; }
+
+    float magnitude() const
+    {
+        return sqrtf(dot(*this));
     }
 
     void normalize()
     {
-        double mag = magnitude();
-        if (isnan(mag) || mag == 0.0)
+        float mag = magnitude();
+        if (isnan(mag) || mag == 0.0f)
             return;
 
-        for (int i = 0; i < N; i++)
-            p_vec[i] /= mag;
+        *this = scale(1.0f / mag);
     }
 
-    double dot(const Vector& v) const
+    constexpr float dot(const Vector& v) const
     {
-        double ret = 0;
-        for (int i = 0; i < N; i++)
-            ret += p_vec[i] * v.p_vec[i];
-
-        return ret;
+        return detail::Dot<0, N>::of(p_vec, 1, v.p_vec, 1);
     }
 
     // The cross product is only valid for vectors with 3 dimensions,
@@ -115,100 +115,100 @@ public:
     // cross() with another value for N will result in a link error.
     Vector cross(const Vector& v) const;
 
-    Vector scale(double scalar) const
+    constexpr Vector scale(float scalar) const
     {
-        Vector ret;
-        for(int i = 0; i < N; i++)
-            ret.p_vec[i] = p_vec[i] * scalar;
-        return ret;
+        return scale(scalar, indices());
     }
 
-    Vector invert() const
+    constexpr Vector invert() const
     {
-        Vector ret;
-        for(int i = 0; i < N; i++)
-            ret.p_vec[i] = -p_vec[i];
-        return ret;
+        return scale(-1.0f, indices());
     }
 
-    Vector& operator=(const Vector& v)
+    float& operator [](int n) &
     {
-        for (int x = 0; x < N; x++ )
-            p_vec[x] = v.p_vec[x];
-        return *this;
+        return p_vec[n];
     }
 
-    double& operator [](int n)
+    constexpr float operator [](int n) const &
     {
         return p_vec[n];
     }
 
-    double operator [](int n) const
+    float& operator ()(int n) &
     {
         return p_vec[n];
     }
 
-    double& operator ()(int n)
+    constexpr float operator ()(int n) const &
     {
         return p_vec[n];
     }
 
-    double operator ()(int n) const
+    constexpr Vector operator+(const Vector& v) const
     {
-        return p_vec[n];
+        return add(v, 1.0f, indices());
+    }
+
+    constexpr Vector operator-(const Vector& v) const
+    {
+        return add(v, -1.0f, indices());
     }
 
-    Vector operator+(const Vector& v) const
+    Vector& operator+=(const Vector& v)
     {
-        Vector ret;
-        for(int i = 0; i < N; i++)
-            ret.p_vec[i] = p_vec[i] + v.p_vec[i];
-        return ret;
+        return *this = *this + v;
     }
 
-    Vector operator-(const Vector& v) const
+    Vector& operator-=(const Vector& v)
     {
-        Vector ret;
-        for(int i = 0; i < N; i++)
-            ret.p_vec[i] = p_vec[i] - v.p_vec[i];
-        return ret;
+        return *this = *this - v;
     }
 
-    Vector operator * (double scalar) const
+    constexpr Vector operator * (float scalar) const
     {
         return scale(scalar);
     }
 
-    Vector operator / (double scalar) const
+    constexpr Vector operator / (float scalar) const
     {
-        Vector ret;
-        for(int i = 0; i < N; i++)
-            ret.p_vec[i] = p_vec[i] / scalar;
-        return ret;
+        return scale(1.0f / scalar);
     }
 
     void toDegrees()
     {
-        for(int i = 0; i < N; i++)
-            p_vec[i] *= 57.2957795131; //180/pi
+        *this = scale(57.2957795131f); //180/pi
     }
 
     void toRadians()
     {
-        for(int i = 0; i < N; i++)
-            p_vec[i] *= 0.01745329251;  //pi/180
+        *this = scale(0.01745329251f);  //pi/180
     }
 
-    double& x() { return p_vec[0]; }
-    double& y() { return p_vec[1]; }
-    double& z() { return p_vec[2]; }
-    double x() const { return p_vec[0]; }
-    double y() const { return p_vec[1]; }
-    double z() const { return p_vec[2]; }
+    float& x() & { return p_vec[0]; }
+    float& y() & { return p_vec[1]; }
+    float& z() & { return p_vec[2]; }
+    constexpr float x() const & { return p_vec[0]; }
+    constexpr float y() const & { return p_vec[1]; }
+    constexpr float z() const & { return p_vec[2]; }
+
+    constexpr const float* data() const { return p_vec; }
 
 
 private:
-    double p_vec[N];
+    float p_vec[N];
+
+    template <uint8_t... I>
+    constexpr Vector scale(float scalar, detail::Indices<I...>) const
+    {
+        return Vector(detail::Elements(), p_vec[I] * scalar...);
+    }
+
+    template <uint8_t... I>
+    constexpr Vector add(const Vector& v, float sign, detail::Indices<I...>) const
+    {
+        return Vector(detail::Elements(), p_vec[I] + sign * v.p_vec[I]...);
+    }
 };
 
 
@@ -7,7 +7,7 @@ Wheel::Wheel(uint8_t wheel_id, uint8_t motor_pin, uint8_t motor_dir_pin, uint8_t
   pinMode(motor_pin, OUTPUT);
   pinMode(motor_dir_pin, OUTPUT);
   pinMode(odometer_pin, INPUT_PULLUP);
-  ledcSetup(wheel_id, Definitions::MOTOR_BASE_FREQ, Definitions::MOTOR_TIMER_13_BIT);
+  ledcSetup(wheel_id, Definitions::MOTOR_BASE_FREQ, Definitions::MOTOR_PWM_RESOLUTION);
   ledcAttachPin(motor_pin, wheel_id);
   attachInterrupt(digitalPinToInterrupt(odometer_pin), std::bind(&Wheel::updateOdometer, this), RISING);
 
@@ -29,8 +29,8 @@ void Wheel::setSpeed(int8_t speed) {
   } else {
     digitalWrite(motor_dir_pin, wheel_invert ? 0 : 1);
   }
-  // calculate duty, 8191 from 2 ^ 13 - 1
-  uint32_t duty = ((pow(2, Definitions::MOTOR_TIMER_13_BIT) - 1) / 100) * abs(speed);
+  // calculate duty, max duty is 8191 from 2 ^ 13 - 1 (computed at compile time)
+  uint32_t duty = Definitions::MOTOR_MAX_DUTY * abs(speed) / 100;
   // write duty to motor using wheel_id as channel
   ledcWrite(wheel_id, duty);
 }
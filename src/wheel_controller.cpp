@@ -1,8 +1,11 @@
 #include <ArduinoLog.h>
 #include "wheel_controller.h"
+#include "fixed.h"
 
-static const float PULSE_PER_CENTIMETER = Definitions::WHEEL_ODOMETERPULSES_PER_ROTATION / (Definitions::WHEEL_DIAMETER * PI / 10);
-static const float PULSE_PER_DEGREE = (((Definitions::WHEEL_PAIR_DISTANCE * PI) / (Definitions::WHEEL_DIAMETER * PI / 10)) * Definitions::WHEEL_ODOMETERPULSES_PER_ROTATION) / 360;
+// Q21.10, enough for about 14 km worth of odometer pulses. Converting to pulses is then done without any floating point maths.
+typedef Fixed<21, 10> Pulses;
+static constexpr Pulses PULSE_PER_CENTIMETER = Pulses::fromFloat(Definitions::WHEEL_PULSES_PER_CENTIMETER);
+static constexpr Pulses PULSE_PER_DEGREE = Pulses::fromFloat(Definitions::WHEEL_PULSES_PER_DEGREE);
 
 WheelController::WheelController(Wheel& leftWheel, Wheel& rightWheel) :
             leftWheel(leftWheel),
@@ -23,7 +26,7 @@ void WheelController::forward(int8_t turnrate, uint8_t speed, bool smooth, uint3
 
   if (distance > 0) {
     auto currentOdometer = leftWheel.getOdometer(); // we only need to count on one wheel, since they always the same distance (but maybe in the opposite direction)
-    targetOdometer = currentOdometer + distance * PULSE_PER_CENTIMETER;
+    targetOdometer = currentOdometer + (PULSE_PER_CENTIMETER * (int32_t)distance).toInt();
     reachedTargetCallback = fn;
   } else {
     targetOdometer = 0;
@@ -54,7 +57,7 @@ void WheelController::backward(int8_t turnrate, uint8_t speed, bool smooth, uint
   
   if (distance > 0) {
     auto currentOdometer = leftWheel.getOdometer(); // we only need to count on one wheel, since they always the same distance (but maybe in the opposite direction)
-    targetOdometer = currentOdometer + distance * PULSE_PER_CENTIMETER;
+    targetOdometer = currentOdometer + (PULSE_PER_CENTIMETER * (int32_t)distance).toInt();
     reachedTargetCallback = fn;
   } else {
     targetOdometer = 0;
@@ -80,7 +83,7 @@ void WheelController::turn(int16_t direction, const TargetReachedCallback& fn) {
   lastSpeed = leftWheel.getSpeed(); // save current speed so that we can return to this after turn.
 
   auto currentOdometer = leftWheel.getOdometer(); // we only need to count on one wheel, since they always the same distance (but maybe in the opposite direction)
-  targetOdometer = currentOdometer + abs(direction) * PULSE_PER_DEGREE;
+  targetOdometer = currentOdometer + (PULSE_PER_DEGREE * abs(direction)).toInt();
   
   Log.trace(F("WheelController-turn, direction: %i, currentOdometer: %i, targetOdometer: %i" CR), direction, currentOdometer, targetOdometer);
 
@@ -93,6 +96,15 @@ void WheelController::turn(int16_t direction, const TargetReachedCallback& fn) {
   }
 }
 
+void WheelController::drive(int8_t leftSpeed, int8_t rightSpeed) {
+  targetOdometer = 0;
+  reachedTargetCallback = nullptr;
+  lastSpeed = 0;
+
+  leftWheel.setSpeed(constrain(leftSpeed, -100, 100));
+  rightWheel.setSpeed(constrain(rightSpeed, -100, 100));
+}
+
 void WheelController::stop(bool smooth) {
   leftWheel.setSpeed(0);
   rightWheel.setSpeed(0);
@@ -150,8 +162,10 @@ void WheelController::process() {
     rightWheel.setSpeed(lastSpeed);
 
     if (reachedTargetCallback != nullptr) {
-      reachedTargetCallback();
+      // callback may start a new move with a callback of its own (e.g. back up, then turn), so clear ours before calling it.
+      auto callback = reachedTargetCallback;
       reachedTargetCallback = nullptr;
+      callback();
     }
   }
 }
@@ -42,6 +42,13 @@ class WheelController : public Processable {
      * @param fn [optional] callback that will be executed once mower is facing desired direction.
      */ 
     void turn(int16_t direction, const TargetReachedCallback& fn = nullptr);
+    /**
+     * Set speed of each wheel directly, used for manual driving where speed is updated many times per second.
+     * Any distance target or turn in progress is cancelled.
+     * @param leftSpeed speed of left wheel (-100 to 100%), negative to drive backward.
+     * @param rightSpeed speed of right wheel (-100 to 100%), negative to drive backward.
+     */
+    void drive(int8_t leftSpeed, int8_t rightSpeed);
     /**
      * Stop mowers movement.
      * @param smooth smoothly take us to halt.
@@ -0,0 +1,115 @@
+#include <ArduinoLog.h>
+#include "wheel_monitor.h"
+#include "definitions.h"
+
+static const float STALL_CURRENT_RATIO = 0.6;    // Part of stall current (at current speed) that counts as stalled, if wheel doesn't turn.
+static const float SPIN_CURRENT_RATIO = 1.5;     // Below this many times no-load current wheel is turning without resistance.
+static const float SPIN_SLIP = 0.5;              // Slip ratio above this means wheel turns at least twice as fast as mower moves.
+
+WheelMonitor::WheelMonitor(IO_Analog& io_analog, Wheel& leftWheel, Wheel& rightWheel, SlipEstimator& slipEstimator) :
+  io_analog(io_analog),
+  slipEstimator(slipEstimator) {
+
+  wheels[LEFT].wheel = &leftWheel;
+  wheels[LEFT].channel = Definitions::LEFT_WHEEL_MOTOR_LOAD_CHANNEL;
+  wheels[LEFT].name = "Left";
+  wheels[RIGHT].wheel = &rightWheel;
+  wheels[RIGHT].channel = Definitions::RIGHT_WHEEL_MOTOR_LOAD_CHANNEL;
+  wheels[RIGHT].name = "Right";
+}
+
+float WheelMonitor::getCurrent(WHEEL wheel) const {
+  return wheels[wheel].current;
+}
+
+uint8_t WheelMonitor::getLoad(WHEEL wheel) const {
+  auto load = round((wheels[wheel].current - Definitions::WHEEL_MOTOR_NOLOAD_CURRENT) / (Definitions::WHEEL_MOTOR_MAX_CURRENT - Definitions::WHEEL_MOTOR_NOLOAD_CURRENT) * 100);
+
+  return constrain(load, 0, 100);
+}
+
+WheelMonitor::TRACTION WheelMonitor::getTraction(WHEEL wheel) const {
+  return wheels[wheel].traction;
+}
+
+bool WheelMonitor::isStalled() const {
+  return wheels[LEFT].traction == STALLED || wheels[RIGHT].traction == STALLED;
+}
+
+bool WheelMonitor::isSpinning() const {
+  return wheels[LEFT].traction == SPINNING || wheels[RIGHT].traction == SPINNING;
+}
+
+void WheelMonitor::process() {
+  auto now = millis();
+
+  if (now - lastUpdate < SAMPLE_INTERVAL) {
+    return;
+  }
+
+  float dt = now - lastUpdate;
+  lastUpdate = now;
+
+  update(LEFT, now, dt);
+  update(RIGHT, now, dt);
+}
+
+void WheelMonitor::update(WHEEL wheel, uint32_t now, float dt) {
+  auto& state = wheels[wheel];
+  // 1000 for converting ampere to milliampere
+  float current = io_analog.getVoltageAdc1(state.channel) / Definitions::WHEEL_MOTOR_LOAD_RESISTOR * 1000;
+  state.current += (current - state.current) * (dt < FILTER_TIME ? dt / FILTER_TIME : 1);
+
+  auto odometer = state.wheel->getOdometer();
+  if (odometer != state.odometer) {
+    state.odometer = odometer;
+    state.lastPulse = now;
+  }
+
+  auto speed = state.wheel->getSpeed();
+  if (speed != state.speed) {
+    state.speed = speed;
+    state.speedChanged = now;
+    state.lastPulse = now;
+    state.highCurrentSince = 0;
+    state.lowCurrentSince = 0;
+    state.traction = GRIP;
+  }
+
+  if (speed == 0 || now - state.speedChanged < SETTLE_TIME || state.traction != GRIP) {
+    return;
+  }
+
+  // a motor that doesn't turn has no back-EMF, it draws stall current for the voltage it gets.
+  float stallCurrent = Definitions::WHEEL_MOTOR_MAX_CURRENT * abs(speed) / 100;
+  if (state.current > stallCurrent * STALL_CURRENT_RATIO) {
+    if (state.highCurrentSince == 0) {
+      state.highCurrentSince = now;
+    }
+  } else {
+    state.highCurrentSince = 0;
+  }
+
+  if (state.highCurrentSince > 0 && now - state.highCurrentSince >= STALL_TIME && now - state.lastPulse >= STALL_TIME) {
+    state.traction = STALLED;
+    Log.notice(F("%s wheel stalled, %F mA and no odometer pulses." CR), state.name, state.current);
+
+    return;
+  }
+
+  // low current is also a wheel rolling freely downhill, it's only spinning if the mower doesn't keep up with it.
+  // Slip stays 0 without gyro/accelerometer, we can't tell then.
+  float slip = slipEstimator.getSlip(wheel == LEFT ? SlipEstimator::LEFT : SlipEstimator::RIGHT);
+  if (now - state.lastPulse < STALL_TIME && state.current < Definitions::WHEEL_MOTOR_NOLOAD_CURRENT * SPIN_CURRENT_RATIO && slip > SPIN_SLIP) {
+    if (state.lowCurrentSince == 0) {
+      state.lowCurrentSince = now;
+    }
+  } else {
+    state.lowCurrentSince = 0;
+  }
+
+  if (state.lowCurrentSince > 0 && now - state.lowCurrentSince >= SPIN_TIME) {
+    state.traction = SPINNING;
+    Log.notice(F("%s wheel spinning, %F mA and slip %F." CR), state.name, state.current, slip);
+  }
+}
@@ -0,0 +1,84 @@
+#ifndef _wheel_monitor_h
+#define _wheel_monitor_h
+
+#include <Arduino.h>
+#include "wheel.h"
+#include "io_analog.h"
+#include "slip_estimator.h"
+#include "processable.h"
+
+/**
+* Watches current and odometer of each wheel motor, to find out when a wheel doesn't take us anywhere.
+*
+* - Stalled: high current but no odometer pulses, wheel is stuck against something (or mower is high centered on a wheel motor).
+* - Spinning: odometer pulses but hardly any current, and the wheel turns faster than the mower moves (slip from SlipEstimator). Wheel has lost its grip.
+*   Low current alone is not enough, a wheel rolling freely on flat ground or downhill looks the same. Without gyro/accelerometer there is no
+*   telling, so spinning is never reported then.
+*
+* A wheel is checked from shortly after it was given a new speed, until it's given another one.
+*/
+class WheelMonitor : public Processable {
+  public:
+    enum WHEEL {
+      LEFT,
+      RIGHT,
+      WHEEL_COUNT
+    };
+
+    enum TRACTION {
+      GRIP,
+      STALLED,
+      SPINNING
+    };
+
+    WheelMonitor(IO_Analog& io_analog, Wheel& leftWheel, Wheel& rightWheel, SlipEstimator& slipEstimator);
+    /**
+    * Filtered motor current (mA) of a wheel.
+    */
+    float getCurrent(WHEEL wheel) const;
+    /**
+    * Load (0-100%) of a wheel motor, 100% is stall current.
+    */
+    uint8_t getLoad(WHEEL wheel) const;
+    TRACTION getTraction(WHEEL wheel) const;
+    /**
+    * Any wheel stalled.
+    */
+    bool isStalled() const;
+    /**
+    * Any wheel spinning.
+    */
+    bool isSpinning() const;
+    /* Internal use only! */
+    void process();
+
+  private:
+    static const uint8_t SAMPLE_INTERVAL = 50;    // How often (ms) wheel currents are read.
+    static const uint8_t FILTER_TIME = 150;       // Time constant (ms) of current filter.
+    static const uint16_t SETTLE_TIME = 300;      // Don't check a wheel this long (ms) after it got a new speed, motor needs time to get going.
+    static const uint16_t STALL_TIME = 300;       // High current and no odometer pulses this long (ms) means wheel is stalled.
+    static const uint16_t SPIN_TIME = 500;        // Low current and slip this long (ms) means wheel is spinning.
+
+    struct wheelState {
+      Wheel* wheel;
+      uint8_t channel;
+      const char* name;
+      float current = 0;
+      int8_t speed = 0;
+      uint32_t odometer = 0;
+      uint32_t speedChanged = 0;
+      uint32_t lastPulse = 0;
+      uint32_t highCurrentSince = 0;  // 0 if current is not high.
+      uint32_t lowCurrentSince = 0;   // 0 if current is not low, or mower keeps up with wheel.
+      TRACTION traction = GRIP;
+    };
+
+    IO_Analog& io_analog;
+    SlipEstimator& slipEstimator;
+    wheelState wheels[WHEEL_COUNT];
+    uint32_t lastUpdate = 0;
+
+    void update(WHEEL wheel, uint32_t now, float dt);
+};
+
+#endif
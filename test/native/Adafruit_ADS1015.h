@@ -0,0 +1,90 @@
+#ifndef _native_adafruit_ads1015_h
+#define _native_adafruit_ads1015_h
+
+/*
+  Stand-in for the ADS1115 driver. Tests set the voltage on each input with Native::setAdcVoltage(), differential 0-1 reads input 0.
+*/
+#include <map>
+#include "Arduino.h"
+
+typedef enum {
+  GAIN_TWOTHIRDS,
+  GAIN_ONE,
+  GAIN_TWO,
+  GAIN_FOUR,
+  GAIN_EIGHT,
+  GAIN_SIXTEEN
+} adsGain_t;
+
+typedef enum {
+  ADS1115_DR_8SPS,
+  ADS1115_DR_16SPS,
+  ADS1115_DR_32SPS,
+  ADS1115_DR_64SPS,
+  ADS1115_DR_128SPS,
+  ADS1115_DR_250SPS,
+  ADS1115_DR_475SPS,
+  ADS1115_DR_860SPS
+} adsSPS_t;
+
+namespace Native {
+  inline std::map<uint16_t, float>& adcVoltages() {
+    static std::map<uint16_t, float> voltages;
+    return voltages;
+  }
+
+  inline void setAdcVoltage(uint8_t address, uint8_t channel, float voltage) {
+    adcVoltages()[address << 8 | channel] = voltage;
+  }
+
+  inline float getAdcVoltage(uint8_t address, uint8_t channel) {
+    return adcVoltages()[address << 8 | channel];
+  }
+}
+
+class Adafruit_ADS1115 {
+  public:
+    Adafruit_ADS1115(uint8_t address = 0x48) : address(address) { }
+
+    void setGain(adsGain_t gain) {
+      this->gain = gain;
+    }
+
+    void setSPS(adsSPS_t) { }
+
+    float voltsPerBit() const {
+      static const float RANGES[] = { 6.144, 4.096, 2.048, 1.024, 0.512, 0.256 };
+      return RANGES[gain] / 32768;
+    }
+
+    /**
+    * Not clipped at full scale like the chip would, BATTERY_MULTIPLIER expects readings up to 3.04 V whatever the gain.
+    */
+    float readADC_SingleEnded_V(uint8_t channel) {
+      return roundf(Native::getAdcVoltage(address, channel) / voltsPerBit()) * voltsPerBit();
+    }
+
+    void startContinuous_SingleEnded(uint8_t channel) {
+      continuousChannel = channel;
+    }
+
+    void startContinuous_Differential_0_1() {
+      continuousChannel = 0;
+    }
+
+    int16_t getLastConversionResults() {
+      return toCounts(continuousChannel);
+    }
+
+  private:
+    uint8_t address;
+    adsGain_t gain = GAIN_TWOTHIRDS;
+    uint8_t continuousChannel = 0;
+
+    int16_t toCounts(uint8_t channel) const {
+      float counts = roundf(Native::getAdcVoltage(address, channel) / voltsPerBit());
+      return constrain(counts, -32768.0f, 32767.0f);
+    }
+};
+
+#endif
@@ -0,0 +1,251 @@
+#ifndef _native_arduino_h
+#define _native_arduino_h
+
+/*
+  Stand-in for the parts of the Arduino core used by the hardware independent code, so it can be unit tested on the host ("pio test -e native").
+  Time only moves when a test says so, see setMillis() and advanceMillis().
+*/
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <algorithm>
+#include <map>
+#include <functional>
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+#define IRAM_ATTR
+#define F(string_literal) (string_literal)
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef uint8_t byte;
+using std::min;
+using std::max;
+
+// single threaded on the host, so critical sections have nothing to protect against.
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux) ((void)(mux))
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x02
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define digitalPinToInterrupt(pin) (pin)
+#define DEC 10
+#define HEX 16
+
+/**
+* Arduino String, only what's used by the code under test.
+*/
+class String : public std::string {
+  public:
+    String() { }
+    String(const char* s) : std::string(s) { }
+    String(const std::string& s) : std::string(s) { }
+    explicit String(int value, unsigned char base = DEC) : String((long)value, base) { }
+    explicit String(unsigned int value, unsigned char base = DEC) : String((unsigned long)value, base) { }
+    explicit String(long value, unsigned char base = DEC) : std::string(format(base == HEX ? "%lx" : "%ld", value)) { }
+    explicit String(unsigned long value, unsigned char base = DEC) : std::string(format(base == HEX ? "%lx" : "%lu", value)) { }
+
+    String operator+(const char* s) const { return String(static_cast<const std::string&>(*this) + s); }
+    String operator+(const String& s) const { return String(static_cast<const std::string&>(*this) + s); }
+
+    using std::string::operator+=;
+    String& operator+=(int value) { append(String(value)); return *this; }
+    String& operator+=(unsigned int value) { append(String(value)); return *this; }
+    String& operator+=(long value) { append(String(value)); return *this; }
+    String& operator+=(unsigned long value) { append(String(value)); return *this; }
+
+    int indexOf(const String& s) const {
+      auto at = find(s);
+      return at == npos ? -1 : at;
+    }
+
+    String substring(size_t from, size_t to) const {
+      return from < to ? String(substr(from, to - from)) : String();
+    }
+
+  private:
+    template <typename T> static std::string format(const char* format, T value) {
+      char buffer[24];
+      snprintf(buffer, sizeof(buffer), format, value);
+      return buffer;
+    }
+};
+
+namespace Native {
+  inline uint32_t& currentMillis() {
+    static uint32_t now = 0;
+    return now;
+  }
+
+  inline void setMillis(uint32_t now) {
+    currentMillis() = now;
+  }
+
+  inline void advanceMillis(uint32_t ms) {
+    currentMillis() += ms;
+  }
+
+  inline uint32_t& randomState() {
+    static uint32_t state = 1;
+    return state;
+  }
+
+  // level last written to each pin with digitalWrite(), or to be read with digitalRead().
+  inline std::map<uint8_t, uint8_t>& pins() {
+    static std::map<uint8_t, uint8_t> pins;
+    return pins;
+  }
+
+  // duty last written to each LEDC (PWM) channel.
+  inline std::map<uint8_t, uint32_t>& ledcDuty() {
+    static std::map<uint8_t, uint32_t> duty;
+    return duty;
+  }
+
+  inline std::map<uint8_t, std::function<void(void)>>& interrupts() {
+    static std::map<uint8_t, std::function<void(void)>> interrupts;
+    return interrupts;
+  }
+
+  /**
+  * Run interrupt handler attached to pin, as if the pin had changed the given number of times.
+  */
+  inline void triggerInterrupt(uint8_t pin, uint32_t times = 1) {
+    auto handler = interrupts().find(pin);
+    for (uint32_t i = 0; handler != interrupts().end() && handler->second && i < times; i++) {
+      handler->second();
+    }
+  }
+}
+
+inline void pinMode(uint8_t, uint8_t) { }
+
+inline void digitalWrite(uint8_t pin, uint8_t value) {
+  Native::pins()[pin] = value;
+}
+
+inline int digitalRead(uint8_t pin) {
+  return Native::pins()[pin];
+}
+
+inline double ledcSetup(uint8_t, double frequency, uint8_t) {
+  return frequency;
+}
+
+inline void ledcAttachPin(uint8_t, uint8_t) { }
+
+inline void ledcWrite(uint8_t channel, uint32_t duty) {
+  Native::ledcDuty()[channel] = duty;
+}
+
+inline void attachInterrupt(uint8_t pin, void (*handler)(void), int) {
+  Native::interrupts()[pin] = handler;
+}
+
+inline void detachInterrupt(uint8_t pin) {
+  Native::interrupts().erase(pin);
+}
+
+inline uint32_t millis() {
+  return Native::currentMillis();
+}
+
+inline uint32_t micros() {
+  return Native::currentMillis() * 1000;
+}
+
+inline void delay(uint32_t ms) {
+  Native::advanceMillis(ms);
+}
+
+// deterministic, so that tests are repeatable.
+inline void randomSeed(uint32_t seed) {
+  Native::randomState() = seed ? seed : 1;
+}
+
+inline long random(long howbig) {
+  if (howbig <= 0) {
+    return 0;
+  }
+  uint32_t& x = Native::randomState();
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return x % howbig;
+}
+
+inline long random(long howsmall, long howbig) {
+  return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+inline uint32_t esp_random() {
+  return random(0x7FFFFFFF);
+}
+
+class Print {
+  public:
+    virtual ~Print() { }
+    virtual size_t write(uint8_t c) = 0;
+
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+      for (size_t i = 0; i < size; i++) {
+        write(buffer[i]);
+      }
+      return size;
+    }
+
+    size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t print(const std::string& s) { return print(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int n, int base = 10) { return print((long)n, base); }
+    size_t print(unsigned int n, int base = 10) { return print((unsigned long)n, base); }
+    size_t print(long n, int base = 10) { return printFormat(base == 16 ? "%lx" : "%ld", n); }
+    size_t print(unsigned long n, int base = 10) { return printFormat(base == 16 ? "%lx" : "%lu", n); }
+    size_t print(unsigned char n, int base = 10) { return print((unsigned long)n, base); }
+    size_t print(double n, int digits = 2) {
+      char buffer[40];
+      snprintf(buffer, sizeof(buffer), "%.*f", digits, n);
+      return print(buffer);
+    }
+    size_t println() { return print("\r\n"); }
+    template <typename T> size_t println(T value) { return print(value) + println(); }
+
+  private:
+    template <typename T> size_t printFormat(const char* format, T n) {
+      char buffer[24];
+      snprintf(buffer, sizeof(buffer), format, n);
+      return print(buffer);
+    }
+};
+
+/**
+* Collects everything printed, for checking output in tests.
+*/
+class StringPrint : public Print {
+  public:
+    std::string output;
+
+    size_t write(uint8_t c) override {
+      output += (char)c;
+      return 1;
+    }
+};
+
+#endif
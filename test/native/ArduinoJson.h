@@ -0,0 +1,250 @@
+#ifndef _native_arduinojson_h
+#define _native_arduinojson_h
+
+/*
+  Stand-in for ArduinoJson 5, only what's used by the code under test: flat or nested objects of strings, numbers and booleans (no arrays).
+  Numbers are printed with %g, not the same digits as the real library.
+*/
+#include <Arduino.h>
+#include <deque>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class JsonObject;
+class DynamicJsonBuffer;
+
+class JsonVariant {
+  public:
+    enum TYPE { UNDEFINED, BOOLEAN, INTEGER, FLOAT, STRING, OBJECT };
+
+    TYPE type = UNDEFINED;
+    double number = 0;
+    std::string text;
+    JsonObject* object = nullptr;
+
+    JsonVariant& operator=(bool value) {
+      type = BOOLEAN;
+      number = value;
+      return *this;
+    }
+
+    template<typename T>
+    typename std::enable_if<std::is_arithmetic<T>::value, JsonVariant&>::type operator=(T value) {
+      type = std::is_integral<T>::value ? INTEGER : FLOAT;
+      number = value;
+      return *this;
+    }
+
+    JsonVariant& operator=(const char* value) {
+      type = STRING;
+      text = value;
+      return *this;
+    }
+
+    JsonVariant& operator=(const String& value) {
+      return *this = value.c_str();
+    }
+
+    template<typename T>
+    typename std::enable_if<std::is_arithmetic<T>::value, T>::type as() const {
+      return type == STRING ? (T)atof(text.c_str()) : (T)number;
+    }
+
+    template<typename T>
+    typename std::enable_if<std::is_same<T, String>::value, String>::type as() const {
+      if (type == STRING) {
+        return String(text);
+      }
+      return type == UNDEFINED ? String() : String(format());
+    }
+
+    template<typename T>
+    typename std::enable_if<std::is_same<T, JsonObject>::value, JsonObject&>::type as() const;
+
+    std::string format() const {
+      char buffer[32];
+      switch (type) {
+        case BOOLEAN:
+          return number ? "true" : "false";
+        case INTEGER:
+          snprintf(buffer, sizeof(buffer), "%lld", (long long)number);
+          return buffer;
+        case FLOAT:
+          snprintf(buffer, sizeof(buffer), "%g", number);
+          return buffer;
+        default:
+          return "null";
+      }
+    }
+};
+
+class JsonObject {
+  public:
+    explicit JsonObject(bool valid = true) : valid(valid) { }
+
+    bool success() const {
+      return valid;
+    }
+
+    bool containsKey(const char* key) const {
+      for (const auto& member : members) {
+        if (member.first == key) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    JsonVariant& operator[](const char* key) {
+      for (auto& member : members) {
+        if (member.first == key) {
+          return member.second;
+        }
+      }
+      members.emplace_back(key, JsonVariant());
+      return members.back().second;
+    }
+
+    size_t printTo(String& output) const {
+      output += "{";
+      for (size_t i = 0; i < members.size(); i++) {
+        const auto& value = members[i].second;
+        output += (i > 0 ? ",\"" : "\"") + members[i].first + "\":";
+        if (value.type == JsonVariant::STRING) {
+          output += "\"" + value.text + "\"";
+        } else if (value.type == JsonVariant::OBJECT) {
+          value.object->printTo(output);
+        } else {
+          output += value.format();
+        }
+      }
+      output += "}";
+
+      return output.length();
+    }
+
+    static JsonObject& invalid() {
+      static JsonObject object(false);
+      return object;
+    }
+
+  private:
+    bool valid;
+    std::deque<std::pair<std::string, JsonVariant>> members;
+};
+
+template<typename T>
+typename std::enable_if<std::is_same<T, JsonObject>::value, JsonObject&>::type JsonVariant::as() const {
+  return type == OBJECT ? *object : JsonObject::invalid();
+}
+
+class DynamicJsonBuffer {
+  public:
+    explicit DynamicJsonBuffer(size_t = 0) { }
+
+    JsonObject& createObject() {
+      objects.emplace_back();
+      return objects.back();
+    }
+
+    JsonObject& parseObject(const char* json) {
+      const char* at = json;
+      auto object = parseMembers(at);
+      return object != nullptr ? *object : JsonObject::invalid();
+    }
+
+  private:
+    std::deque<JsonObject> objects;
+
+    static void skipSpace(const char*& at) {
+      while (*at == ' ' || *at == '\t' || *at == '\r' || *at == '\n') {
+        at++;
+      }
+    }
+
+    static bool parseString(const char*& at, std::string& text) {
+      if (*at++ != '"') {
+        return false;
+      }
+      for (; *at != '"'; at++) {
+        if (*at == '\0') {
+          return false;
+        }
+        if (*at == '\\' && *++at == '\0') {
+          return false;
+        }
+        text += *at;
+      }
+      at++;
+      return true;
+    }
+
+    bool parseValue(const char*& at, JsonVariant& value) {
+      skipSpace(at);
+      if (*at == '"') {
+        value.type = JsonVariant::STRING;
+        return parseString(at, value.text);
+      }
+      if (*at == '{') {
+        value.type = JsonVariant::OBJECT;
+        value.object = parseMembers(at);
+        return value.object != nullptr;
+      }
+      if (strncmp(at, "true", 4) == 0 || strncmp(at, "false", 5) == 0) {
+        value = *at == 't';
+        at += *at == 't' ? 4 : 5;
+        return true;
+      }
+      if (strncmp(at, "null", 4) == 0) {
+        at += 4;
+        return true;
+      }
+
+      char* end;
+      value.number = strtod(at, &end);
+      if (end == at) {
+        return false;
+      }
+      value.type = std::string(at, (const char*)end).find_first_of(".eE") != std::string::npos ? JsonVariant::FLOAT : JsonVariant::INTEGER;
+      at = end;
+      return true;
+    }
+
+    JsonObject* parseMembers(const char*& at) {
+      skipSpace(at);
+      if (*at++ != '{') {
+        return nullptr;
+      }
+
+      auto& object = createObject();
+      skipSpace(at);
+      if (*at == '}') {
+        at++;
+        return &object;
+      }
+
+      while (true) {
+        std::string key;
+        skipSpace(at);
+        if (!parseString(at, key)) {
+          return nullptr;
+        }
+        skipSpace(at);
+        if (*at++ != ':' || !parseValue(at, object[key.c_str()])) {
+          return nullptr;
+        }
+        skipSpace(at);
+        if (*at == '}') {
+          at++;
+          return &object;
+        }
+        if (*at++ != ',') {
+          return nullptr;
+        }
+      }
+    }
+};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef _native_arduino_log_h
+#define _native_arduino_log_h
+
+/*
+  Stand-in for ArduinoLog, log messages are thrown away in unit tests.
+*/
+#define CR "\n"
+
+class NativeLogging {
+  public:
+    template <typename... Args> void fatal(const char*, Args...) { }
+    template <typename... Args> void error(const char*, Args...) { }
+    template <typename... Args> void warning(const char*, Args...) { }
+    template <typename... Args> void notice(const char*, Args...) { }
+    template <typename... Args> void trace(const char*, Args...) { }
+    template <typename... Args> void verbose(const char*, Args...) { }
+};
+
+static NativeLogging Log __attribute__((unused));
+
+#endif
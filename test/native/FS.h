@@ -0,0 +1,95 @@
+#ifndef _native_fs_h
+#define _native_fs_h
+
+/*
+  Stand-in for the Arduino file system API, files are kept in memory. Tests can look at (and break) the bytes of a file, and count
+  how many times each byte has been written to check flash wear.
+*/
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+
+namespace fs {
+
+  struct FileData {
+    std::vector<uint8_t> bytes;
+    std::vector<uint32_t> writeCount;   // times each byte has been written.
+  };
+
+  class File {
+    public:
+      File() { }
+      File(const std::shared_ptr<FileData>& data) : data(data) { }
+
+      operator bool() const {
+        return (bool)data;
+      }
+
+      bool seek(uint32_t position) {
+        if (!data || position > data->bytes.size()) {
+          return false;
+        }
+        this->position = position;
+        return true;
+      }
+
+      size_t read(uint8_t* buffer, size_t size) {
+        size_t i = 0;
+        while (data && i < size && position < data->bytes.size()) {
+          buffer[i++] = data->bytes[position++];
+        }
+        return i;
+      }
+
+      size_t write(const uint8_t* buffer, size_t size) {
+        if (!data) {
+          return 0;
+        }
+        for (size_t i = 0; i < size; i++, position++) {
+          if (position == data->bytes.size()) {
+            data->bytes.push_back(0);
+            data->writeCount.push_back(0);
+          }
+          data->bytes[position] = buffer[i];
+          data->writeCount[position]++;
+        }
+        return size;
+      }
+
+      void flush() { }
+
+      void close() {
+        data.reset();
+      }
+
+    private:
+      std::shared_ptr<FileData> data;
+      size_t position = 0;
+  };
+
+  class FS {
+    public:
+      std::map<std::string, std::shared_ptr<FileData>> files;
+
+      bool exists(const char* path) {
+        return files.count(path) > 0;
+      }
+
+      File open(const char* path, const char* mode) {
+        if (mode[0] == 'w') {
+          files[path] = std::make_shared<FileData>();
+        }
+        if (!exists(path)) {
+          return File();
+        }
+        return File(files[path]);
+      }
+  };
+}
+
+using fs::FS;
+using fs::File;
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef _native_functional_interrupt_h
+#define _native_functional_interrupt_h
+
+/*
+  Stand-in for the ESP32 core's FunctionalInterrupt, see Native::triggerInterrupt().
+*/
+#include <functional>
+#include "Arduino.h"
+
+inline void attachInterrupt(uint8_t pin, std::function<void(void)> handler, int) {
+  Native::interrupts()[pin] = handler;
+}
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef _native_preferences_h
+#define _native_preferences_h
+
+/*
+  Stand-in for the ESP32 Preferences (NVS) library. What is stored survives between Preferences objects, like it does on flash,
+  until Native::clearPreferences().
+*/
+#include <map>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+
+namespace Native {
+  inline std::map<std::string, std::vector<uint8_t>>& preferences() {
+    static std::map<std::string, std::vector<uint8_t>> preferences;
+    return preferences;
+  }
+
+  inline void clearPreferences() {
+    preferences().clear();
+  }
+}
+
+class Preferences {
+  public:
+    bool begin(const char* name, bool = false) {
+      this->name = name;
+      return true;
+    }
+
+    void end() { }
+
+    bool clear() {
+      auto& stored = Native::preferences();
+      for (auto it = stored.begin(); it != stored.end();) {
+        it = it->first.compare(0, name.size() + 1, name + "/") == 0 ? stored.erase(it) : std::next(it);
+      }
+      return true;
+    }
+
+    size_t putBytes(const char* key, const void* value, size_t length) {
+      auto bytes = (const uint8_t*)value;
+      Native::preferences()[name + "/" + key] = std::vector<uint8_t>(bytes, bytes + length);
+      return length;
+    }
+
+    size_t getBytesLength(const char* key) {
+      auto found = Native::preferences().find(name + "/" + key);
+      return found == Native::preferences().end() ? 0 : found->second.size();
+    }
+
+    size_t getBytes(const char* key, void* buffer, size_t maxLength) {
+      auto found = Native::preferences().find(name + "/" + key);
+      if (found == Native::preferences().end() || found->second.size() > maxLength) {
+        return 0;
+      }
+      memcpy(buffer, found->second.data(), found->second.size());
+      return found->second.size();
+    }
+
+    size_t putString(const char* key, const String& value) {
+      return putBytes(key, value.c_str(), value.size());
+    }
+
+    String getString(const char* key, const String& defaultValue = String()) {
+      auto found = Native::preferences().find(name + "/" + key);
+      if (found == Native::preferences().end()) {
+        return defaultValue;
+      }
+      return String(std::string(found->second.begin(), found->second.end()));
+    }
+
+  private:
+    std::string name;
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef _native_spiffs_h
+#define _native_spiffs_h
+
+/*
+  Stand-in for SPIFFS, one in-memory file system shared by all translation units.
+*/
+#include "FS.h"
+
+namespace fs {
+  class SPIFFSFS : public FS {
+    public:
+      bool begin(bool = false) {
+        return true;
+      }
+
+      bool format() {
+        files.clear();
+        return true;
+      }
+  };
+}
+
+namespace Native {
+  inline fs::SPIFFSFS& spiffs() {
+    static fs::SPIFFSFS spiffs;
+    return spiffs;
+  }
+}
+
+static fs::SPIFFSFS& SPIFFS = Native::spiffs();
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef _native_sparkfun_lsm9ds1_h
+#define _native_sparkfun_lsm9ds1_h
+
+/*
+  Stand-in for the LSM9DS1 driver. Tests set what the sensor measures in Native::imu(), in g, degrees per second and gauss.
+*/
+#include "Arduino.h"
+
+#define IMU_MODE_SPI 0
+#define IMU_MODE_I2C 1
+
+namespace Native {
+  struct ImuReadings {
+    bool connected = true;
+    float accel[3] = { 0, 0, 1 };     // level and still.
+    float gyro[3] = { 0, 0, 0 };
+    float mag[3] = { 0.2, 0, -0.4 };  // northern hemisphere, pointing north.
+  };
+
+  inline ImuReadings& imu() {
+    static ImuReadings readings;
+    return readings;
+  }
+}
+
+class LSM9DS1 {
+  public:
+    struct {
+      struct {
+        uint8_t commInterface = IMU_MODE_I2C;
+        uint8_t mAddress = 0x1E;
+        uint8_t agAddress = 0x6B;
+      } device;
+    } settings;
+
+    int16_t ax = 0, ay = 0, az = 0;
+    int16_t gx = 0, gy = 0, gz = 0;
+    int16_t mx = 0, my = 0, mz = 0;
+
+    uint16_t begin() {
+      return Native::imu().connected ? 0x683D : 0;
+    }
+
+    void calibrate(bool = true) { }
+    void calibrateMag(bool = true) { }
+
+    uint8_t accelAvailable() { return 1; }
+    uint8_t gyroAvailable() { return 1; }
+    uint8_t magAvailable() { return 1; }
+
+    void readAccel() {
+      ax = toRaw(Native::imu().accel[0], ACCEL_RESOLUTION);
+      ay = toRaw(Native::imu().accel[1], ACCEL_RESOLUTION);
+      az = toRaw(Native::imu().accel[2], ACCEL_RESOLUTION);
+    }
+
+    void readGyro() {
+      gx = toRaw(Native::imu().gyro[0], GYRO_RESOLUTION);
+      gy = toRaw(Native::imu().gyro[1], GYRO_RESOLUTION);
+      gz = toRaw(Native::imu().gyro[2], GYRO_RESOLUTION);
+    }
+
+    void readMag() {
+      mx = toRaw(Native::imu().mag[0], MAG_RESOLUTION);
+      my = toRaw(Native::imu().mag[1], MAG_RESOLUTION);
+      mz = toRaw(Native::imu().mag[2], MAG_RESOLUTION);
+    }
+
+    float calcAccel(int16_t value) { return value * ACCEL_RESOLUTION; }
+    float calcGyro(int16_t value) { return value * GYRO_RESOLUTION; }
+    float calcMag(int16_t value) { return value * MAG_RESOLUTION; }
+
+  private:
+    // driver defaults: +-2 g, 245 dps and 4 gauss.
+    static constexpr float ACCEL_RESOLUTION = 0.000061;
+    static constexpr float GYRO_RESOLUTION = 0.00875;
+    static constexpr float MAG_RESOLUTION = 0.00014;
+
+    static int16_t toRaw(float value, float resolution) {
+      return constrain(roundf(value / resolution), -32768.0f, 32767.0f);
+    }
+};
+
+#endif
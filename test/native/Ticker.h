@@ -0,0 +1,105 @@
+#ifndef _native_ticker_h
+#define _native_ticker_h
+
+/*
+  Stand-in for the ESP32 Ticker library. Nothing runs by itself, Native::runTickers() lets time pass and calls every attached ticker
+  when it's due, just like the timer task would.
+*/
+#include <functional>
+#include <vector>
+#include "Arduino.h"
+
+class Ticker;
+
+namespace Native {
+  inline std::vector<Ticker*>& tickers() {
+    static std::vector<Ticker*> tickers;
+    return tickers;
+  }
+}
+
+class Ticker {
+  public:
+    ~Ticker() {
+      detach();
+    }
+
+    template<typename TArg> void attach(float seconds, void (*callback)(TArg), TArg arg) {
+      attach_ms<TArg>(seconds * 1000, callback, arg);
+    }
+
+    template<typename TArg> void attach_ms(uint32_t milliseconds, void (*callback)(TArg), TArg arg) {
+      start(milliseconds, true, [callback, arg]() { callback(arg); });
+    }
+
+    template<typename TArg> void once_ms(uint32_t milliseconds, void (*callback)(TArg), TArg arg) {
+      start(milliseconds, false, [callback, arg]() { callback(arg); });
+    }
+
+    void attach_ms(uint32_t milliseconds, void (*callback)(void)) {
+      start(milliseconds, true, callback);
+    }
+
+    void once_ms(uint32_t milliseconds, void (*callback)(void)) {
+      start(milliseconds, false, callback);
+    }
+
+    void detach() {
+      auto& tickers = Native::tickers();
+      tickers.erase(std::remove(tickers.begin(), tickers.end(), this), tickers.end());
+    }
+
+    bool active() const {
+      auto& tickers = Native::tickers();
+      return std::find(tickers.begin(), tickers.end(), this) != tickers.end();
+    }
+
+    /* Native only, call callback if it's due. */
+    void runIfDue(uint32_t now) {
+      if (now - started < interval) {
+        return;
+      }
+      started += interval;
+      if (!repeat) {
+        detach();
+      }
+      // callback may detach or attach us again.
+      auto fn = callback;
+      fn();
+    }
+
+  private:
+    uint32_t interval = 0;
+    uint32_t started = 0;
+    bool repeat = false;
+    std::function<void(void)> callback;
+
+    void start(uint32_t milliseconds, bool repeat, const std::function<void(void)>& callback) {
+      detach();
+      this->interval = milliseconds > 0 ? milliseconds : 1;
+      this->started = millis();
+      this->repeat = repeat;
+      this->callback = callback;
+      Native::tickers().push_back(this);
+    }
+};
+
+namespace Native {
+  /**
+  * Let time pass a millisecond at a time, calling tickers as they become due.
+  */
+  inline void runTickers(uint32_t duration) {
+    for (uint32_t i = 0; i < duration; i++) {
+      advanceMillis(1);
+      // copy, a ticker may detach (or attach another) when called.
+      auto due = tickers();
+      for (auto ticker : due) {
+        if (std::find(tickers().begin(), tickers().end(), ticker) != tickers().end()) {
+          ticker->runIfDue(millis());
+        }
+      }
+    }
+  }
+}
+
+#endif
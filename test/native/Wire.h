@@ -0,0 +1,58 @@
+#ifndef _native_wire_h
+#define _native_wire_h
+
+/*
+  Stand-in for the Arduino I2C library, keeps every transaction so tests can check what was written to a device.
+*/
+#include <vector>
+#include "Arduino.h"
+
+class TwoWire {
+  public:
+    struct transaction {
+      uint16_t address;
+      std::vector<uint8_t> data;
+    };
+
+    std::vector<transaction> transactions;
+    uint8_t failures = 0;   // number of coming transactions to fail, as if device didn't acknowledge.
+
+    void beginTransmission(uint16_t address) {
+      current.address = address;
+      current.data.clear();
+    }
+
+    size_t write(uint8_t data) {
+      current.data.push_back(data);
+      return 1;
+    }
+
+    uint8_t endTransmission() {
+      if (failures > 0) {
+        failures--;
+        return 2;
+      }
+      transactions.push_back(current);
+      return 0;
+    }
+
+    void clear() {
+      transactions.clear();
+      failures = 0;
+    }
+
+  private:
+    transaction current;
+};
+
+namespace Native {
+  // one bus shared by all translation units.
+  inline TwoWire& wire() {
+    static TwoWire wire;
+    return wire;
+  }
+}
+
+static TwoWire& Wire = Native::wire();
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef _native_freertos_h
+#define _native_freertos_h
+
+/*
+  Stand-in for the FreeRTOS parts used by the firmware. Tests are single threaded, so this only keeps track of who holds what.
+*/
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY 0xFFFFFFFF
+
+#endif
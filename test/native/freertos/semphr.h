@@ -0,0 +1,39 @@
+#ifndef _native_freertos_semphr_h
+#define _native_freertos_semphr_h
+
+#include "FreeRTOS.h"
+
+struct NativeSemaphore {
+  bool taken = false;
+};
+
+typedef NativeSemaphore* SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return new NativeSemaphore();
+}
+
+inline void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+  delete semaphore;
+}
+
+/**
+* There is no other task that could give it back, so a mutex already taken fails right away whatever the timeout.
+*/
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t) {
+  if (semaphore->taken) {
+    return pdFALSE;
+  }
+  semaphore->taken = true;
+  return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  if (!semaphore->taken) {
+    return pdFALSE;
+  }
+  semaphore->taken = false;
+  return pdTRUE;
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef _native_configuration_h
+#define _native_configuration_h
+
+/*
+  Stand-in for configuration.cpp (which needs ArduinoJson) and the clock in utils.cpp. Defines the globals, so include it from exactly
+  one source file in each test that builds code using them.
+*/
+#include "configuration.h"
+#include "utils.h"
+
+namespace Configuration {
+  Preferences preferences;
+  configObject config;
+
+  void load() { }
+  void save() { }
+
+  void wipe() {
+    config = configObject();
+  }
+}
+
+namespace Utils {
+  bool isTimeAvailable = false;
+
+  // milliseconds, just like the real one.
+  int64_t getEpocTime() {
+    return millis();
+  }
+}
+
+#endif
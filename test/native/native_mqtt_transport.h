@@ -0,0 +1,62 @@
+#ifndef _native_mqtt_transport_h
+#define _native_mqtt_transport_h
+
+#include <string>
+#include <vector>
+#include "mqtt_queue.h"
+
+/**
+* Stand-in for a MQTT client, keeps what was published and lets the test decide when the broker acknowledges it.
+*/
+class TestTransport : public MqttTransport {
+  public:
+    struct published {
+      std::string topic;
+      std::string payload;
+      bool retain;
+      uint16_t packetId;
+    };
+
+    bool connected = true;
+    bool busy = false;
+    uint8_t lossPercent = 0;    // share of messages the broker never acknowledges.
+    std::vector<published> sent;
+    std::vector<uint16_t> pending;    // sent but not acknowledged yet.
+
+    bool isConnected() override {
+      return connected;
+    }
+
+    uint16_t publish(const char* topic, const char* payload, uint8_t, bool retain) override {
+      if (busy) {
+        return 0;
+      }
+      nextPacketId = nextPacketId == 0xFFFF ? 1 : nextPacketId + 1;
+      sent.push_back({topic, payload, retain, nextPacketId});
+      if ((uint32_t)random(100) >= lossPercent) {
+        pending.push_back(nextPacketId);
+      }
+      return nextPacketId;
+    }
+
+    void onAck(const AckCallback& fn) override {
+      ackCallback = fn;
+    }
+
+    void ack(uint16_t packetId) {
+      ackCallback(packetId);
+    }
+
+    void ackPending() {
+      for (auto packetId : pending) {
+        ack(packetId);
+      }
+      pending.clear();
+    }
+
+  private:
+    AckCallback ackCallback;
+    uint16_t nextPacketId = 0;
+};
+
+#endif
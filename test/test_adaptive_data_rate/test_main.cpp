@@ -0,0 +1,190 @@
+#include <unity.h>
+#include "dockingstation/adaptive_data_rate.h"
+
+static const int8_t MIN_POWER = 2;
+static const int8_t MAX_POWER = 10;
+
+AdaptiveDataRate* adr;
+
+void setUp() {
+  randomSeed(3);
+  adr = new AdaptiveDataRate(MIN_POWER, MAX_POWER);
+}
+
+void tearDown() {
+  delete adr;
+}
+
+void addSamples(float snr, uint8_t count) {
+  for (uint8_t i = 0; i < count; i++) {
+    adr->addSample(snr);
+  }
+}
+
+/**
+* SNR measured with the given settings, on a link that gives baseSnr at 125 kHz and max power. Noise grows with bandwidth, and SNR is
+* measured before despreading so it doesn't depend on spreading factor.
+*/
+float measure(float baseSnr, const RadioSettings& settings) {
+  return baseSnr + (settings.power - MAX_POWER) - 10 * log10f(settings.bandwidth / 125);
+}
+
+/**
+* Run the link the way Dockingstation does: measure, evaluate, switch and start over with new measurements.
+* @return number of switches.
+*/
+uint16_t runLink(float baseSnr, float jitter, uint16_t rounds, RadioSettings& settings) {
+  uint16_t switches = 0;
+
+  for (uint16_t i = 0; i < rounds; i++) {
+    adr->addSample(measure(baseSnr, settings) + (random(2001) - 1000) / 1000.0f * jitter);
+
+    RadioSettings next;
+    if (adr->evaluate(settings, next)) {
+      settings = next;
+      adr->reset();
+      switches++;
+    }
+  }
+
+  return switches;
+}
+
+void test_required_snr() {
+  TEST_ASSERT_EQUAL_FLOAT(-7.5, AdaptiveDataRate::getRequiredSNR(7));
+  TEST_ASSERT_EQUAL_FLOAT(-12.5, AdaptiveDataRate::getRequiredSNR(9));
+  TEST_ASSERT_EQUAL_FLOAT(-20, AdaptiveDataRate::getRequiredSNR(12));
+}
+
+void test_fallback_is_most_robust() {
+  auto fallback = adr->getFallbackSettings();
+
+  TEST_ASSERT_EQUAL(12, fallback.spreadingFactor);
+  TEST_ASSERT_EQUAL_FLOAT(125, fallback.bandwidth);
+  TEST_ASSERT_EQUAL(MAX_POWER, fallback.power);
+}
+
+void test_no_change_without_samples() {
+  RadioSettings next;
+
+  TEST_ASSERT_FALSE(adr->evaluate(adr->getFallbackSettings(), next));
+  TEST_ASSERT_EQUAL_FLOAT(0, adr->getWorstSNR());
+}
+
+void test_worst_sample_counts() {
+  addSamples(5, 7);
+  adr->addSample(-3);
+
+  TEST_ASSERT_EQUAL_FLOAT(-3, adr->getWorstSNR());
+
+  // pushed out of history by newer samples.
+  addSamples(5, 8);
+  TEST_ASSERT_EQUAL_FLOAT(5, adr->getWorstSNR());
+}
+
+void test_faster_one_step_at_a_time_with_full_history() {
+  auto current = adr->getFallbackSettings();
+  RadioSettings next;
+
+  addSamples(10, 7);
+  TEST_ASSERT_FALSE(adr->evaluate(current, next));
+
+  adr->addSample(10);
+  TEST_ASSERT_TRUE(adr->evaluate(current, next));
+  TEST_ASSERT_EQUAL(11, next.spreadingFactor);
+}
+
+void test_worse_link_drops_right_away() {
+  RadioSettings current = {125, 7, 5, MIN_POWER, 8};
+  RadioSettings next;
+
+  // one bad measurement is enough, -12 dB at max power needs SF12.
+  adr->addSample(-20);
+  TEST_ASSERT_TRUE(adr->evaluate(current, next));
+  TEST_ASSERT_EQUAL(12, next.spreadingFactor);
+  TEST_ASSERT_GREATER_THAN(current.power, next.power);
+}
+
+void test_hysteresis_before_going_faster() {
+  // SF8 needs -10 dB + 6 dB margin, 1 dB above is less than the hysteresis.
+  RadioSettings current = {125, 9, 5, MAX_POWER, 8};
+  RadioSettings next;
+  addSamples(-3, 8);
+
+  TEST_ASSERT_FALSE(adr->evaluate(current, next));
+
+  adr->reset();
+  addSamples(0, 8);
+  TEST_ASSERT_TRUE(adr->evaluate(current, next));
+  TEST_ASSERT_EQUAL(8, next.spreadingFactor);
+}
+
+void test_power_lowered_gently_at_fastest_rate() {
+  RadioSettings current = {250, 7, 5, MAX_POWER, 8};
+  RadioSettings next;
+  addSamples(20, 8);
+
+  TEST_ASSERT_TRUE(adr->evaluate(current, next));
+  TEST_ASSERT_EQUAL(7, next.spreadingFactor);
+  TEST_ASSERT_EQUAL(MAX_POWER - 2, next.power);
+}
+
+void test_unknown_settings_treated_as_slowest() {
+  RadioSettings current = {62.5, 10, 5, MAX_POWER, 8};
+  RadioSettings next;
+  addSamples(10, 8);
+
+  TEST_ASSERT_TRUE(adr->evaluate(current, next));
+  TEST_ASSERT_EQUAL(11, next.spreadingFactor);
+  TEST_ASSERT_EQUAL_FLOAT(125, next.bandwidth);
+}
+
+void test_converges_to_fastest_rate_with_margin() {
+  // base SNR at max power and 125 kHz, and the data rate that keeps 6 dB above what it needs.
+  const float links[] = {12, 0, -5, -10};
+  const uint8_t expected[] = {7, 8, 10, 12};
+
+  for (uint8_t i = 0; i < 4; i++) {
+    adr->reset();
+    auto settings = adr->getFallbackSettings();
+    runLink(links[i], 0, 200, settings);
+
+    TEST_ASSERT_EQUAL(expected[i], settings.spreadingFactor);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, measure(links[i], settings) - AdaptiveDataRate::getRequiredSNR(settings.spreadingFactor) - 6);
+  }
+}
+
+void test_no_flapping_on_noisy_link() {
+  auto settings = adr->getFallbackSettings();
+  runLink(-4, 1.5, 200, settings);
+
+  // once settled, +-1.5 dB of noise must not make it switch back and forth.
+  TEST_ASSERT_LESS_OR_EQUAL(1, runLink(-4, 1.5, 1000, settings));
+}
+
+void test_fading_link_follows_down() {
+  auto settings = adr->getFallbackSettings();
+  runLink(12, 0, 200, settings);
+  TEST_ASSERT_EQUAL(7, settings.spreadingFactor);
+
+  // mower drives off behind the shed, the very next measurement moves us to a robust rate.
+  runLink(-12, 0, 1, settings);
+  TEST_ASSERT_EQUAL(12, settings.spreadingFactor);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_required_snr);
+  RUN_TEST(test_fallback_is_most_robust);
+  RUN_TEST(test_no_change_without_samples);
+  RUN_TEST(test_worst_sample_counts);
+  RUN_TEST(test_faster_one_step_at_a_time_with_full_history);
+  RUN_TEST(test_worse_link_drops_right_away);
+  RUN_TEST(test_hysteresis_before_going_faster);
+  RUN_TEST(test_power_lowered_gently_at_fastest_rate);
+  RUN_TEST(test_unknown_settings_treated_as_slowest);
+  RUN_TEST(test_converges_to_fastest_rate_with_margin);
+  RUN_TEST(test_no_flapping_on_noisy_link);
+  RUN_TEST(test_fading_link_follows_down);
+  return UNITY_END();
+}
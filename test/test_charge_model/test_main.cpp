@@ -0,0 +1,297 @@
+#include <unity.h>
+#include "charge_model.h"
+
+static const float CAPACITY = 4400;             // mAh
+static const float MAX_VOLTAGE = 16.8;
+static const float EMPTY_VOLTAGE = 12.0;
+static const float TERMINATION_CURRENT = 100;   // mA
+static const float MOWING_CURRENT = 3000;       // mA
+
+/**
+* CC/CV charger connected to a Li-ion pack. Constant current up to the knee, then current decays exponentially at constant voltage until
+* it drops below termination current.
+*/
+struct Charger {
+  float current;      // CC current (mA)
+  float knee;         // SoC where charger goes to CV
+  float tau;          // CV time constant (seconds)
+  float soc;
+  float cvCurrent = 0;
+
+  Charger(float current, float knee, float tau, float soc) : current(current), knee(knee), tau(tau), soc(soc) { }
+
+  bool isCharging() const {
+    return soc < knee || cvCurrent == 0 || cvCurrent >= TERMINATION_CURRENT;
+  }
+
+  float getVoltage() const {
+    if (soc < knee) {
+      return EMPTY_VOLTAGE + soc / knee * (MAX_VOLTAGE - 0.1 - EMPTY_VOLTAGE);
+    }
+    return MAX_VOLTAGE;
+  }
+
+  /**
+  * Charge for one second.
+  * @return charge current (mA).
+  */
+  float step() {
+    float charge = current;
+
+    if (soc >= knee) {
+      cvCurrent = cvCurrent == 0 ? current : cvCurrent * expf(-1 / tau);
+      charge = cvCurrent;
+    }
+    soc = min(soc + charge / 3600 / CAPACITY, 1.0f);
+
+    return charge;
+  }
+};
+
+static ChargeModel* model;
+
+void setUp() {
+  model = new ChargeModel(CAPACITY, MAX_VOLTAGE, TERMINATION_CURRENT);
+}
+
+void tearDown() {
+  delete model;
+}
+
+/**
+* Charge until charger stops, feeding model the way Battery does.
+* @return seconds it took.
+*/
+uint32_t charge(Charger& charger, uint32_t& now) {
+  uint32_t start = now;
+
+  while (charger.isCharging()) {
+    float current = charger.step();
+    now += 1000;
+    model->update(now, charger.getVoltage(), current, charger.soc);
+  }
+  model->update(now, charger.getVoltage(), 0, charger.soc);
+
+  return (now - start) / 1000;
+}
+
+void learn(uint8_t cycles) {
+  uint32_t now = 0;
+  for (uint8_t i = 0; i < cycles; i++) {
+    Charger charger(1500, 0.8, 3000, 0.1);
+    charge(charger, now);
+  }
+}
+
+void test_assumes_half_c_before_first_charge() {
+  TEST_ASSERT_EQUAL(ChargeModel::PHASE::IDLE, model->getPhase());
+  TEST_ASSERT_EQUAL(3600, model->getChargeTime(0, 0.5));
+  TEST_ASSERT_EQUAL(0, model->getChargeTime(0.6, 0.5));
+}
+
+void test_follows_charge_phases() {
+  Charger charger(1500, 0.8, 3000, 0.7);
+  uint32_t now = 0;
+
+  model->update(now, charger.getVoltage(), charger.step(), charger.soc);
+  TEST_ASSERT_EQUAL(ChargeModel::PHASE::CONSTANT_CURRENT, model->getPhase());
+
+  while (charger.soc < charger.knee + 0.01) {
+    now += 1000;
+    model->update(now, charger.getVoltage(), charger.step(), charger.soc);
+  }
+  TEST_ASSERT_EQUAL(ChargeModel::PHASE::CONSTANT_VOLTAGE, model->getPhase());
+
+  charge(charger, now);
+  TEST_ASSERT_EQUAL(ChargeModel::PHASE::IDLE, model->getPhase());
+}
+
+void test_learns_charge_cycle() {
+  learn(1);
+
+  TEST_ASSERT_FLOAT_WITHIN(1, 1500, model->getConstantCurrent());
+  // knee moves halfway towards what was measured each cycle.
+  TEST_ASSERT_FLOAT_WITHIN(0.005, 0.775, model->getKneeLevel());
+  TEST_ASSERT_FLOAT_WITHIN(150, 3000, model->getTimeConstant());
+
+  learn(3);
+  TEST_ASSERT_FLOAT_WITHIN(0.005, 0.8, model->getKneeLevel());
+  TEST_ASSERT_FLOAT_WITHIN(30, 3000, model->getTimeConstant());
+}
+
+void test_does_not_learn_knee_when_starting_in_cv() {
+  Charger charger(1500, 0.8, 3000, 0.9);
+  uint32_t now = 0;
+  charge(charger, now);
+
+  TEST_ASSERT_EQUAL_FLOAT(0.75, model->getKneeLevel());
+}
+
+/**
+* Predictions made before charging starts, after three learning cycles, compared with how long the charge took.
+*/
+void test_predicts_charge_time() {
+  learn(3);
+
+  float maxError = 0;
+  for (float level = 0; level < 0.95; level += 0.1) {
+    uint32_t predicted = model->getTimeToFull(level);
+    Charger charger(1500, 0.8, 3000, level);
+    uint32_t now = 0;
+    uint32_t actual = charge(charger, now);
+
+    maxError = max(maxError, fabsf((float)predicted - actual) / actual);
+  }
+
+  char message[50];
+  sprintf(message, "max error predicting time to full %.1f%%", maxError * 100);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_LESS_THAN_FLOAT(0.02, maxError);
+}
+
+void test_predicts_from_cv_phase() {
+  learn(3);
+
+  Charger charger(1500, 0.8, 3000, 0.5);
+  uint32_t now = 0;
+  while (charger.soc < 0.9) {
+    now += 1000;
+    model->update(now, charger.getVoltage(), charger.step(), charger.soc);
+  }
+  TEST_ASSERT_EQUAL(ChargeModel::PHASE::CONSTANT_VOLTAGE, model->getPhase());
+
+  uint32_t toLevel = model->getTimeToLevel(charger.soc, 0.95);
+  uint32_t predicted = model->getTimeToFull(charger.soc);
+  uint32_t start = now;
+  uint32_t reached = 0;
+  while (charger.isCharging()) {
+    now += 1000;
+    model->update(now, charger.getVoltage(), charger.step(), charger.soc);
+    if (reached == 0 && charger.soc >= 0.95) {
+      reached = (now - start) / 1000;
+    }
+  }
+  uint32_t actual = (now - start) / 1000;
+
+  TEST_ASSERT_UINT_WITHIN(actual / 50, actual, predicted);
+  TEST_ASSERT_UINT_WITHIN(reached / 50, reached, toLevel);
+}
+
+void test_mowing_in_window() {
+  // mow 60, charge 30, mow what is left of the window.
+  TEST_ASSERT_EQUAL(90, ChargeModel::getMowingInWindow(120, 0, 60, 30, 50));
+  // window over before first charge is done.
+  TEST_ASSERT_EQUAL(0, ChargeModel::getMowingInWindow(120, 120, 60, 30, 50));
+  TEST_ASSERT_EQUAL(20, ChargeModel::getMowingInWindow(120, 100, 60, 30, 50));
+  TEST_ASSERT_EQUAL(60, ChargeModel::getMowingInWindow(500, 0, 60, 30, 0));
+}
+
+/**
+* Mower that mows at MOWING_CURRENT during a window every day, and charges the rest of the time. Follows the same departure rule as
+* Charging::shouldDepart().
+* @return mowed m2 per day, over the days after learning.
+*/
+uint32_t mowDays(uint16_t windowStart, uint16_t windowEnd, uint8_t departureLevel) {
+  static const uint8_t LEARNING_DAYS = 3;
+  static const uint8_t MEASURED_DAYS = 7;
+  static const float AREA_PER_SECOND = 0.3 * 0.25;   // m2, 0.3 m/s with a 0.25 m cut.
+
+  uint32_t now = 0;
+  float soc = 1;
+  bool mowing = false;
+  float mowed = 0;
+  Charger charger(1500, 0.8, 3000, soc);
+  charger.cvCurrent = TERMINATION_CURRENT / 2;   // starts out fully charged.
+  auto mowingTime = [](uint8_t level) {
+    return (uint16_t)(level / 100.0f * CAPACITY / MOWING_CURRENT * 60);
+  };
+
+  for (uint32_t second = 0; second < (LEARNING_DAYS + MEASURED_DAYS) * 86400; second++) {
+    now += 1000;
+    uint16_t minute = second % 86400 / 60;
+    bool inWindow = minute >= windowStart && minute < windowEnd;
+
+    if (mowing) {
+      soc -= MOWING_CURRENT / 3600 / CAPACITY;
+      if (second >= LEARNING_DAYS * 86400) {
+        mowed += AREA_PER_SECOND;
+      }
+      if (soc <= 0 || !inWindow) {
+        mowing = false;
+        charger = Charger(1500, 0.8, 3000, max(soc, 0.0f));
+      }
+      continue;
+    }
+
+    if (charger.isCharging()) {
+      float current = charger.step();
+      model->update(now, charger.getVoltage(), current, charger.soc);
+      soc = charger.soc;
+    } else {
+      model->update(now, charger.getVoltage(), 0, charger.soc);
+      soc = 1;
+    }
+
+    if (!inWindow) {
+      continue;
+    }
+
+    uint8_t level = soc * 100;
+    if (!charger.isCharging()) {
+      mowing = true;
+    } else if (departureLevel < 100 && level >= departureLevel && second % 10 == 0) {
+      uint16_t window = windowEnd - minute;
+      auto partial = ChargeModel::getMowingInWindow(window, 0, mowingTime(level), model->getChargeTime(0, departureLevel / 100.0f) / 60, mowingTime(departureLevel));
+      auto full = ChargeModel::getMowingInWindow(window, model->getTimeToFull(soc) / 60, mowingTime(100), model->getChargeTime(0, 1) / 60, mowingTime(100));
+      mowing = partial > full;
+    }
+  }
+
+  return mowed / MEASURED_DAYS;
+}
+
+/**
+* With a short schedule window there is not time for many full charges, leaving early gives more mowing. With the default
+* departure level (100) nothing changes.
+*/
+void test_departing_early_gives_more_mowing() {
+  static const uint16_t WINDOWS[][2] = { { 8 * 60, 20 * 60 }, { 10 * 60, 16 * 60 }, { 9 * 60, 13 * 60 } };
+  static const uint8_t LEVELS[] = { 100, 90, 80, 70 };
+
+  for (auto& window : WINDOWS) {
+    uint32_t full = 0;
+    uint32_t best = 0;
+    char message[100];
+    int length = sprintf(message, "%02d-%02d:", window[0] / 60, window[1] / 60);
+
+    for (auto level : LEVELS) {
+      delete model;
+      model = new ChargeModel(CAPACITY, MAX_VOLTAGE, TERMINATION_CURRENT);
+      uint32_t mowed = mowDays(window[0], window[1], level);
+      length += sprintf(message + length, " %d%% %u m2", level, mowed);
+
+      if (level == 100) {
+        full = mowed;
+      }
+      // rule only leaves early when it predicts more mowing, should never lose much on it.
+      TEST_ASSERT_GREATER_OR_EQUAL(full * 0.97, mowed);
+      best = max(best, mowed);
+    }
+    TEST_MESSAGE(message);
+
+    TEST_ASSERT_GREATER_THAN(full * 1.03, best);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_assumes_half_c_before_first_charge);
+  RUN_TEST(test_follows_charge_phases);
+  RUN_TEST(test_learns_charge_cycle);
+  RUN_TEST(test_does_not_learn_knee_when_starting_in_cv);
+  RUN_TEST(test_predicts_charge_time);
+  RUN_TEST(test_predicts_from_cv_phase);
+  RUN_TEST(test_mowing_in_window);
+  RUN_TEST(test_departing_early_gives_more_mowing);
+  return UNITY_END();
+}
@@ -0,0 +1,123 @@
+#include <unity.h>
+#include "cutter_governor.h"
+
+static const uint8_t MIN_SPEED = 60;
+static const uint8_t MAX_SPEED = 100;
+static const uint16_t INTERVAL = 100;   // ms, Cutter updates governor this often.
+
+CutterGovernor* governor;
+uint32_t now;
+
+void setUp() {
+  now = 1000;
+  governor = new CutterGovernor(MIN_SPEED, MAX_SPEED);
+  governor->reset(now);
+}
+
+void tearDown() {
+  delete governor;
+}
+
+/**
+* Feed governor the same load for a while.
+* @return speed governor ended up at.
+*/
+uint8_t run(uint32_t duration, uint8_t load, uint8_t groundSpeed = 0) {
+  uint8_t speed = governor->getSpeed();
+
+  for (uint32_t elapsed = 0; elapsed < duration; elapsed += INTERVAL) {
+    now += INTERVAL;
+    speed = governor->update(now, load, groundSpeed);
+  }
+
+  return speed;
+}
+
+void test_floor_rises_with_ground_speed() {
+  TEST_ASSERT_EQUAL(MIN_SPEED, governor->getFloor(0));
+  TEST_ASSERT_EQUAL(70, governor->getFloor(50));
+  TEST_ASSERT_EQUAL(80, governor->getFloor(100));
+  TEST_ASSERT_EQUAL(80, governor->getFloor(150));
+}
+
+void test_starts_at_full_speed() {
+  TEST_ASSERT_EQUAL(MAX_SPEED, governor->getSpeed());
+  TEST_ASSERT_EQUAL(MAX_SPEED, run(2000, 5));
+}
+
+void test_steps_down_in_sparse_grass() {
+  // filter has to settle and load stay low for a while before first step.
+  run(2900, 5);
+  TEST_ASSERT_EQUAL(MAX_SPEED, governor->getSpeed());
+
+  run(1000, 5);
+  TEST_ASSERT_EQUAL(95, governor->getSpeed());
+
+  run(1000, 5);
+  TEST_ASSERT_EQUAL(90, governor->getSpeed());
+
+  TEST_ASSERT_EQUAL(MIN_SPEED, run(20000, 5));
+}
+
+void test_never_below_floor() {
+  TEST_ASSERT_EQUAL(80, run(30000, 5, 100));
+
+  // mower speeds up, blade has to follow right away.
+  governor->reset(now);
+  run(30000, 5, 0);
+  TEST_ASSERT_EQUAL(MIN_SPEED, governor->getSpeed());
+  now += INTERVAL;
+  TEST_ASSERT_EQUAL(70, governor->update(now, 5, 50));
+}
+
+void test_full_speed_as_soon_as_load_is_high() {
+  run(30000, 5);
+  TEST_ASSERT_EQUAL(MIN_SPEED, governor->getSpeed());
+
+  // unfiltered load decides, one reading is enough.
+  now += INTERVAL;
+  TEST_ASSERT_EQUAL(MAX_SPEED, governor->update(now, 40, 0));
+  TEST_ASSERT_EQUAL_FLOAT(40, governor->getFilteredLoad());
+}
+
+void test_keeps_speed_between_thresholds() {
+  run(8000, 5);
+  // filtered load needs a moment to follow.
+  run(5000, 25);
+  auto speed = governor->getSpeed();
+  TEST_ASSERT_LESS_THAN(MAX_SPEED, speed);
+
+  TEST_ASSERT_EQUAL(speed, run(30000, 25));
+}
+
+void test_waits_longer_after_going_back_to_full_speed() {
+  run(30000, 5);
+  run(INTERVAL, 50);
+  TEST_ASSERT_EQUAL(MAX_SPEED, governor->getSpeed());
+
+  TEST_ASSERT_EQUAL(MAX_SPEED, run(29000, 5));
+  TEST_ASSERT_LESS_THAN(MAX_SPEED, run(2000, 5));
+}
+
+void test_disabled_when_min_is_max() {
+  CutterGovernor fixed(MAX_SPEED, MAX_SPEED);
+  fixed.reset(now);
+
+  for (uint32_t elapsed = 0; elapsed < 60000; elapsed += INTERVAL) {
+    now += INTERVAL;
+    TEST_ASSERT_EQUAL(MAX_SPEED, fixed.update(now, 0, 0));
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_floor_rises_with_ground_speed);
+  RUN_TEST(test_starts_at_full_speed);
+  RUN_TEST(test_steps_down_in_sparse_grass);
+  RUN_TEST(test_never_below_floor);
+  RUN_TEST(test_full_speed_as_soon_as_load_is_high);
+  RUN_TEST(test_keeps_speed_between_thresholds);
+  RUN_TEST(test_waits_longer_after_going_back_to_full_speed);
+  RUN_TEST(test_disabled_when_min_is_max);
+  return UNITY_END();
+}
@@ -0,0 +1,137 @@
+#include <unity.h>
+#include "cutter_jam_detector.h"
+#include "definitions.h"
+
+/**
+* Cutter current (mA) at a load (0-1, same scale as Cutter::getLoad()) while running at full speed.
+*/
+static float loadCurrent(float load) {
+  return Definitions::CUTTER_NOLOAD_CURRENT + load * (Definitions::CUTTER_MAX_CURRENT - Definitions::CUTTER_NOLOAD_CURRENT);
+}
+
+/**
+* Cutter current (mA) of a motor at a speed setting (%) with the blade turning at an rpm.
+*/
+static float motorCurrent(uint8_t speed, float rpm) {
+  float stallCurrent = Definitions::CUTTER_MAX_CURRENT * speed / 100;
+  return stallCurrent - rpm / Definitions::CUTTER_NOLOAD_RPM * (Definitions::CUTTER_MAX_CURRENT - Definitions::CUTTER_NOLOAD_CURRENT);
+}
+
+// ADC noise, +-5% of max current.
+static float noise() {
+  return (random(1001) - 500) / 10000.0f * Definitions::CUTTER_MAX_CURRENT;
+}
+
+static CutterJamDetector detector;
+
+void setUp() {
+  detector.reset();
+  randomSeed(1);
+}
+
+void tearDown() { }
+
+void test_rpm_estimate_matches_motor_model() {
+  TEST_ASSERT_FLOAT_WITHIN(1, Definitions::CUTTER_NOLOAD_RPM, CutterJamDetector::estimateRpm(Definitions::CUTTER_NOLOAD_CURRENT, 100));
+  TEST_ASSERT_FLOAT_WITHIN(1, 0, CutterJamDetector::estimateRpm(Definitions::CUTTER_MAX_CURRENT, 100));
+  TEST_ASSERT_FLOAT_WITHIN(1, 1000, CutterJamDetector::estimateRpm(motorCurrent(60, 1000), 60));
+}
+
+void test_jam_threshold_is_above_overload_current() {
+  // the most current the blade may draw while still counting as turning.
+  float highest = 0;
+  for (float current = 0; current < Definitions::CUTTER_MAX_CURRENT; current++) {
+    detector.reset();
+    for (uint8_t i = 0; i < CutterJamDetector::JAM_SAMPLES; i++) {
+      detector.update(current, 100);
+    }
+    if (!detector.isJammed()) {
+      highest = current;
+    }
+  }
+
+  TEST_ASSERT_GREATER_THAN(loadCurrent(Definitions::CUTTER_LOAD_THRESHOLD / 100.0f), highest);
+}
+
+void test_stalled_blade_is_jammed() {
+  uint8_t samples = 0;
+  while (!detector.update(motorCurrent(100, 0) + noise(), 100)) {
+    samples++;
+    TEST_ASSERT_LESS_THAN(CutterJamDetector::JAM_SAMPLES, samples);
+  }
+
+  TEST_ASSERT_TRUE(detector.isJammed());
+  TEST_ASSERT_GREATER_THAN(loadCurrent(0.9), detector.getJamCurrent());
+}
+
+void test_stalled_slow_blade_is_jammed() {
+  for (uint8_t i = 0; i < CutterJamDetector::JAM_SAMPLES; i++) {
+    detector.update(motorCurrent(Definitions::CUTTER_MIN_SPEED, 0) + noise() / 4, Definitions::CUTTER_MIN_SPEED);
+  }
+
+  TEST_ASSERT_TRUE(detector.isJammed());
+}
+
+void test_jam_stays_until_reset() {
+  for (uint8_t i = 0; i < CutterJamDetector::JAM_SAMPLES; i++) {
+    detector.update(motorCurrent(100, 0), 100);
+  }
+  detector.update(Definitions::CUTTER_NOLOAD_CURRENT, 100);
+
+  TEST_ASSERT_TRUE(detector.isJammed());
+  detector.reset();
+  TEST_ASSERT_FALSE(detector.isJammed());
+}
+
+void test_blade_that_recovers_is_not_jammed() {
+  // blade bogs down on a tuft and picks up speed again, over and over.
+  for (int i = 0; i < 10000; i++) {
+    float rpm = i % 20 < CutterJamDetector::JAM_SAMPLES - 1 ? 0 : Definitions::CUTTER_NOLOAD_RPM / 2;
+    detector.update(motorCurrent(100, rpm), 100);
+  }
+
+  TEST_ASSERT_FALSE(detector.isJammed());
+}
+
+void test_thick_grass_is_not_jammed() {
+  // one minute at 500 Hz, load wanders between 50% and 90% with ADC noise on top. That is overloaded, but not jammed.
+  float load = 0.7;
+  for (int i = 0; i < 30000; i++) {
+    load += (random(201) - 100) / 5000.0f;
+    load = constrain(load, 0.5, 0.9);
+    detector.update(loadCurrent(load) + noise(), 100);
+  }
+
+  TEST_ASSERT_FALSE(detector.isJammed());
+}
+
+void test_sustained_overload_is_not_jammed() {
+  for (int i = 0; i < 30000; i++) {
+    detector.update(loadCurrent(0.85) + noise(), 100);
+  }
+
+  TEST_ASSERT_FALSE(detector.isJammed());
+}
+
+void test_no_jam_below_min_speed() {
+  // blade starting up might not overcome friction yet.
+  for (int i = 0; i < 1000; i++) {
+    detector.update(motorCurrent(CutterJamDetector::JAM_MIN_SPEED - 1, 0), CutterJamDetector::JAM_MIN_SPEED - 1);
+  }
+
+  TEST_ASSERT_FALSE(detector.isJammed());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_rpm_estimate_matches_motor_model);
+  RUN_TEST(test_jam_threshold_is_above_overload_current);
+  RUN_TEST(test_stalled_blade_is_jammed);
+  RUN_TEST(test_stalled_slow_blade_is_jammed);
+  RUN_TEST(test_jam_stays_until_reset);
+  RUN_TEST(test_blade_that_recovers_is_not_jammed);
+  RUN_TEST(test_thick_grass_is_not_jammed);
+  RUN_TEST(test_sustained_overload_is_not_jammed);
+  RUN_TEST(test_no_jam_below_min_speed);
+  return UNITY_END();
+}
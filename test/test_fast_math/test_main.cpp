@@ -0,0 +1,110 @@
+#include <unity.h>
+#include <math.h>
+#include "fast_math.h"
+
+/*
+  Compares FastMath against libm (in double) over the whole input range, the max errors must stay within what fast_math.h documents.
+*/
+
+static const int SAMPLES = 200000;
+
+void setUp() { }
+void tearDown() { }
+
+void test_invSqrt_relative_error() {
+  double maxError = 0;
+  // logarithmic sweep from 1e-37 to 1e37.
+  for (int i = 0; i <= SAMPLES; i++) {
+    float x = powf(10, -37 + 74.0f * i / SAMPLES);
+    double expected = 1 / sqrt((double)x);
+    maxError = fmax(maxError, fabs(FastMath::invSqrt(x) - expected) / expected);
+  }
+
+  TEST_ASSERT_TRUE(maxError <= 4.8e-6);
+}
+
+void test_sqrt_relative_error() {
+  double maxError = 0;
+  for (int i = 0; i <= SAMPLES; i++) {
+    float x = powf(10, -37 + 74.0f * i / SAMPLES);
+    double expected = sqrt((double)x);
+    maxError = fmax(maxError, fabs(FastMath::sqrt(x) - expected) / expected);
+  }
+
+  TEST_ASSERT_TRUE(maxError <= 4.8e-6);
+  TEST_ASSERT_EQUAL_FLOAT(0, FastMath::sqrt(0));
+  TEST_ASSERT_EQUAL_FLOAT(0, FastMath::sqrt(-1));
+}
+
+void test_atan_error() {
+  double maxError = 0;
+  // linear in the interesting part, logarithmic out to +-1e30.
+  for (int i = -SAMPLES; i <= SAMPLES; i++) {
+    float x = 20.0f * i / SAMPLES;
+    maxError = fmax(maxError, fabs(FastMath::atan(x) - atan((double)x)));
+  }
+  for (int i = 0; i <= SAMPLES; i++) {
+    float x = powf(10, 1 + 29.0f * i / SAMPLES);
+    maxError = fmax(maxError, fabs(FastMath::atan(x) - atan((double)x)));
+    maxError = fmax(maxError, fabs(FastMath::atan(-x) - atan(-(double)x)));
+  }
+
+  TEST_ASSERT_TRUE(maxError <= 1.2e-5);
+}
+
+void test_atan2_error_all_quadrants() {
+  double maxError = 0;
+  // points on circles of different radius, all the way around.
+  const float radiuses[] = {1e-6f, 0.01f, 1, 9.81f, 1000, 1e6f};
+  for (float radius : radiuses) {
+    for (int i = 0; i < SAMPLES / 10; i++) {
+      double angle = -PI + 2 * PI * i / (SAMPLES / 10);
+      float y = radius * sin(angle);
+      float x = radius * cos(angle);
+      maxError = fmax(maxError, fabs(FastMath::atan2(y, x) - atan2((double)y, (double)x)));
+    }
+  }
+
+  TEST_ASSERT_TRUE(maxError <= 1.2e-5);
+  TEST_ASSERT_EQUAL_FLOAT(0, FastMath::atan2(0, 0));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, PI / 2, FastMath::atan2(1, 0));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, -PI / 2, FastMath::atan2(-1, 0));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, PI, FastMath::atan2(0, -1));
+}
+
+void test_asin_error() {
+  double maxError = 0;
+  for (int i = -SAMPLES; i <= SAMPLES; i++) {
+    float x = (float)i / SAMPLES;
+    maxError = fmax(maxError, fabs(FastMath::asin(x) - asin((double)x)));
+  }
+
+  TEST_ASSERT_TRUE(maxError <= 7.3e-6);
+  // out of range is clamped.
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, PI / 2, FastMath::asin(1.5f));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, -PI / 2, FastMath::asin(-1.5f));
+}
+
+void test_sin_cos_error() {
+  double maxSinError = 0;
+  double maxCosError = 0;
+  for (int i = -SAMPLES; i <= SAMPLES; i++) {
+    float x = 100 * PI * i / SAMPLES;
+    maxSinError = fmax(maxSinError, fabs(FastMath::sin(x) - sin((double)x)));
+    maxCosError = fmax(maxCosError, fabs(FastMath::cos(x) - cos((double)x)));
+  }
+
+  TEST_ASSERT_TRUE(maxSinError <= 7.5e-7);
+  TEST_ASSERT_TRUE(maxCosError <= 7.5e-7);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_invSqrt_relative_error);
+  RUN_TEST(test_sqrt_relative_error);
+  RUN_TEST(test_atan_error);
+  RUN_TEST(test_atan2_error_all_quadrants);
+  RUN_TEST(test_asin_error);
+  RUN_TEST(test_sin_cos_error);
+  return UNITY_END();
+}
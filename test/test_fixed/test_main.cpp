@@ -0,0 +1,176 @@
+#include <unity.h>
+#include <math.h>
+#include <chrono>
+#include "fixed.h"
+
+typedef Fixed<15, 16> Q15_16;
+typedef Fixed<7, 8> Q7_8;
+typedef Fixed<21, 10> Q21_10;
+
+// conversions are constexpr, so these are checked by the compiler.
+static_assert(Q15_16::fromFloat(1.5f).getRaw() == 98304, "fromFloat");
+static_assert((Q15_16::fromInt(2) * Q15_16::fromFloat(0.25f)).toFloat() == 0.5f, "constexpr multiply");
+static_assert(Q15_16::fromFloat(1e9f) == Q15_16::max(), "fromFloat saturates");
+static_assert(Q7_8::fromInt(200) == Q7_8::max(), "fromInt saturates");
+static_assert(sizeof(Q7_8) == 2 && sizeof(Q15_16) == 4, "storage size");
+
+void setUp() { }
+void tearDown() { }
+
+void test_addition_saturates() {
+  TEST_ASSERT_TRUE(Q15_16::max() + Q15_16::max() == Q15_16::max());
+  TEST_ASSERT_TRUE(Q15_16::min() + Q15_16::min() == Q15_16::min());
+  TEST_ASSERT_TRUE(Q7_8::max() + Q7_8::fromInt(1) == Q7_8::max());
+  TEST_ASSERT_TRUE(Q7_8::min() + Q7_8::fromInt(-1) == Q7_8::min());
+  // no saturation when result fits.
+  TEST_ASSERT_TRUE(Q7_8::max() + Q7_8::min() == Q7_8::fromRaw(-1));
+}
+
+void test_subtraction_and_negation_saturate() {
+  TEST_ASSERT_TRUE(Q15_16::min() - Q15_16::max() == Q15_16::min());
+  TEST_ASSERT_TRUE(Q15_16::max() - Q15_16::min() == Q15_16::max());
+  TEST_ASSERT_TRUE(Q7_8::min() - Q7_8::fromInt(1) == Q7_8::min());
+  // -min() doesn't fit, two's complement has one more negative value.
+  TEST_ASSERT_TRUE(-Q7_8::min() == Q7_8::max());
+  TEST_ASSERT_TRUE(-Q15_16::min() == Q15_16::max());
+}
+
+void test_multiplication_saturates() {
+  TEST_ASSERT_TRUE(Q15_16::max() * Q15_16::fromInt(2) == Q15_16::max());
+  TEST_ASSERT_TRUE(Q15_16::max() * Q15_16::fromInt(-2) == Q15_16::min());
+  TEST_ASSERT_TRUE(Q15_16::min() * Q15_16::min() == Q15_16::max());
+  TEST_ASSERT_TRUE(Q15_16::fromInt(3) * 100000 == Q15_16::max());
+  TEST_ASSERT_TRUE(Q15_16::fromInt(-3) * 100000 == Q15_16::min());
+  TEST_ASSERT_TRUE(Q7_8::fromInt(100) * Q7_8::fromInt(100) == Q7_8::max());
+}
+
+void test_division_saturates() {
+  TEST_ASSERT_TRUE(Q15_16::fromInt(1) / Q15_16() == Q15_16::max());
+  TEST_ASSERT_TRUE(Q15_16::fromInt(-1) / Q15_16() == Q15_16::min());
+  TEST_ASSERT_TRUE(Q15_16::fromInt(1) / 0 == Q15_16::max());
+  TEST_ASSERT_TRUE(Q15_16::fromInt(-1) / 0 == Q15_16::min());
+  TEST_ASSERT_TRUE(Q15_16::fromInt(100) / Q15_16::fromFloat(0.001f) == Q15_16::max());
+  TEST_ASSERT_TRUE(Q15_16::fromInt(-100) / Q15_16::fromFloat(0.001f) == Q15_16::min());
+}
+
+void test_rounding() {
+  TEST_ASSERT_EQUAL_FLOAT(-3.5f, (Q15_16::fromInt(-7) / 2).toFloat());
+  TEST_ASSERT_EQUAL_FLOAT(-3.5f, (Q15_16::fromInt(7) / Q15_16::fromInt(-2)).toFloat());
+  TEST_ASSERT_EQUAL(3, Q15_16::fromFloat(2.5f).toInt());
+  TEST_ASSERT_EQUAL(-2, Q15_16::fromFloat(-2.5f).toInt());
+  TEST_ASSERT_EQUAL(-3, Q15_16::fromFloat(-2.5f).floor());
+  TEST_ASSERT_TRUE(Q15_16::fromInt(40000) == Q15_16::max());
+  TEST_ASSERT_TRUE(Q15_16::fromFloat(-1e9f) == Q15_16::min());
+}
+
+void test_convert_between_formats() {
+  TEST_ASSERT_TRUE((Q15_16::fromFloat(300.5f).convert<7, 8>() == Q7_8::max()));
+  TEST_ASSERT_TRUE((Q15_16::fromFloat(-300.5f).convert<7, 8>() == Q7_8::min()));
+  TEST_ASSERT_EQUAL_FLOAT(-1.25f, (Q15_16::fromFloat(-1.25f).convert<7, 8>().toFloat()));
+  TEST_ASSERT_EQUAL_FLOAT(-1.25f, (Q7_8::fromFloat(-1.25f).convert<15, 16>().toFloat()));
+}
+
+static double saturated(double value) {
+  return fmin(fmax(value, Q15_16::RAW_MIN / 65536.0), Q15_16::RAW_MAX / 65536.0);
+}
+
+void test_matches_double_within_half_lsb() {
+  const double lsb = 1 / 65536.0;
+  double maxError = 0;
+  uint32_t seed = 1;
+
+  for (int i = 0; i < 200000; i++) {
+    seed = seed * 1664525 + 1013904223;
+    float a = ((seed >> 8) / 16777216.0f - 0.5f) * 400;
+    seed = seed * 1664525 + 1013904223;
+    float b = ((seed >> 8) / 16777216.0f - 0.5f) * 400;
+
+    Q15_16 fa = Q15_16::fromFloat(a);
+    Q15_16 fb = Q15_16::fromFloat(b);
+    double da = fa.getRaw() * lsb;
+    double db = fb.getRaw() * lsb;
+
+    maxError = fmax(maxError, fabs((fa + fb).getRaw() * lsb - saturated(da + db)));
+    maxError = fmax(maxError, fabs((fa - fb).getRaw() * lsb - saturated(da - db)));
+    maxError = fmax(maxError, fabs((fa * fb).getRaw() * lsb - saturated(da * db)));
+    if (fb.getRaw() != 0) {
+      maxError = fmax(maxError, fabs((fa / fb).getRaw() * lsb - saturated(da / db)));
+    }
+  }
+
+  TEST_ASSERT_TRUE(maxError <= lsb / 2);
+}
+
+void test_pulse_conversion_matches_float() {
+  // same conversion as WheelController.
+  const float pulsesPerCentimeter = 90 / (190 * M_PI / 10);
+  const float pulsesPerDegree = 27 * M_PI / 360 * pulsesPerCentimeter;
+  const Q21_10 fixedPerCentimeter = Q21_10::fromFloat(pulsesPerCentimeter);
+  const Q21_10 fixedPerDegree = Q21_10::fromFloat(pulsesPerDegree);
+
+  for (int32_t degrees = 0; degrees <= 360; degrees++) {
+    TEST_ASSERT_INT_WITHIN(1, lroundf(degrees * pulsesPerDegree), (fixedPerDegree * degrees).toInt());
+  }
+  for (int32_t centimeters = 0; centimeters <= 10000; centimeters++) {
+    TEST_ASSERT_INT_WITHIN(1, lroundf(centimeters * pulsesPerCentimeter), (fixedPerCentimeter * centimeters).toInt());
+  }
+}
+
+/**
+* Not a pass/fail test, just reports how a first order low-pass filter compares to float on this computer.
+*/
+void test_benchmark_against_float() {
+  const int SAMPLES = 1 << 16;
+  const int ROUNDS = 50;
+  static float floatInput[SAMPLES];
+  static Q15_16 fixedInput[SAMPLES];
+  for (int i = 0; i < SAMPLES; i++) {
+    floatInput[i] = 2.0f * i / SAMPLES;
+    fixedInput[i] = Q15_16::fromFloat(floatInput[i]);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  volatile float floatState = 0;
+  for (int round = 0; round < ROUNDS; round++) {
+    float state = floatState;
+    for (int i = 0; i < SAMPLES; i++) {
+      state = state * 0.9f + floatInput[i] * 0.1f;
+    }
+    floatState = state;
+  }
+  auto middle = std::chrono::steady_clock::now();
+
+  const Q15_16 keep = Q15_16::fromFloat(0.9f);
+  const Q15_16 gain = Q15_16::fromFloat(0.1f);
+  Q15_16 fixedState;
+  volatile int32_t sink = 0;
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int i = 0; i < SAMPLES; i++) {
+      fixedState = fixedState * keep + fixedInput[i] * gain;
+    }
+    sink = fixedState.getRaw();
+  }
+  auto end = std::chrono::steady_clock::now();
+  (void)sink;
+
+  char message[100];
+  snprintf(message, sizeof(message), "low-pass filter step, float: %.2f ns, Fixed<15, 16>: %.2f ns",
+           std::chrono::duration<double, std::nano>(middle - start).count() / SAMPLES / ROUNDS,
+           std::chrono::duration<double, std::nano>(end - middle).count() / SAMPLES / ROUNDS);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, floatState, fixedState.toFloat());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_addition_saturates);
+  RUN_TEST(test_subtraction_and_negation_saturate);
+  RUN_TEST(test_multiplication_saturates);
+  RUN_TEST(test_division_saturates);
+  RUN_TEST(test_rounding);
+  RUN_TEST(test_convert_between_formats);
+  RUN_TEST(test_matches_double_within_half_lsb);
+  RUN_TEST(test_pulse_conversion_matches_float);
+  RUN_TEST(test_benchmark_against_float);
+  return UNITY_END();
+}
@@ -0,0 +1,184 @@
+#include <unity.h>
+#include "flash_ring.h"
+
+static const uint16_t RECORD_SIZE = 8;
+static const uint32_t CAPACITY = 16;
+
+fs::FS* fileSystem;
+
+void setUp() {
+  fileSystem = new fs::FS();
+}
+
+void tearDown() {
+  delete fileSystem;
+}
+
+void makeRecord(uint32_t value, uint8_t* record) {
+  for (uint8_t i = 0; i < RECORD_SIZE; i++) {
+    record[i] = value + i;
+  }
+}
+
+void assertRecord(uint32_t value, FlashRing& ring, uint32_t position) {
+  uint8_t expected[RECORD_SIZE];
+  uint8_t record[RECORD_SIZE];
+
+  makeRecord(value, expected);
+  TEST_ASSERT_TRUE(ring.read(position, record));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, record, RECORD_SIZE);
+}
+
+void pushRecords(FlashRing& ring, uint32_t from, uint32_t count) {
+  uint8_t record[RECORD_SIZE];
+
+  for (uint32_t i = from; i < from + count; i++) {
+    makeRecord(i, record);
+    TEST_ASSERT_TRUE(ring.push(record));
+  }
+}
+
+void test_push_and_read() {
+  FlashRing ring(*fileSystem, "/ring.bin", RECORD_SIZE, CAPACITY);
+  TEST_ASSERT_TRUE(ring.begin());
+
+  pushRecords(ring, 0, 5);
+
+  TEST_ASSERT_EQUAL(5, ring.size());
+  TEST_ASSERT_EQUAL(0, ring.getFirst());
+  assertRecord(0, ring, 0);
+  assertRecord(4, ring, 4);
+
+  uint8_t record[RECORD_SIZE];
+  TEST_ASSERT_FALSE(ring.read(5, record));
+}
+
+void test_full_ring_overwrites_oldest() {
+  FlashRing ring(*fileSystem, "/ring.bin", RECORD_SIZE, CAPACITY);
+  ring.begin();
+
+  pushRecords(ring, 0, CAPACITY + 3);
+
+  TEST_ASSERT_EQUAL(CAPACITY, ring.size());
+  TEST_ASSERT_EQUAL(3, ring.getFirst());
+  TEST_ASSERT_EQUAL(3, ring.getOverwritten());
+  assertRecord(3, ring, 0);
+  assertRecord(CAPACITY + 2, ring, CAPACITY - 1);
+}
+
+void test_discard_until_index() {
+  FlashRing ring(*fileSystem, "/ring.bin", RECORD_SIZE, CAPACITY);
+  ring.begin();
+  pushRecords(ring, 0, 10);
+
+  ring.discardUntil(4);
+  TEST_ASSERT_EQUAL(6, ring.size());
+  assertRecord(4, ring, 0);
+
+  // older than what's left, nothing happens.
+  ring.discardUntil(2);
+  TEST_ASSERT_EQUAL(6, ring.size());
+
+  ring.discardUntil(100);
+  TEST_ASSERT_EQUAL(0, ring.size());
+  TEST_ASSERT_EQUAL(10, ring.getFirst());
+}
+
+void test_survives_restart() {
+  {
+    FlashRing ring(*fileSystem, "/ring.bin", RECORD_SIZE, CAPACITY);
+    ring.begin();
+    pushRecords(ring, 0, 10);
+    ring.discardUntil(3);
+    pushRecords(ring, 10, 2);
+  }
+
+  FlashRing ring(*fileSystem, "/ring.bin", RECORD_SIZE, CAPACITY);
+  TEST_ASSERT_TRUE(ring.begin());
+
+  TEST_ASSERT_EQUAL(9, ring.size());
+  TEST_ASSERT_EQUAL(3, ring.getFirst());
+  assertRecord(3, ring, 0);
+  assertRecord(11, ring, 8);
+}
+
+void test_survives_restart_after_wrapping() {
+  {
+    FlashRing ring(*fileSystem, "/ring.bin", RECORD_SIZE, CAPACITY);
+    ring.begin();
+    pushRecords(ring, 0, CAPACITY * 3 + 5);
+  }
+
+  FlashRing ring(*fileSystem, "/ring.bin", RECORD_SIZE, CAPACITY);
+  ring.begin();
+
+  TEST_ASSERT_EQUAL(CAPACITY, ring.size());
+  TEST_ASSERT_EQUAL(CAPACITY * 2 + 5, ring.getFirst());
+  assertRecord(CAPACITY * 2 + 5, ring, 0);
+  assertRecord(CAPACITY * 3 + 4, ring, CAPACITY - 1);
+
+  // carries on where it left off.
+  pushRecords(ring, CAPACITY * 3 + 5, 1);
+  TEST_ASSERT_EQUAL(CAPACITY * 2 + 6, ring.getFirst());
+  assertRecord(CAPACITY * 3 + 5, ring, CAPACITY - 1);
+}
+
+void test_push_does_not_write_header() {
+  FlashRing ring(*fileSystem, "/ring.bin", RECORD_SIZE, CAPACITY);
+  ring.begin();
+  auto& file = *fileSystem->files["/ring.bin"];
+  auto headerWrites = file.writeCount[0];
+
+  pushRecords(ring, 0, CAPACITY * 10);
+
+  TEST_ASSERT_EQUAL(headerWrites, file.writeCount[0]);
+  // every slot worn evenly, once for creating the file and once per lap.
+  for (uint32_t i = 16; i < file.writeCount.size(); i++) {
+    TEST_ASSERT_EQUAL(11, file.writeCount[i]);
+  }
+}
+
+void test_torn_record_is_not_trusted() {
+  {
+    FlashRing ring(*fileSystem, "/ring.bin", RECORD_SIZE, CAPACITY);
+    ring.begin();
+    pushRecords(ring, 0, 6);
+  }
+
+  // power lost while record 3 was rewritten, its sequence number is garbage. Only what follows without a gap is kept.
+  auto& file = *fileSystem->files["/ring.bin"];
+  file.bytes[16 + 3 * (4 + RECORD_SIZE)] = 0xAA;
+
+  FlashRing ring(*fileSystem, "/ring.bin", RECORD_SIZE, CAPACITY);
+  ring.begin();
+
+  TEST_ASSERT_EQUAL(2, ring.size());
+  TEST_ASSERT_EQUAL(4, ring.getFirst());
+  assertRecord(4, ring, 0);
+}
+
+void test_other_settings_creates_new() {
+  {
+    FlashRing ring(*fileSystem, "/ring.bin", RECORD_SIZE, CAPACITY);
+    ring.begin();
+    pushRecords(ring, 0, 6);
+  }
+
+  FlashRing ring(*fileSystem, "/ring.bin", RECORD_SIZE, CAPACITY * 2);
+  TEST_ASSERT_TRUE(ring.begin());
+
+  TEST_ASSERT_EQUAL(0, ring.size());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_push_and_read);
+  RUN_TEST(test_full_ring_overwrites_oldest);
+  RUN_TEST(test_discard_until_index);
+  RUN_TEST(test_survives_restart);
+  RUN_TEST(test_survives_restart_after_wrapping);
+  RUN_TEST(test_push_does_not_write_header);
+  RUN_TEST(test_torn_record_is_not_trusted);
+  RUN_TEST(test_other_settings_creates_new);
+  return UNITY_END();
+}
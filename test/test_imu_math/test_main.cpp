@@ -0,0 +1,181 @@
+#include <unity.h>
+#include <Arduino.h>
+#include "vector.h"
+#include "matrix.h"
+#include "quaternion.h"
+
+// element-wise operations are constexpr, checked at compile time.
+static constexpr imu::Vector<3> A(1, 2, 3);
+static constexpr imu::Vector<3> B(4, -5, 6);
+static_assert((A + B).z() == 9 && (A - B).y() == 7 && (A * 2).x() == 2 && A.invert().y() == -2, "Vector element-wise operations");
+static_assert(A.dot(B) == 12, "Vector dot product");
+static_assert((imu::Matrix<3>::identity() * A).y() == 2, "Matrix identity");
+static_assert(imu::Quaternion().toMatrix()(1, 1) == 1 && imu::Quaternion().toMatrix()(0, 1) == 0, "No rotation is identity matrix");
+
+static const float HALF_SQRT2 = 0.70710678f;
+
+void setUp() {
+  randomSeed(11);
+}
+
+void tearDown() { }
+
+void assertVector(float x, float y, float z, const imu::Vector<3>& v, float delta = 1e-6) {
+  TEST_ASSERT_FLOAT_WITHIN(delta, x, v.x());
+  TEST_ASSERT_FLOAT_WITHIN(delta, y, v.y());
+  TEST_ASSERT_FLOAT_WITHIN(delta, z, v.z());
+}
+
+/**
+* Random unit quaternion, components uniform in -1..1 before normalizing.
+*/
+imu::Quaternion randomRotation() {
+  imu::Quaternion q(random(-1000000, 1000001) / 1e6f, random(-1000000, 1000001) / 1e6f, random(-1000000, 1000001) / 1e6f, random(-1000000, 1000001) / 1e6f);
+  q.normalize();
+
+  return q;
+}
+
+void test_vector() {
+  auto v = A;
+  v += B;
+  assertVector(5, -3, 9, v);
+  v -= B;
+  assertVector(1, 2, 3, v);
+  assertVector(0.5, 1, 1.5, A / 2);
+
+  TEST_ASSERT_EQUAL_FLOAT(5, imu::Vector<2>(3, 4).magnitude());
+  TEST_ASSERT_EQUAL(2, imu::Vector<2>().n());
+  TEST_ASSERT_EQUAL_FLOAT(0, imu::Vector<2>().magnitude());
+
+  // x cross y is z, and the cross product is perpendicular to both.
+  assertVector(0, 0, 1, imu::Vector<3>(1, 0, 0).cross(imu::Vector<3>(0, 1, 0)));
+  auto cross = A.cross(B);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 0, cross.dot(A));
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 0, cross.dot(B));
+
+  v = A;
+  v.toRadians();
+  v.toDegrees();
+  assertVector(1, 2, 3, v, 1e-5);
+}
+
+void test_normalize() {
+  auto v = B;
+  v.normalize();
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1, v.magnitude());
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 4 / B.magnitude(), v.x());
+
+  // a zero vector has no direction, it's left as it is.
+  imu::Vector<3> zero;
+  zero.normalize();
+  assertVector(0, 0, 0, zero);
+}
+
+void test_matrix() {
+  auto m = imu::Matrix<3>(imu::detail::Elements(), 1, 2, 3, 4, 5, 6, 7, 8, 10);
+
+  assertVector(14, 32, 53, m * A);
+  assertVector(2, 5, 8, m.col_to_vector(1));
+  assertVector(7, 8, 10, m.row_to_vector(2));
+  TEST_ASSERT_EQUAL_FLOAT(4, m.transpose()(0, 1));
+  TEST_ASSERT_EQUAL_FLOAT(0, (m - m)(2, 2));
+  TEST_ASSERT_EQUAL_FLOAT(20, (m + m)(2, 2));
+  TEST_ASSERT_EQUAL_FLOAT(30, (m * 3.0f)(2, 2));
+
+  // row times column.
+  auto product = m * m.transpose();
+  TEST_ASSERT_EQUAL_FLOAT(1 * 7 + 2 * 8 + 3 * 10, product(0, 2));
+  TEST_ASSERT_EQUAL_FLOAT(7 * 7 + 8 * 8 + 10 * 10, product(2, 2));
+
+  auto same = m * imu::Matrix<3>::identity();
+  for (uint8_t i = 0; i < 9; i++) {
+    TEST_ASSERT_EQUAL_FLOAT(m(i / 3, i % 3), same(i / 3, i % 3));
+  }
+}
+
+void test_quaternion_rotation() {
+  // 90 degrees around z takes x to y.
+  imu::Quaternion quarter(HALF_SQRT2, 0, 0, HALF_SQRT2);
+  assertVector(0, 1, 0, quarter.rotateVector(imu::Vector<3>(1, 0, 0)));
+
+  // twice is half a turn, and conjugate turns back.
+  assertVector(-1, 0, 0, (quarter * quarter).rotateVector(imu::Vector<3>(1, 0, 0)));
+  assertVector(1, 2, 3, quarter.conjugate().rotateVector(quarter.rotateVector(A)), 1e-5);
+
+  // product applies right hand side first.
+  imu::Quaternion aroundX(HALF_SQRT2, HALF_SQRT2, 0, 0);
+  auto expected = quarter.rotateVector(aroundX.rotateVector(A));
+  assertVector(expected.x(), expected.y(), expected.z(), (quarter * aroundX).rotateVector(A), 1e-5);
+
+  TEST_ASSERT_EQUAL_FLOAT(HALF_SQRT2, imu::Quaternion(HALF_SQRT2, imu::Vector<3>(0, 0, HALF_SQRT2)).vector().z());
+}
+
+void test_quaternion_normalize() {
+  imu::Quaternion q(1, 2, 3, 4);
+  q.normalize();
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1, q.magnitude());
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 2 / sqrtf(30), q.x());
+
+  imu::Quaternion zero(0, 0, 0, 0);
+  zero.normalize();
+  TEST_ASSERT_EQUAL_FLOAT(0, zero.w());
+}
+
+void test_rotation_matrix_is_orthonormal() {
+  float maxError = 0;
+
+  for (uint16_t i = 0; i < 10000; i++) {
+    auto rotation = randomRotation().toMatrix();
+    auto product = rotation * rotation.transpose();
+
+    for (uint8_t cell = 0; cell < 9; cell++) {
+      maxError = max(maxError, fabsf(product(cell / 3, cell % 3) - (cell / 3 == cell % 3 ? 1 : 0)));
+    }
+  }
+
+  // normalize() and nine products each round, a few float epsilons (1.2e-7) is all it should be.
+  TEST_ASSERT_LESS_THAN_FLOAT(4e-6, maxError);
+}
+
+/**
+* IO_Accelerometer used to write out the Euler and gravity terms from the quaternion components by hand, toMatrix() should give the same.
+*/
+void test_matches_hand_written_euler_terms() {
+  float maxError = 0;
+
+  for (uint32_t i = 0; i < 100000; i++) {
+    auto q = randomRotation();
+    auto rotation = q.toMatrix();
+    float q1 = q.w(), q2 = q.x(), q3 = q.y(), q4 = q.z();
+
+    float a12 = 2.0f * (q2 * q3 + q1 * q4);
+    float a22 = q1 * q1 + q2 * q2 - q3 * q3 - q4 * q4;
+    float a31 = 2.0f * (q1 * q2 + q3 * q4);
+    float a32 = 2.0f * (q2 * q4 - q1 * q3);
+    float a33 = q1 * q1 - q2 * q2 - q3 * q3 + q4 * q4;
+
+    maxError = max(maxError, fabsf(a12 - rotation(1, 0)));
+    maxError = max(maxError, fabsf(a22 - rotation(0, 0)));
+    maxError = max(maxError, fabsf(a31 - rotation(2, 1)));
+    maxError = max(maxError, fabsf(a32 - rotation(2, 0)));
+    maxError = max(maxError, fabsf(a33 - rotation(2, 2)));
+  }
+
+  char message[60];
+  sprintf(message, "max difference %.1e", maxError);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_LESS_THAN_FLOAT(1e-6, maxError);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_vector);
+  RUN_TEST(test_normalize);
+  RUN_TEST(test_matrix);
+  RUN_TEST(test_quaternion_rotation);
+  RUN_TEST(test_quaternion_normalize);
+  RUN_TEST(test_rotation_matrix_is_orthonormal);
+  RUN_TEST(test_matches_hand_written_euler_terms);
+  return UNITY_END();
+}
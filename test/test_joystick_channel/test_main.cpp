@@ -0,0 +1,245 @@
+#include <unity.h>
+#include <vector>
+#include "joystick_channel.h"
+
+static const uint32_t PROCESS_INTERVAL = 10;  // main loop runs the channel about this often (ms).
+
+/**
+* Wired up the same way as in main.cpp, with the real wheels and wheel controller.
+*/
+struct Mower {
+  Wheel leftWheel;
+  Wheel rightWheel;
+  WheelController wheelController;
+  JoystickChannel joystick;
+
+  Mower() :
+    leftWheel(1, Definitions::LEFT_WHEEL_MOTOR_PIN, Definitions::LEFT_WHEEL_MOTOR_DIRECTION_PIN, Definitions::LEFT_WHEEL_ODOMETER_PIN, Definitions::LEFT_WHEEL_MOTOR_INVERTED, Definitions::LEFT_WHEEL_MOTOR_SPEED),
+    rightWheel(2, Definitions::RIGHT_WHEEL_MOTOR_PIN, Definitions::RIGHT_WHEEL_MOTOR_DIRECTION_PIN, Definitions::RIGHT_WHEEL_ODOMETER_PIN, Definitions::RIGHT_WHEEL_MOTOR_INVERTED, Definitions::RIGHT_WHEEL_MOTOR_SPEED),
+    wheelController(leftWheel, rightWheel),
+    joystick(wheelController) { }
+};
+
+Mower* mower;
+Wheel* leftWheel;
+Wheel* rightWheel;
+JoystickChannel* joystick;
+
+void setUp() {
+  Native::setMillis(1000);
+  randomSeed(7);
+  mower = new Mower();
+  leftWheel = &mower->leftWheel;
+  rightWheel = &mower->rightWheel;
+  joystick = &mower->joystick;
+  joystick->reset();
+}
+
+void tearDown() {
+  delete mower;
+}
+
+std::vector<uint8_t> makeFrame(uint16_t sequence, int8_t speed, int8_t turnrate) {
+  return { JoystickChannel::JOYSTICK_FRAME, (uint8_t)(sequence & 0xFF), (uint8_t)(sequence >> 8), (uint8_t)speed, (uint8_t)turnrate };
+}
+
+bool send(uint16_t sequence, int8_t speed, int8_t turnrate = 0) {
+  auto frame = makeFrame(sequence, speed, turnrate);
+  return joystick->onFrame(frame.data(), frame.size());
+}
+
+/**
+* Let time pass, processing the channel the way the main loop does.
+*/
+void run(uint32_t duration) {
+  for (uint32_t elapsed = 0; elapsed < duration; elapsed += PROCESS_INTERVAL) {
+    Native::advanceMillis(PROCESS_INTERVAL);
+    joystick->process();
+  }
+}
+
+void test_malformed_frames_rejected() {
+  auto frame = makeFrame(1, 50, 0);
+
+  TEST_ASSERT_FALSE(joystick->onFrame(frame.data(), frame.size() - 1));
+  frame[0] = 99;
+  TEST_ASSERT_FALSE(joystick->onFrame(frame.data(), frame.size()));
+  TEST_ASSERT_EQUAL(0, joystick->getStatistics().framesReceived);
+}
+
+void test_out_of_order_and_lost_frames() {
+  TEST_ASSERT_TRUE(send(10, 50));
+  TEST_ASSERT_TRUE(send(13, 50));
+  TEST_ASSERT_FALSE(send(12, 50));
+  TEST_ASSERT_FALSE(send(13, 50));
+
+  auto& statistics = joystick->getStatistics();
+  TEST_ASSERT_EQUAL(2, statistics.framesReceived);
+  TEST_ASSERT_EQUAL(2, statistics.framesOutOfOrder);
+  TEST_ASSERT_EQUAL(2, statistics.framesLost);
+}
+
+void test_sequence_wraps_around() {
+  TEST_ASSERT_TRUE(send(65535, 50));
+  TEST_ASSERT_TRUE(send(0, 50));
+  TEST_ASSERT_FALSE(send(65534, 50));
+  TEST_ASSERT_EQUAL(0, joystick->getStatistics().framesLost);
+}
+
+void test_acceleration_is_limited() {
+  send(1, 100);
+
+  run(PROCESS_INTERVAL);
+  TEST_ASSERT_EQUAL(2, leftWheel->getSpeed());    // 250 %/s for 10 ms.
+
+  run(90);
+  TEST_ASSERT_EQUAL(25, leftWheel->getSpeed());
+  TEST_ASSERT_EQUAL(25, rightWheel->getSpeed());
+
+  // keep setpoints coming, the dead-man would stop us otherwise.
+  for (uint16_t sequence = 2; sequence < 10; sequence++) {
+    send(sequence, 100);
+    run(50);
+  }
+  TEST_ASSERT_EQUAL(100, leftWheel->getSpeed());
+}
+
+void test_turning_slows_inner_wheel() {
+  for (uint16_t sequence = 1; sequence < 20; sequence++) {
+    send(sequence, 80, -50);
+    run(40);
+  }
+
+  TEST_ASSERT_EQUAL(40, leftWheel->getSpeed());
+  TEST_ASSERT_EQUAL(80, rightWheel->getSpeed());
+
+  for (uint16_t sequence = 20; sequence < 40; sequence++) {
+    send(sequence, -80, 100);
+    run(40);
+  }
+
+  TEST_ASSERT_EQUAL(-80, leftWheel->getSpeed());
+  TEST_ASSERT_EQUAL(0, rightWheel->getSpeed());
+}
+
+void test_deadman_stops_wheels() {
+  send(1, 100);
+  run(200);
+  send(2, 100);
+  run(JoystickChannel::DEADMAN_TIMEOUT);
+  TEST_ASSERT_NOT_EQUAL(0, leftWheel->getSpeed());
+  TEST_ASSERT_FALSE(joystick->hasTimedOut());
+
+  run(PROCESS_INTERVAL);
+  TEST_ASSERT_EQUAL(0, leftWheel->getSpeed());
+  TEST_ASSERT_EQUAL(0, rightWheel->getSpeed());
+  TEST_ASSERT_TRUE(joystick->hasTimedOut());
+  TEST_ASSERT_EQUAL(1, joystick->getStatistics().deadmanStops);
+
+  // stays stopped until the client is back, then starts over from standstill.
+  run(1000);
+  TEST_ASSERT_EQUAL(1, joystick->getStatistics().deadmanStops);
+  send(3, 100);
+  TEST_ASSERT_FALSE(joystick->hasTimedOut());
+  run(PROCESS_INTERVAL);
+  TEST_ASSERT_EQUAL(2, leftWheel->getSpeed());
+}
+
+void test_disconnect_stops_right_away() {
+  send(1, 100);
+  run(200);
+
+  joystick->onDisconnect();
+  TEST_ASSERT_EQUAL(0, leftWheel->getSpeed());
+  TEST_ASSERT_TRUE(joystick->hasTimedOut());
+}
+
+void test_command_latency() {
+  send(1, 50);
+  Native::advanceMillis(4);
+  run(PROCESS_INTERVAL);
+
+  auto& statistics = joystick->getStatistics();
+  TEST_ASSERT_EQUAL(1, statistics.commands);
+  TEST_ASSERT_EQUAL(PROCESS_INTERVAL + 4, statistics.commandLatency);
+  TEST_ASSERT_EQUAL(PROCESS_INTERVAL + 4, statistics.maxCommandLatency);
+}
+
+/**
+* Client streams full forward at 25 Hz for 2 s over a network with 5-65 ms delay (so frames get reordered) that loses 10% of them,
+* then goes away without saying so. The mower must start moving within network delay plus one loop, and stop within
+* DEADMAN_TIMEOUT of the last frame that got through.
+*/
+void test_stream_over_lossy_network() {
+  static const uint32_t FRAME_INTERVAL = 40;
+  static const uint32_t STREAM_DURATION = 2000;
+  static const uint32_t MIN_DELAY = 5;
+  static const uint32_t MAX_DELAY = 65;
+
+  struct packet {
+    uint32_t arrival;
+    uint16_t sequence;
+  };
+  std::vector<packet> network;
+  auto start = millis();
+  uint32_t lastSent = 0;
+
+  for (uint32_t sent = 0; sent <= STREAM_DURATION; sent += FRAME_INTERVAL) {
+    // first and last always get through, so that start and stop can be measured.
+    if (sent > 0 && sent < STREAM_DURATION && random(100) < 10) {
+      continue;
+    }
+    network.push_back({ start + sent + (uint32_t)random(MIN_DELAY, MAX_DELAY + 1), (uint16_t)(sent / FRAME_INTERVAL + 1) });
+    lastSent = start + sent;
+  }
+
+  uint32_t firstMove = 0;
+  uint32_t stopped = 0;
+  uint32_t lastArrival = 0;
+
+  for (uint32_t now = start; now < start + STREAM_DURATION + 1000; now++) {
+    Native::setMillis(now);
+
+    for (auto& packet : network) {
+      if (packet.arrival == now && send(packet.sequence, 100)) {
+        lastArrival = now;
+      }
+    }
+
+    if ((now - start) % PROCESS_INTERVAL == 0) {
+      joystick->process();
+    }
+
+    if (firstMove == 0 && leftWheel->getSpeed() != 0) {
+      firstMove = now;
+    }
+    if (firstMove != 0 && stopped == 0 && leftWheel->getSpeed() == 0) {
+      stopped = now;
+    }
+  }
+
+  auto& statistics = joystick->getStatistics();
+  TEST_ASSERT_GREATER_THAN(0, statistics.framesLost);
+  TEST_ASSERT_LESS_OR_EQUAL(PROCESS_INTERVAL, statistics.maxCommandLatency);
+  TEST_ASSERT_EQUAL(1, statistics.deadmanStops);
+
+  TEST_ASSERT_NOT_EQUAL(0, firstMove);
+  TEST_ASSERT_LESS_OR_EQUAL(MAX_DELAY + PROCESS_INTERVAL, firstMove - start);
+  TEST_ASSERT_NOT_EQUAL(0, stopped);
+  TEST_ASSERT_LESS_OR_EQUAL(JoystickChannel::DEADMAN_TIMEOUT + PROCESS_INTERVAL, stopped - lastArrival);
+  TEST_ASSERT_LESS_OR_EQUAL(MAX_DELAY + JoystickChannel::DEADMAN_TIMEOUT + PROCESS_INTERVAL, stopped - lastSent);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_malformed_frames_rejected);
+  RUN_TEST(test_out_of_order_and_lost_frames);
+  RUN_TEST(test_sequence_wraps_around);
+  RUN_TEST(test_acceleration_is_limited);
+  RUN_TEST(test_turning_slows_inner_wheel);
+  RUN_TEST(test_deadman_stops_wheels);
+  RUN_TEST(test_disconnect_stops_right_away);
+  RUN_TEST(test_command_latency);
+  RUN_TEST(test_stream_over_lossy_network);
+  return UNITY_END();
+}
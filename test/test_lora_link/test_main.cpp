@@ -0,0 +1,239 @@
+#include <unity.h>
+#include <deque>
+#include <vector>
+#include "dockingstation/lora_link.h"
+
+/**
+* Stand-in for a LoRa radio, packets arrive at the peer when their airtime has passed. A share of them can be lost on the way.
+*/
+class TestRadio : public Radio {
+  public:
+    TestRadio* peer = nullptr;
+    uint8_t lossPercent = 0;
+    std::deque<std::vector<uint8_t>> inbox;
+    uint32_t packetsSent = 0;
+
+    TestRadio() {
+      settings = {125, 7, 5, 10, 8};
+    }
+
+    bool startTransmit(const uint8_t* data, size_t length) override {
+      transmitting = true;
+      transmitEnd = millis() + getAirtime(settings, length) / 1000 + 1;
+      packet.assign(data, data + length);
+      packetsSent++;
+      return true;
+    }
+
+    bool isTransmitting() override {
+      if (transmitting && (int32_t)(millis() - transmitEnd) >= 0) {
+        transmitting = false;
+        if ((uint32_t)random(100) >= lossPercent) {
+          peer->inbox.push_back(packet);
+        }
+      }
+      return transmitting;
+    }
+
+    size_t readPacket(uint8_t* data, size_t size) override {
+      if (inbox.empty()) {
+        return 0;
+      }
+      size_t length = min(size, inbox.front().size());
+      memcpy(data, inbox.front().data(), length);
+      inbox.pop_front();
+      return length;
+    }
+
+    float getLastSNR() const override { return 5; }
+    float getLastRSSI() const override { return -90; }
+    const RadioSettings& getSettings() const override { return settings; }
+    bool applySettings(const RadioSettings& newSettings) override {
+      settings = newSettings;
+      return true;
+    }
+
+  private:
+    RadioSettings settings;
+    bool transmitting = false;
+    uint32_t transmitEnd = 0;
+    std::vector<uint8_t> packet;
+};
+
+static const uint16_t MOWER = 1;
+static const uint16_t STATION = 2;
+
+/**
+* A mower and a station talking to each other over two test radios.
+*/
+struct Link {
+  TestRadio mowerRadio;
+  TestRadio stationRadio;
+  LoraLink mower{mowerRadio, MOWER, STATION, 10};
+  LoraLink station{stationRadio, STATION, MOWER, 10};
+
+  Link() {
+    mowerRadio.peer = &stationRadio;
+    stationRadio.peer = &mowerRadio;
+  }
+};
+
+static Link* radioLink;
+static std::vector<std::vector<uint8_t>> received;
+
+void setUp() {
+  Native::setMillis(1000);
+  randomSeed(42);
+  radioLink = new Link();
+  received.clear();
+  radioLink->station.onReceive([](const uint8_t* data, size_t length, uint16_t, LINK_PRIORITY) {
+    received.emplace_back(data, data + length);
+  });
+}
+
+void tearDown() {
+  delete radioLink;
+}
+
+static void run(uint32_t ms) {
+  for (uint32_t i = 0; i < ms; i++) {
+    Native::advanceMillis(1);
+    radioLink->mower.process();
+    radioLink->station.process();
+  }
+}
+
+static std::vector<uint8_t> makeMessage(size_t length, uint8_t seed) {
+  std::vector<uint8_t> message(length);
+  for (size_t i = 0; i < length; i++) {
+    message[i] = seed + i * 7;
+  }
+  return message;
+}
+
+/**
+* Put a data frame directly on the air to the station, as if from the mower.
+*/
+static void injectFrame(uint8_t sequence, uint8_t messageId, uint8_t fragment, uint8_t fragmentCountMinusOne, size_t payloadLength) {
+  std::vector<uint8_t> frame(LoraLink::HEADER_SIZE + payloadLength, 0xAA);
+  frame[0] = STATION;
+  frame[1] = STATION >> 8;
+  frame[2] = MOWER;
+  frame[3] = MOWER >> 8;
+  frame[4] = 0;
+  frame[5] = sequence;
+  frame[6] = messageId;
+  frame[7] = (fragment << 4) | fragmentCountMinusOne;
+  radioLink->stationRadio.inbox.push_back(frame);
+}
+
+void test_small_message_is_delivered() {
+  auto message = makeMessage(20, 1);
+  bool delivered = false;
+
+  TEST_ASSERT_TRUE(radioLink->mower.send(message.data(), message.size(), LINK_PRIORITY::BULK, [&delivered](bool success) { delivered = success; }));
+  run(2000);
+
+  TEST_ASSERT_EQUAL(1, received.size());
+  TEST_ASSERT_TRUE(received[0] == message);
+  TEST_ASSERT_TRUE(delivered);
+  TEST_ASSERT_TRUE(radioLink->station.isConnected());
+}
+
+void test_large_message_is_fragmented_and_reassembled() {
+  auto message = makeMessage(LoraLink::MAX_MESSAGE_SIZE, 3);
+
+  TEST_ASSERT_TRUE(radioLink->mower.send(message.data(), message.size(), LINK_PRIORITY::BULK));
+  run(20000);
+
+  TEST_ASSERT_EQUAL(1, received.size());
+  TEST_ASSERT_TRUE(received[0] == message);
+  TEST_ASSERT_EQUAL(LoraLink::MAX_FRAGMENTS, radioLink->mower.getStatistics().framesSent - radioLink->mower.getStatistics().framesRetransmitted);
+}
+
+void test_too_large_message_is_refused() {
+  auto message = makeMessage(LoraLink::MAX_MESSAGE_SIZE + 1, 0);
+  TEST_ASSERT_FALSE(radioLink->mower.send(message.data(), message.size(), LINK_PRIORITY::BULK));
+}
+
+void test_messages_survive_lossy_radio() {
+  radioLink->mowerRadio.lossPercent = 20;
+  radioLink->stationRadio.lossPercent = 20;
+  std::vector<std::vector<uint8_t>> messages;
+
+  for (uint8_t i = 0; i < 10; i++) {
+    messages.push_back(makeMessage(100 + i * 60, i));
+    TEST_ASSERT_TRUE(radioLink->mower.send(messages.back().data(), messages.back().size(), LINK_PRIORITY::BULK));
+  }
+  run(60000);
+
+  TEST_ASSERT_EQUAL(messages.size(), received.size());
+  for (auto& message : messages) {
+    TEST_ASSERT_TRUE(std::find(received.begin(), received.end(), message) != received.end());
+  }
+  TEST_ASSERT_GREATER_THAN(0, radioLink->mower.getStatistics().framesRetransmitted);
+  TEST_ASSERT_EQUAL(10, radioLink->mower.getStatistics().messagesDelivered[static_cast<uint8_t>(LINK_PRIORITY::BULK)]);
+}
+
+void test_control_message_goes_before_queued_bulk() {
+  auto bulk = makeMessage(LoraLink::MAX_PAYLOAD_SIZE, 1);
+  uint8_t stop[] = {42};
+
+  for (int i = 0; i < 5; i++) {
+    radioLink->mower.send(bulk.data(), bulk.size(), LINK_PRIORITY::BULK);
+  }
+  radioLink->mower.send(stop, sizeof(stop), LINK_PRIORITY::CONTROL);
+  run(20000);
+
+  TEST_ASSERT_EQUAL(6, received.size());
+  TEST_ASSERT_EQUAL(1, received[0].size());
+  TEST_ASSERT_EQUAL(42, received[0][0]);
+}
+
+void test_duplicate_frame_is_delivered_once() {
+  injectFrame(10, 1, 0, 0, 5);
+  injectFrame(10, 1, 0, 0, 5);
+  run(100);
+
+  TEST_ASSERT_EQUAL(1, received.size());
+  TEST_ASSERT_EQUAL(1, radioLink->station.getStatistics().framesDuplicate);
+}
+
+void test_fragment_beyond_count_is_dropped() {
+  // fragment 15 of a 2 fragment message would be written far outside the reassembly buffer.
+  injectFrame(10, 1, 15, 1, LoraLink::MAX_PAYLOAD_SIZE);
+  injectFrame(11, 1, 0, 1, LoraLink::MAX_PAYLOAD_SIZE);
+  run(100);
+
+  TEST_ASSERT_EQUAL(0, received.size());
+  TEST_ASSERT_EQUAL(1, radioLink->station.getStatistics().framesMalformed);
+}
+
+void test_short_middle_fragment_is_dropped() {
+  injectFrame(10, 1, 0, 1, 10);
+  injectFrame(11, 1, 1, 1, 10);
+  run(100);
+
+  TEST_ASSERT_EQUAL(0, received.size());
+  TEST_ASSERT_EQUAL(1, radioLink->station.getStatistics().framesMalformed);
+
+  // a proper first fragment completes the message.
+  injectFrame(12, 1, 0, 1, LoraLink::MAX_PAYLOAD_SIZE);
+  run(100);
+
+  TEST_ASSERT_EQUAL(1, received.size());
+  TEST_ASSERT_EQUAL(LoraLink::MAX_PAYLOAD_SIZE + 10, received[0].size());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_small_message_is_delivered);
+  RUN_TEST(test_large_message_is_fragmented_and_reassembled);
+  RUN_TEST(test_too_large_message_is_refused);
+  RUN_TEST(test_messages_survive_lossy_radio);
+  RUN_TEST(test_control_message_goes_before_queued_bulk);
+  RUN_TEST(test_duplicate_frame_is_delivered_once);
+  RUN_TEST(test_fragment_beyond_count_is_dropped);
+  RUN_TEST(test_short_middle_fragment_is_dropped);
+  return UNITY_END();
+}
@@ -0,0 +1,255 @@
+#include <unity.h>
+#include <algorithm>
+#include <math.h>
+#include <vector>
+#include "lttb.h"
+#include "time_series.h"
+
+static const uint32_t SAMPLE_INTERVAL = 20;   // seconds, same as Battery.
+
+struct point {
+  float x;
+  float y;
+};
+
+std::vector<point> series;
+
+void setUp() {
+  randomSeed(5);
+  series.clear();
+}
+
+void tearDown() { }
+
+/**
+* Battery voltage every 20 s for some days: resting, sagging while mowing with a noisy cutter load, and rising while charging.
+*/
+void makeBatterySeries(uint32_t samples) {
+  float soc = 1;
+
+  for (uint32_t i = 0; i < samples; i++) {
+    uint32_t secondOfDay = i * SAMPLE_INTERVAL % 86400;
+    bool mowing = secondOfDay >= 9 * 3600 && secondOfDay < 17 * 3600 && soc > 0.05 && (secondOfDay / 60) % 180 < 90;
+    float current = mowing ? 2000 + random(0, 2001) : soc < 1 ? -1500 : 50;
+
+    soc = constrain(soc - current * SAMPLE_INTERVAL / 3600 / 4400, 0.0f, 1.0f);
+    float voltage = 12 + soc * 4.8f - current / 1000 * 0.12f;
+    series.push_back({ (float)(i * SAMPLE_INTERVAL), roundf(voltage * 100) / 100 });
+  }
+}
+
+std::vector<uint32_t> downsample(uint16_t points) {
+  Lttb lttb(series.size(), points);
+  std::vector<uint32_t> picked;
+
+  for (auto& p : series) {
+    lttb.addAverage(p.x, p.y);
+  }
+  for (auto& p : series) {
+    lttb.addCandidate(p.x, p.y);
+  }
+  for (uint32_t i = 0; i < series.size(); i++) {
+    if (lttb.isSelected(i)) {
+      picked.push_back(i);
+    }
+  }
+
+  return picked;
+}
+
+/**
+* Textbook LTTB with all points in memory and double precision, same bucket boundaries as Lttb.
+*/
+std::vector<uint32_t> downsampleInMemory(uint16_t points) {
+  uint32_t total = series.size();
+  uint32_t buckets = points - 2;
+  auto bucketStart = [&](uint32_t bucket) { return (uint32_t)(((uint64_t)bucket * (total - 2) + buckets - 1) / buckets) + 1; };
+  std::vector<uint32_t> picked = { 0 };
+
+  for (uint32_t bucket = 0; bucket < buckets; bucket++) {
+    uint32_t start = bucketStart(bucket);
+    uint32_t end = bucketStart(bucket + 1);
+    double nextX = series[total - 1].x;
+    double nextY = series[total - 1].y;
+
+    if (bucket + 1 < buckets) {
+      uint32_t nextEnd = bucketStart(bucket + 2);
+      nextX = nextY = 0;
+      for (uint32_t i = end; i < nextEnd; i++) {
+        nextX += series[i].x;
+        nextY += series[i].y;
+      }
+      nextX /= nextEnd - end;
+      nextY /= nextEnd - end;
+    }
+
+    auto& selected = series[picked.back()];
+    double bestArea = -1;
+    uint32_t best = start;
+    for (uint32_t i = start; i < end; i++) {
+      double area = fabs((selected.x - nextX) * (series[i].y - selected.y) - (selected.x - series[i].x) * (nextY - selected.y));
+      if (area > bestArea) {
+        bestArea = area;
+        best = i;
+      }
+    }
+    picked.push_back(best);
+  }
+  picked.push_back(total - 1);
+
+  return picked;
+}
+
+/**
+* How much of the min/max range of each time window the picked points cover, on average (0-1). A chart that keeps the peaks scores 1.
+*/
+float getRangeKept(const std::vector<uint32_t>& picked, uint16_t windows) {
+  float kept = 0;
+  uint32_t counted = 0;
+  uint32_t next = 0;
+
+  for (uint16_t window = 0; window < windows; window++) {
+    uint32_t start = (uint64_t)window * series.size() / windows;
+    uint32_t end = (uint64_t)(window + 1) * series.size() / windows;
+    float min = INFINITY, max = -INFINITY, pickedMin = INFINITY, pickedMax = -INFINITY;
+
+    for (uint32_t i = start; i < end; i++) {
+      min = fminf(min, series[i].y);
+      max = fmaxf(max, series[i].y);
+    }
+    for (; next < picked.size() && picked[next] < end; next++) {
+      pickedMin = fminf(pickedMin, series[picked[next]].y);
+      pickedMax = fmaxf(pickedMax, series[picked[next]].y);
+    }
+
+    if (max > min) {
+      kept += pickedMax > pickedMin ? (pickedMax - pickedMin) / (max - min) : 0;
+      counted++;
+    }
+  }
+
+  return kept / counted;
+}
+
+void test_small_series_is_not_downsampled() {
+  makeBatterySeries(50);
+  Lttb lttb(series.size(), 100);
+
+  TEST_ASSERT_FALSE(lttb.isDownsampling());
+  TEST_ASSERT_TRUE(lttb.isSelected(0));
+  TEST_ASSERT_TRUE(lttb.isSelected(49));
+  TEST_ASSERT_EQUAL(50, downsample(50).size());
+}
+
+void test_picks_requested_number_of_points() {
+  makeBatterySeries(1000);
+
+  for (uint16_t points : { 3, 10, 99, 500 }) {
+    auto picked = downsample(points);
+
+    TEST_ASSERT_EQUAL(points, picked.size());
+    TEST_ASSERT_EQUAL(0, picked.front());
+    TEST_ASSERT_EQUAL(999, picked.back());
+  }
+
+  // less than three points makes no sense, first and last are always kept.
+  TEST_ASSERT_EQUAL(3, downsample(1).size());
+}
+
+void test_keeps_spike() {
+  for (uint32_t i = 0; i < 1000; i++) {
+    series.push_back({ (float)i, i == 437 ? 11.5f : 16.0f });
+  }
+
+  auto picked = downsample(20);
+
+  TEST_ASSERT_TRUE(std::find(picked.begin(), picked.end(), 437) != picked.end());
+}
+
+void test_epoch_timestamps() {
+  // absolute epoch seconds don't fit in a float, TimeSeries passes time relative to first sample. Float precision is still enough for
+  // 20 s steps over the 3 days history covers.
+  makeBatterySeries(12554);
+
+  TEST_ASSERT_EQUAL_FLOAT(series.back().x, 12553.0f * SAMPLE_INTERVAL);
+  TEST_ASSERT_EQUAL(200, downsample(200).size());
+}
+
+void test_matches_in_memory_lttb() {
+  makeBatterySeries(12554);
+
+  for (uint16_t points : { 40, 200, 500, 1000 }) {
+    auto streamed = downsample(points);
+    auto reference = downsampleInMemory(points);
+    uint16_t matching = 0;
+
+    for (uint16_t i = 0; i < points; i++) {
+      matching += streamed[i] == reference[i];
+    }
+
+    char message[60];
+    sprintf(message, "%d points: %d match in-memory LTTB", points, matching);
+    TEST_MESSAGE(message);
+    // picks can differ when two candidates have the same area to float precision.
+    TEST_ASSERT_GREATER_OR_EQUAL(points * 0.98, matching);
+  }
+}
+
+void test_keeps_more_range_than_decimation() {
+  static const uint16_t POINTS = 500;
+  makeBatterySeries(12554);
+
+  std::vector<uint32_t> everyNth;
+  for (uint16_t i = 0; i < POINTS; i++) {
+    everyNth.push_back((uint64_t)i * (series.size() - 1) / (POINTS - 1));
+  }
+
+  float lttb = getRangeKept(downsample(POINTS), 100);
+  float decimated = getRangeKept(everyNth, 100);
+
+  char message[60];
+  sprintf(message, "range kept %.0f%%, every-nth %.0f%%", lttb * 100, decimated * 100);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_GREATER_THAN_FLOAT(decimated, lttb);
+}
+
+/**
+* The battery history chart asks for 500 points, compare with getting all of about three days of samples.
+*/
+void test_history_response_size() {
+  static const char* const names[3] = {"value", "current", "level"};
+  static const uint8_t decimals[3] = {2, 0, 1};
+  makeBatterySeries(12554);
+
+  fs::FS fileSystem;
+  FlashRing ring(fileSystem, "/battery.bin", 256, 256);
+  ring.begin();
+  TimeSeries history(ring, 256, 3);
+  history.begin();
+  for (auto& p : series) {
+    float values[3] = { p.y, 1000, 50 };
+    history.add(1600000000 + p.x, values);
+  }
+
+  StringPrint all;
+  history.printJson(all, names, decimals);
+  StringPrint downsampled;
+  history.printJson(downsampled, names, decimals, 500);
+
+  char message[60];
+  sprintf(message, "JSON %u kB -> %u kB", (uint32_t)all.output.size() / 1024, (uint32_t)downsampled.output.size() / 1024);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_LESS_THAN(all.output.size() / 20, downsampled.output.size());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_small_series_is_not_downsampled);
+  RUN_TEST(test_picks_requested_number_of_points);
+  RUN_TEST(test_keeps_spike);
+  RUN_TEST(test_epoch_timestamps);
+  RUN_TEST(test_matches_in_memory_lttb);
+  RUN_TEST(test_keeps_more_range_than_decimation);
+  RUN_TEST(test_history_response_size);
+  return UNITY_END();
+}
@@ -0,0 +1,376 @@
+#include <unity.h>
+#include <vector>
+#include "native_configuration.h"
+#include "cutter.h"
+
+static const uint8_t CUTTER_CHANNEL = 3;      // LEDC channel Cutter uses.
+static const float SPINUP_TIME = 0.3;         // seconds for blade to reach full speed at stall torque, sets inertia of blade.
+static const float BATTERY_VOLTAGE = 15;
+
+// shared by everything on the I2C bus, like in main.cpp.
+SemaphoreHandle_t i2cLock = xSemaphoreCreateMutex();
+
+/**
+* Blade on a brushed DC motor, wired up the same way as in main.cpp. Motor current follows the same model as CutterJamDetector uses:
+* stall current scaled by duty, minus back-EMF from blade speed. Air drag grows with the square of blade speed. Cutting grass takes power
+* in proportion to the area mowed per second (ground speed), whatever the blade speed, so a slower blade needs more torque (current).
+* Below the slowest speed that gives a clean cut grass is pushed over rather than cut, torque stops growing there.
+*/
+struct Mower {
+  IO_Analog io_analog;
+  Cutter cutter;
+
+  float bladeSpeed = 0;     // 0-1 of no-load rpm.
+  float current = 0;        // mA
+  float grass = 0;          // 0-1, part of max current it takes to cut the grass at full ground speed and slowest blade speed.
+  uint8_t groundSpeed = 0;  // 0-100%
+  double energy = 0;        // Wh drawn from battery by cutter.
+  bool stone = false;       // blade held still by a stone or root.
+  bool bladeMissing = false;
+  bool fuseOpen = false;
+  bool readBattery = false; // read battery voltage every second, like Battery does, which pauses continuous sampling.
+  uint32_t elapsed = 0;
+
+  Mower() : io_analog(i2cLock), cutter(io_analog) { }
+
+  void setGroundSpeed(uint8_t speed) {
+    groundSpeed = speed;
+    cutter.setGroundSpeed(speed);
+  }
+
+  float getDuty() {
+    return (float)Native::ledcDuty()[CUTTER_CHANNEL] / Definitions::MOTOR_MAX_DUTY;
+  }
+
+  /**
+  * Run for a while, 1 ms at a time. Main loop has no delay, so it runs Cutter::process() at least that often.
+  */
+  void run(uint32_t duration) {
+    for (uint32_t elapsed = 0; elapsed < duration; elapsed++) {
+      step();
+    }
+  }
+
+  void step() {
+    auto duty = getDuty();
+    float loadCurrent = getLoadCurrent(bladeSpeed, grass * groundSpeed / 100);
+    if (bladeMissing) {
+      // motor only has its own friction to turn, and no blade to give it inertia.
+      loadCurrent = Definitions::CUTTER_NOLOAD_CURRENT * 0.4f * bladeSpeed;
+    }
+    current = max(Definitions::CUTTER_MAX_CURRENT * duty - bladeSpeed * (Definitions::CUTTER_MAX_CURRENT - Definitions::CUTTER_NOLOAD_CURRENT), 0.0f);
+    // friction holds a stopped blade still.
+    bladeSpeed = max(bladeSpeed + (current - loadCurrent) / Definitions::CUTTER_MAX_CURRENT / (bladeMissing ? 0.02f : SPINUP_TIME) / 1000, 0.0f);
+    if (stone) {
+      bladeSpeed = 0;
+      current = Definitions::CUTTER_MAX_CURRENT * duty;
+    }
+    if (fuseOpen) {
+      current = 0;
+    }
+
+    // current only flows through motor (and shunt) while PWM is on, battery sees the average.
+    energy += duty * current / 1000 * BATTERY_VOLTAGE / 3600000;
+    Native::setAdcVoltage(Definitions::ADC1_ADDR, Definitions::CUTTER_LOAD_CHANNEL, current / 1000 * Definitions::CUTTER_LOAD_RESISTOR);
+
+    Native::runTickers(1);
+    if (readBattery && ++elapsed % 1000 == 0) {
+      io_analog.getVoltageAdc1(Definitions::BATTERY_SENSOR_CHANNEL);
+    }
+    cutter.process();
+  }
+
+  /**
+  * Run until condition is met, or for at most max ms.
+  * @return ms it took, max if condition was never met.
+  */
+  template<typename T> uint32_t runUntil(uint32_t max, T condition) {
+    for (uint32_t elapsed = 0; elapsed < max; elapsed++) {
+      if (condition()) {
+        return elapsed;
+      }
+      step();
+    }
+    return max;
+  }
+
+  static float getLoadCurrent(float bladeSpeed, float grass) {
+    float drag = Definitions::CUTTER_NOLOAD_CURRENT * bladeSpeed * bladeSpeed;
+    float minSpeed = Definitions::CUTTER_MIN_SPEED / 100.0f;
+    return drag + grass * (Definitions::CUTTER_MAX_CURRENT - Definitions::CUTTER_NOLOAD_CURRENT) * minSpeed / max(bladeSpeed, minSpeed);
+  }
+
+  /**
+  * Battery current (mA) of a blade held at full speed in some grass, what we had without the governor.
+  */
+  static float getFullSpeedCurrent(float grass) {
+    // solve motor current = load current for blade speed, motor current falls and load current rises with speed.
+    float low = 0.3, high = 1;
+    for (uint8_t i = 0; i < 30; i++) {
+      float speed = (low + high) / 2;
+      float motor = Definitions::CUTTER_MAX_CURRENT - speed * (Definitions::CUTTER_MAX_CURRENT - Definitions::CUTTER_NOLOAD_CURRENT);
+      (motor > getLoadCurrent(speed, grass) ? low : high) = speed;
+    }
+
+    return getLoadCurrent(low, grass);
+  }
+};
+
+Mower* mower;
+
+void setUp() {
+  Native::setMillis(1000);
+  randomSeed(9);
+  mower = new Mower();
+}
+
+void tearDown() {
+  delete mower;
+}
+
+/**
+* Start cutter the way Mowing does it, standing still for two seconds before driving off.
+*/
+void spinUp(float grass = 0.02, uint8_t groundSpeed = 60) {
+  mower->grass = grass;
+  mower->cutter.start();
+  mower->setGroundSpeed(0);
+  mower->run(2000);
+  mower->setGroundSpeed(groundSpeed);
+  mower->run(4000);
+}
+
+void test_spins_up_to_full_speed() {
+  spinUp();
+
+  TEST_ASSERT_EQUAL(Definitions::CUTTER_MAX_SPEED, mower->cutter.getSpeed());
+  TEST_ASSERT_FLOAT_WITHIN(0.1, 1, mower->bladeSpeed);
+  TEST_ASSERT_LESS_THAN(10, mower->cutter.getLoad());
+  TEST_ASSERT_FALSE(mower->cutter.isJammed());
+}
+
+void test_slows_down_in_sparse_grass() {
+  spinUp();
+  mower->setGroundSpeed(0);
+  mower->run(30000);
+
+  TEST_ASSERT_EQUAL(Definitions::CUTTER_MIN_SPEED, mower->cutter.getSpeed());
+  // no-load current follows blade speed, so a slow blade doesn't look like a blown fuse or missing blade.
+  TEST_ASSERT_LESS_THAN(15, mower->cutter.getLoad());
+  TEST_ASSERT_FALSE(mower->cutter.isFuseblown());
+  TEST_ASSERT_FALSE(mower->cutter.isBladeMissing());
+}
+
+void test_back_to_full_speed_in_thick_grass() {
+  spinUp();
+  mower->run(30000);
+  TEST_ASSERT_EQUAL(72, mower->cutter.getSpeed());
+
+  mower->grass = 0.7;
+  uint32_t elapsed = 0;
+  while (mower->cutter.getSpeed() < Definitions::CUTTER_MAX_SPEED && elapsed < 5000) {
+    mower->run(1);
+    elapsed++;
+  }
+
+  // most of the time goes to the blade slowing down until load reads as high, then load is median filtered over 300 ms and blade
+  // ramps up 1% every 10 ms.
+  TEST_ASSERT_LESS_THAN(2500, elapsed);
+  TEST_ASSERT_GREATER_THAN(35, mower->cutter.getLoad());
+}
+
+void test_jammed_blade_cut_quickly() {
+  mower->readBattery = true;
+  spinUp(0.2);
+
+  mower->stone = true;
+  auto elapsed = mower->runUntil(1000, []() { return mower->getDuty() == 0; });
+
+  // 15 samples of 2 ms.
+  TEST_ASSERT_GREATER_OR_EQUAL(30, elapsed);
+  TEST_ASSERT_LESS_THAN(50, elapsed);
+  TEST_ASSERT_TRUE(mower->cutter.isJammed());
+
+  // main loop makes it official.
+  mower->run(1);
+  TEST_ASSERT_FALSE(mower->cutter.isCutting());
+
+  char message[30];
+  sprintf(message, "power cut after %u ms", elapsed);
+  TEST_MESSAGE(message);
+}
+
+void test_lost_blade() {
+  mower->readBattery = true;
+  spinUp();
+
+  mower->bladeMissing = true;
+  auto elapsed = mower->runUntil(5000, []() { return mower->cutter.isBladeMissing(); });
+
+  TEST_ASSERT_GREATER_THAN(2000, elapsed);
+  TEST_ASSERT_LESS_THAN(3000, elapsed);
+  TEST_ASSERT_FALSE(mower->cutter.isFuseblown());
+  TEST_ASSERT_FALSE(mower->cutter.isJammed());
+
+  char message[30];
+  sprintf(message, "flagged after %u ms", elapsed);
+  TEST_MESSAGE(message);
+}
+
+void test_open_fuse() {
+  mower->readBattery = true;
+  spinUp();
+
+  mower->fuseOpen = true;
+  auto elapsed = mower->runUntil(5000, []() { return mower->cutter.isFuseblown(); });
+
+  TEST_ASSERT_GREATER_THAN(200, elapsed);
+  TEST_ASSERT_LESS_THAN(500, elapsed);
+  TEST_ASSERT_FALSE(mower->cutter.isJammed());
+
+  char message[30];
+  sprintf(message, "flagged after %u ms", elapsed);
+  TEST_MESSAGE(message);
+}
+
+/**
+* Things that make the current jump, but are not a jam.
+*/
+void test_no_false_jams() {
+  mower->readBattery = true;
+
+  // spin-up, current is high while blade is slow.
+  spinUp(0.2, 100);
+  TEST_ASSERT_FALSE(mower->cutter.isJammed());
+  TEST_ASSERT_EQUAL(10000, mower->runUntil(10000, []() { return mower->cutter.isJammed(); }));
+
+  // blade hits a twig, a hard knock for 20 ms.
+  mower->grass = 2;
+  mower->run(20);
+  mower->grass = 0.2;
+  TEST_ASSERT_EQUAL(5000, mower->runUntil(5000, []() { return mower->cutter.isJammed(); }));
+
+  // grass thick enough to slow the blade down a lot.
+  mower->grass = 0.45;
+  auto slowest = mower->bladeSpeed;
+  for (uint16_t elapsed = 0; elapsed < 3000; elapsed++) {
+    mower->step();
+    slowest = min(slowest, mower->bladeSpeed);
+    TEST_ASSERT_FALSE(mower->cutter.isJammed());
+  }
+  TEST_ASSERT_LESS_THAN_FLOAT(0.6, slowest);
+  TEST_ASSERT_FALSE(mower->cutter.isFuseblown());
+  TEST_ASSERT_FALSE(mower->cutter.isBladeMissing());
+}
+
+void test_rpm_estimate() {
+  mower->readBattery = true;
+  spinUp();
+
+  float error = 0;
+  uint16_t samples = 0;
+  for (float grass : { 0.0f, 0.1f, 0.2f, 0.3f }) {
+    mower->grass = grass;
+    mower->run(2000);
+
+    for (uint8_t i = 0; i < 10; i++) {
+      mower->run(100);
+      error += fabsf(mower->cutter.getRpm() - mower->bladeSpeed * Definitions::CUTTER_NOLOAD_RPM);
+      samples++;
+    }
+  }
+
+  char message[50];
+  sprintf(message, "rpm estimate off by %.0f rpm on average", error / samples);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_LESS_THAN_FLOAT(Definitions::CUTTER_NOLOAD_RPM * 0.05, error / samples);
+}
+
+/**
+* Four hours of mowing over patches of sparse, medium, and thick grass, at varying ground speed. Compares energy with a blade held at
+* full speed over the same patches.
+*/
+void test_mowing_mixed_grass() {
+  static const uint32_t DURATION = 4 * 3600 * 1000UL;
+
+  struct patch {
+    uint32_t duration;
+    float grass;
+    uint8_t groundSpeed;
+  };
+  std::vector<patch> patches;
+  for (uint32_t time = 0; time < DURATION;) {
+    auto kind = random(100);
+    float grass = kind < 60 ? random(2, 9) / 100.0f : kind < 90 ? random(10, 26) / 100.0f : random(40, 61) / 100.0f;
+    patch next = { (uint32_t)random(5, 61) * 1000, grass, (uint8_t)random(60, 101) };
+    patches.push_back(next);
+    time += next.duration;
+  }
+
+  spinUp(patches[0].grass);
+  mower->energy = 0;
+
+  double fullSpeedEnergy = 0;
+  uint32_t belowFloor = 0;
+  uint32_t raises = 0;
+  uint32_t maxRecovery = 0;
+  uint32_t recoveries = 0;
+  uint32_t recoveryTime = 0;
+  CutterGovernor floors(Definitions::CUTTER_MIN_SPEED, Definitions::CUTTER_MAX_SPEED);
+
+  for (auto& patch : patches) {
+    // load above HIGH_LOAD even at full blade speed, governor must go back to full speed.
+    bool thick = patch.grass * patch.groundSpeed / 100 > 0.4 && mower->cutter.getSpeed() < Definitions::CUTTER_MAX_SPEED;
+    uint8_t lastSpeed = mower->cutter.getSpeed();
+    mower->grass = patch.grass;
+    mower->setGroundSpeed(patch.groundSpeed);
+    fullSpeedEnergy += Mower::getFullSpeedCurrent(patch.grass * patch.groundSpeed / 100) / 1000 * BATTERY_VOLTAGE * patch.duration / 3600000;
+
+    for (uint32_t elapsed = 0; elapsed < patch.duration; elapsed++) {
+      mower->step();
+      auto speed = mower->cutter.getSpeed();
+
+      if (thick && speed == Definitions::CUTTER_MAX_SPEED) {
+        thick = false;
+        recoveries++;
+        recoveryTime += elapsed;
+        maxRecovery = max(maxRecovery, elapsed);
+      }
+      if (speed == Definitions::CUTTER_MAX_SPEED && lastSpeed < speed) {
+        raises++;
+      }
+      // blade ramps 1% every 10 ms when the floor goes up with ground speed, allow for that.
+      if (speed < floors.getFloor(patch.groundSpeed) && elapsed > 500) {
+        belowFloor++;
+      }
+      lastSpeed = speed;
+    }
+  }
+
+  float saving = 1 - mower->energy / fullSpeedEnergy;
+  char message[150];
+  sprintf(message, "cutter %.1f -> %.1f Wh (-%.1f%%), back to full speed in %u ms (max %u ms), %.1f raises/h, %u ms below floor",
+    fullSpeedEnergy, mower->energy, saving * 100, recoveries > 0 ? recoveryTime / recoveries : 0, maxRecovery, raises / 4.0f, belowFloor);
+  TEST_MESSAGE(message);
+
+  TEST_ASSERT_GREATER_THAN_FLOAT(0.05, saving);
+  TEST_ASSERT_GREATER_THAN(0, recoveries);
+  TEST_ASSERT_LESS_THAN(2500, maxRecovery);
+  TEST_ASSERT_EQUAL(0, belowFloor);
+  TEST_ASSERT_FALSE(mower->cutter.isJammed());
+  TEST_ASSERT_FALSE(mower->cutter.isFuseblown());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_spins_up_to_full_speed);
+  RUN_TEST(test_slows_down_in_sparse_grass);
+  RUN_TEST(test_back_to_full_speed_in_thick_grass);
+  RUN_TEST(test_jammed_blade_cut_quickly);
+  RUN_TEST(test_lost_blade);
+  RUN_TEST(test_open_fuse);
+  RUN_TEST(test_no_false_jams);
+  RUN_TEST(test_rpm_estimate);
+  RUN_TEST(test_mowing_mixed_grass);
+  return UNITY_END();
+}
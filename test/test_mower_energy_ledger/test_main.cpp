@@ -0,0 +1,306 @@
+#include <unity.h>
+#include <SPIFFS.h>
+#include "native_configuration.h"
+#include "energy_ledger.h"
+
+static const uint8_t STEP = 50;               // ms, how often the main loop runs in these tests.
+static const float FULL_SPEED = 0.5;          // m/s, wheel speed at 100%.
+static const float PULSES_PER_METER = Definitions::WHEEL_PULSES_PER_CENTIMETER * 100;
+static const float BATTERY_VOLTAGE = 15;
+static const float CUTTER_CURRENT = Definitions::CUTTER_NOLOAD_CURRENT * 2;   // mA, blade in grass at full speed.
+static const float WHEEL_CURRENT = Definitions::WHEEL_MOTOR_NOLOAD_CURRENT * 2; // mA, each wheel driving.
+static const float IDLE_CURRENT = 150;        // mA, electronics, same as Battery.
+
+/**
+* Wh used drawing this much current (mA) for a while (ms).
+*/
+double toWh(float current, uint32_t duration) {
+  return current * BATTERY_VOLTAGE * duration / 1000.0 / 3600 / 1000;
+}
+
+// shared by everything on the I2C bus, like in main.cpp.
+SemaphoreHandle_t i2cLock = xSemaphoreCreateMutex();
+
+/**
+* Wired up the same way as in main.cpp, on fake wheels and cutter. The accelerometer is never started, so heading stays 0.
+*/
+struct Mower {
+  Wheel leftWheel;
+  Wheel rightWheel;
+  IO_Analog io_analog;
+  IO_Accelerometer accelerometer;
+  SlipEstimator slipEstimator;
+  PoseEstimator poseEstimator;
+  WheelController wheelController;
+  Battery battery;
+  Cutter cutter;
+  EnergyLedger energyLedger;
+
+  float pulses[2] = {0};  // odometer pulses not yet given to the wheels.
+  double cutterEnergy = 0; // Wh drawn by cutter.
+
+  Mower() :
+    leftWheel(1, Definitions::LEFT_WHEEL_MOTOR_PIN, Definitions::LEFT_WHEEL_MOTOR_DIRECTION_PIN, Definitions::LEFT_WHEEL_ODOMETER_PIN, Definitions::LEFT_WHEEL_MOTOR_INVERTED, Definitions::LEFT_WHEEL_MOTOR_SPEED),
+    rightWheel(2, Definitions::RIGHT_WHEEL_MOTOR_PIN, Definitions::RIGHT_WHEEL_MOTOR_DIRECTION_PIN, Definitions::RIGHT_WHEEL_ODOMETER_PIN, Definitions::RIGHT_WHEEL_MOTOR_INVERTED, Definitions::RIGHT_WHEEL_MOTOR_SPEED),
+    io_analog(i2cLock),
+    accelerometer(Wire, i2cLock),
+    slipEstimator(leftWheel, rightWheel, accelerometer),
+    poseEstimator(leftWheel, rightWheel, accelerometer, slipEstimator),
+    wheelController(leftWheel, rightWheel),
+    battery(io_analog, Wire),
+    cutter(io_analog),
+    energyLedger(battery, wheelController, cutter, poseEstimator) {
+    Native::setAdcVoltage(Definitions::ADC1_ADDR, Definitions::BATTERY_SENSOR_CHANNEL, BATTERY_VOLTAGE / Definitions::BATTERY_MULTIPLIER);
+    setReadings();
+    battery.start();
+    poseEstimator.reset();
+  }
+
+  void setReadings() {
+    Wheel* wheels[2] = { &leftWheel, &rightWheel };
+    const uint8_t channels[2] = { Definitions::LEFT_WHEEL_MOTOR_LOAD_CHANNEL, Definitions::RIGHT_WHEEL_MOTOR_LOAD_CHANNEL };
+
+    for (uint8_t i = 0; i < 2; i++) {
+      float current = wheels[i]->getSpeed() != 0 ? WHEEL_CURRENT : 0;
+      Native::setAdcVoltage(Definitions::ADC1_ADDR, channels[i], current / 1000 * Definitions::WHEEL_MOTOR_LOAD_RESISTOR);
+    }
+    // follows blade speed while it ramps up, current close to stall current at a low speed would look like a jam.
+    float current = CUTTER_CURRENT * cutter.getSpeed() / 100;
+    Native::setAdcVoltage(Definitions::ADC1_ADDR, Definitions::CUTTER_LOAD_CHANNEL, current / 1000 * Definitions::CUTTER_LOAD_RESISTOR);
+  }
+
+  void step() {
+    Wheel* wheels[2] = { &leftWheel, &rightWheel };
+    const uint8_t pins[2] = { Definitions::LEFT_WHEEL_ODOMETER_PIN, Definitions::RIGHT_WHEEL_ODOMETER_PIN };
+
+    setReadings();
+    cutterEnergy += toWh(CUTTER_CURRENT * cutter.getSpeed() / 100, STEP);
+    for (uint8_t i = 0; i < 2; i++) {
+      pulses[i] += abs(wheels[i]->getSpeed()) / 100.0f * FULL_SPEED * STEP / 1000 * PULSES_PER_METER;
+      Native::triggerInterrupt(pins[i], (uint32_t)pulses[i]);
+      pulses[i] -= (uint32_t)pulses[i];
+    }
+
+    Native::runTickers(STEP);
+    wheelController.process();
+    cutter.process();
+    battery.process();
+    slipEstimator.process();
+    poseEstimator.process();
+    energyLedger.process();
+  }
+
+  void run(uint32_t duration) {
+    for (uint32_t elapsed = 0; elapsed < duration; elapsed += STEP) {
+      step();
+    }
+  }
+
+  double getActivityEnergy(EnergyLedger::ACTIVITY activity) const {
+    double energy = 0;
+    for (uint8_t state = 0; state < EnergyLedger::STATE_COUNT; state++) {
+      energy += energyLedger.getEnergy(static_cast<Definitions::MOWER_STATES>(state), activity);
+    }
+    return energy;
+  }
+};
+
+/**
+* Counters as they are stored on flash, restored by a ledger of their own.
+*/
+double getSavedEnergy(Mower& mower) {
+  EnergyLedger restored(mower.battery, mower.wheelController, mower.cutter, mower.poseEstimator);
+  restored.start();
+  return restored.getTotalEnergy();
+}
+
+Mower* mower;
+
+void setUp() {
+  Native::setMillis(1000);
+  Native::clearPreferences();
+  SPIFFS.format();
+  mower = new Mower();
+}
+
+void tearDown() {
+  delete mower;
+}
+
+void test_energy_attributed_to_state_and_activity() {
+  auto& ledger = mower->energyLedger;
+  ledger.start();
+  ledger.setState(Definitions::MOWER_STATES::DOCKED);
+  mower->run(10000);
+
+  ledger.setState(Definitions::MOWER_STATES::MOWING);
+  mower->cutter.start();
+  mower->wheelController.drive(50, 50);
+  mower->run(60000);
+
+  ledger.setState(Definitions::MOWER_STATES::DOCKING);
+  mower->cutter.stop(false);
+  mower->run(30000);
+
+  TEST_ASSERT_FLOAT_WITHIN(0.2, 10, ledger.getTime(Definitions::MOWER_STATES::DOCKED));
+  TEST_ASSERT_FLOAT_WITHIN(0.2, 60, ledger.getTime(Definitions::MOWER_STATES::MOWING));
+  TEST_ASSERT_FLOAT_WITHIN(0.2, 30, ledger.getTime(Definitions::MOWER_STATES::DOCKING));
+
+  // only electronics while docked.
+  TEST_ASSERT_FLOAT_WITHIN(toWh(IDLE_CURRENT, 10000) * 0.05, toWh(IDLE_CURRENT, 10000), ledger.getEnergy(Definitions::MOWER_STATES::DOCKED));
+  TEST_ASSERT_FLOAT_WITHIN(toWh(IDLE_CURRENT, 10000) * 0.05, toWh(IDLE_CURRENT, 10000), ledger.getEnergy(Definitions::MOWER_STATES::DOCKED, EnergyLedger::ELECTRONICS));
+
+  double cutting = mower->cutterEnergy;
+  double driving = toWh(2 * WHEEL_CURRENT, 60000);
+  // battery reads load once a second, so up to a second of cutting may be booked on the next state.
+  TEST_ASSERT_FLOAT_WITHIN(toWh(CUTTER_CURRENT, 1000) * 1.05, cutting, ledger.getEnergy(Definitions::MOWER_STATES::MOWING, EnergyLedger::CUTTING));
+  TEST_ASSERT_FLOAT_WITHIN(driving * 0.05, driving, ledger.getEnergy(Definitions::MOWER_STATES::MOWING, EnergyLedger::DRIVING));
+  TEST_ASSERT_EQUAL_FLOAT(0, ledger.getEnergy(Definitions::MOWER_STATES::MOWING, EnergyLedger::TURNING));
+
+  // wheels still going, cutter stopped.
+  // governor slows the blade down when there is little grass.
+  TEST_ASSERT_GREATER_THAN_FLOAT(toWh(CUTTER_CURRENT, 30000), cutting);
+  TEST_ASSERT_FLOAT_WITHIN(toWh(CUTTER_CURRENT, 1000) * 1.05, 0, ledger.getEnergy(Definitions::MOWER_STATES::DOCKING, EnergyLedger::CUTTING));
+  TEST_ASSERT_FLOAT_WITHIN(driving / 2 * 0.05, driving / 2, ledger.getEnergy(Definitions::MOWER_STATES::DOCKING, EnergyLedger::DRIVING));
+
+  double total = 0;
+  for (uint8_t state = 0; state < EnergyLedger::STATE_COUNT; state++) {
+    total += ledger.getEnergy(static_cast<Definitions::MOWER_STATES>(state));
+  }
+  TEST_ASSERT_EQUAL_FLOAT(total, ledger.getTotalEnergy());
+  TEST_ASSERT_EQUAL_FLOAT(ledger.getEnergy(Definitions::MOWER_STATES::MOWING) / (ledger.getTime(Definitions::MOWER_STATES::MOWING) / 3600), ledger.getWhPerMowingHour());
+}
+
+struct wheelSpeeds {
+  int8_t left;
+  int8_t right;
+  EnergyLedger::ACTIVITY activity;
+};
+
+void test_turning_classified_from_wheel_speeds() {
+  static const wheelSpeeds cases[] = {
+    { 50, 50, EnergyLedger::DRIVING },
+    { 50, 30, EnergyLedger::DRIVING },      // driving in a curve.
+    { -50, -50, EnergyLedger::DRIVING },    // backing up.
+    { -30, -50, EnergyLedger::DRIVING },
+    { 50, -50, EnergyLedger::TURNING },     // on the spot.
+    { -40, 40, EnergyLedger::TURNING },
+    { 50, 0, EnergyLedger::TURNING },       // around the stopped wheel.
+    { 0, 50, EnergyLedger::TURNING },
+    { 0, -50, EnergyLedger::TURNING },      // one wheel reversing, the other one stopped.
+    { 50, -10, EnergyLedger::TURNING },     // one wheel reversing slowly.
+  };
+
+  for (auto& speeds : cases) {
+    delete mower;
+    Native::clearPreferences();
+    mower = new Mower();
+    mower->energyLedger.start();
+    mower->energyLedger.setState(Definitions::MOWER_STATES::MOWING);
+
+    mower->wheelController.drive(speeds.left, speeds.right);
+    mower->run(10000);
+
+    char message[40];
+    sprintf(message, "left %d, right %d", speeds.left, speeds.right);
+    auto other = speeds.activity == EnergyLedger::DRIVING ? EnergyLedger::TURNING : EnergyLedger::DRIVING;
+    TEST_ASSERT_TRUE_MESSAGE(mower->getActivityEnergy(speeds.activity) > 0, message);
+    TEST_ASSERT_FLOAT_WITHIN_MESSAGE(0, 0, mower->getActivityEnergy(other), message);
+  }
+
+}
+
+void test_area_only_counted_when_mowing_with_cutter_running() {
+  auto& ledger = mower->energyLedger;
+  ledger.start();
+  ledger.setState(Definitions::MOWER_STATES::MOWING);
+  mower->wheelController.drive(50, 50);
+
+  // blade not started yet.
+  mower->run(10000);
+  TEST_ASSERT_EQUAL_FLOAT(0, ledger.getMowedArea());
+  TEST_ASSERT_EQUAL_FLOAT(0, ledger.getAreaPerWh());
+
+  mower->cutter.start();
+  auto travelled = mower->poseEstimator.getTravelled();
+  mower->run(60000);
+  float mowed = (mower->poseEstimator.getTravelled() - travelled) * Definitions::CUTTER_DIAMETER / 100.0f;
+  TEST_ASSERT_FLOAT_WITHIN(0.3, 15 * Definitions::CUTTER_DIAMETER / 100.0f, mowed);
+  // first second of cutting is booked before the blade was running.
+  TEST_ASSERT_FLOAT_WITHIN(0.5 * Definitions::CUTTER_DIAMETER / 100.0f, mowed, ledger.getMowedArea());
+  TEST_ASSERT_EQUAL_FLOAT(ledger.getMowedArea() / ledger.getEnergy(Definitions::MOWER_STATES::MOWING), ledger.getAreaPerWh());
+
+  // turning on the spot covers no new ground.
+  auto area = ledger.getMowedArea();
+  mower->wheelController.drive(50, -50);
+  mower->run(10000);
+  mower->wheelController.drive(50, 0);
+  mower->run(10000);
+  TEST_ASSERT_FLOAT_WITHIN(0.5 * 2 * Definitions::CUTTER_DIAMETER / 100.0f, area, ledger.getMowedArea());
+
+  // going home with the blade still running.
+  area = ledger.getMowedArea();
+  ledger.setState(Definitions::MOWER_STATES::DOCKING);
+  mower->wheelController.drive(50, 50);
+  mower->run(30000);
+  TEST_ASSERT_EQUAL_FLOAT(area, ledger.getMowedArea());
+}
+
+void test_counters_discarded_on_version_mismatch() {
+  mower->energyLedger.start();
+  mower->energyLedger.setState(Definitions::MOWER_STATES::DOCKED);
+  mower->run(60000);
+  mower->energyLedger.setState(Definitions::MOWER_STATES::MOWING);
+
+  auto saved = mower->energyLedger.getTotalEnergy();
+  TEST_ASSERT_GREATER_THAN_FLOAT(0, saved);
+  TEST_ASSERT_EQUAL_FLOAT(saved, getSavedEnergy(*mower));
+
+  // stored by an older (or newer) firmware, version is the first byte.
+  auto& stored = Native::preferences()["liam-esp/energy"];
+  stored[0]++;
+  TEST_ASSERT_EQUAL_FLOAT(0, getSavedEnergy(*mower));
+
+  // counters that have grown or shrunk, but kept the version.
+  stored[0]--;
+  stored.push_back(0);
+  TEST_ASSERT_EQUAL_FLOAT(0, getSavedEnergy(*mower));
+  stored.resize(stored.size() - 2);
+  TEST_ASSERT_EQUAL_FLOAT(0, getSavedEnergy(*mower));
+}
+
+void test_saved_on_state_change_and_interval() {
+  auto& ledger = mower->energyLedger;
+  ledger.start();
+  mower->run(10000);
+  TEST_ASSERT_EQUAL(0, Configuration::preferences.getBytesLength("energy"));
+
+  ledger.setState(Definitions::MOWER_STATES::DOCKED);
+  auto saved = ledger.getTotalEnergy();
+  TEST_ASSERT_EQUAL_FLOAT(saved, getSavedEnergy(*mower));
+
+  // SAVE_INTERVAL is 10 minutes, counted from last save.
+  mower->run(599000);
+  TEST_ASSERT_EQUAL_FLOAT(saved, getSavedEnergy(*mower));
+  TEST_ASSERT_GREATER_THAN_FLOAT(saved, ledger.getTotalEnergy());
+
+  mower->run(1000);
+  TEST_ASSERT_EQUAL_FLOAT(ledger.getTotalEnergy(), getSavedEnergy(*mower));
+
+  // on every state change, with what was used until then booked on the state we left.
+  mower->run(30000);
+  ledger.setState(Definitions::MOWER_STATES::LAUNCHING);
+  TEST_ASSERT_EQUAL_FLOAT(ledger.getTotalEnergy(), getSavedEnergy(*mower));
+  TEST_ASSERT_FLOAT_WITHIN(0.1, 640, ledger.getTime(Definitions::MOWER_STATES::DOCKED));
+  TEST_ASSERT_EQUAL_FLOAT(0, ledger.getTime(Definitions::MOWER_STATES::LAUNCHING));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_energy_attributed_to_state_and_activity);
+  RUN_TEST(test_turning_classified_from_wheel_speeds);
+  RUN_TEST(test_area_only_counted_when_mowing_with_cutter_running);
+  RUN_TEST(test_counters_discarded_on_version_mismatch);
+  RUN_TEST(test_saved_on_state_change_and_interval);
+  return UNITY_END();
+}
@@ -0,0 +1,305 @@
+#include <unity.h>
+#include <SPIFFS.h>
+#include "native_configuration.h"
+#include "return_planner.h"
+
+static const HardwareProfile::Battery& BATTERY = HardwareProfiles::LIION_4S_BATTERY;
+static const uint8_t CURVE_POINTS = HardwareProfile::Battery::SOC_CURVE_POINTS;
+static const uint8_t STEP = 50;             // ms, how often the main loop runs the planner in these tests.
+static const float PACK_RESISTANCE = 0.12;  // ohm
+
+// shared by everything on the I2C bus, like in main.cpp.
+SemaphoreHandle_t i2cLock = xSemaphoreCreateMutex();
+
+/**
+* Wired up the same way as in main.cpp. The accelerometer is never started, so heading stays 0 and driving forward goes north.
+*/
+struct Mower {
+  Wheel leftWheel;
+  Wheel rightWheel;
+  IO_Analog io_analog;
+  IO_Accelerometer accelerometer;
+  SlipEstimator slipEstimator;
+  PoseEstimator poseEstimator;
+  Battery battery;
+  ReturnPlanner returnPlanner;
+
+  float soc;            // true state of charge of the battery pack.
+  float pulses = 0;     // odometer pulses not yet given to the wheels.
+
+  Mower(float soc) :
+    leftWheel(1, Definitions::LEFT_WHEEL_MOTOR_PIN, Definitions::LEFT_WHEEL_MOTOR_DIRECTION_PIN, Definitions::LEFT_WHEEL_ODOMETER_PIN, Definitions::LEFT_WHEEL_MOTOR_INVERTED, Definitions::LEFT_WHEEL_MOTOR_SPEED),
+    rightWheel(2, Definitions::RIGHT_WHEEL_MOTOR_PIN, Definitions::RIGHT_WHEEL_MOTOR_DIRECTION_PIN, Definitions::RIGHT_WHEEL_ODOMETER_PIN, Definitions::RIGHT_WHEEL_MOTOR_INVERTED, Definitions::RIGHT_WHEEL_MOTOR_SPEED),
+    io_analog(i2cLock),
+    accelerometer(Wire, i2cLock),
+    slipEstimator(leftWheel, rightWheel, accelerometer),
+    poseEstimator(leftWheel, rightWheel, accelerometer, slipEstimator),
+    battery(io_analog, Wire),
+    returnPlanner(battery, poseEstimator),
+    soc(soc) {
+    setBatteryReadings(0);
+    battery.start();
+    returnPlanner.reset();
+  }
+
+  float getOpenCircuitVoltage() const {
+    float position = constrain(soc, 0.0f, 1.0f) * (CURVE_POINTS - 1);
+    uint8_t i = min((uint8_t)position, (uint8_t)(CURVE_POINTS - 2));
+    float level = BATTERY.socCurve[i] + (BATTERY.socCurve[i + 1] - BATTERY.socCurve[i]) * (position - i);
+
+    return BATTERY.empty + level * (BATTERY.fullyCharged - BATTERY.empty);
+  }
+
+  /**
+  * What the ADC sees with this much current (mA) drawn from the pack. Battery adds the electronics itself, the rest goes through the cutter shunt.
+  */
+  void setBatteryReadings(float current) {
+    float voltage = getOpenCircuitVoltage() - current / 1000 * PACK_RESISTANCE;
+    Native::setAdcVoltage(Definitions::ADC1_ADDR, Definitions::BATTERY_SENSOR_CHANNEL, voltage / Definitions::BATTERY_MULTIPLIER);
+    Native::setAdcVoltage(Definitions::ADC1_ADDR, Definitions::CUTTER_LOAD_CHANNEL, max(current - 150, 0.0f) / 1000 * Definitions::CUTTER_LOAD_RESISTOR);
+  }
+
+  /**
+  * Drive straight for a while, negative speed to back up.
+  * @param speed m/s
+  * @param current mA drawn from pack.
+  */
+  void drive(uint32_t duration, float speed, float current) {
+    int8_t wheelSpeed = speed > 0 ? 50 : speed < 0 ? -50 : 0;
+    leftWheel.setSpeed(wheelSpeed);
+    rightWheel.setSpeed(wheelSpeed);
+
+    for (uint32_t elapsed = 0; elapsed < duration; elapsed += STEP) {
+      soc -= current * STEP / 1000.0f / 3600 / BATTERY.capacity;
+      setBatteryReadings(current);
+
+      pulses += fabsf(speed) * STEP / 1000 * Definitions::WHEEL_PULSES_PER_CENTIMETER * 100;
+      Native::triggerInterrupt(Definitions::LEFT_WHEEL_ODOMETER_PIN, (uint32_t)pulses);
+      Native::triggerInterrupt(Definitions::RIGHT_WHEEL_ODOMETER_PIN, (uint32_t)pulses);
+      pulses -= (uint32_t)pulses;
+
+      Native::runTickers(STEP);
+      battery.process();
+      poseEstimator.process();
+      returnPlanner.process();
+    }
+  }
+
+  /**
+  * Energy (Wh) left in pack until it's empty, from the true state of charge.
+  */
+  float getTrueRemainingEnergy() const {
+    return soc * BATTERY.capacity / 1000 * (getOpenCircuitVoltage() + BATTERY.empty) / 2;
+  }
+};
+
+Mower* mower;
+
+void setUp() {
+  Native::setMillis(1000);
+  randomSeed(5);
+  SPIFFS.format();
+}
+
+void tearDown() {
+  delete mower;
+  mower = nullptr;
+}
+
+void test_return_energy() {
+  // nothing but the docking reserve when at the docking station.
+  TEST_ASSERT_EQUAL_FLOAT(2, ReturnPlanner::getReturnEnergy(0, 0.04));
+  // 100 m straight line, 150 m path, 6 Wh, 30% margin.
+  TEST_ASSERT_EQUAL_FLOAT(100 * 1.5 * 0.04 * 1.3 + 2, ReturnPlanner::getReturnEnergy(100, 0.04));
+}
+
+void test_learns_energy_per_meter() {
+  mower = new Mower(0.8);
+  TEST_ASSERT_EQUAL_FLOAT(0.04, mower->returnPlanner.getEnergyPerMeter());
+
+  // 2.5 A at a bit above 15 V while going 0.3 m/s is about 35 mWh/m.
+  mower->drive(600000, 0.3, 2500);
+
+  float expected = mower->battery.getEnergyUsed() / mower->poseEstimator.getTravelled();
+  TEST_ASSERT_FLOAT_WITHIN(5, 180, mower->poseEstimator.getTravelled());
+  TEST_ASSERT_FLOAT_WITHIN(expected * 0.05, expected, mower->returnPlanner.getEnergyPerMeter());
+}
+
+void test_follows_heavier_grass() {
+  mower = new Mower(0.8);
+  mower->drive(300000, 0.3, 2000);
+  auto sparse = mower->returnPlanner.getEnergyPerMeter();
+
+  mower->drive(300000, 0.3, 4000);
+  TEST_ASSERT_FLOAT_WITHIN(sparse * 0.15, sparse * 2, mower->returnPlanner.getEnergyPerMeter());
+}
+
+void test_energy_used_while_docked_not_counted() {
+  mower = new Mower(0.8);
+
+  // sitting in the docking station with the cutter running (test mode), then leaving.
+  mower->drive(120000, 0, 3000);
+  mower->returnPlanner.reset();
+  mower->drive(120000, 0.3, 1500);
+
+  float perMeter = mower->returnPlanner.getEnergyPerMeter();
+  TEST_ASSERT_LESS_THAN_FLOAT(0.04, perMeter);
+  TEST_ASSERT_FLOAT_WITHIN(0.005, 0.021, perMeter);
+}
+
+void test_return_energy_grows_with_distance() {
+  mower = new Mower(0.8);
+  mower->drive(100000, 0.3, 2500);
+  auto near = mower->returnPlanner.getReturnEnergy();
+
+  mower->drive(100000, 0.3, 2500);
+  auto far = mower->returnPlanner.getReturnEnergy();
+
+  TEST_ASSERT_FLOAT_WITHIN(0.5, 30, mower->poseEstimator.getDistanceToDock() - 30);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, ReturnPlanner::getReturnEnergy(mower->poseEstimator.getDistanceToDock(), mower->returnPlanner.getEnergyPerMeter()), far);
+  TEST_ASSERT_GREATER_THAN_FLOAT(near, far);
+
+  // backing up towards the docking station.
+  mower->drive(100000, -0.3, 2500);
+  TEST_ASSERT_FLOAT_WITHIN(0.5, 30, mower->poseEstimator.getDistanceToDock());
+}
+
+/**
+* Mow back and forth 40-80 m out until told to return, then go home along a path up to PATH_FACTOR longer than the straight line.
+* The pack must not run empty on the way.
+*/
+void test_returns_in_time() {
+  mower = new Mower(0.25);
+
+  mower->drive(40 / 0.3 * 1000, 0.3, 2500);
+  bool outward = true;
+  uint32_t mowing = 0;
+
+  while (!mower->returnPlanner.shouldReturn()) {
+    auto distance = mower->poseEstimator.getDistanceToDock();
+    if (distance > 80) {
+      outward = false;
+    } else if (distance < 40) {
+      outward = true;
+    }
+    mower->drive(1000, outward ? 0.3 : -0.3, 2500);
+    mowing++;
+    TEST_ASSERT_LESS_THAN(7200, mowing);
+  }
+
+  auto distance = mower->poseEstimator.getDistanceToDock();
+  TEST_ASSERT_GREATER_THAN_FLOAT(30, distance);
+  TEST_ASSERT_GREATER_THAN_FLOAT(0.05, mower->soc);
+
+  // cutter off on the way home, but the planner doesn't know that.
+  mower->drive(distance * 1.5 / 0.3 * 1000, -0.3, 1500);
+
+  TEST_ASSERT_GREATER_THAN_FLOAT(1, mower->getTrueRemainingEnergy());
+}
+
+/**
+* Energy policies compared on random lawns: return home with a fixed 20% of the energy left, or when ReturnPlanner says so.
+* Mowing follows parallel lanes across a rectangular lawn with the docking station somewhere along the edge. Grass gets thicker or
+* thinner from lawn to lawn and there are stripes of tall grass. The path home is 1.0-1.5 times the straight line, without the
+* cutter running.
+*/
+struct policyResult {
+  float minutes = 0;      // mowing time, summed over all lawns.
+  uint16_t strandings = 0;
+  float minArrivalEnergy = 1000;  // Wh
+};
+
+void mowLawns(uint16_t lawns, bool usePlanner, policyResult& result) {
+  static const float FULL_ENERGY = BATTERY.capacity / 1000 * (BATTERY.fullyCharged + BATTERY.empty) / 2;
+  static const float SPEED = 0.3;             // m/s
+  static const float LANE_WIDTH = 0.25;       // m
+  static const float CUTTING_ENERGY = 0.03;   // Wh/m in normal grass.
+  static const float TRAVEL_ENERGY = 0.018;   // Wh/m with cutter off.
+
+  randomSeed(42);
+
+  for (uint16_t lawn = 0; lawn < lawns; lawn++) {
+    float width = random(10, 71);
+    float length = random(10, 71);
+    float dockX = random(0, (long)width + 1);
+    float grass = random(80, 141) / 100.0f;
+    float pathFactor = random(100, 151) / 100.0f;
+    uint16_t stripe = random(5, 20);
+
+    float remaining = FULL_ENERGY;
+    float energyPerMeter = 0.04;
+    float sampleEnergy = 0;
+    float sampleDistance = 0;
+    float x = dockX;
+    float y = 0;
+    float direction = 1;
+    uint32_t meters = 0;
+
+    while (true) {
+      float distance = sqrtf((x - dockX) * (x - dockX) + y * y);
+      bool shouldReturn = usePlanner ? remaining <= ReturnPlanner::getReturnEnergy(distance, energyPerMeter) : remaining <= FULL_ENERGY * 0.2;
+
+      if (shouldReturn) {
+        float arrival = remaining - distance * pathFactor * TRAVEL_ENERGY - 0.5;  // docking takes some
+        if (arrival < 0) {
+          result.strandings++;
+        }
+        result.minArrivalEnergy = min(result.minArrivalEnergy, arrival);
+        result.minutes += meters / SPEED / 60;
+        break;
+      }
+
+      // one meter along the lane, then over to the next one at the end.
+      y += direction;
+      if (y < 0 || y > length) {
+        direction = -direction;
+        y += direction;
+        x = x + LANE_WIDTH > width ? 0 : x + LANE_WIDTH;
+      }
+
+      uint16_t lane = x / LANE_WIDTH;
+      float used = CUTTING_ENERGY * grass * (lane % stripe < 3 ? 1.6f : 1);
+      remaining -= used;
+      meters++;
+
+      // same sampling as ReturnPlanner::process().
+      sampleEnergy += used;
+      sampleDistance++;
+      if (sampleDistance >= 5) {
+        energyPerMeter += (sampleEnergy / sampleDistance - energyPerMeter) * 0.2f;
+        sampleEnergy = 0;
+        sampleDistance = 0;
+      }
+    }
+  }
+}
+
+void test_more_mowing_than_fixed_reserve() {
+  static const uint16_t LAWNS = 1000;
+  policyResult fixed;
+  policyResult planned;
+
+  mowLawns(LAWNS, false, fixed);
+  mowLawns(LAWNS, true, planned);
+
+  char message[120];
+  snprintf(message, sizeof(message), "min/charge %.1f -> %.1f, strandings %u -> %u, least left on arrival %.1f -> %.1f Wh", fixed.minutes / LAWNS,
+           planned.minutes / LAWNS, fixed.strandings, planned.strandings, fixed.minArrivalEnergy, planned.minArrivalEnergy);
+  TEST_MESSAGE(message);
+
+  TEST_ASSERT_EQUAL(0, planned.strandings);
+  TEST_ASSERT_GREATER_THAN_FLOAT(0, planned.minArrivalEnergy);
+  TEST_ASSERT_GREATER_THAN_FLOAT(fixed.minutes * 1.1, planned.minutes);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_return_energy);
+  RUN_TEST(test_learns_energy_per_meter);
+  RUN_TEST(test_follows_heavier_grass);
+  RUN_TEST(test_energy_used_while_docked_not_counted);
+  RUN_TEST(test_return_energy_grows_with_distance);
+  RUN_TEST(test_returns_in_time);
+  RUN_TEST(test_more_mowing_than_fixed_reserve);
+  return UNITY_END();
+}
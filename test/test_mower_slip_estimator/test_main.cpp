@@ -0,0 +1,283 @@
+#include <unity.h>
+#include "native_configuration.h"
+#include "definitions.h"
+#include "slip_estimator.h"
+#include "pose_estimator.h"
+
+static const uint8_t STEP = 10;   // ms, how often the main loop runs the estimators in these tests.
+static const float HALF_TRACK = Definitions::WHEEL_PAIR_DISTANCE / 100.0f / 2;
+static const float PULSES_PER_METER = Definitions::WHEEL_PULSES_PER_CENTIMETER * 100;
+static const float GRAVITY = 9.81;
+static const float EARTH_FIELD = 0.2;   // gauss, horizontal part.
+static const float TURN_RATE = 90 * DEG_TO_RAD;  // rad/s, turning on the spot.
+static const uint16_t START_TIME = 8000;  // ms, mower sits still after start while orientation filter finds down and north.
+
+// shared by everything on the I2C bus, like in main.cpp.
+SemaphoreHandle_t i2cLock = xSemaphoreCreateMutex();
+
+/**
+* Wired up the same way as in main.cpp, on a kinematic model of the mower: it moves at a true forward speed and yaw rate, and each wheel
+* turns 1 / (1 - slip) times faster than its contact point moves over the ground. The IMU sees the true motion plus noise and an
+* accelerometer bias, as from a slight slope.
+*/
+struct Mower {
+  Wheel leftWheel;
+  Wheel rightWheel;
+  IO_Accelerometer accelerometer;
+  SlipEstimator slipEstimator;
+  PoseEstimator poseEstimator;
+
+  float speed = 0;              // m/s, true forward speed.
+  float yawRate = 0;            // rad/s, true, positive when turning right.
+  float heading = 0;            // rad, true, turned since start.
+  float slip[SlipEstimator::WHEEL_COUNT] = {0};
+  float accelerationBias = 0.01;  // g
+  float maxAcceleration = 0.5;  // m/s², how fast mower speeds up or slows down.
+  float pulses[SlipEstimator::WHEEL_COUNT] = {0};   // odometer pulses not yet given to the wheels.
+  float distance = 0;           // m, true distance travelled.
+  float odometry = 0;           // m, distance travelled according to odometers alone.
+  uint32_t slippingFor = 0;     // ms that SlipEstimator said wheels slip.
+
+  Mower(bool imuConnected = true) :
+    leftWheel(1, Definitions::LEFT_WHEEL_MOTOR_PIN, Definitions::LEFT_WHEEL_MOTOR_DIRECTION_PIN, Definitions::LEFT_WHEEL_ODOMETER_PIN, Definitions::LEFT_WHEEL_MOTOR_INVERTED, Definitions::LEFT_WHEEL_MOTOR_SPEED),
+    rightWheel(2, Definitions::RIGHT_WHEEL_MOTOR_PIN, Definitions::RIGHT_WHEEL_MOTOR_DIRECTION_PIN, Definitions::RIGHT_WHEEL_ODOMETER_PIN, Definitions::RIGHT_WHEEL_MOTOR_INVERTED, Definitions::RIGHT_WHEEL_MOTOR_SPEED),
+    accelerometer(Wire, i2cLock),
+    slipEstimator(leftWheel, rightWheel, accelerometer),
+    poseEstimator(leftWheel, rightWheel, accelerometer, slipEstimator) {
+    Native::imu().connected = imuConnected;
+    accelerometer.start();
+    drive(START_TIME, 0);
+    poseEstimator.reset();
+  }
+
+  static float noise(float amplitude) {
+    return random(-1000, 1001) / 1000.0f * amplitude;
+  }
+
+  /**
+  * Drive for a while, speeding up or slowing down as fast as the mower can.
+  * @param targetSpeed m/s forward.
+  * @param targetYawRate rad/s, positive to turn right.
+  */
+  void drive(uint32_t duration, float targetSpeed, float targetYawRate = 0) {
+    Wheel* wheels[SlipEstimator::WHEEL_COUNT] = { &leftWheel, &rightWheel };
+    const uint8_t pins[SlipEstimator::WHEEL_COUNT] = { Definitions::LEFT_WHEEL_ODOMETER_PIN, Definitions::RIGHT_WHEEL_ODOMETER_PIN };
+    float dt = STEP / 1000.0f;
+
+    for (uint32_t elapsed = 0; elapsed < duration; elapsed += STEP) {
+      float acceleration = constrain((targetSpeed - speed) / dt, -maxAcceleration, maxAcceleration);
+      speed += acceleration * dt;
+      yawRate += constrain(targetYawRate - yawRate, -TURN_RATE * dt * 5, TURN_RATE * dt * 5);
+      heading += yawRate * dt;
+
+      Native::imu().accel[0] = acceleration / GRAVITY + accelerationBias + noise(0.02);
+      Native::imu().gyro[2] = -yawRate / DEG_TO_RAD + noise(0.5);
+      // earth's field turns the other way in the sensor frame.
+      Native::imu().mag[0] = EARTH_FIELD * cosf(heading);
+      Native::imu().mag[1] = -EARTH_FIELD * sinf(heading);
+
+      float ground[SlipEstimator::WHEEL_COUNT] = { speed + yawRate * HALF_TRACK, speed - yawRate * HALF_TRACK };
+      float travelled[SlipEstimator::WHEEL_COUNT];
+      for (uint8_t i = 0; i < SlipEstimator::WHEEL_COUNT; i++) {
+        float turning = ground[i] / (1 - slip[i]);
+        wheels[i]->setSpeed(turning > 0.001 ? 50 : turning < -0.001 ? -50 : 0);
+        travelled[i] = turning * dt;
+        pulses[i] += fabsf(travelled[i]) * PULSES_PER_METER;
+        Native::triggerInterrupt(pins[i], (uint32_t)pulses[i]);
+        pulses[i] -= (uint32_t)pulses[i];
+      }
+      distance += fabsf(speed) * dt;
+      odometry += fabsf(travelled[0] + travelled[1]) / 2;
+
+      Native::runTickers(STEP);
+      slipEstimator.process();
+      poseEstimator.process();
+      slippingFor += slipEstimator.isSlipping() ? STEP : 0;
+    }
+  }
+
+  /**
+  * Turn on the spot, like Mowing does at the end of a lane.
+  */
+  void turn(float degrees) {
+    drive(500, 0);
+    drive(fabsf(degrees) / 90 * 1000, 0, degrees > 0 ? TURN_RATE : -TURN_RATE);
+    drive(300, 0);
+  }
+
+  /**
+  * How long (ms) until SlipEstimator says wheels slip, or duration if it never does.
+  */
+  uint32_t driveUntilSlipping(uint32_t duration, float targetSpeed) {
+    for (uint32_t elapsed = 0; elapsed < duration; elapsed += STEP) {
+      drive(STEP, targetSpeed);
+      if (slipEstimator.isSlipping()) {
+        return elapsed + STEP;
+      }
+    }
+    return duration;
+  }
+};
+
+Mower* mower;
+
+void setUp() {
+  Native::setMillis(1000);
+  randomSeed(7);
+}
+
+void tearDown() {
+  delete mower;
+  mower = nullptr;
+}
+
+void test_no_slip_when_driving_normally() {
+  mower = new Mower();
+
+  for (uint8_t lane = 0; lane < 3; lane++) {
+    mower->drive(8000, 0.3);
+    mower->drive(1000, 0);
+    mower->turn(lane % 2 ? 120 : -150);
+  }
+  mower->drive(3000, 0.3);
+
+  TEST_ASSERT_EQUAL(0, mower->slippingFor);
+  TEST_ASSERT_FLOAT_WITHIN(0.1, 0, mower->slipEstimator.getSlip(SlipEstimator::LEFT));
+  TEST_ASSERT_FLOAT_WITHIN(0.1, 0, mower->slipEstimator.getSlip(SlipEstimator::RIGHT));
+}
+
+void test_speed_follows_odometry_despite_bias() {
+  mower = new Mower();
+  // a steeper slope than the other tests.
+  mower->accelerationBias = 0.05;
+
+  mower->drive(20000, 0.3);
+
+  TEST_ASSERT_FLOAT_WITHIN(0.02, 0.3, mower->slipEstimator.getSpeed());
+  mower->drive(5000, 0);
+  TEST_ASSERT_FLOAT_WITHIN(0.02, 0, mower->slipEstimator.getSpeed());
+}
+
+void test_nothing_flagged_while_settling() {
+  mower = new Mower();
+  // not processed for a while, estimator starts over.
+  Native::runTickers(2000);
+  mower->slip[SlipEstimator::LEFT] = 0.6;
+
+  mower->drive(4900, 0.3);
+
+  TEST_ASSERT_EQUAL(0, mower->slippingFor);
+  TEST_ASSERT_EQUAL_FLOAT(0, mower->slipEstimator.getSlip(SlipEstimator::LEFT));
+}
+
+void test_one_wheel_spinning() {
+  mower = new Mower();
+  mower->drive(10000, 0.3);
+
+  mower->slip[SlipEstimator::LEFT] = 0.6;
+  auto detected = mower->driveUntilSlipping(3000, 0.3);
+
+  char message[60];
+  sprintf(message, "one wheel spinning detected after %u ms", detected);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_LESS_THAN(1000, detected);
+
+  // still seen as long as it lasts.
+  mower->drive(5000, 0.3);
+  TEST_ASSERT_TRUE(mower->slipEstimator.isSlipping());
+  TEST_ASSERT_FLOAT_WITHIN(0.15, 0.6, mower->slipEstimator.getSlip(SlipEstimator::LEFT));
+  TEST_ASSERT_FLOAT_WITHIN(0.1, 0, mower->slipEstimator.getSlip(SlipEstimator::RIGHT));
+
+  mower->slip[SlipEstimator::LEFT] = 0;
+  mower->drive(1500, 0.3);
+  TEST_ASSERT_FALSE(mower->slipEstimator.isSlipping());
+}
+
+/**
+* Both wheels spinning is only seen while the accelerometer tells the mower slows down, after that odometry wins. It takes a big loss of
+* grip: at 45% slip the estimate never gets far enough from odometry.
+*/
+void test_both_wheels_slipping() {
+  mower = new Mower();
+  mower->drive(10000, 0.3);
+
+  // wheels keep turning as fast, but the mower slows down to 30% of that.
+  uint32_t detected = 0;
+  while (detected < 3000 && !mower->slipEstimator.isSlipping()) {
+    mower->drive(STEP, 0.3 * (1 - 0.7));
+    mower->slip[SlipEstimator::LEFT] = mower->slip[SlipEstimator::RIGHT] = 1 - mower->speed / 0.3;
+    detected += STEP;
+  }
+
+  char message[60];
+  sprintf(message, "both wheels slipping detected after %u ms", detected);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_LESS_THAN(1500, detected);
+  TEST_ASSERT_GREATER_THAN_FLOAT(0.3, mower->slipEstimator.getSlip(SlipEstimator::LEFT));
+  TEST_ASSERT_GREATER_THAN_FLOAT(0.3, mower->slipEstimator.getSlip(SlipEstimator::RIGHT));
+}
+
+void test_without_accelerometer() {
+  mower = new Mower(false);
+  mower->drive(10000, 0.3);
+  mower->slip[SlipEstimator::LEFT] = 0.6;
+  mower->drive(5000, 0.3);
+
+  TEST_ASSERT_EQUAL(0, mower->slippingFor);
+  TEST_ASSERT_FLOAT_WITHIN(0.05, (0.3 + 0.3 / 0.4) / 2, mower->slipEstimator.getSpeed());
+}
+
+/**
+* Mow lanes 10 m long with turns on the spot at each end. With wet patches, one wheel spins at 60% for 3 s in every lane.
+* @param poseError set to how much further than the truth (0-1) PoseEstimator says the mower went.
+* @param odometryError same for odometry alone.
+*/
+void mowLanes(bool wetPatches, float& poseError, float& odometryError) {
+  mower = new Mower();
+  float startTravelled = mower->poseEstimator.getTravelled();
+  float startDistance = mower->distance;
+  float startOdometry = mower->odometry;
+
+  for (uint8_t lane = 0; lane < 20; lane++) {
+    mower->drive(15000, 0.3);
+    if (wetPatches) {
+      mower->slip[lane % 2 ? SlipEstimator::LEFT : SlipEstimator::RIGHT] = 0.6;
+    }
+    mower->drive(3000, 0.3);
+    mower->slip[SlipEstimator::LEFT] = mower->slip[SlipEstimator::RIGHT] = 0;
+    mower->drive(15000, 0.3);
+    mower->drive(1000, 0);
+    mower->turn(lane % 2 ? 180 : -180);
+  }
+
+  float distance = mower->distance - startDistance;
+  poseError = (mower->poseEstimator.getTravelled() - startTravelled) / distance - 1;
+  odometryError = (mower->odometry - startOdometry) / distance - 1;
+  delete mower;
+  mower = nullptr;
+}
+
+void test_distance_error_with_spinning_wheel() {
+  float normalPose, normalOdometry, wetPose, wetOdometry;
+  mowLanes(false, normalPose, normalOdometry);
+  mowLanes(true, wetPose, wetOdometry);
+
+  char message[100];
+  sprintf(message, "distance error normal %+.1f%% (odometry %+.1f%%), wet %+.1f%% (odometry %+.1f%%)", normalPose * 100, normalOdometry * 100, wetPose * 100, wetOdometry * 100);
+  TEST_MESSAGE(message);
+
+  TEST_ASSERT_FLOAT_WITHIN(0.01, normalOdometry, normalPose);
+  TEST_ASSERT_LESS_THAN_FLOAT(wetOdometry * 0.6, wetPose);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_no_slip_when_driving_normally);
+  RUN_TEST(test_speed_follows_odometry_despite_bias);
+  RUN_TEST(test_nothing_flagged_while_settling);
+  RUN_TEST(test_one_wheel_spinning);
+  RUN_TEST(test_both_wheels_slipping);
+  RUN_TEST(test_without_accelerometer);
+  RUN_TEST(test_distance_error_with_spinning_wheel);
+  return UNITY_END();
+}
@@ -0,0 +1,347 @@
+#include <unity.h>
+#include <string>
+#include "native_configuration.h"
+#include "stuck_recovery.h"
+
+static const uint8_t STEP = 5;                // ms, how often the main loop runs in these tests.
+static const float FULL_SPEED = 0.5;          // m/s, wheel speed at 100%.
+static const float PULSES_PER_METER = Definitions::WHEEL_PULSES_PER_CENTIMETER * 100;
+static const float WEDGED_DISTANCE = 0.45;    // m, mower has to back straight out this far before it can turn or go forward.
+
+// shared by everything on the I2C bus, like in main.cpp.
+SemaphoreHandle_t i2cLock = xSemaphoreCreateMutex();
+
+/**
+* Wired up the same way as in main.cpp, on fake wheels. Without accelerometer no wheel is ever seen spinning, only stalled.
+*
+* When trapped the mower is wedged in somewhere: driving forward or turning stalls the wheels, until it has backed straight out
+* wedgedDistance in one go. Backing up further than roomBehind stalls the wheels too. The accelerometer is never started, so heading
+* stays 0 and the pose only moves north and south.
+*/
+struct Mower {
+  Wheel leftWheel;
+  Wheel rightWheel;
+  IO_Analog io_analog;
+  IO_Accelerometer accelerometer;
+  SlipEstimator slipEstimator;
+  PoseEstimator poseEstimator;
+  WheelController wheelController;
+  WheelMonitor wheelMonitor;
+  StuckRecovery stuckRecovery;
+
+  bool trapped = false;
+  float wedgedDistance = WEDGED_DISTANCE;
+  float roomBehind = INFINITY;  // m
+  float backedUp = 0;     // m backed straight since last forward or turn.
+  float pulses[2] = {0};  // odometer pulses not yet given to the wheels.
+
+  Mower() :
+    leftWheel(1, Definitions::LEFT_WHEEL_MOTOR_PIN, Definitions::LEFT_WHEEL_MOTOR_DIRECTION_PIN, Definitions::LEFT_WHEEL_ODOMETER_PIN, Definitions::LEFT_WHEEL_MOTOR_INVERTED, Definitions::LEFT_WHEEL_MOTOR_SPEED),
+    rightWheel(2, Definitions::RIGHT_WHEEL_MOTOR_PIN, Definitions::RIGHT_WHEEL_MOTOR_DIRECTION_PIN, Definitions::RIGHT_WHEEL_ODOMETER_PIN, Definitions::RIGHT_WHEEL_MOTOR_INVERTED, Definitions::RIGHT_WHEEL_MOTOR_SPEED),
+    io_analog(i2cLock),
+    accelerometer(Wire, i2cLock),
+    slipEstimator(leftWheel, rightWheel, accelerometer),
+    poseEstimator(leftWheel, rightWheel, accelerometer, slipEstimator),
+    wheelController(leftWheel, rightWheel),
+    wheelMonitor(io_analog, leftWheel, rightWheel, slipEstimator),
+    stuckRecovery(wheelController, wheelMonitor, poseEstimator) {
+    stuckRecovery.start();
+    poseEstimator.reset();
+  }
+
+  void step() {
+    Wheel* wheels[2] = { &leftWheel, &rightWheel };
+    const uint8_t pins[2] = { Definitions::LEFT_WHEEL_ODOMETER_PIN, Definitions::RIGHT_WHEEL_ODOMETER_PIN };
+    const uint8_t channels[2] = { Definitions::LEFT_WHEEL_MOTOR_LOAD_CHANNEL, Definitions::RIGHT_WHEEL_MOTOR_LOAD_CHANNEL };
+    auto left = leftWheel.getSpeed();
+    auto right = rightWheel.getSpeed();
+    bool backing = left < 0 && right < 0;
+    bool blocked = backing ? backedUp >= roomBehind : trapped && (left != 0 || right != 0) && backedUp < wedgedDistance;
+
+    for (uint8_t i = 0; i < 2; i++) {
+      auto speed = abs(wheels[i]->getSpeed());
+      float current = blocked ? Definitions::WHEEL_MOTOR_MAX_CURRENT * speed / 100 : speed > 0 ? Definitions::WHEEL_MOTOR_NOLOAD_CURRENT * 2 : 0;
+      Native::setAdcVoltage(Definitions::ADC1_ADDR, channels[i], current / 1000 * Definitions::WHEEL_MOTOR_LOAD_RESISTOR);
+
+      if (!blocked) {
+        pulses[i] += speed / 100.0f * FULL_SPEED * STEP / 1000 * PULSES_PER_METER;
+        Native::triggerInterrupt(pins[i], (uint32_t)pulses[i]);
+        pulses[i] -= (uint32_t)pulses[i];
+      }
+    }
+
+    if (backing) {
+      backedUp += blocked ? 0 : abs(left) / 100.0f * FULL_SPEED * STEP / 1000;
+    } else if (left != 0 || right != 0) {
+      // turned or drove out of the trap.
+      trapped &= blocked;
+      backedUp = 0;
+    }
+
+    Native::runTickers(STEP);
+    wheelController.process();
+    wheelMonitor.process();
+    slipEstimator.process();
+    poseEstimator.process();
+    stuckRecovery.process();
+  }
+
+  void run(uint32_t duration) {
+    for (uint32_t elapsed = 0; elapsed < duration; elapsed += STEP) {
+      step();
+    }
+  }
+
+  /**
+  * Get stuck the way Mowing and Stuck state do it, and wait for the recovery to finish.
+  */
+  StuckRecovery::RESULT getStuck(StuckRecovery::CAUSE cause) {
+    wheelController.stop(false);
+    stuckRecovery.setCause(cause);
+    stuckRecovery.setState(Definitions::MOWER_STATES::STUCK);
+    stuckRecovery.begin();
+
+    for (uint32_t elapsed = 0; elapsed < 300000 && stuckRecovery.getResult() == StuckRecovery::RECOVERING; elapsed += STEP) {
+      step();
+    }
+
+    auto result = stuckRecovery.getResult();
+    if (result == StuckRecovery::RECOVERED) {
+      stuckRecovery.setState(Definitions::MOWER_STATES::MOWING);
+    }
+
+    return result;
+  }
+
+  /**
+  * Mow straight ahead for a while.
+  */
+  void mow(uint32_t duration) {
+    wheelController.forward(0, 50);
+    run(duration);
+    wheelController.stop(false);
+  }
+
+  /**
+  * Drive to a position north of the docking station, and let enough time pass for the next time we get stuck to be a new event.
+  */
+  void moveTo(float y) {
+    bool arrived = false;
+    auto done = [&arrived](void) -> void {
+      arrived = true;
+    };
+    float distance = y - poseEstimator.getPose().position.y();
+
+    if (distance > 0) {
+      wheelController.forward(0, 50, false, distance * 100, done);
+    } else {
+      wheelController.backward(0, 50, false, -distance * 100, done);
+    }
+    while (!arrived) {
+      step();
+    }
+    run(20000);
+  }
+
+  std::string getJson() const {
+    StringPrint output;
+    stuckRecovery.printJson(output);
+    return output.output;
+  }
+
+  /**
+  * Attempts (or successes) of a manoeuvre for a cause, as reported to the API.
+  */
+  uint32_t getCount(const char* cause, const char* manoeuvre, const char* counter = "attempts") const {
+    auto json = getJson();
+    auto at = json.find(std::string("\"") + cause + "\":{");
+    at = json.find(std::string("\"") + manoeuvre + "\":{", at);
+    at = json.find(std::string("\"") + counter + "\":", at);
+
+    return std::stoul(json.substr(at + strlen(counter) + 3));
+  }
+
+  uint32_t getTotalAttempts(const char* cause) const {
+    static const char* const manoeuvres[] = { "reverseTurn", "rocking", "wiggle", "reverseTrack", "wait" };
+    uint32_t total = 0;
+
+    for (auto manoeuvre : manoeuvres) {
+      total += getCount(cause, manoeuvre);
+    }
+    return total;
+  }
+
+  uint32_t getCounter(const char* counter) const {
+    auto json = getJson();
+    auto at = json.find(std::string("\"") + counter + "\":");
+
+    return std::stoul(json.substr(at + strlen(counter) + 3));
+  }
+};
+
+Mower* mower;
+
+void setUp() {
+  Native::setMillis(1000);
+  Native::clearPreferences();
+  randomSeed(3);
+  mower = new Mower();
+}
+
+void tearDown() {
+  delete mower;
+  mower = nullptr;
+}
+
+void test_first_listed_manoeuvre_until_learned() {
+  // bumped into something, not wedged.
+  mower->trapped = true;
+  mower->wedgedDistance = 0;
+  TEST_ASSERT_EQUAL(StuckRecovery::RECOVERED, mower->getStuck(StuckRecovery::BUMP));
+
+  TEST_ASSERT_EQUAL(1, mower->getTotalAttempts("bump"));
+  TEST_ASSERT_EQUAL(1, mower->getCount("bump", "reverseTurn", "successes"));
+  TEST_ASSERT_EQUAL(1, mower->getCounter("events"));
+  TEST_ASSERT_EQUAL(1, mower->getCounter("recovered"));
+}
+
+/**
+* Only the last manoeuvre listed for the cause works here. The first time all of them are tried, after that it's tried first.
+*/
+void test_learns_what_works_here() {
+  uint32_t tries[3];
+
+  for (uint8_t event = 0; event < 3; event++) {
+    mower->moveTo(1.5);
+    auto before = mower->getTotalAttempts("unknown");
+    mower->trapped = true;
+    TEST_ASSERT_EQUAL(StuckRecovery::RECOVERED, mower->getStuck(StuckRecovery::UNKNOWN));
+    tries[event] = mower->getTotalAttempts("unknown") - before;
+  }
+
+  char message[60];
+  sprintf(message, "tries per event %u, %u, %u", tries[0], tries[1], tries[2]);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_EQUAL(4, tries[0]);
+  TEST_ASSERT_EQUAL(1, tries[1]);
+  TEST_ASSERT_EQUAL(1, tries[2]);
+  TEST_ASSERT_EQUAL(3, mower->getCount("unknown", "reverseTrack", "successes"));
+  TEST_ASSERT_EQUAL(3, mower->getCounter("recovered"));
+}
+
+/**
+* Two places where different manoeuvres work: wedged in at one, and with little room behind at the other. Each place gets what works
+* there, even though the other place says something else.
+*/
+void test_learns_per_location() {
+  static const float WEDGED_AT = 1.5;
+  static const float CRAMPED_AT = 10.5;
+  uint32_t tries[2][2];
+
+  for (uint8_t event = 0; event < 2; event++) {
+    for (uint8_t place = 0; place < 2; place++) {
+      mower->moveTo(place == 0 ? WEDGED_AT : CRAMPED_AT);
+      mower->trapped = true;
+      mower->wedgedDistance = place == 0 ? WEDGED_DISTANCE : 0;
+      mower->roomBehind = place == 0 ? INFINITY : 0.4;
+
+      auto before = mower->getTotalAttempts("unknown");
+      TEST_ASSERT_EQUAL(StuckRecovery::RECOVERED, mower->getStuck(StuckRecovery::UNKNOWN));
+      tries[place][event] = mower->getTotalAttempts("unknown") - before;
+      mower->roomBehind = INFINITY;
+    }
+  }
+
+  char message[80];
+  sprintf(message, "tries wedged %u then %u, cramped %u then %u", tries[0][0], tries[0][1], tries[1][0], tries[1][1]);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_EQUAL(4, tries[0][0]);
+  // reverse along track worked in the first place, so it's tried first. It backs into the wall, after that only wiggle works.
+  TEST_ASSERT_EQUAL(3, tries[1][0]);
+  TEST_ASSERT_EQUAL(1, tries[0][1]);
+  TEST_ASSERT_EQUAL(1, tries[1][1]);
+  TEST_ASSERT_EQUAL(2, mower->getCount("unknown", "wiggle", "successes"));
+  TEST_ASSERT_EQUAL(2, mower->getCount("unknown", "reverseTrack", "successes"));
+}
+
+void test_stuck_again_right_after_goes_on_with_next() {
+  // reverse and turn frees us, but we drive right back in.
+  mower->trapped = true;
+  mower->wedgedDistance = 0;
+  TEST_ASSERT_EQUAL(StuckRecovery::RECOVERED, mower->getStuck(StuckRecovery::BUMP));
+  mower->mow(5000);
+
+  // this time it takes more backing up.
+  mower->trapped = true;
+  mower->wedgedDistance = WEDGED_DISTANCE;
+  TEST_ASSERT_EQUAL(StuckRecovery::RECOVERED, mower->getStuck(StuckRecovery::BUMP));
+
+  // same event, reverse and turn did not count as a success.
+  TEST_ASSERT_EQUAL(1, mower->getCounter("events"));
+  TEST_ASSERT_EQUAL(1, mower->getCounter("recovered"));
+  TEST_ASSERT_EQUAL(0, mower->getCount("bump", "reverseTurn", "successes"));
+  TEST_ASSERT_EQUAL(1, mower->getCount("bump", "reverseTrack", "successes"));
+}
+
+void test_escalates_when_nothing_works() {
+  mower->trapped = true;
+  mower->roomBehind = 0;
+
+  TEST_ASSERT_EQUAL(StuckRecovery::ESCALATED, mower->getStuck(StuckRecovery::BUMP));
+  TEST_ASSERT_EQUAL(3, mower->getTotalAttempts("bump"));
+  TEST_ASSERT_EQUAL(1, mower->getCounter("escalations"));
+
+  // waiting for help, wheels stand still.
+  mower->run(5000);
+  TEST_ASSERT_EQUAL(0, mower->leftWheel.getSpeed());
+  TEST_ASSERT_EQUAL(0, mower->rightWheel.getSpeed());
+}
+
+void test_missing_blade_escalates_right_away() {
+  TEST_ASSERT_EQUAL(StuckRecovery::ESCALATED, mower->getStuck(StuckRecovery::BLADE_MISSING));
+  TEST_ASSERT_EQUAL(0, mower->getTotalAttempts("bladeMissing"));
+  TEST_ASSERT_EQUAL(1, mower->getCounter("escalations"));
+}
+
+void test_cutter_fault_waits_to_cool_down() {
+  auto start = millis();
+
+  TEST_ASSERT_EQUAL(StuckRecovery::RECOVERED, mower->getStuck(StuckRecovery::CUTTER_FAULT));
+  TEST_ASSERT_UINT_WITHIN(STEP * 2, Definitions::STUCK_RETRY_DELAY * 1000UL, millis() - start);
+  TEST_ASSERT_EQUAL(1, mower->getCount("cutterFault", "wait", "successes"));
+}
+
+void test_learned_stats_survive_restart() {
+  mower->trapped = true;
+  mower->getStuck(StuckRecovery::UNKNOWN);
+  mower->run(20000);
+
+  // restarted where we got stuck last time.
+  delete mower;
+  mower = new Mower();
+  TEST_ASSERT_EQUAL(1, mower->getCounter("events"));
+  TEST_ASSERT_EQUAL(1, mower->getCount("unknown", "reverseTrack", "successes"));
+
+  mower->trapped = true;
+  auto before = mower->getTotalAttempts("unknown");
+  mower->getStuck(StuckRecovery::UNKNOWN);
+  TEST_ASSERT_EQUAL(1, mower->getTotalAttempts("unknown") - before);
+
+  // clearing counters keeps what was learned.
+  mower->stuckRecovery.reset();
+  TEST_ASSERT_EQUAL(0, mower->getCounter("events"));
+  TEST_ASSERT_EQUAL(2, mower->getCount("unknown", "reverseTrack", "successes"));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_first_listed_manoeuvre_until_learned);
+  RUN_TEST(test_learns_what_works_here);
+  RUN_TEST(test_learns_per_location);
+  RUN_TEST(test_stuck_again_right_after_goes_on_with_next);
+  RUN_TEST(test_escalates_when_nothing_works);
+  RUN_TEST(test_missing_blade_escalates_right_away);
+  RUN_TEST(test_cutter_fault_waits_to_cool_down);
+  RUN_TEST(test_learned_stats_survive_restart);
+  return UNITY_END();
+}
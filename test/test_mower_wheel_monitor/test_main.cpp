@@ -0,0 +1,257 @@
+#include <unity.h>
+#include "native_configuration.h"
+#include "definitions.h"
+#include "wheel_monitor.h"
+
+static const uint8_t STEP = 10;   // ms, how often the main loop runs in these tests.
+static const float FULL_SPEED = 0.5;          // m/s, wheel speed at 100%.
+static const float PULSES_PER_METER = Definitions::WHEEL_PULSES_PER_CENTIMETER * 100;
+static const float GRAVITY = 9.81;
+static const float EARTH_FIELD = 0.2;         // gauss, horizontal part.
+static const uint16_t START_TIME = 8000;      // ms, mower sits still after start while orientation filter finds down and north.
+static const uint16_t SAMPLE_INTERVAL = 50;   // ms, same as WheelMonitor.
+static const uint16_t SETTLE_TIME = 300;      // ms, same as WheelMonitor.
+static const uint16_t STALL_TIME = 300;       // ms, same as WheelMonitor.
+static const uint16_t SPIN_TIME = 500;        // ms, same as WheelMonitor.
+static const float GRIP_CURRENT = Definitions::WHEEL_MOTOR_NOLOAD_CURRENT * 2.5;  // mA, wheel pushing the mower over grass.
+static const float FREE_CURRENT = Definitions::WHEEL_MOTOR_NOLOAD_CURRENT;        // mA, wheel turning without resistance.
+
+// shared by everything on the I2C bus, like in main.cpp.
+SemaphoreHandle_t i2cLock = xSemaphoreCreateMutex();
+
+/**
+* Wired up the same way as in main.cpp, on the same kinematic model as test_mower_slip_estimator: the mower moves straight ahead at a true
+* speed, and each wheel turns 1 / (1 - slip) times faster than the ground under it moves. A blocked wheel gets no odometer pulses and
+* draws stall current for the speed it's given, and holds the mower still.
+*/
+struct Mower {
+  Wheel leftWheel;
+  Wheel rightWheel;
+  IO_Analog io_analog;
+  IO_Accelerometer accelerometer;
+  SlipEstimator slipEstimator;
+  WheelMonitor wheelMonitor;
+
+  float speed = 0;              // m/s, true forward speed.
+  float maxAcceleration = 0.5;  // m/s², how fast mower speeds up or slows down.
+  int8_t wheelSpeed[WheelMonitor::WHEEL_COUNT] = {0};   // what the wheels are told, 0-100%.
+  float slip[WheelMonitor::WHEEL_COUNT] = {0};
+  bool blocked[WheelMonitor::WHEEL_COUNT] = {false};
+  float current[WheelMonitor::WHEEL_COUNT] = { GRIP_CURRENT, GRIP_CURRENT };  // mA, when turning.
+  float pulses[WheelMonitor::WHEEL_COUNT] = {0};   // odometer pulses not yet given to the wheels.
+
+  Mower() :
+    leftWheel(1, Definitions::LEFT_WHEEL_MOTOR_PIN, Definitions::LEFT_WHEEL_MOTOR_DIRECTION_PIN, Definitions::LEFT_WHEEL_ODOMETER_PIN, Definitions::LEFT_WHEEL_MOTOR_INVERTED, Definitions::LEFT_WHEEL_MOTOR_SPEED),
+    rightWheel(2, Definitions::RIGHT_WHEEL_MOTOR_PIN, Definitions::RIGHT_WHEEL_MOTOR_DIRECTION_PIN, Definitions::RIGHT_WHEEL_ODOMETER_PIN, Definitions::RIGHT_WHEEL_MOTOR_INVERTED, Definitions::RIGHT_WHEEL_MOTOR_SPEED),
+    io_analog(i2cLock),
+    accelerometer(Wire, i2cLock),
+    slipEstimator(leftWheel, rightWheel, accelerometer),
+    wheelMonitor(io_analog, leftWheel, rightWheel, slipEstimator) {
+    Native::imu().connected = true;
+    accelerometer.start();
+    run(START_TIME);
+  }
+
+  /**
+  * Give both wheels a new speed, mower follows as fast as it can unless a wheel is blocked.
+  */
+  void setSpeed(int8_t speed) {
+    wheelSpeed[WheelMonitor::LEFT] = wheelSpeed[WheelMonitor::RIGHT] = speed;
+  }
+
+  void step() {
+    Wheel* wheels[WheelMonitor::WHEEL_COUNT] = { &leftWheel, &rightWheel };
+    const uint8_t pins[WheelMonitor::WHEEL_COUNT] = { Definitions::LEFT_WHEEL_ODOMETER_PIN, Definitions::RIGHT_WHEEL_ODOMETER_PIN };
+    const uint8_t channels[WheelMonitor::WHEEL_COUNT] = { Definitions::LEFT_WHEEL_MOTOR_LOAD_CHANNEL, Definitions::RIGHT_WHEEL_MOTOR_LOAD_CHANNEL };
+    float dt = STEP / 1000.0f;
+
+    bool held = blocked[WheelMonitor::LEFT] || blocked[WheelMonitor::RIGHT];
+    // the wheel with grip sets the pace.
+    float targetSpeed = held ? 0 : FULL_SPEED * (wheelSpeed[WheelMonitor::LEFT] + wheelSpeed[WheelMonitor::RIGHT]) / 200;
+    float acceleration = constrain((targetSpeed - speed) / dt, -maxAcceleration, maxAcceleration);
+    speed += acceleration * dt;
+
+    Native::imu().accel[0] = acceleration / GRAVITY + random(-1000, 1001) / 1000.0f * 0.02f;
+    Native::imu().gyro[2] = random(-1000, 1001) / 1000.0f * 0.5f;
+    Native::imu().mag[0] = EARTH_FIELD;
+    Native::imu().mag[1] = 0;
+
+    for (uint8_t i = 0; i < WheelMonitor::WHEEL_COUNT; i++) {
+      wheels[i]->setSpeed(wheelSpeed[i]);
+      float turning = blocked[i] ? 0 : speed / (1 - slip[i]);
+      pulses[i] += fabsf(turning) * dt * PULSES_PER_METER;
+      Native::triggerInterrupt(pins[i], (uint32_t)pulses[i]);
+      pulses[i] -= (uint32_t)pulses[i];
+
+      float motorCurrent = blocked[i] ? Definitions::WHEEL_MOTOR_MAX_CURRENT * abs(wheelSpeed[i]) / 100 : wheelSpeed[i] != 0 ? current[i] : 0;
+      Native::setAdcVoltage(Definitions::ADC1_ADDR, channels[i], motorCurrent / 1000 * Definitions::WHEEL_MOTOR_LOAD_RESISTOR);
+    }
+
+    Native::runTickers(STEP);
+    slipEstimator.process();
+    wheelMonitor.process();
+  }
+
+  void run(uint32_t duration) {
+    for (uint32_t elapsed = 0; elapsed < duration; elapsed += STEP) {
+      step();
+    }
+  }
+
+  /**
+  * How long (ms) until a wheel gets this traction, or duration if it never does.
+  */
+  uint32_t runUntil(WheelMonitor::WHEEL wheel, WheelMonitor::TRACTION traction, uint32_t duration) {
+    for (uint32_t elapsed = 0; elapsed < duration; elapsed += STEP) {
+      step();
+      if (wheelMonitor.getTraction(wheel) == traction) {
+        return elapsed + STEP;
+      }
+    }
+    return duration;
+  }
+};
+
+Mower* mower;
+
+void setUp() {
+  Native::setMillis(1000);
+  randomSeed(6);
+}
+
+void tearDown() {
+  delete mower;
+  mower = nullptr;
+}
+
+void test_blocked_wheel_stalled() {
+  mower = new Mower();
+  // pushed up against a wall already.
+  mower->blocked[WheelMonitor::LEFT] = mower->blocked[WheelMonitor::RIGHT] = true;
+  mower->setSpeed(50);
+
+  auto detected = mower->runUntil(WheelMonitor::LEFT, WheelMonitor::STALLED, 3000);
+
+  char message[60];
+  sprintf(message, "blocked wheel stalled after %u ms", detected);
+  TEST_MESSAGE(message);
+  // not while motor is getting going, but as soon as it has been blocked for STALL_TIME after that.
+  TEST_ASSERT_GREATER_OR_EQUAL(SETTLE_TIME + STALL_TIME, detected);
+  TEST_ASSERT_LESS_OR_EQUAL(SETTLE_TIME + STALL_TIME + SAMPLE_INTERVAL, detected);
+  TEST_ASSERT_TRUE(mower->wheelMonitor.isStalled());
+  TEST_ASSERT_FALSE(mower->wheelMonitor.isSpinning());
+  TEST_ASSERT_EQUAL(WheelMonitor::STALLED, mower->wheelMonitor.getTraction(WheelMonitor::RIGHT));
+}
+
+void test_wheel_blocked_while_driving() {
+  mower = new Mower();
+  mower->setSpeed(50);
+  mower->run(5000);
+  TEST_ASSERT_FALSE(mower->wheelMonitor.isStalled());
+
+  // ran into a root, only the right wheel is held.
+  mower->blocked[WheelMonitor::RIGHT] = true;
+  auto detected = mower->runUntil(WheelMonitor::RIGHT, WheelMonitor::STALLED, 3000);
+
+  // current filter has to catch up first.
+  TEST_ASSERT_LESS_OR_EQUAL(STALL_TIME + 200, detected);
+  TEST_ASSERT_EQUAL(WheelMonitor::STALLED, mower->wheelMonitor.getTraction(WheelMonitor::RIGHT));
+}
+
+void test_wheel_rolling_freely_not_spinning() {
+  mower = new Mower();
+  mower->setSpeed(50);
+  mower->run(2000);
+
+  // downhill, or on hard flat ground: hardly any current, but the mower keeps up with the wheels.
+  mower->current[WheelMonitor::LEFT] = mower->current[WheelMonitor::RIGHT] = FREE_CURRENT;
+  mower->run(30000);
+
+  TEST_ASSERT_EQUAL(WheelMonitor::GRIP, mower->wheelMonitor.getTraction(WheelMonitor::LEFT));
+  TEST_ASSERT_EQUAL(WheelMonitor::GRIP, mower->wheelMonitor.getTraction(WheelMonitor::RIGHT));
+  TEST_ASSERT_FLOAT_WITHIN(0.1, 0, mower->slipEstimator.getSlip(SlipEstimator::LEFT));
+  TEST_ASSERT_LESS_THAN(Definitions::WHEEL_MOTOR_NOLOAD_CURRENT * 1.5, mower->wheelMonitor.getCurrent(WheelMonitor::LEFT));
+}
+
+void test_wheel_spinning() {
+  mower = new Mower();
+  mower->setSpeed(50);
+  mower->run(10000);
+
+  // on wet grass, the left wheel turns four times faster than the ground under it moves.
+  mower->slip[WheelMonitor::LEFT] = 0.75;
+  mower->current[WheelMonitor::LEFT] = FREE_CURRENT;
+  auto detected = mower->runUntil(WheelMonitor::LEFT, WheelMonitor::SPINNING, 5000);
+
+  char message[60];
+  sprintf(message, "spinning wheel detected after %u ms", detected);
+  TEST_MESSAGE(message);
+  // SlipEstimator needs up to a second to see it, then it has to last SPIN_TIME.
+  TEST_ASSERT_GREATER_OR_EQUAL(SPIN_TIME, detected);
+  TEST_ASSERT_LESS_THAN(1000 + SPIN_TIME, detected);
+  TEST_ASSERT_TRUE(mower->wheelMonitor.isSpinning());
+  TEST_ASSERT_FALSE(mower->wheelMonitor.isStalled());
+  TEST_ASSERT_EQUAL(WheelMonitor::GRIP, mower->wheelMonitor.getTraction(WheelMonitor::RIGHT));
+}
+
+void test_flag_cleared_on_new_speed() {
+  mower = new Mower();
+  mower->blocked[WheelMonitor::LEFT] = true;
+  mower->setSpeed(50);
+  mower->run(1000);
+  TEST_ASSERT_EQUAL(WheelMonitor::STALLED, mower->wheelMonitor.getTraction(WheelMonitor::LEFT));
+
+  // stays until wheel is told something else.
+  mower->run(5000);
+  TEST_ASSERT_TRUE(mower->wheelMonitor.isStalled());
+
+  mower->setSpeed(-50);
+  mower->run(SAMPLE_INTERVAL);
+  TEST_ASSERT_EQUAL(WheelMonitor::GRIP, mower->wheelMonitor.getTraction(WheelMonitor::LEFT));
+  TEST_ASSERT_FALSE(mower->wheelMonitor.isStalled());
+
+  // still blocked backwards, so it's flagged again.
+  mower->run(SETTLE_TIME + STALL_TIME);
+  TEST_ASSERT_TRUE(mower->wheelMonitor.isStalled());
+}
+
+void test_nothing_flagged_while_settling() {
+  mower = new Mower();
+  mower->setSpeed(50);
+  mower->run(10000);
+  mower->slip[WheelMonitor::LEFT] = 0.75;
+  mower->current[WheelMonitor::LEFT] = FREE_CURRENT;
+  mower->run(3000);
+  TEST_ASSERT_EQUAL(WheelMonitor::SPINNING, mower->wheelMonitor.getTraction(WheelMonitor::LEFT));
+
+  // still spinning at the new speed, not checked until it has settled.
+  mower->setSpeed(60);
+  auto detected = mower->runUntil(WheelMonitor::LEFT, WheelMonitor::SPINNING, 3000);
+  TEST_ASSERT_GREATER_OR_EQUAL(SETTLE_TIME + SPIN_TIME, detected);
+  TEST_ASSERT_LESS_OR_EQUAL(SETTLE_TIME + SPIN_TIME + SAMPLE_INTERVAL, detected);
+
+  // motor starting against a load draws close to stall current before it gets going.
+  delete mower;
+  mower = new Mower();
+  mower->blocked[WheelMonitor::LEFT] = mower->blocked[WheelMonitor::RIGHT] = true;
+  mower->setSpeed(50);
+  for (uint32_t elapsed = 0; elapsed < SETTLE_TIME; elapsed += STEP) {
+    mower->step();
+    TEST_ASSERT_EQUAL(WheelMonitor::GRIP, mower->wheelMonitor.getTraction(WheelMonitor::LEFT));
+  }
+  mower->blocked[WheelMonitor::LEFT] = mower->blocked[WheelMonitor::RIGHT] = false;
+  mower->run(5000);
+  TEST_ASSERT_FALSE(mower->wheelMonitor.isStalled());
+  TEST_ASSERT_FALSE(mower->wheelMonitor.isSpinning());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_blocked_wheel_stalled);
+  RUN_TEST(test_wheel_blocked_while_driving);
+  RUN_TEST(test_wheel_rolling_freely_not_spinning);
+  RUN_TEST(test_wheel_spinning);
+  RUN_TEST(test_flag_cleared_on_new_speed);
+  RUN_TEST(test_nothing_flagged_while_settling);
+  return UNITY_END();
+}
@@ -0,0 +1,216 @@
+#include <unity.h>
+#include <vector>
+#include "mqtt_publisher.h"
+#include "native_mqtt_transport.h"
+
+static const uint8_t STEP = 100;    // ms, how often the main loop runs in these tests.
+
+/**
+* Publisher reporting a status the test controls, through a StatusSnapshot as in the mower.
+*/
+struct Publisher {
+  StatusSnapshot snapshot;
+  TestTransport transport;
+  MqttPublisher publisher;
+  MowerStatus mower;
+
+  Publisher() : publisher(snapshot, transport, "liam") {
+    mower.state = 3;
+    mower.batteryVoltage = 16.4;
+    mower.batteryLevel = 80;
+    mower.batteryChargeCurrent = 850;
+    mower.cutterLoad = 30;
+    mower.leftWheelSpd = 80;
+    mower.rightWheelSpd = 80;
+    mower.heading = 355;
+
+    snapshot.onCollect([this](MowerStatus& status, const char*& stateName) {
+      status = mower;
+      status.uptime = millis() / 1000;
+      stateName = "MOWING";
+    });
+  }
+
+  /**
+  * Run main loop, broker acknowledges everything it gets right away while connected.
+  */
+  void run(uint32_t duration) {
+    for (uint32_t elapsed = 0; elapsed < duration; elapsed += STEP) {
+      Native::advanceMillis(STEP);
+      snapshot.process();
+      publisher.process();
+
+      if (transport.connected) {
+        transport.ackPending();
+      } else {
+        transport.pending.clear();
+      }
+    }
+  }
+
+  uint32_t count(const char* topic) const {
+    uint32_t count = 0;
+    for (auto& message : transport.sent) {
+      count += message.topic == topic;
+    }
+    return count;
+  }
+};
+
+Publisher* publisher;
+
+void setUp() {
+  Native::setMillis(1000);
+  randomSeed(4);
+  publisher = new Publisher();
+}
+
+void tearDown() {
+  delete publisher;
+}
+
+void test_status_published_at_start() {
+  publisher->run(STEP);
+
+  TEST_ASSERT_EQUAL(1, publisher->transport.sent.size());
+  auto& message = publisher->transport.sent[0];
+  TEST_ASSERT_EQUAL_STRING("liam/status", message.topic.c_str());
+  TEST_ASSERT_FALSE(message.retain);
+  // the same JSON as the REST API.
+  TEST_ASSERT_EQUAL_STRING(publisher->snapshot.getJson().c_str(), message.payload.c_str());
+}
+
+void test_state_published_right_away() {
+  publisher->run(1000);
+
+  publisher->publisher.onStateChanged("DOCKING");
+
+  auto& message = publisher->transport.sent.back();
+  TEST_ASSERT_EQUAL_STRING("liam/state", message.topic.c_str());
+  TEST_ASSERT_EQUAL_STRING("DOCKING", message.payload.c_str());
+  TEST_ASSERT_TRUE(message.retain);
+}
+
+struct change {
+  const char* name;
+  void (*small)(MowerStatus& status);   // within deadband, nullptr if any change counts.
+  void (*large)(MowerStatus& status);
+};
+
+/**
+* Each value is published once it has changed more than its deadband, smaller changes wait for the heartbeat.
+*/
+void test_deadbands() {
+  static const change changes[] = {
+    { "state", nullptr, [](MowerStatus& s) { s.state = 4; } },
+    { "isCharging", nullptr, [](MowerStatus& s) { s.isCharging = true; } },
+    { "cutterRotating", nullptr, [](MowerStatus& s) { s.cutterRotating = true; } },
+    { "batteryLevel", nullptr, [](MowerStatus& s) { s.batteryLevel = 79; } },
+    { "batteryVoltage", [](MowerStatus& s) { s.batteryVoltage = 16.36; }, [](MowerStatus& s) { s.batteryVoltage = 16.34; } },
+    { "batteryChargeCurrent", [](MowerStatus& s) { s.batteryChargeCurrent = 860; }, [](MowerStatus& s) { s.batteryChargeCurrent = 870; } },
+    { "cutterLoad", [](MowerStatus& s) { s.cutterLoad = 34; }, [](MowerStatus& s) { s.cutterLoad = 35; } },
+    { "leftWheelSpd", [](MowerStatus& s) { s.leftWheelSpd = 76; }, [](MowerStatus& s) { s.leftWheelSpd = 75; } },
+    { "rightWheelSpd", [](MowerStatus& s) { s.rightWheelSpd = 84; }, [](MowerStatus& s) { s.rightWheelSpd = 85; } },
+    { "pitch", [](MowerStatus& s) { s.pitch = -2; }, [](MowerStatus& s) { s.pitch = -3; } },
+    { "roll", [](MowerStatus& s) { s.roll = 2; }, [](MowerStatus& s) { s.roll = 3; } },
+    // heading wraps around.
+    { "heading", [](MowerStatus& s) { s.heading = 4; }, [](MowerStatus& s) { s.heading = 5; } },
+    { "heading back", [](MowerStatus& s) { s.heading = 346; }, [](MowerStatus& s) { s.heading = 345; } },
+  };
+
+  for (auto& change : changes) {
+    delete publisher;
+    publisher = new Publisher();
+    publisher->run(5000);
+
+    if (change.small != nullptr) {
+      change.small(publisher->mower);
+      publisher->run(50000);
+      TEST_ASSERT_EQUAL_MESSAGE(1, publisher->count("liam/status"), change.name);
+    }
+
+    change.large(publisher->mower);
+    publisher->run(STEP * 2);
+    TEST_ASSERT_EQUAL_MESSAGE(2, publisher->count("liam/status"), change.name);
+  }
+}
+
+void test_not_more_often_than_min_interval() {
+  publisher->run(STEP);
+
+  // voltage sagging fast, a new value every half second.
+  for (uint8_t i = 0; i < 20; i++) {
+    publisher->mower.batteryVoltage -= 0.1;
+    publisher->run(500);
+  }
+
+  TEST_ASSERT_EQUAL(1 + 10000 / 2000, publisher->count("liam/status"));
+}
+
+void test_heartbeat_when_nothing_changes() {
+  publisher->run(5 * 60000 + STEP);
+
+  TEST_ASSERT_EQUAL(1 + 5, publisher->count("liam/status"));
+  // uptime is not a change, but goes along with each message.
+  TEST_ASSERT_TRUE(publisher->transport.sent.back().payload.find(",\"uptime\":301}") != std::string::npos);
+}
+
+/**
+* Two hours of mowing lanes, with a 10 minute broker outage.
+*/
+void test_mowing_with_outage() {
+  std::vector<std::string> states;
+
+  for (uint32_t second = 0; second < 2 * 3600; second++) {
+    auto& mower = publisher->mower;
+    // 30 s lanes, turning at each end.
+    auto lane = second / 30;
+    bool turning = second % 30 >= 27;
+    mower.heading = (lane % 2 ? 90 : 270) + (turning ? 60 * (second % 30 - 26) : 0);
+    mower.leftWheelSpd = turning ? -40 : 80;
+    mower.rightWheelSpd = turning ? 40 : 80;
+    mower.cutterLoad = 30 + random(0, 12);
+    mower.pitch = random(-2, 3);
+    mower.roll = random(-2, 3);
+    mower.batteryVoltage = 16.4 - second / 7200.0f * 1.6 + random(-10, 11) / 1000.0f;
+    mower.batteryLevel = 80 - second / 120;
+
+    publisher->transport.connected = second < 1800 || second >= 2400;
+    if (second % 900 == 0) {
+      states.push_back(second % 1800 == 0 ? "MOWING" : "DOCKING");
+      publisher->publisher.onStateChanged(states.back().c_str());
+    }
+    publisher->run(1000);
+  }
+
+  auto& statistics = publisher->publisher.getStatistics();
+  char message[160];
+  sprintf(message, "%u status messages, %u published, %u dropped, queue peak %u bytes, MqttPublisher %u bytes", publisher->count("liam/status"),
+    statistics.published, statistics.dropped, statistics.maxQueueBytes, (unsigned)sizeof(MqttPublisher));
+  TEST_MESSAGE(message);
+
+  // every state arrived, in order.
+  std::vector<std::string> received;
+  for (auto& message : publisher->transport.sent) {
+    if (message.topic == "liam/state" && (received.empty() || received.back() != message.payload)) {
+      received.push_back(message.payload);
+    }
+  }
+  TEST_ASSERT_TRUE(states == received);
+  TEST_ASSERT_EQUAL(0, publisher->publisher.getQueueLength());
+  TEST_ASSERT_LESS_OR_EQUAL(4096, statistics.maxQueueBytes);
+  // a change now and then while mowing, limited by MIN_INTERVAL.
+  TEST_ASSERT_GREATER_THAN(2 * 3600 / 60, publisher->count("liam/status"));
+  TEST_ASSERT_LESS_OR_EQUAL(2 * 3600 / 2, publisher->count("liam/status"));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_status_published_at_start);
+  RUN_TEST(test_state_published_right_away);
+  RUN_TEST(test_deadbands);
+  RUN_TEST(test_not_more_often_than_min_interval);
+  RUN_TEST(test_heartbeat_when_nothing_changes);
+  RUN_TEST(test_mowing_with_outage);
+  return UNITY_END();
+}
@@ -0,0 +1,228 @@
+#include <unity.h>
+#include <vector>
+#include "mqtt_queue.h"
+#include "native_mqtt_transport.h"
+
+struct Broker {
+  TestTransport transport;
+  MqttQueue queue;
+
+  Broker() : queue(transport) { }
+};
+
+Broker* broker;
+TestTransport* transport;
+MqttQueue* queue;
+
+void setUp() {
+  Native::setMillis(1000);
+  randomSeed(1);
+  broker = new Broker();
+  transport = &broker->transport;
+  queue = &broker->queue;
+}
+
+void tearDown() {
+  delete broker;
+}
+
+void test_sends_queued_messages_in_order_when_connected() {
+  transport->connected = false;
+  queue->enqueue("liam/state", "MOWING", true, false);
+  queue->enqueue("liam/status", "{}", false, true);
+  queue->process(millis());
+
+  TEST_ASSERT_EQUAL(0, transport->sent.size());
+  TEST_ASSERT_EQUAL(2, queue->getLength());
+
+  transport->connected = true;
+  queue->process(millis());
+
+  TEST_ASSERT_EQUAL(2, transport->sent.size());
+  TEST_ASSERT_EQUAL_STRING("liam/state", transport->sent[0].topic.c_str());
+  TEST_ASSERT_EQUAL_STRING("MOWING", transport->sent[0].payload.c_str());
+  TEST_ASSERT_TRUE(transport->sent[0].retain);
+  TEST_ASSERT_EQUAL_STRING("liam/status", transport->sent[1].topic.c_str());
+  TEST_ASSERT_FALSE(transport->sent[1].retain);
+}
+
+void test_ack_is_handled_by_process_not_by_callback() {
+  queue->enqueue("liam/state", "MOWING", true, false);
+  queue->process(millis());
+  transport->ackPending();
+
+  // callback only queues the acknowledgement, it is the main loop that removes the message.
+  TEST_ASSERT_EQUAL(1, queue->getLength());
+  TEST_ASSERT_EQUAL(0, queue->getStatistics().acknowledged);
+
+  queue->process(millis());
+
+  TEST_ASSERT_EQUAL(0, queue->getLength());
+  TEST_ASSERT_EQUAL(1, queue->getStatistics().acknowledged);
+  TEST_ASSERT_EQUAL(0, queue->getStatistics().queueBytes);
+}
+
+void test_limits_messages_in_flight() {
+  for (uint8_t i = 0; i < 6; i++) {
+    queue->enqueue("liam/state", "MOWING", true, false);
+  }
+  queue->process(millis());
+
+  TEST_ASSERT_EQUAL(4, transport->sent.size());
+
+  transport->ack(transport->sent[0].packetId);
+  queue->process(millis());
+
+  TEST_ASSERT_EQUAL(5, transport->sent.size());
+}
+
+void test_resends_unacknowledged_message() {
+  queue->enqueue("liam/state", "MOWING", true, false);
+  queue->process(millis());
+  transport->pending.clear();
+
+  Native::advanceMillis(9999);
+  queue->process(millis());
+  TEST_ASSERT_EQUAL(1, transport->sent.size());
+
+  Native::advanceMillis(1);
+  queue->process(millis());
+  TEST_ASSERT_EQUAL(2, transport->sent.size());
+  TEST_ASSERT_EQUAL(1, queue->getStatistics().retries);
+
+  // first attempt acknowledged late, the second acknowledgement finds nothing to remove.
+  transport->ack(transport->sent[0].packetId);
+  transport->ack(transport->sent[1].packetId);
+  queue->process(millis());
+
+  TEST_ASSERT_EQUAL(0, queue->getLength());
+  TEST_ASSERT_EQUAL(1, queue->getStatistics().acknowledged);
+}
+
+void test_busy_transport_is_tried_again() {
+  transport->busy = true;
+  queue->enqueue("liam/state", "MOWING", true, false);
+  queue->process(millis());
+
+  TEST_ASSERT_EQUAL(0, queue->getStatistics().published);
+
+  transport->busy = false;
+  queue->process(millis());
+
+  TEST_ASSERT_EQUAL(1, queue->getStatistics().published);
+  TEST_ASSERT_EQUAL(0, queue->getStatistics().retries);
+}
+
+void test_full_queue_drops_status_before_state() {
+  transport->connected = false;
+  queue->enqueue("liam/state", "MOWING", true, false);
+  for (uint8_t i = 0; i < 25; i++) {
+    queue->enqueue("liam/status", String("{\"n\":") + std::to_string(i).c_str() + "}", false, true);
+  }
+
+  TEST_ASSERT_EQUAL(20, queue->getLength());
+  TEST_ASSERT_EQUAL(6, queue->getStatistics().dropped);
+
+  transport->connected = true;
+  queue->process(millis());
+
+  // state survives, the oldest status messages are the ones gone.
+  TEST_ASSERT_EQUAL_STRING("liam/state", transport->sent[0].topic.c_str());
+  TEST_ASSERT_EQUAL_STRING("{\"n\":6}", transport->sent[1].payload.c_str());
+}
+
+void test_queue_is_bounded_in_bytes() {
+  transport->connected = false;
+  String payload(std::string(1000, 'x'));
+
+  for (uint8_t i = 0; i < 10; i++) {
+    queue->enqueue("liam/status", payload, false, true);
+  }
+
+  TEST_ASSERT_LESS_OR_EQUAL(4096, queue->getStatistics().queueBytes);
+  TEST_ASSERT_LESS_OR_EQUAL(4096, queue->getStatistics().maxQueueBytes);
+  TEST_ASSERT_EQUAL(4, queue->getLength());
+}
+
+void test_lost_acknowledgements_are_resent_not_lost() {
+  queue->enqueue("liam/state", "MOWING", true, false);
+  queue->process(millis());
+
+  // more acknowledgements than the FIFO holds arrive before the main loop gets to run, the last one is lost.
+  for (uint16_t i = 0; i < 8; i++) {
+    transport->ack(1000 + i);
+  }
+  transport->ackPending();
+  queue->process(millis());
+
+  TEST_ASSERT_EQUAL(1, queue->getLength());
+
+  Native::advanceMillis(10000);
+  queue->process(millis());
+  transport->ackPending();
+  queue->process(millis());
+
+  TEST_ASSERT_EQUAL(2, transport->sent.size());
+  TEST_ASSERT_EQUAL(0, queue->getLength());
+}
+
+/**
+* Two hours of mowing with a ten minute outage and a lossy period, one state change every ten minutes and status every two seconds.
+* Every state change must reach the broker, in order, and the queue must stay within its bounds.
+*/
+void test_state_changes_survive_outage_and_loss() {
+  const char* states[] = {"MOWING", "DOCKING", "CHARGING", "DOCKED"};
+  std::vector<std::string> expected;
+  uint32_t start = millis();
+
+  for (uint32_t t = 0; t < 2 * 3600000UL; t += 100) {
+    Native::setMillis(start + t);
+    transport->connected = t < 1800000 || t >= 2400000;
+    transport->lossPercent = t >= 3600000 && t < 4200000 ? 20 : 0;
+
+    if (t % 600000 == 0) {
+      expected.push_back(states[expected.size() % 4]);
+      queue->enqueue("liam/state", expected.back().c_str(), true, false);
+    }
+    if (t % 2000 == 0) {
+      queue->enqueue("liam/status", "{\"batteryVoltage\":15.2,\"cutterLoad\":35}", false, true);
+    }
+    if (!transport->connected) {
+      // acknowledgements don't survive a lost connection.
+      transport->pending.clear();
+    } else if (t % 300 == 0) {
+      transport->ackPending();
+    }
+    queue->process(millis());
+  }
+
+  std::vector<std::string> received;
+  for (auto& msg : transport->sent) {
+    // QoS 1 allows duplicates, a resent message is the same state again.
+    if (msg.topic == "liam/state" && (received.empty() || received.back() != msg.payload)) {
+      received.push_back(msg.payload);
+    }
+  }
+
+  TEST_ASSERT_EQUAL(expected.size(), received.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    TEST_ASSERT_EQUAL_STRING(expected[i].c_str(), received[i].c_str());
+  }
+  TEST_ASSERT_GREATER_THAN(0, queue->getStatistics().dropped);
+  TEST_ASSERT_GREATER_THAN(0, queue->getStatistics().retries);
+  TEST_ASSERT_LESS_OR_EQUAL(4096, queue->getStatistics().maxQueueBytes);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_sends_queued_messages_in_order_when_connected);
+  RUN_TEST(test_ack_is_handled_by_process_not_by_callback);
+  RUN_TEST(test_limits_messages_in_flight);
+  RUN_TEST(test_resends_unacknowledged_message);
+  RUN_TEST(test_busy_transport_is_tried_again);
+  RUN_TEST(test_full_queue_drops_status_before_state);
+  RUN_TEST(test_queue_is_bounded_in_bytes);
+  RUN_TEST(test_lost_acknowledgements_are_resent_not_lost);
+  RUN_TEST(test_state_changes_survive_outage_and_loss);
+  return UNITY_END();
+}
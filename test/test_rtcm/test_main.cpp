@@ -0,0 +1,381 @@
+#include <unity.h>
+#include <deque>
+#include <vector>
+#include <Wire.h>
+#include "rtcm.h"
+
+static const uint16_t GPS_ADDRESS = 0x42;
+
+// shared by everything on the I2C bus, like in main.cpp.
+SemaphoreHandle_t i2cLock = xSemaphoreCreateMutex();
+
+typedef std::vector<uint8_t> bytes;
+
+bytes makeFrame(uint16_t type, uint16_t payloadLength, uint8_t fill = 0) {
+  bytes frame = { Rtcm::PREAMBLE, (uint8_t)(payloadLength >> 8), (uint8_t)payloadLength, (uint8_t)(type >> 4), (uint8_t)((type << 4) | (fill & 0x0F)) };
+
+  for (uint16_t i = 2; i < payloadLength; i++) {
+    frame.push_back(fill + i);
+  }
+
+  auto crc = Rtcm::crc24q(frame.data(), frame.size());
+  frame.push_back(crc >> 16);
+  frame.push_back(crc >> 8);
+  frame.push_back(crc);
+
+  return frame;
+}
+
+void append(bytes& to, const bytes& from) {
+  to.insert(to.end(), from.begin(), from.end());
+}
+
+struct parsedFrames {
+  std::vector<bytes> frames;
+  std::vector<uint16_t> types;
+};
+
+parsedFrames parseAll(const bytes& stream) {
+  parsedFrames result;
+  RtcmParser parser([&result](const uint8_t* frame, size_t length, uint16_t type) {
+    result.frames.push_back(bytes(frame, frame + length));
+    result.types.push_back(type);
+  });
+
+  parser.parse(stream.data(), stream.size());
+
+  return result;
+}
+
+bytes injected() {
+  bytes data;
+  for (auto& transaction : Wire.transactions) {
+    append(data, transaction.data);
+  }
+  return data;
+}
+
+void runInjector(RtcmInjector& injector, uint32_t duration) {
+  for (uint32_t i = 0; i < duration; i++) {
+    injector.process();
+    Native::advanceMillis(1);
+  }
+}
+
+void setUp() {
+  Native::setMillis(1000);
+  randomSeed(5);
+  Wire.clear();
+}
+
+void tearDown() { }
+
+void test_crc24q() {
+  const char* check = "123456789";
+
+  TEST_ASSERT_EQUAL_HEX32(0xCDE703, Rtcm::crc24q((const uint8_t*)check, 9));
+}
+
+void test_frame_length_and_type() {
+  auto frame = makeFrame(1077, 100);
+
+  TEST_ASSERT_EQUAL(frame.size(), Rtcm::getFrameLength(frame.data(), frame.size()));
+  TEST_ASSERT_EQUAL(1077, Rtcm::getMessageType(frame.data()));
+  // incomplete, or damaged.
+  TEST_ASSERT_EQUAL(0, Rtcm::getFrameLength(frame.data(), frame.size() - 1));
+  frame[10] ^= 0x01;
+  TEST_ASSERT_EQUAL(0, Rtcm::getFrameLength(frame.data(), frame.size()));
+}
+
+void test_parser_skips_other_messages() {
+  bytes stream;
+  const char* nmea = "$GNGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n";
+  append(stream, bytes(nmea, nmea + strlen(nmea)));
+  append(stream, makeFrame(1005, 19));
+  // UBX message with a preamble byte inside.
+  append(stream, { 0xB5, 0x62, 0x01, 0x07, 0x04, 0x00, 0xD3, 0xFF, 0x00, 0x12, 0x34, 0x56 });
+  append(stream, makeFrame(1077, 200));
+  append(stream, bytes(nmea, nmea + strlen(nmea)));
+
+  auto parsed = parseAll(stream);
+
+  TEST_ASSERT_EQUAL(2, parsed.frames.size());
+  TEST_ASSERT_EQUAL(1005, parsed.types[0]);
+  TEST_ASSERT_EQUAL(1077, parsed.types[1]);
+}
+
+void test_parser_resyncs_after_damaged_frame() {
+  auto damaged = makeFrame(1087, 150);
+  damaged[20] ^= 0xFF;
+  bytes stream;
+  // claims to be longer than it is, so the next frame starts within it.
+  append(stream, { Rtcm::PREAMBLE, 0x00, 0x40, 0x12, 0x34 });
+  append(stream, makeFrame(1005, 19));
+  append(stream, damaged);
+  append(stream, makeFrame(1097, 80));
+
+  auto parsed = parseAll(stream);
+
+  TEST_ASSERT_EQUAL(2, parsed.frames.size());
+  TEST_ASSERT_EQUAL(1005, parsed.types[0]);
+  TEST_ASSERT_EQUAL(1097, parsed.types[1]);
+}
+
+void test_parser_handles_frames_split_across_reads() {
+  auto frame = makeFrame(1230, 30);
+  uint8_t count = 0;
+  RtcmParser parser([&count](const uint8_t*, size_t, uint16_t) {
+    count++;
+  });
+
+  parser.parse(frame.data(), 2);
+  parser.parse(frame.data() + 2, 10);
+  TEST_ASSERT_EQUAL(0, count);
+  parser.parse(frame.data() + 12, frame.size() - 12);
+  TEST_ASSERT_EQUAL(1, count);
+}
+
+void test_filter_drops_types_not_allowed() {
+  RtcmFilter filter({ 1005, 1077 });
+  auto legacy = makeFrame(1004, 100);
+
+  TEST_ASSERT_TRUE(filter.accept(makeFrame(1077, 100).data(), 106, millis()));
+  TEST_ASSERT_FALSE(filter.accept(legacy.data(), legacy.size(), millis()));
+  TEST_ASSERT_EQUAL(1, filter.getDroppedFrames());
+  TEST_ASSERT_EQUAL(legacy.size(), filter.getDroppedBytes());
+}
+
+void test_filter_sends_static_messages_when_changed_or_due() {
+  RtcmFilter filter({ 1005, 1077 });
+  auto position = makeFrame(1005, 19, 1);
+  auto moved = makeFrame(1005, 19, 2);
+  auto observations = makeFrame(1077, 100);
+
+  TEST_ASSERT_TRUE(filter.accept(position.data(), position.size(), 1000));
+  TEST_ASSERT_FALSE(filter.accept(position.data(), position.size(), 2000));
+  // observations are always sent.
+  TEST_ASSERT_TRUE(filter.accept(observations.data(), observations.size(), 2000));
+  TEST_ASSERT_TRUE(filter.accept(observations.data(), observations.size(), 2000));
+
+  TEST_ASSERT_TRUE(filter.accept(moved.data(), moved.size(), 3000));
+  TEST_ASSERT_FALSE(filter.accept(moved.data(), moved.size(), 32999));
+  TEST_ASSERT_TRUE(filter.accept(moved.data(), moved.size(), 33000));
+}
+
+void test_batcher_packs_epoch_without_splitting_frames() {
+  std::vector<bytes> batches;
+  RtcmBatcher batcher(240, [&batches](const uint8_t* data, size_t length) {
+    batches.push_back(bytes(data, data + length));
+  });
+  auto frame = makeFrame(1077, 94);  // 100 bytes
+
+  for (uint8_t i = 0; i < 5; i++) {
+    batcher.add(frame.data(), frame.size(), 1000 + i);
+  }
+  batcher.process(1010);
+  TEST_ASSERT_EQUAL(2, batches.size());
+
+  // burst is over.
+  batcher.process(1024);
+  TEST_ASSERT_EQUAL(3, batches.size());
+  TEST_ASSERT_EQUAL(1 + 2 * 100, batches[0].size());
+  TEST_ASSERT_EQUAL(1 + 100, batches[2].size());
+
+  // all batches of an epoch have the same sequence number, next epoch the next one.
+  TEST_ASSERT_EQUAL(0, batches[0][0]);
+  TEST_ASSERT_EQUAL(0, batches[2][0]);
+  batcher.add(frame.data(), frame.size(), 2000);
+  batcher.process(2100);
+  TEST_ASSERT_EQUAL(1, batches[3][0]);
+}
+
+void test_injector_writes_frames_in_chunks() {
+  RtcmInjector injector(GPS_ADDRESS, i2cLock);
+  bytes batch = { 0 };
+  append(batch, makeFrame(1005, 19));
+  append(batch, makeFrame(1077, 150));
+  // 225 bytes in all, a full chunk after six others would leave a single byte behind.
+  append(batch, makeFrame(1087, 38));
+
+  injector.inject(batch.data(), batch.size());
+  runInjector(injector, 100);
+
+  for (auto& transaction : Wire.transactions) {
+    TEST_ASSERT_EQUAL_HEX16(GPS_ADDRESS, transaction.address);
+    TEST_ASSERT_LESS_OR_EQUAL(32, transaction.data.size());
+    TEST_ASSERT_GREATER_THAN(1, transaction.data.size());
+  }
+  TEST_ASSERT_EQUAL(8, Wire.transactions.size());
+  TEST_ASSERT_EQUAL(31, Wire.transactions[6].data.size());
+  TEST_ASSERT_TRUE(bytes(batch.begin() + 1, batch.end()) == injected());
+  TEST_ASSERT_EQUAL(3, injector.getStatistics().framesInjected);
+  TEST_ASSERT_EQUAL(100, injector.getCorrectionAge());
+}
+
+void test_injector_paces_writes() {
+  RtcmInjector injector(GPS_ADDRESS, i2cLock);
+  bytes batch = { 0 };
+  append(batch, makeFrame(1077, 500));
+
+  injector.inject(batch.data(), batch.size());
+  runInjector(injector, 10);
+
+  // one chunk per CHUNK_INTERVAL (2 ms).
+  TEST_ASSERT_EQUAL(5, Wire.transactions.size());
+}
+
+void test_injector_retries_failed_write() {
+  RtcmInjector injector(GPS_ADDRESS, i2cLock);
+  bytes batch = { 0 };
+  append(batch, makeFrame(1077, 100));
+  Wire.failures = 2;
+
+  injector.inject(batch.data(), batch.size());
+  runInjector(injector, 100);
+
+  TEST_ASSERT_EQUAL(2, injector.getStatistics().writeErrors);
+  TEST_ASSERT_TRUE(bytes(batch.begin() + 1, batch.end()) == injected());
+}
+
+void test_injector_waits_for_busy_bus() {
+  RtcmInjector injector(GPS_ADDRESS, i2cLock);
+  bytes batch = { 0 };
+  append(batch, makeFrame(1077, 100));
+
+  injector.inject(batch.data(), batch.size());
+  // another device is being read.
+  xSemaphoreTake(i2cLock, portMAX_DELAY);
+  runInjector(injector, 10);
+
+  TEST_ASSERT_EQUAL(0, Wire.transactions.size());
+
+  xSemaphoreGive(i2cLock);
+  runInjector(injector, 100);
+
+  TEST_ASSERT_EQUAL(0, injector.getStatistics().writeErrors);
+  TEST_ASSERT_TRUE(bytes(batch.begin() + 1, batch.end()) == injected());
+}
+
+void test_injector_drops_stale_and_invalid_batches() {
+  RtcmInjector injector(GPS_ADDRESS, i2cLock);
+  bytes newer = { 5 };
+  bytes older = { 4 };
+  append(newer, makeFrame(1077, 50));
+  append(older, makeFrame(1077, 60));
+
+  injector.inject(newer.data(), newer.size());
+  injector.inject(older.data(), older.size());
+  TEST_ASSERT_EQUAL(1, injector.getStatistics().batchesStale);
+
+  // rest of a batch is not trusted after a bad frame.
+  bytes damaged = { 6 };
+  append(damaged, makeFrame(1087, 50));
+  damaged[10] ^= 0x01;
+  append(damaged, makeFrame(1097, 50));
+  injector.inject(damaged.data(), damaged.size());
+  TEST_ASSERT_EQUAL(1, injector.getStatistics().framesInvalid);
+  TEST_ASSERT_EQUAL(1, injector.getStatistics().framesReceived);
+}
+
+void test_injector_drops_whole_frames_when_full() {
+  RtcmInjector injector(GPS_ADDRESS, i2cLock);
+  bytes batch = { 0 };
+  auto frame = makeFrame(1077, 994);   // 1000 bytes
+
+  for (uint8_t i = 0; i < 3; i++) {
+    batch[0] = i;
+    bytes message = batch;
+    append(message, frame);
+    injector.inject(message.data(), message.size());
+  }
+
+  TEST_ASSERT_EQUAL(1, injector.getStatistics().framesDropped);
+  runInjector(injector, 1000);
+  TEST_ASSERT_EQUAL(2, parseAll(injected()).frames.size());
+}
+
+/**
+* Base station stream (observations every second, static messages and NMEA in between) through filter and batcher, over a link
+* that loses and reorders batches, to the GNSS module. Everything reaching the module must be whole, valid frames.
+*/
+void test_replay_over_lossy_link() {
+  const char* nmea = "$GNRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n";
+  RtcmFilter filter({ 1005, 1077, 1087, 1097, 1127, 1230 });
+  std::deque<bytes> link;
+  uint32_t sentFrames = 0;
+  RtcmBatcher batcher(240, [&link](const uint8_t* data, size_t length) {
+    if (random(100) >= 10) {
+      link.push_back(bytes(data, data + length));
+    }
+  });
+  RtcmParser parser([&](const uint8_t* frame, size_t length, uint16_t) {
+    if (filter.accept(frame, length, millis())) {
+      batcher.add(frame, length, millis());
+      sentFrames++;
+    }
+  });
+  RtcmInjector injector(GPS_ADDRESS, i2cLock);
+
+  for (uint16_t epoch = 0; epoch < 120; epoch++) {
+    bytes stream(nmea, nmea + strlen(nmea));
+    append(stream, makeFrame(1005, 19));
+    append(stream, makeFrame(1033, 40));
+    append(stream, makeFrame(1004, 120, epoch));
+    append(stream, makeFrame(1077, 180 + epoch % 20, epoch));
+    append(stream, makeFrame(1087, 150, epoch));
+    append(stream, makeFrame(1097, 120, epoch));
+    append(stream, makeFrame(1127, 100, epoch));
+    append(stream, makeFrame(1230, 10));
+    parser.parse(stream.data(), stream.size());
+
+    for (uint16_t ms = 0; ms < 1000; ms++) {
+      batcher.process(millis());
+      // now and then a batch is held back by a retransmission and arrives after the next one.
+      if (link.size() >= 2 && random(100) < 5) {
+        std::swap(link[0], link[1]);
+      }
+      if (!link.empty() && ms % 50 == 0) {
+        injector.inject(link.front().data(), link.front().size());
+        link.pop_front();
+      }
+      injector.process();
+      Native::advanceMillis(1);
+    }
+  }
+
+  auto module = injected();
+  auto parsed = parseAll(module);
+  size_t parsedBytes = 0;
+  for (auto& frame : parsed.frames) {
+    parsedBytes += frame.size();
+  }
+
+  // nothing but whole frames, and no more than was sent.
+  TEST_ASSERT_EQUAL(module.size(), parsedBytes);
+  TEST_ASSERT_EQUAL(injector.getStatistics().framesInjected, parsed.frames.size());
+  TEST_ASSERT_LESS_OR_EQUAL(sentFrames, parsed.frames.size());
+  TEST_ASSERT_GREATER_THAN(sentFrames * 8 / 10, parsed.frames.size());
+  TEST_ASSERT_EQUAL(0, parser.getInvalidFrames());
+  TEST_ASSERT_GREATER_THAN(0, filter.getDroppedBytes());
+  TEST_ASSERT_LESS_THAN(2000, injector.getCorrectionAge());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_crc24q);
+  RUN_TEST(test_frame_length_and_type);
+  RUN_TEST(test_parser_skips_other_messages);
+  RUN_TEST(test_parser_resyncs_after_damaged_frame);
+  RUN_TEST(test_parser_handles_frames_split_across_reads);
+  RUN_TEST(test_filter_drops_types_not_allowed);
+  RUN_TEST(test_filter_sends_static_messages_when_changed_or_due);
+  RUN_TEST(test_batcher_packs_epoch_without_splitting_frames);
+  RUN_TEST(test_injector_writes_frames_in_chunks);
+  RUN_TEST(test_injector_paces_writes);
+  RUN_TEST(test_injector_retries_failed_write);
+  RUN_TEST(test_injector_waits_for_busy_bus);
+  RUN_TEST(test_injector_drops_stale_and_invalid_batches);
+  RUN_TEST(test_injector_drops_whole_frames_when_full);
+  RUN_TEST(test_replay_over_lossy_link);
+  return UNITY_END();
+}
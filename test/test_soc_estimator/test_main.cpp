@@ -0,0 +1,233 @@
+#include <unity.h>
+#include "soc_estimator.h"
+
+static const HardwareProfile::Battery& BATTERY = HardwareProfiles::LIION_4S_BATTERY;
+static const uint8_t CURVE_POINTS = HardwareProfile::Battery::SOC_CURVE_POINTS;
+
+/**
+* Battery with an open circuit voltage that follows the chemistry curve, and a voltage that sags with internal resistance under load.
+*/
+struct Pack {
+  float capacity;       // mAh
+  float resistance;     // ohm
+  float soc;
+
+  Pack(float capacity, float resistance, float soc) : capacity(capacity), resistance(resistance), soc(soc) { }
+
+  float getOpenCircuitVoltage() const {
+    float position = constrain(soc, 0.0f, 1.0f) * (CURVE_POINTS - 1);
+    uint8_t i = min((uint8_t)position, (uint8_t)(CURVE_POINTS - 2));
+    float level = BATTERY.socCurve[i] + (BATTERY.socCurve[i + 1] - BATTERY.socCurve[i]) * (position - i);
+
+    return BATTERY.empty + level * (BATTERY.fullyCharged - BATTERY.empty);
+  }
+
+  /**
+  * Draw current (mA) for some seconds.
+  * @return terminal voltage while doing so.
+  */
+  float draw(float current, float seconds) {
+    soc -= current * seconds / 3600 / capacity;
+    return getOpenCircuitVoltage() - current / 1000 * resistance;
+  }
+};
+
+SocEstimator* estimator;
+
+void setUp() {
+  randomSeed(11);
+  estimator = new SocEstimator(BATTERY.capacity, BATTERY.empty, BATTERY.fullyCharged, BATTERY.socCurve);
+}
+
+void tearDown() {
+  delete estimator;
+}
+
+/**
+* 20 mV of ADC noise, the battery voltage is rounded to two decimals just like Battery does.
+*/
+float measure(float voltage) {
+  return roundf((voltage + (random(41) - 20) / 1000.0f) * 100) / 100;
+}
+
+void test_voltage_to_soc_follows_curve() {
+  TEST_ASSERT_EQUAL_FLOAT(0, estimator->voltageToSoc(BATTERY.empty));
+  TEST_ASSERT_EQUAL_FLOAT(0, estimator->voltageToSoc(BATTERY.empty - 1));
+  TEST_ASSERT_EQUAL_FLOAT(1, estimator->voltageToSoc(BATTERY.fullyCharged));
+  TEST_ASSERT_EQUAL_FLOAT(1, estimator->voltageToSoc(BATTERY.fullyCharged + 1));
+
+  for (float soc = 0.05; soc < 1; soc += 0.1) {
+    Pack pack(BATTERY.capacity, 0, soc);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, soc, estimator->voltageToSoc(pack.getOpenCircuitVoltage()));
+  }
+}
+
+void test_reset_from_resting_voltage() {
+  Pack pack(BATTERY.capacity, 0.12, 0.7);
+  estimator->reset(pack.getOpenCircuitVoltage());
+
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 0.7, estimator->getStateOfCharge());
+  TEST_ASSERT_EQUAL_FLOAT(pack.getOpenCircuitVoltage(), estimator->getOpenCircuitVoltage());
+}
+
+void test_counts_charge_going_out() {
+  // same resistance as estimator starts out with, a steady load gives it nothing to learn from.
+  Pack pack(BATTERY.capacity, 0.15, 1);
+  estimator->reset(pack.getOpenCircuitVoltage());
+  estimator->update(0, pack.draw(0, 0), 0);
+
+  // half the capacity in one hour.
+  float current = BATTERY.capacity / 2;
+  float energy = 0;
+  for (uint32_t second = 1; second <= 3600; second++) {
+    float voltage = pack.draw(current, 1);
+    estimator->update(second * 1000, voltage, current);
+    energy += voltage * current / 1000 / 3600;
+  }
+
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 0.5, estimator->getStateOfCharge());
+  TEST_ASSERT_FLOAT_WITHIN(1, current, estimator->getAverageCurrent());
+  TEST_ASSERT_FLOAT_WITHIN(1, current, estimator->getWorkCurrent());
+  TEST_ASSERT_EQUAL(60, estimator->getRemainingMinutes());
+  TEST_ASSERT_FLOAT_WITHIN(0.1, energy, estimator->getEnergyUsed());
+}
+
+void test_charging_counts_up() {
+  Pack pack(BATTERY.capacity, 0.12, 0.2);
+  estimator->reset(pack.getOpenCircuitVoltage());
+  estimator->update(0, pack.draw(0, 0), 0);
+
+  for (uint32_t second = 1; second <= 1800; second++) {
+    estimator->update(second * 1000, pack.draw(-1500, 1), -1500);
+  }
+
+  TEST_ASSERT_FLOAT_WITHIN(0.02, pack.soc, estimator->getStateOfCharge());
+  TEST_ASSERT_EQUAL(UINT16_MAX, estimator->getRemainingMinutes());
+  TEST_ASSERT_EQUAL_FLOAT(0, estimator->getEnergyUsed());
+  TEST_ASSERT_EQUAL_FLOAT(0, estimator->getWorkCurrent());
+}
+
+void test_learns_internal_resistance_from_load_steps() {
+  Pack pack(BATTERY.capacity, 0.12, 0.8);
+  estimator->reset(pack.getOpenCircuitVoltage());
+  TEST_ASSERT_EQUAL_FLOAT(0.15, estimator->getInternalResistance());
+
+  // cutter starting and stopping every ten seconds.
+  for (uint32_t second = 0; second < 600; second++) {
+    float current = (second / 10) % 2 ? 3000 : 200;
+    estimator->update(second * 1000, pack.draw(current, 1), current);
+  }
+
+  TEST_ASSERT_FLOAT_WITHIN(0.005, 0.12, estimator->getInternalResistance());
+}
+
+void test_ignores_steps_across_long_gaps() {
+  Pack pack(BATTERY.capacity, 0.12, 0.8);
+  estimator->reset(pack.getOpenCircuitVoltage());
+
+  // a minute between updates, voltage has changed for other reasons than the load step.
+  for (uint32_t minute = 0; minute < 20; minute++) {
+    float current = minute % 2 ? 3000 : 200;
+    estimator->update(minute * 60000, pack.draw(current, 60) - 0.5, current);
+  }
+
+  TEST_ASSERT_EQUAL_FLOAT(0.15, estimator->getInternalResistance());
+}
+
+void test_work_current_kept_while_resting() {
+  Pack pack(BATTERY.capacity, 0.12, 0.8);
+  estimator->reset(pack.getOpenCircuitVoltage());
+
+  uint32_t second = 0;
+  for (; second < 600; second++) {
+    estimator->update(second * 1000, pack.draw(2500, 1), 2500);
+  }
+  for (; second < 1200; second++) {
+    estimator->update(second * 1000, pack.draw(50, 1), 50);
+  }
+
+  TEST_ASSERT_FLOAT_WITHIN(1, 50, estimator->getAverageCurrent());
+  TEST_ASSERT_FLOAT_WITHIN(100, 2500, estimator->getWorkCurrent());
+  TEST_ASSERT_EQUAL(UINT16_MAX, estimator->getRemainingMinutes());
+}
+
+void test_set_full() {
+  Pack pack(BATTERY.capacity, 0.12, 0.9);
+  estimator->reset(pack.getOpenCircuitVoltage());
+  estimator->setFull();
+
+  TEST_ASSERT_EQUAL_FLOAT(1, estimator->getStateOfCharge());
+}
+
+/**
+* Mow from full until the recharge condition Battery uses is met, with the cutter and wheels drawing 2-4 A that changes every few
+* seconds. Compares with mapping voltage straight to level, which is what we had before.
+* @return seconds from recharge triggered until pack is truly empty, negative if pack ran empty first.
+*/
+int32_t mowUntilEmpty(Pack& pack, float& maxError, float& maxVoltageError) {
+  estimator->reset(pack.getOpenCircuitVoltage());
+  maxError = 0;
+  maxVoltageError = 0;
+  float current = 0;
+
+  for (uint32_t second = 0; second < 24 * 3600; second++) {
+    if (second % 5 == 0) {
+      current = random(2000, 4001);
+    }
+
+    float voltage = measure(pack.draw(current, 1));
+    estimator->update(second * 1000, voltage, current);
+
+    // skip the first minutes, resistance has not been learned yet.
+    if (second > 300) {
+      float linear = constrain((voltage - BATTERY.empty) / (BATTERY.fullyCharged - BATTERY.empty), 0.0f, 1.0f);
+      maxError = max(maxError, fabsf(estimator->getStateOfCharge() - pack.soc));
+      maxVoltageError = max(maxVoltageError, fabsf(linear - pack.soc));
+    }
+
+    if (estimator->getStateOfCharge() <= 0 || estimator->getOpenCircuitVoltage() <= BATTERY.empty) {
+      return pack.soc * pack.capacity / current * 3600;
+    }
+  }
+
+  return INT32_MIN;
+}
+
+void test_mowing_until_empty() {
+  Pack pack(BATTERY.capacity, 0.12, 1);
+  float maxError, maxVoltageError;
+  auto margin = mowUntilEmpty(pack, maxError, maxVoltageError);
+
+  TEST_ASSERT_LESS_THAN_FLOAT(0.02, maxError);
+  TEST_ASSERT_GREATER_THAN_FLOAT(0.2, maxVoltageError);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 0.12, estimator->getInternalResistance());
+  // goes home when the pack is empty, give or take a few seconds of noise. BATTERY_EMPTY is above where cells take damage.
+  TEST_ASSERT_GREATER_OR_EQUAL(-10, margin);
+  TEST_ASSERT_LESS_THAN(60, margin);
+}
+
+void test_mowing_with_worn_battery() {
+  // pack has lost 14% of its capacity, voltage keeps the estimate from running too far away.
+  Pack pack(BATTERY.capacity * 0.86, 0.12, 1);
+  float maxError, maxVoltageError;
+  auto margin = mowUntilEmpty(pack, maxError, maxVoltageError);
+
+  TEST_ASSERT_LESS_THAN_FLOAT(0.1, maxError);
+  TEST_ASSERT_GREATER_OR_EQUAL(-10, margin);
+  TEST_ASSERT_LESS_THAN(60, margin);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_voltage_to_soc_follows_curve);
+  RUN_TEST(test_reset_from_resting_voltage);
+  RUN_TEST(test_counts_charge_going_out);
+  RUN_TEST(test_charging_counts_up);
+  RUN_TEST(test_learns_internal_resistance_from_load_steps);
+  RUN_TEST(test_ignores_steps_across_long_gaps);
+  RUN_TEST(test_work_current_kept_while_resting);
+  RUN_TEST(test_set_full);
+  RUN_TEST(test_mowing_until_empty);
+  RUN_TEST(test_mowing_with_worn_battery);
+  return UNITY_END();
+}
@@ -0,0 +1,193 @@
+#include <unity.h>
+#include "dockingstation/status_encoder.h"
+
+static const uint32_t ALL_FIELDS = (1UL << StatusEncoder::FIELD_COUNT) - 1;
+
+StatusEncoder* encoder;
+MowerStatus status;
+uint8_t buffer[128];
+
+MowerStatus makeStatus() {
+  MowerStatus status;
+
+  status.state = 3;
+  status.batteryVoltage = 15.432;
+  status.batteryLevel = 72;
+  status.batteryChargeCurrent = -12;
+  status.isCharging = true;
+  status.lastFullyChargeTime = 1234567;
+  status.lastChargeDuration = 5400;
+  status.cutterLoad = 35;
+  status.cutterRotating = true;
+  status.uptime = 98765;
+  status.leftWheelSpd = 80;
+  status.rightWheelSpd = -80;
+  status.pitch = -7;
+  status.roll = 4;
+  status.heading = 359;
+  status.obstacleFrontDistance = 120;
+  status.areaPerWh = 1.25;
+  status.whPerMowingHour = 42.5;
+
+  return status;
+}
+
+void setUp() {
+  encoder = new StatusEncoder();
+  status = makeStatus();
+}
+
+void tearDown() {
+  delete encoder;
+}
+
+void assertStatusEqual(const MowerStatus& expected, const MowerStatus& actual) {
+  TEST_ASSERT_EQUAL(expected.state, actual.state);
+  TEST_ASSERT_FLOAT_WITHIN(0.0005, expected.batteryVoltage, actual.batteryVoltage);
+  TEST_ASSERT_EQUAL(expected.batteryLevel, actual.batteryLevel);
+  TEST_ASSERT_FLOAT_WITHIN(0.5, expected.batteryChargeCurrent, actual.batteryChargeCurrent);
+  TEST_ASSERT_EQUAL(expected.isCharging, actual.isCharging);
+  TEST_ASSERT_EQUAL(expected.lastFullyChargeTime, actual.lastFullyChargeTime);
+  TEST_ASSERT_EQUAL(expected.lastChargeDuration, actual.lastChargeDuration);
+  TEST_ASSERT_EQUAL(expected.cutterLoad, actual.cutterLoad);
+  TEST_ASSERT_EQUAL(expected.cutterRotating, actual.cutterRotating);
+  TEST_ASSERT_EQUAL(expected.uptime, actual.uptime);
+  TEST_ASSERT_EQUAL(expected.leftWheelSpd, actual.leftWheelSpd);
+  TEST_ASSERT_EQUAL(expected.rightWheelSpd, actual.rightWheelSpd);
+  TEST_ASSERT_EQUAL(expected.pitch, actual.pitch);
+  TEST_ASSERT_EQUAL(expected.roll, actual.roll);
+  TEST_ASSERT_EQUAL(expected.heading, actual.heading);
+  TEST_ASSERT_EQUAL(expected.obstacleFrontDistance, actual.obstacleFrontDistance);
+  TEST_ASSERT_FLOAT_WITHIN(0.005, expected.areaPerWh, actual.areaPerWh);
+  TEST_ASSERT_FLOAT_WITHIN(0.05, expected.whPerMowingHour, actual.whPerMowingHour);
+}
+
+void test_keyframe_round_trip() {
+  auto length = encoder->encode(status, buffer, sizeof(buffer), 0);
+  TEST_ASSERT_GREATER_THAN(0, length);
+
+  MowerStatus decoded;
+  uint32_t sequence = 99;
+  TEST_ASSERT_EQUAL(ALL_FIELDS, StatusEncoder::decode(buffer, length, decoded, &sequence));
+  TEST_ASSERT_EQUAL(0, sequence);
+  assertStatusEqual(status, decoded);
+}
+
+void test_nothing_changed_sends_nothing() {
+  encoder->encode(status, buffer, sizeof(buffer), 0);
+
+  TEST_ASSERT_EQUAL(0, encoder->encode(status, buffer, sizeof(buffer), 1000));
+}
+
+void test_delta_only_has_changed_fields() {
+  encoder->encode(status, buffer, sizeof(buffer), 0);
+  MowerStatus received;
+  StatusEncoder::decode(buffer, encoder->encode(status, buffer, sizeof(buffer), 0, true), received);
+
+  status.cutterLoad = 60;
+  status.pitch = -12;
+  auto length = encoder->encode(status, buffer, sizeof(buffer), 1000);
+
+  uint32_t sequence;
+  TEST_ASSERT_EQUAL((1UL << StatusEncoder::CUTTER_LOAD) | (1UL << StatusEncoder::PITCH), StatusEncoder::decode(buffer, length, received, &sequence));
+  TEST_ASSERT_EQUAL(2, sequence);
+  // a delta merges into what was received before.
+  assertStatusEqual(status, received);
+}
+
+void test_changes_within_deadband_are_not_sent() {
+  encoder->encode(status, buffer, sizeof(buffer), 0);
+
+  status.batteryVoltage += 0.04;
+  status.cutterLoad += 5;
+  status.heading = 3;   // 4 degrees from 359
+  TEST_ASSERT_EQUAL(0, encoder->encode(status, buffer, sizeof(buffer), 1000));
+
+  status.heading = 5;
+  encoder->encode(status, buffer, sizeof(buffer), 2000);
+  TEST_ASSERT_EQUAL(1UL << StatusEncoder::HEADING, encoder->getLastFieldMask());
+}
+
+void test_slow_change_is_sent_once_past_deadband() {
+  encoder->encode(status, buffer, sizeof(buffer), 0);
+
+  // 30 mV at a time, each step within deadband but not all of them together.
+  status.batteryVoltage -= 0.03;
+  TEST_ASSERT_EQUAL(0, encoder->encode(status, buffer, sizeof(buffer), 1000));
+  status.batteryVoltage -= 0.03;
+  TEST_ASSERT_GREATER_THAN(0, encoder->encode(status, buffer, sizeof(buffer), 2000));
+  TEST_ASSERT_EQUAL(1UL << StatusEncoder::BATTERY_VOLTAGE, encoder->getLastFieldMask());
+}
+
+void test_keyframe_only_fields_wait_for_keyframe() {
+  encoder->encode(status, buffer, sizeof(buffer), 0);
+
+  status.uptime += 10;
+  status.areaPerWh = 2;
+  TEST_ASSERT_EQUAL(0, encoder->encode(status, buffer, sizeof(buffer), 10000));
+
+  TEST_ASSERT_GREATER_THAN(0, encoder->encode(status, buffer, sizeof(buffer), 30000));
+  TEST_ASSERT_EQUAL(ALL_FIELDS, encoder->getLastFieldMask());
+}
+
+void test_requested_keyframe() {
+  encoder->encode(status, buffer, sizeof(buffer), 0);
+  encoder->requestKeyframe();
+
+  encoder->encode(status, buffer, sizeof(buffer), 1000);
+  TEST_ASSERT_EQUAL(ALL_FIELDS, encoder->getLastFieldMask());
+}
+
+void test_excluded_field_appended_later() {
+  uint32_t excluded = 1UL << StatusEncoder::UPTIME;
+  auto length = encoder->encode(status, buffer, sizeof(buffer), 0, true, excluded);
+  TEST_ASSERT_EQUAL(ALL_FIELDS & ~excluded, encoder->getLastFieldMask());
+
+  length += StatusEncoder::encodeField(StatusEncoder::UPTIME, status, buffer + length, sizeof(buffer) - length);
+
+  MowerStatus decoded;
+  TEST_ASSERT_EQUAL(ALL_FIELDS, StatusEncoder::decode(buffer, length, decoded));
+  assertStatusEqual(status, decoded);
+}
+
+void test_buffer_too_small() {
+  TEST_ASSERT_EQUAL(0, encoder->encode(status, buffer, 10, 0));
+  TEST_ASSERT_EQUAL(0, StatusEncoder::encodeField(StatusEncoder::LAST_FULLY_CHARGE_TIME, status, buffer, 2));
+}
+
+void test_malformed_frame() {
+  auto length = encoder->encode(status, buffer, sizeof(buffer), 0);
+
+  MowerStatus decoded;
+  // cut off in the middle of a varint.
+  buffer[length - 1] |= 0x80;
+  TEST_ASSERT_EQUAL(-1, StatusEncoder::decode(buffer, length, decoded));
+}
+
+void test_deltas_are_smaller_than_full_frames() {
+  for (uint32_t second = 0; second < 600; second++) {
+    status.uptime = second;
+    status.heading = (second * 2) % 360;
+    status.batteryVoltage = 16 - second * 0.001;
+    status.cutterLoad = 30 + second % 10;
+    encoder->encode(status, buffer, sizeof(buffer), second * 1000);
+  }
+
+  TEST_ASSERT_LESS_THAN(encoder->getFullFrameBytes() / 2, encoder->getEncodedBytes());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_keyframe_round_trip);
+  RUN_TEST(test_nothing_changed_sends_nothing);
+  RUN_TEST(test_delta_only_has_changed_fields);
+  RUN_TEST(test_changes_within_deadband_are_not_sent);
+  RUN_TEST(test_slow_change_is_sent_once_past_deadband);
+  RUN_TEST(test_keyframe_only_fields_wait_for_keyframe);
+  RUN_TEST(test_requested_keyframe);
+  RUN_TEST(test_excluded_field_appended_later);
+  RUN_TEST(test_buffer_too_small);
+  RUN_TEST(test_malformed_frame);
+  RUN_TEST(test_deltas_are_smaller_than_full_frames);
+  return UNITY_END();
+}
@@ -0,0 +1,135 @@
+#include <unity.h>
+#include "status_snapshot.h"
+
+static const uint8_t STEP = 100;    // ms, how often the main loop collects status in these tests.
+
+/**
+* A snapshot collecting from a status the test controls, the battery readings with ADC noise on top.
+*/
+struct Snapshot {
+  StatusSnapshot snapshot;
+  MowerStatus mower;
+  float voltageNoise = 0;   // V, peak.
+  float currentNoise = 0;   // mA, peak.
+  uint32_t collected = 0;
+
+  Snapshot() {
+    mower.state = 2;
+    mower.batteryVoltage = 16.4;
+    mower.batteryLevel = 80;
+    mower.batteryChargeCurrent = 850;
+    mower.isCharging = true;
+    mower.heading = 90;
+
+    snapshot.onCollect([this](MowerStatus& status, const char*& stateName) {
+      status = mower;
+      status.batteryVoltage += random(-1000, 1001) / 1000.0f * voltageNoise;
+      status.batteryChargeCurrent += random(-1000, 1001) / 1000.0f * currentNoise;
+      status.uptime = millis() / 1000;
+      stateName = "CHARGING";
+      collected++;
+    });
+  }
+
+  /**
+  * Run main loop, every client asking for both encodings on each tick.
+  */
+  void run(uint32_t duration) {
+    uint8_t buffer[128];
+
+    for (uint32_t elapsed = 0; elapsed < duration; elapsed += STEP) {
+      Native::advanceMillis(STEP);
+      snapshot.process();
+      snapshot.getJson();
+      TEST_ASSERT_GREATER_THAN(0, snapshot.writeProtobuf(buffer, sizeof(buffer)));
+    }
+  }
+};
+
+Snapshot* snapshot;
+
+void setUp() {
+  Native::setMillis(1000);
+  randomSeed(5);
+  snapshot = new Snapshot();
+}
+
+void tearDown() {
+  delete snapshot;
+}
+
+void test_nothing_before_collector() {
+  StatusSnapshot empty;
+
+  empty.process();
+
+  TEST_ASSERT_EQUAL(0, empty.getVersion());
+}
+
+void test_same_version_on_sensor_noise() {
+  // a few mV and mA, less than what the sensors resolve.
+  snapshot->voltageNoise = 0.004;
+  snapshot->currentNoise = 4;
+
+  snapshot->run(60000);
+
+  TEST_ASSERT_EQUAL(600, snapshot->collected);
+  TEST_ASSERT_EQUAL(1, snapshot->snapshot.getVersion());
+  TEST_ASSERT_EQUAL(2, snapshot->snapshot.getEncodeCount());
+  TEST_ASSERT_EQUAL_FLOAT(16.4, snapshot->snapshot.getStatus().batteryVoltage);
+  TEST_ASSERT_EQUAL_FLOAT(850, snapshot->snapshot.getStatus().batteryChargeCurrent);
+  TEST_ASSERT_EQUAL_STRING("CHARGING", snapshot->snapshot.getStateName());
+}
+
+void test_new_version_on_real_change() {
+  snapshot->run(1000);
+  auto etag = snapshot->snapshot.getETag();
+  TEST_ASSERT_TRUE(snapshot->snapshot.isNotModified(etag));
+
+  snapshot->mower.batteryVoltage = 16.38;
+  snapshot->run(1000);
+  TEST_ASSERT_EQUAL(2, snapshot->snapshot.getVersion());
+  TEST_ASSERT_FALSE(snapshot->snapshot.isNotModified(etag));
+
+  snapshot->mower.batteryChargeCurrent = 820;
+  snapshot->run(1000);
+  snapshot->mower.heading = 91;
+  snapshot->run(1000);
+
+  // each version is encoded once, however many times it was asked for.
+  TEST_ASSERT_EQUAL(4, snapshot->snapshot.getVersion());
+  TEST_ASSERT_EQUAL(8, snapshot->snapshot.getEncodeCount());
+  TEST_ASSERT_TRUE(snapshot->snapshot.isNotModified(snapshot->snapshot.getETag()));
+  TEST_ASSERT_FALSE(snapshot->snapshot.isNotModified(""));
+}
+
+void test_uptime_kept_current_without_new_version() {
+  snapshot->run(5000);
+
+  TEST_ASSERT_EQUAL(1, snapshot->snapshot.getVersion());
+  TEST_ASSERT_EQUAL(6, snapshot->snapshot.getStatus().uptime);
+
+  auto json = snapshot->snapshot.getJson();
+  TEST_ASSERT_EQUAL('{', json[0]);
+  TEST_ASSERT_TRUE(json.indexOf("\"state\":\"CHARGING\"") > 0);
+  TEST_ASSERT_TRUE(json.indexOf("\"heading\":90,") > 0);
+  TEST_ASSERT_TRUE(json.indexOf(",\"uptime\":6}") > 0);
+
+  uint8_t buffer[128];
+  MowerStatus decoded;
+  auto length = snapshot->snapshot.writeProtobuf(buffer, sizeof(buffer));
+  // a keyframe, uptime appended to the cached part.
+  TEST_ASSERT_EQUAL((1UL << StatusEncoder::FIELD_COUNT) - 1, StatusEncoder::decode(buffer, length, decoded));
+  TEST_ASSERT_EQUAL(6, decoded.uptime);
+  TEST_ASSERT_EQUAL(90, decoded.heading);
+  TEST_ASSERT_EQUAL(0, snapshot->snapshot.writeProtobuf(buffer, 8));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_nothing_before_collector);
+  RUN_TEST(test_same_version_on_sensor_noise);
+  RUN_TEST(test_new_version_on_real_change);
+  RUN_TEST(test_uptime_kept_current_without_new_version);
+  return UNITY_END();
+}
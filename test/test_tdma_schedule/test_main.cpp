@@ -0,0 +1,407 @@
+#include <unity.h>
+#include <vector>
+#include "dockingstation/tdma_schedule.h"
+#include "dockingstation/tdma_allocator.h"
+#include "dockingstation/lora_link.h"
+
+static const uint16_t MOWER = 0x1234;
+static const uint16_t OTHER_MOWER = 0x5678;
+static const uint16_t SLOT_LENGTH = 500;
+static const RadioSettings SF9 = {125, 9, 5, 14, 8};
+
+static bool sameRate(const RadioSettings& a, const RadioSettings& b) {
+  return a.spreadingFactor == b.spreadingFactor && a.bandwidth == b.bandwidth && a.codingRate == b.codingRate && a.power == b.power;
+}
+
+static tdmaBeacon makeBeacon(uint16_t superframe, uint8_t slotCount) {
+  tdmaBeacon beacon;
+  beacon.superframe = superframe;
+  beacon.slotLength = SLOT_LENGTH;
+  beacon.slotCount = slotCount;
+  beacon.nextSettings = SF9;
+  for (uint8_t i = 0; i < slotCount; i++) {
+    beacon.slotOwners[i] = TdmaSchedule::FREE_SLOT;
+  }
+
+  return beacon;
+}
+
+static void receive(TdmaSchedule& schedule, const tdmaBeacon& beacon, uint32_t startTime) {
+  uint8_t buffer[64];
+  auto length = TdmaSchedule::encodeBeacon(beacon, buffer, sizeof(buffer));
+  TEST_ASSERT_GREATER_THAN(0, length);
+  schedule.onBeacon(buffer, length, startTime);
+}
+
+void setUp() {
+  randomSeed(7);
+}
+
+void tearDown() { }
+
+void test_beacon_round_trip() {
+  auto beacon = makeBeacon(513, 3);
+  beacon.slotOwners[1] = MOWER;
+  beacon.nextSettings = {250, 7, 6, -3, 8};
+  uint8_t buffer[64];
+  tdmaBeacon decoded;
+
+  auto length = TdmaSchedule::encodeBeacon(beacon, buffer, sizeof(buffer));
+
+  TEST_ASSERT_EQUAL(10 + 2 * 3, length);
+  TEST_ASSERT_TRUE(TdmaSchedule::decodeBeacon(buffer, length, decoded));
+  TEST_ASSERT_EQUAL(513, decoded.superframe);
+  TEST_ASSERT_EQUAL(SLOT_LENGTH, decoded.slotLength);
+  TEST_ASSERT_EQUAL(3, decoded.slotCount);
+  TEST_ASSERT_EQUAL_HEX16(TdmaSchedule::FREE_SLOT, decoded.slotOwners[0]);
+  TEST_ASSERT_EQUAL_HEX16(MOWER, decoded.slotOwners[1]);
+  TEST_ASSERT_TRUE(sameRate(beacon.nextSettings, decoded.nextSettings));
+}
+
+void test_invalid_beacons_are_rejected() {
+  auto beacon = makeBeacon(1, 2);
+  uint8_t buffer[64];
+  tdmaBeacon decoded;
+  auto length = TdmaSchedule::encodeBeacon(beacon, buffer, sizeof(buffer));
+
+  TEST_ASSERT_FALSE(TdmaSchedule::decodeBeacon(buffer, length - 1, decoded));
+  TEST_ASSERT_EQUAL(0, TdmaSchedule::encodeBeacon(beacon, buffer, length - 1));
+
+  buffer[4] = tdmaBeacon::MAX_SLOTS + 1;
+  TEST_ASSERT_FALSE(TdmaSchedule::decodeBeacon(buffer, sizeof(buffer), decoded));
+
+  TdmaSchedule::encodeBeacon(beacon, buffer, sizeof(buffer));
+  buffer[5] = 13;
+  TEST_ASSERT_FALSE(TdmaSchedule::decodeBeacon(buffer, length, decoded));
+}
+
+void test_transmit_freely_without_schedule() {
+  TdmaSchedule schedule(MOWER);
+
+  TEST_ASSERT_FALSE(schedule.isSynchronized(1000));
+  TEST_ASSERT_TRUE(schedule.canTransmit(1000, 100, false, false));
+  TEST_ASSERT_FALSE(schedule.needsSignOn(1000));
+}
+
+void test_transmit_only_in_own_slot() {
+  TdmaSchedule schedule(MOWER);
+  auto beacon = makeBeacon(1, 3);
+  beacon.slotOwners[1] = MOWER;
+  receive(schedule, beacon, 10000);
+
+  TEST_ASSERT_EQUAL(2, schedule.getSlot());
+  // beacon slot, someone else's slot, ours, free slot, contention slot.
+  TEST_ASSERT_FALSE(schedule.canTransmit(10000 + 100, 100, false, false));
+  TEST_ASSERT_TRUE(schedule.canTransmit(10000 + 100, 100, false, true));
+  TEST_ASSERT_FALSE(schedule.canTransmit(10000 + SLOT_LENGTH + 100, 100, false, false));
+  TEST_ASSERT_TRUE(schedule.canTransmit(10000 + 2 * SLOT_LENGTH + 100, 100, false, false));
+  TEST_ASSERT_FALSE(schedule.canTransmit(10000 + 3 * SLOT_LENGTH + 100, 100, false, false));
+  TEST_ASSERT_FALSE(schedule.canTransmit(10000 + 4 * SLOT_LENGTH + 100, 100, true, false));
+
+  // don't run into next slot.
+  TEST_ASSERT_FALSE(schedule.canTransmit(10000 + 2 * SLOT_LENGTH + 400, 100, false, false));
+
+  // same slot next superframe.
+  TEST_ASSERT_TRUE(schedule.canTransmit(10000 + 5 * SLOT_LENGTH + 2 * SLOT_LENGTH + 100, 100, false, false));
+}
+
+void test_schedule_is_lost_after_missed_beacons() {
+  TdmaSchedule schedule(MOWER);
+  receive(schedule, makeBeacon(1, 2), 10000);
+  uint32_t superframeLength = 4 * SLOT_LENGTH;
+
+  TEST_ASSERT_TRUE(schedule.isSynchronized(10000 + 4 * superframeLength - 1));
+  TEST_ASSERT_FALSE(schedule.isSynchronized(10000 + 4 * superframeLength));
+  TEST_ASSERT_TRUE(schedule.canTransmit(10000 + 4 * superframeLength + SLOT_LENGTH / 2, 100, false, false));
+}
+
+void test_sign_on() {
+  TdmaSchedule schedule(MOWER);
+  receive(schedule, makeBeacon(1, 2), 10000);
+  uint8_t buffer[64];
+  uint16_t address = 0;
+
+  TEST_ASSERT_TRUE(schedule.needsSignOn(10000));
+  auto length = schedule.encodeSignOn(buffer, sizeof(buffer), "mower-1", "1.0.0");
+  TEST_ASSERT_GREATER_THAN(0, length);
+  TEST_ASSERT_TRUE(TdmaSchedule::decodeSignOn(buffer, length, address));
+  TEST_ASSERT_EQUAL_HEX16(MOWER, address);
+  TEST_ASSERT_FALSE(schedule.needsSignOn(10000));
+
+  // sign on requests may only go in the contention slot, after our random delay.
+  TEST_ASSERT_FALSE(schedule.canTransmit(10000 + SLOT_LENGTH + 100, 50, true, false));
+  TEST_ASSERT_TRUE(schedule.canTransmit(10000 + 3 * SLOT_LENGTH + SLOT_LENGTH / 2, 50, true, false));
+
+  // response to someone else.
+  length = TdmaSchedule::encodeSignOnResponse(OTHER_MOWER, 1, buffer, sizeof(buffer));
+  schedule.onSignOnResponse(buffer, length);
+  TEST_ASSERT_EQUAL(0, schedule.getSlot());
+
+  length = TdmaSchedule::encodeSignOnResponse(MOWER, 2, buffer, sizeof(buffer));
+  schedule.onSignOnResponse(buffer, length);
+  TEST_ASSERT_EQUAL(2, schedule.getSlot());
+}
+
+void test_sign_on_is_retried() {
+  TdmaSchedule schedule(MOWER);
+  uint8_t buffer[64];
+  uint32_t superframeLength = 4 * SLOT_LENGTH;
+
+  receive(schedule, makeBeacon(1, 2), 10000);
+  schedule.encodeSignOn(buffer, sizeof(buffer), "mower-1", "1.0.0");
+  receive(schedule, makeBeacon(2, 2), 10000 + superframeLength);
+  TEST_ASSERT_FALSE(schedule.needsSignOn(10000 + superframeLength));
+  receive(schedule, makeBeacon(3, 2), 10000 + 2 * superframeLength);
+  TEST_ASSERT_TRUE(schedule.needsSignOn(10000 + 2 * superframeLength));
+}
+
+void test_next_settings_apply_after_superframe() {
+  TdmaSchedule schedule(MOWER);
+  RadioSettings settings;
+  uint32_t superframeLength = 4 * SLOT_LENGTH;
+
+  TEST_ASSERT_FALSE(schedule.getNextSettings(10000, settings));
+  receive(schedule, makeBeacon(1, 2), 10000);
+  TEST_ASSERT_FALSE(schedule.getNextSettings(10000 + superframeLength - 1, settings));
+  TEST_ASSERT_TRUE(schedule.getNextSettings(10000 + superframeLength, settings));
+  TEST_ASSERT_TRUE(sameRate(SF9, settings));
+}
+
+void test_allocator_assigns_slots() {
+  TdmaAllocator allocator(2, SLOT_LENGTH, 2, 17);
+
+  TEST_ASSERT_EQUAL(1, allocator.assign(MOWER, 0));
+  TEST_ASSERT_EQUAL(2, allocator.assign(OTHER_MOWER, 0));
+  TEST_ASSERT_EQUAL(1, allocator.assign(MOWER, 0));
+  TEST_ASSERT_EQUAL(0, allocator.assign(0x9999, 0));
+
+  TEST_ASSERT_EQUAL(4 * SLOT_LENGTH, allocator.getSuperframeLength());
+  TEST_ASSERT_EQUAL_HEX16(TdmaSchedule::FREE_SLOT, allocator.getSlotOwner(100));
+  TEST_ASSERT_EQUAL_HEX16(MOWER, allocator.getSlotOwner(SLOT_LENGTH + 100));
+  TEST_ASSERT_EQUAL_HEX16(OTHER_MOWER, allocator.getSlotOwner(2 * SLOT_LENGTH + 100));
+  TEST_ASSERT_EQUAL_HEX16(TdmaSchedule::FREE_SLOT, allocator.getSlotOwner(3 * SLOT_LENGTH + 100));
+}
+
+void test_allocator_releases_quiet_slots() {
+  TdmaAllocator allocator(2, SLOT_LENGTH, 2, 17);
+  allocator.assign(MOWER, 0);
+  allocator.assign(OTHER_MOWER, 0);
+
+  allocator.heard(MOWER, 50000, 0);
+  auto beacon = allocator.nextBeacon(70000);
+
+  TEST_ASSERT_EQUAL_HEX16(MOWER, beacon.slotOwners[0]);
+  TEST_ASSERT_EQUAL_HEX16(TdmaSchedule::FREE_SLOT, beacon.slotOwners[1]);
+  TEST_ASSERT_EQUAL(2, allocator.assign(0x9999, 70000));
+}
+
+/**
+* Run superframes where each mower with a slot is heard once, with the given SNR.
+*/
+static void runSuperframes(TdmaAllocator& allocator, uint32_t& now, int count, float snr, float otherSnr) {
+  for (int i = 0; i < count; i++) {
+    allocator.nextBeacon(now);
+    allocator.heard(MOWER, now + SLOT_LENGTH, snr);
+    allocator.heard(OTHER_MOWER, now + 2 * SLOT_LENGTH, otherSnr);
+    now += allocator.getSuperframeLength();
+  }
+}
+
+void test_allocator_speeds_up_channel_for_good_links() {
+  TdmaAllocator allocator(2, SLOT_LENGTH, 2, 17);
+  uint32_t now = 1000;
+  allocator.assign(MOWER, now);
+  allocator.assign(OTHER_MOWER, now);
+
+  TEST_ASSERT_EQUAL(12, allocator.getSettings().spreadingFactor);
+
+  // SNR is measured with the settings in use, with a strong link it only gets better when we lower the spreading factor.
+  runSuperframes(allocator, now, 28, 10, 10);
+
+  TEST_ASSERT_LESS_THAN(12, allocator.getSettings().spreadingFactor);
+}
+
+void test_allocator_channel_follows_weakest_mower() {
+  TdmaAllocator allocator(2, SLOT_LENGTH, 2, 17);
+  uint32_t now = 1000;
+  allocator.assign(MOWER, now);
+  allocator.assign(OTHER_MOWER, now);
+
+  // margin for SF12 is needed by the other mower, it's at the edge of coverage.
+  runSuperframes(allocator, now, 28, 10, AdaptiveDataRate::getRequiredSNR(12) + 6);
+
+  TEST_ASSERT_EQUAL(12, allocator.getSettings().spreadingFactor);
+}
+
+void test_allocator_falls_back_when_mower_goes_quiet() {
+  TdmaAllocator allocator(2, SLOT_LENGTH, 2, 17);
+  uint32_t now = 1000;
+  allocator.assign(MOWER, now);
+  allocator.assign(OTHER_MOWER, now);
+  runSuperframes(allocator, now, 28, 10, 10);
+  TEST_ASSERT_LESS_THAN(12, allocator.getSettings().spreadingFactor);
+
+  // other mower missed a change and can't hear us anymore.
+  for (int i = 0; i < 20; i++) {
+    allocator.nextBeacon(now);
+    allocator.heard(MOWER, now + SLOT_LENGTH, 10);
+    now += allocator.getSuperframeLength();
+  }
+  allocator.nextBeacon(now);
+  now += allocator.getSuperframeLength();
+  allocator.nextBeacon(now);
+
+  TEST_ASSERT_EQUAL(12, allocator.getSettings().spreadingFactor);
+}
+
+void test_allocator_has_discovery_superframes() {
+  TdmaAllocator allocator(2, SLOT_LENGTH, 2, 17);
+  uint32_t now = 1000;
+  allocator.assign(MOWER, now);
+  runSuperframes(allocator, now, 28, 10, 10);
+
+  int discovery = 0;
+  for (int i = 0; i < 60; i++) {
+    auto beacon = allocator.nextBeacon(now);
+    if (beacon.nextSettings.spreadingFactor == 12) {
+      discovery++;
+    }
+    allocator.heard(MOWER, now + SLOT_LENGTH, 10);
+    now += allocator.getSuperframeLength();
+  }
+
+  TEST_ASSERT_EQUAL(2, discovery);
+}
+
+void test_mower_follows_allocator() {
+  TdmaAllocator allocator(2, SLOT_LENGTH, 2, 17);
+  TdmaSchedule schedule(MOWER);
+  RadioSettings mowerSettings = AdaptiveDataRate(2, 17).getFallbackSettings();
+  uint32_t now = 1000;
+  allocator.assign(MOWER, now);
+
+  for (int i = 0; i < 50; i++) {
+    auto beacon = allocator.nextBeacon(now);
+    // mower only hears beacons sent with the settings it listens to.
+    if (sameRate(allocator.getSettings(), mowerSettings)) {
+      receive(schedule, beacon, now);
+    }
+    allocator.heard(MOWER, now + SLOT_LENGTH, 10);
+    now += allocator.getSuperframeLength();
+
+    RadioSettings next;
+    if (schedule.getNextSettings(now, next)) {
+      mowerSettings = next;
+    }
+  }
+
+  TEST_ASSERT_LESS_THAN(12, mowerSettings.spreadingFactor);
+  allocator.nextBeacon(now);
+  TEST_ASSERT_TRUE(sameRate(allocator.getSettings(), mowerSettings));
+}
+
+/**
+* Mowers sharing the channel, each with a 30 byte message to send every second. Queued messages go out together, in frames of
+* as many as fit. Returns the number of transmissions that started while another mower was transmitting.
+*/
+static uint32_t runChannel(uint8_t mowers, bool tdma, uint32_t duration, uint32_t& generated, uint32_t& sent) {
+  const RadioSettings settings = {125, 7, 5, 10, 8};
+  const uint8_t MESSAGE_SIZE = 30;
+  const uint8_t perFrame = LoraLink::MAX_PAYLOAD_SIZE / MESSAGE_SIZE;
+  const uint32_t ackTime = Radio::getAirtime(settings, LoraLink::HEADER_SIZE + 5) / 1000 + 1;
+
+  TdmaAllocator allocator(mowers, 300, 2, 17);
+  std::vector<TdmaSchedule> schedules;
+  std::vector<uint32_t> queued(mowers, 0);
+  std::vector<uint32_t> busyUntil(mowers, 0);
+  std::vector<uint32_t> phase(mowers);
+  uint32_t start = 1000;
+  uint32_t nextSuperframe = start;
+  uint32_t collisions = 0;
+  generated = sent = 0;
+
+  for (uint8_t i = 0; i < mowers; i++) {
+    schedules.push_back(TdmaSchedule(0x100 + i));
+    allocator.assign(0x100 + i, start);
+    phase[i] = random(1000);
+  }
+
+  for (uint32_t now = start; now < start + duration; now++) {
+    if (tdma && now == nextSuperframe) {
+      auto beacon = allocator.nextBeacon(now);
+      for (auto& schedule : schedules) {
+        receive(schedule, beacon, now);
+      }
+      nextSuperframe += allocator.getSuperframeLength();
+    }
+
+    for (uint8_t i = 0; i < mowers; i++) {
+      if ((now - start) % 1000 == phase[i]) {
+        queued[i]++;
+        generated++;
+      }
+
+      if (queued[i] == 0 || now < busyUntil[i]) {
+        continue;
+      }
+
+      uint32_t count = min(queued[i], (uint32_t)perFrame);
+      uint32_t airtime = Radio::getAirtime(settings, LoraLink::HEADER_SIZE + count * MESSAGE_SIZE) / 1000 + 1 + ackTime;
+      if (!schedules[i].canTransmit(now, airtime, false, false)) {
+        continue;
+      }
+
+      for (uint8_t j = 0; j < mowers; j++) {
+        if (j != i && now < busyUntil[j]) {
+          collisions++;
+          break;
+        }
+      }
+
+      busyUntil[i] = now + airtime;
+      queued[i] -= count;
+      sent += count;
+      allocator.heard(0x100 + i, now, 10);
+    }
+  }
+
+  return collisions;
+}
+
+void test_mowers_never_collide_and_keep_up() {
+  for (uint8_t mowers = 1; mowers <= tdmaBeacon::MAX_SLOTS; mowers++) {
+    uint32_t generated, sent;
+
+    TEST_ASSERT_EQUAL(0, runChannel(mowers, true, 120000, generated, sent));
+    // what's left is at most what a mower collects while waiting for its slot.
+    TEST_ASSERT_GREATER_OR_EQUAL(generated - mowers * 4, sent);
+  }
+}
+
+void test_mowers_collide_without_schedule() {
+  uint32_t generated, sent;
+
+  TEST_ASSERT_GREATER_THAN(0, runChannel(tdmaBeacon::MAX_SLOTS, false, 120000, generated, sent));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_beacon_round_trip);
+  RUN_TEST(test_invalid_beacons_are_rejected);
+  RUN_TEST(test_transmit_freely_without_schedule);
+  RUN_TEST(test_transmit_only_in_own_slot);
+  RUN_TEST(test_schedule_is_lost_after_missed_beacons);
+  RUN_TEST(test_sign_on);
+  RUN_TEST(test_sign_on_is_retried);
+  RUN_TEST(test_next_settings_apply_after_superframe);
+  RUN_TEST(test_allocator_assigns_slots);
+  RUN_TEST(test_allocator_releases_quiet_slots);
+  RUN_TEST(test_allocator_speeds_up_channel_for_good_links);
+  RUN_TEST(test_allocator_channel_follows_weakest_mower);
+  RUN_TEST(test_allocator_falls_back_when_mower_goes_quiet);
+  RUN_TEST(test_allocator_has_discovery_superframes);
+  RUN_TEST(test_mower_follows_allocator);
+  RUN_TEST(test_mowers_never_collide_and_keep_up);
+  RUN_TEST(test_mowers_collide_without_schedule);
+  return UNITY_END();
+}
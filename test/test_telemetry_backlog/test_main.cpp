@@ -0,0 +1,389 @@
+#include <unity.h>
+#include <vector>
+#include "dockingstation/telemetry_backlog.h"
+
+static const size_t BATCH_SIZE = 246;     // what fits in a link frame, as in Dockingstation.
+static const uint32_t CAPACITY = 64;
+static const uint16_t STEP = 100;         // ms, how often the main loop runs in these tests.
+
+typedef std::vector<uint8_t> bytes;
+
+/**
+* A record every 10 s of mowing: battery running down and heading changing, attitude and cutter load now and then, the other fields
+* hardly ever.
+*/
+telemetryRecord makeRecord(uint32_t i) {
+  telemetryRecord record;
+
+  record.time = 1700000000 + i * 10;
+  record.batteryVoltage = 16400 - i * 3;
+  record.chargeCurrent = i % 20 == 0 ? -5 : 0;
+  record.heading = (i * 7) % 360;
+  record.pitch = (int8_t)(i / 3 % 3) - 1;
+  record.roll = -(int8_t)(i / 4 % 2);
+  record.cutterLoad = 30 + i / 2 % 4;
+  record.batteryLevel = 80 - i / 30;
+  record.state = 3;
+  record.flags = telemetryRecord::FLAG_CUTTING;
+
+  return record;
+}
+
+void assertRecordEqual(const telemetryRecord& expected, const telemetryRecord& actual) {
+  TEST_ASSERT_EQUAL(expected.time, actual.time);
+  TEST_ASSERT_EQUAL(expected.batteryVoltage, actual.batteryVoltage);
+  TEST_ASSERT_EQUAL(expected.chargeCurrent, actual.chargeCurrent);
+  TEST_ASSERT_EQUAL(expected.heading, actual.heading);
+  TEST_ASSERT_EQUAL(expected.pitch, actual.pitch);
+  TEST_ASSERT_EQUAL(expected.roll, actual.roll);
+  TEST_ASSERT_EQUAL(expected.cutterLoad, actual.cutterLoad);
+  TEST_ASSERT_EQUAL(expected.batteryLevel, actual.batteryLevel);
+  TEST_ASSERT_EQUAL(expected.state, actual.state);
+  TEST_ASSERT_EQUAL(expected.flags, actual.flags);
+}
+
+/**
+* Stand-in for the link to the docking station. Batches are delivered (and acknowledged) after a while, unless the link goes down
+* in the meantime or the batch is lost. The docking station end decodes what it gets.
+*/
+struct Link {
+  struct batch {
+    bytes data;
+    TelemetryBacklog::DeliveredCallback fn;
+    uint32_t due;
+    bool lost;
+  };
+
+  std::function<bool(uint32_t now)> isUp = [](uint32_t) { return true; };
+  bool queueFull = false;
+  uint8_t lossPercent = 0;
+  uint32_t latency = 400;   // ms until acknowledged.
+  std::vector<batch> inFlight;
+  std::vector<telemetryRecord> received;
+  uint32_t sent = 0;
+  uint32_t lost = 0;
+  uint32_t bytesReceived = 0;
+  uint32_t now = 0;
+
+  bool send(const uint8_t* data, size_t length, const TelemetryBacklog::DeliveredCallback& fn) {
+    if (queueFull) {
+      return false;
+    }
+    inFlight.push_back({bytes(data, data + length), fn, now + latency, (uint32_t)random(100) < lossPercent});
+    sent++;
+    return true;
+  }
+
+  void process(uint32_t time) {
+    now = time;
+    // link going down fails everything that was waiting for an acknowledgement.
+    while (!inFlight.empty() && (!isUp(now) || now >= inFlight.front().due)) {
+      auto current = inFlight.front();
+      inFlight.erase(inFlight.begin());
+
+      bool delivered = isUp(now) && !current.lost;
+      lost += !delivered;
+      if (delivered) {
+        bytesReceived += current.data.size();
+        telemetryRecord records[TelemetryBacklog::MAX_BATCH_RECORDS];
+        uint8_t count;
+        TEST_ASSERT_TRUE(TelemetryBacklog::decodeBatch(current.data.data(), current.data.size(), records, TelemetryBacklog::MAX_BATCH_RECORDS, count));
+        received.insert(received.end(), records, records + count);
+      }
+      current.fn(delivered);
+    }
+  }
+};
+
+/**
+* Backlog on a ring in the in-memory file system, the mower can be restarted (ring and backlog start over from flash).
+*/
+struct Mower {
+  fs::FS fileSystem;
+  Link link;
+  FlashRing* ring = nullptr;
+  TelemetryBacklog* backlog = nullptr;
+  uint32_t capacity;
+
+  Mower(uint32_t capacity = CAPACITY) : capacity(capacity) {
+    start();
+  }
+
+  ~Mower() {
+    delete backlog;
+    delete ring;
+  }
+
+  void start() {
+    ring = new FlashRing(fileSystem, "/telemetry.bin", telemetryRecord::SIZE, capacity);
+    TEST_ASSERT_TRUE(ring->begin());
+    backlog = new TelemetryBacklog(*ring, BATCH_SIZE, [this](const uint8_t* data, size_t length, const TelemetryBacklog::DeliveredCallback& fn) {
+      return link.send(data, length, fn);
+    });
+  }
+
+  void restart() {
+    // radio starts over too, nothing comes back for what was in flight.
+    link.inFlight.clear();
+    delete backlog;
+    delete ring;
+    start();
+  }
+
+  void process(uint32_t now) {
+    link.process(now);
+    backlog->process(now, link.isUp(now) && !link.queueFull);
+  }
+};
+
+Mower* mower;
+
+void setUp() {
+  randomSeed(9);
+  mower = new Mower();
+}
+
+void tearDown() {
+  delete mower;
+}
+
+void test_record_round_trip() {
+  auto record = makeRecord(20);
+  record.chargeCurrent = -1234;
+  record.pitch = -45;
+  record.flags = telemetryRecord::FLAG_CHARGING | telemetryRecord::FLAG_UPTIME;
+  uint8_t buffer[telemetryRecord::SIZE];
+  telemetryRecord decoded;
+
+  TelemetryBacklog::encodeRecord(record, buffer);
+  TelemetryBacklog::decodeRecord(buffer, decoded);
+
+  assertRecordEqual(record, decoded);
+}
+
+void test_batch_round_trip() {
+  telemetryRecord records[TelemetryBacklog::MAX_BATCH_RECORDS];
+  for (uint8_t i = 0; i < TelemetryBacklog::MAX_BATCH_RECORDS; i++) {
+    records[i] = makeRecord(i);
+  }
+  // a big jump in every field.
+  records[10].time += 100000;
+  records[10].chargeCurrent = -2000;
+  records[10].state = 0;
+
+  uint8_t buffer[BATCH_SIZE];
+  uint8_t encoded;
+  auto length = TelemetryBacklog::encodeBatch(records, TelemetryBacklog::MAX_BATCH_RECORDS, buffer, sizeof(buffer), encoded);
+
+  char message[80];
+  sprintf(message, "%u records in %u bytes, %u uncompressed", encoded, (unsigned)length, encoded * telemetryRecord::SIZE);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_EQUAL(TelemetryBacklog::MAX_BATCH_RECORDS, encoded);
+  TEST_ASSERT_LESS_THAN(encoded * telemetryRecord::SIZE / 2, length);
+
+  telemetryRecord decoded[TelemetryBacklog::MAX_BATCH_RECORDS];
+  uint8_t count;
+  TEST_ASSERT_TRUE(TelemetryBacklog::decodeBatch(buffer, length, decoded, TelemetryBacklog::MAX_BATCH_RECORDS, count));
+  TEST_ASSERT_EQUAL(encoded, count);
+  for (uint8_t i = 0; i < count; i++) {
+    assertRecordEqual(records[i], decoded[i]);
+  }
+
+  // a truncated batch is not accepted.
+  TEST_ASSERT_FALSE(TelemetryBacklog::decodeBatch(buffer, length - 1, decoded, TelemetryBacklog::MAX_BATCH_RECORDS, count));
+}
+
+void test_batch_stops_at_record_that_does_not_fit() {
+  telemetryRecord records[4] = { makeRecord(0), makeRecord(1), makeRecord(2), makeRecord(3) };
+  uint8_t buffer[BATCH_SIZE];
+  uint8_t encoded;
+
+  // first record has every field different from nothing, it takes the most.
+  auto full = TelemetryBacklog::encodeBatch(records, 1, buffer, sizeof(buffer), encoded);
+  auto length = TelemetryBacklog::encodeBatch(records, 4, buffer, full + 2, encoded);
+
+  TEST_ASSERT_EQUAL(1, encoded);
+  TEST_ASSERT_EQUAL(full, length);
+  TEST_ASSERT_EQUAL(1, buffer[0]);
+
+  telemetryRecord decoded[4];
+  uint8_t count;
+  TEST_ASSERT_TRUE(TelemetryBacklog::decodeBatch(buffer, length, decoded, 4, count));
+  TEST_ASSERT_EQUAL(1, count);
+  assertRecordEqual(records[0], decoded[0]);
+
+  TelemetryBacklog::encodeBatch(records, 4, buffer, full - 1, encoded);
+  TEST_ASSERT_EQUAL(0, encoded);
+  TEST_ASSERT_EQUAL(0, TelemetryBacklog::encodeBatch(records, 4, buffer, 0, encoded));
+}
+
+void test_discarded_only_after_ack() {
+  for (uint32_t i = 0; i < 10; i++) {
+    mower->backlog->store(makeRecord(i));
+  }
+  TEST_ASSERT_EQUAL(10, mower->backlog->getStatistics().recordsStored);
+
+  // bucket has to fill up first.
+  for (uint32_t now = 0; mower->link.sent == 0; now += STEP) {
+    mower->process(now);
+  }
+  TEST_ASSERT_EQUAL(1, mower->link.inFlight.size());
+  TEST_ASSERT_EQUAL(10, mower->backlog->getPending());
+
+  mower->link.inFlight.front().fn(true);
+  mower->link.inFlight.clear();
+
+  TEST_ASSERT_EQUAL(0, mower->backlog->getPending());
+  TEST_ASSERT_EQUAL(10, mower->backlog->getStatistics().recordsUploaded);
+  TEST_ASSERT_EQUAL(1, mower->backlog->getStatistics().batchesSent);
+  TEST_ASSERT_EQUAL(160, mower->backlog->getStatistics().rawBytes);
+}
+
+void test_failed_batch_is_resent() {
+  for (uint32_t i = 0; i < 10; i++) {
+    mower->backlog->store(makeRecord(i));
+  }
+  uint32_t now = 0;
+  for (; mower->link.sent == 0; now += STEP) {
+    mower->process(now);
+  }
+  auto first = mower->link.inFlight.front();
+  mower->link.inFlight.clear();
+  first.fn(false);
+
+  TEST_ASSERT_EQUAL(10, mower->backlog->getPending());
+  TEST_ASSERT_EQUAL(1, mower->backlog->getStatistics().batchesFailed);
+
+  for (; mower->link.sent == 1; now += STEP) {
+    mower->process(now);
+  }
+  TEST_ASSERT_TRUE(first.data == mower->link.inFlight.front().data);
+}
+
+/**
+* Records acknowledged after they were overwritten are already gone, the ones that took their place must stay.
+*/
+void test_ring_overwritten_while_batch_in_flight() {
+  delete mower;
+  mower = new Mower(16);
+  for (uint32_t i = 0; i < 16; i++) {
+    mower->backlog->store(makeRecord(i));
+  }
+  for (uint32_t now = 0; mower->link.sent == 0; now += STEP) {
+    mower->process(now);
+  }
+
+  for (uint32_t i = 16; i < 21; i++) {
+    mower->backlog->store(makeRecord(i));
+  }
+  TEST_ASSERT_EQUAL(16, mower->backlog->getPending());
+
+  mower->link.inFlight.front().fn(true);
+  mower->link.inFlight.clear();
+
+  TEST_ASSERT_EQUAL(5, mower->backlog->getPending());
+  TEST_ASSERT_EQUAL(16, mower->ring->getFirst());
+
+  uint8_t buffer[telemetryRecord::SIZE];
+  telemetryRecord record;
+  mower->ring->read(0, buffer);
+  TelemetryBacklog::decodeRecord(buffer, record);
+  assertRecordEqual(makeRecord(16), record);
+}
+
+void test_waits_for_link_and_budget() {
+  delete mower;
+  mower = new Mower(128);
+  for (uint32_t i = 0; i < 100; i++) {
+    mower->backlog->store(makeRecord(i));
+  }
+  mower->link.latency = 60000;
+  mower->link.isUp = [](uint32_t now) { return now >= 20000; };
+
+  // bucket was full long before the link came up.
+  uint32_t now = 0;
+  for (; mower->link.sent == 0; now += STEP) {
+    mower->process(now);
+  }
+  TEST_ASSERT_EQUAL(20000, now - STEP);
+
+  // nothing else is sent until that batch is acknowledged, or while the link has other things to send.
+  mower->process(now + 30000);
+  TEST_ASSERT_EQUAL(1, mower->link.sent);
+  mower->link.inFlight.front().fn(true);
+  mower->link.inFlight.clear();
+  mower->link.queueFull = true;
+  now += 60000;
+  mower->process(now);
+  TEST_ASSERT_EQUAL(1, mower->link.sent);
+
+  mower->link.queueFull = false;
+  now += STEP;
+  mower->process(now);
+  TEST_ASSERT_EQUAL(2, mower->link.sent);
+  auto firstLength = mower->backlog->getStatistics().bytesSent;
+  mower->link.inFlight.front().fn(true);
+  mower->link.inFlight.clear();
+  auto length = mower->backlog->getStatistics().bytesSent - firstLength;
+
+  // next batch goes once the bucket has refilled what the last one took, at 20 bytes per second.
+  uint32_t sentAt = now;
+  for (; mower->link.sent == 2; now += STEP) {
+    mower->process(now);
+  }
+  TEST_ASSERT_UINT_WITHIN(STEP, length * 1000 / 20, now - STEP - sentAt);
+}
+
+/**
+* An hour of mowing with two long outages and a restart in the second one, and one batch in ten lost on the way.
+*/
+void test_hour_with_outages() {
+  delete mower;
+  mower = new Mower(2048);
+  auto outage = [](uint32_t now) {
+    return (now >= 5 * 60000 && now < 20 * 60000) || (now >= 30 * 60000 && now < 45 * 60000);
+  };
+  mower->link.isUp = [outage](uint32_t now) { return !outage(now); };
+  mower->link.lossPercent = 10;
+  std::vector<telemetryRecord> stored;
+  uint32_t pendingAtRestart = 0;
+
+  for (uint32_t now = 0; now < 60 * 60000; now += STEP) {
+    if (now % 10000 == 0 && outage(now)) {
+      stored.push_back(makeRecord(stored.size()));
+      mower->backlog->store(stored.back());
+    }
+    if (now == 40 * 60000) {
+      pendingAtRestart = mower->backlog->getPending();
+      mower->restart();
+      TEST_ASSERT_EQUAL(pendingAtRestart, mower->backlog->getPending());
+    }
+    mower->process(now);
+  }
+
+  auto rawBytes = stored.size() * telemetryRecord::SIZE;
+  char message[120];
+  sprintf(message, "%u records, %u pending at restart, %u of %u batches failed, %u bytes received for %u bytes of records", (unsigned)stored.size(),
+    pendingAtRestart, mower->link.lost, mower->link.sent, mower->link.bytesReceived, (unsigned)rawBytes);
+  TEST_MESSAGE(message);
+
+  TEST_ASSERT_EQUAL(0, mower->backlog->getPending());
+  TEST_ASSERT_EQUAL(stored.size(), mower->link.received.size());
+  for (size_t i = 0; i < stored.size(); i++) {
+    assertRecordEqual(stored[i], mower->link.received[i]);
+  }
+  TEST_ASSERT_LESS_THAN(rawBytes / 2, mower->link.bytesReceived);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_record_round_trip);
+  RUN_TEST(test_batch_round_trip);
+  RUN_TEST(test_batch_stops_at_record_that_does_not_fit);
+  RUN_TEST(test_discarded_only_after_ack);
+  RUN_TEST(test_failed_batch_is_resent);
+  RUN_TEST(test_ring_overwritten_while_batch_in_flight);
+  RUN_TEST(test_waits_for_link_and_budget);
+  RUN_TEST(test_hour_with_outages);
+  return UNITY_END();
+}
@@ -0,0 +1,298 @@
+#include <unity.h>
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+#include "telemetry_hub.h"
+
+static const uint8_t STEP = 10;   // ms, how often the main loop runs in these tests.
+
+/**
+* Same fields as a logmessage in the LogStore.
+*/
+struct logLine {
+  uint16_t id;
+  String message;
+};
+
+typedef std::vector<uint8_t> bytes;
+
+/**
+* A hub with pose and log topics, and clients that keep every frame they were sent.
+*/
+struct Hub {
+  TelemetryHub hub;
+  std::deque<logLine> log;
+  uint16_t lastLogId = 0;
+  uint32_t poseSerialized = 0;
+  uint32_t logSerialized = 0;
+  std::map<uint32_t, std::vector<bytes>> received;
+  std::map<uint32_t, bool> dropping;    // client's send queue is full.
+
+  Hub() {
+    hub.setSerializer(TELEMETRY_TOPIC::POSE, [this](uint8_t* buffer, size_t size) {
+      poseSerialized++;
+      return TelemetryHub::encodePose(buffer, size, millis(), 90, 1, -2, 50, 50);
+    });
+    hub.setDeltaSerializer(TELEMETRY_TOPIC::LOG, [this](uint8_t* buffer, size_t size, uint16_t& cursor) -> size_t {
+      logSerialized++;
+      return TelemetryHub::encodeLog(buffer, size, log, cursor);
+    }, [this]() -> uint16_t {
+      return log.empty() ? lastLogId : log.front().id - 1;
+    });
+    hub.onSend([this](uint32_t clientId, const uint8_t* data, size_t length) {
+      if (dropping[clientId]) {
+        return false;
+      }
+      received[clientId].push_back(bytes(data, data + length));
+      return true;
+    });
+  }
+
+  /**
+  * Add log lines, keeping only the last ten like the LogStore does.
+  */
+  void addLines(uint16_t count) {
+    for (uint16_t i = 0; i < count; i++) {
+      lastLogId++;
+      log.push_back({lastLogId, String("line ") + std::to_string(lastLogId).c_str()});
+      if (log.size() > 10) {
+        log.pop_front();
+      }
+    }
+  }
+
+  void run(uint32_t duration) {
+    for (uint32_t elapsed = 0; elapsed < duration; elapsed += STEP) {
+      Native::advanceMillis(STEP);
+      hub.process();
+    }
+  }
+
+  size_t framesOf(uint32_t clientId, TELEMETRY_TOPIC topic) {
+    size_t count = 0;
+    for (const auto& frame : received[clientId]) {
+      count += frame[0] == static_cast<uint8_t>(topic);
+    }
+    return count;
+  }
+
+  /**
+  * Ids of all log lines a client has received, in order.
+  */
+  std::vector<uint16_t> logIds(uint32_t clientId) {
+    std::vector<uint16_t> ids;
+    for (const auto& frame : received[clientId]) {
+      for (size_t at = 3; frame[0] == static_cast<uint8_t>(TELEMETRY_TOPIC::LOG) && at < frame.size(); at += 3 + frame[at + 2]) {
+        ids.push_back(frame[at] | (frame[at + 1] << 8));
+      }
+    }
+    return ids;
+  }
+};
+
+Hub* hub;
+
+void setUp() {
+  Native::setMillis(1000);
+  hub = new Hub();
+}
+
+void tearDown() {
+  delete hub;
+}
+
+void test_one_serialization_per_topic_and_tick() {
+  for (uint32_t clientId = 1; clientId <= 5; clientId++) {
+    TEST_ASSERT_TRUE(hub->hub.addClient(clientId));
+    TEST_ASSERT_TRUE(hub->hub.subscribe(clientId, TELEMETRY_TOPIC::POSE, 100));
+  }
+
+  hub->run(1000);
+
+  // every client got each frame, but it was only serialized once.
+  TEST_ASSERT_EQUAL(10, hub->poseSerialized);
+  TEST_ASSERT_EQUAL(10, hub->hub.getFramesSerialized());
+  TEST_ASSERT_EQUAL(50, hub->hub.getFramesSent());
+  TEST_ASSERT_EQUAL(50 * 17, hub->hub.getBytesSent());
+  for (uint32_t clientId = 1; clientId <= 5; clientId++) {
+    TEST_ASSERT_EQUAL(10, hub->received[clientId].size());
+    TEST_ASSERT_TRUE(hub->received[clientId] == hub->received[1]);
+  }
+
+  // sequence number goes up by one for each frame of the topic.
+  auto& last = hub->received[1].back();
+  TEST_ASSERT_EQUAL(static_cast<uint8_t>(TELEMETRY_TOPIC::POSE), last[0]);
+  TEST_ASSERT_EQUAL(9, last[1] | (last[2] << 8));
+}
+
+void test_per_client_intervals() {
+  hub->hub.addClient(1);
+  hub->hub.addClient(2);
+  hub->hub.addClient(3);
+  hub->hub.subscribe(1, TELEMETRY_TOPIC::POSE, 100);
+  hub->hub.subscribe(2, TELEMETRY_TOPIC::POSE, 500);
+  // faster than allowed, limited to MIN_INTERVAL.
+  hub->hub.subscribe(3, TELEMETRY_TOPIC::POSE, 10);
+
+  hub->run(2000);
+
+  TEST_ASSERT_EQUAL(20, hub->received[1].size());
+  TEST_ASSERT_EQUAL(4, hub->received[2].size());
+  // 50 ms is not a whole number of ticks, so each update waits for the tick after.
+  TEST_ASSERT_EQUAL(2000 / 60 + 1, hub->received[3].size());
+  // serialized once on each tick that any client was due, and shared by those that were.
+  std::set<uint16_t> frames;
+  for (auto& client : hub->received) {
+    for (auto& frame : client.second) {
+      frames.insert(frame[1] | (frame[2] << 8));
+    }
+  }
+  TEST_ASSERT_EQUAL(frames.size(), hub->poseSerialized);
+  TEST_ASSERT_LESS_THAN(20 + 4 + 34, hub->poseSerialized);
+
+  hub->hub.subscribe(3, TELEMETRY_TOPIC::POSE, 0);
+  hub->hub.removeClient(1);
+  hub->received.clear();
+  hub->run(1000);
+
+  TEST_ASSERT_EQUAL(0, hub->received[1].size());
+  TEST_ASSERT_EQUAL(2, hub->received[2].size());
+  TEST_ASSERT_EQUAL(0, hub->received[3].size());
+}
+
+void test_only_registered_topics_and_known_clients() {
+  TEST_ASSERT_FALSE(hub->hub.subscribe(1, TELEMETRY_TOPIC::POSE, 100));
+
+  hub->hub.addClient(1);
+  TEST_ASSERT_FALSE(hub->hub.subscribe(1, TELEMETRY_TOPIC::MAP_TILES, 100));
+  TEST_ASSERT_FALSE(hub->hub.subscribe(1, TELEMETRY_TOPIC::COUNT, 100));
+
+  for (uint32_t clientId = 2; clientId <= 8; clientId++) {
+    TEST_ASSERT_TRUE(hub->hub.addClient(clientId));
+  }
+  TEST_ASSERT_FALSE(hub->hub.addClient(9));
+  // already known.
+  TEST_ASSERT_TRUE(hub->hub.addClient(8));
+}
+
+void test_subscribe_message() {
+  hub->hub.addClient(1);
+
+  TEST_ASSERT_TRUE(hub->hub.handleMessage(1, "{\"type\":\"subscribe\",\"payload\":{\"topic\":\"pose\",\"interval\":250}}"));
+  TEST_ASSERT_FALSE(hub->hub.handleMessage(1, "{\"type\":\"subscribe\",\"payload\":{\"topic\":\"weather\",\"interval\":250}}"));
+  TEST_ASSERT_FALSE(hub->hub.handleMessage(1, "{\"type\":\"unsubscribe\",\"payload\":{\"topic\":\"pose\"}}"));
+  TEST_ASSERT_FALSE(hub->hub.handleMessage(1, "{\"type\":\"subscribe\"}"));
+  TEST_ASSERT_FALSE(hub->hub.handleMessage(1, "subscribe pose"));
+  TEST_ASSERT_FALSE(hub->hub.handleMessage(2, "{\"type\":\"subscribe\",\"payload\":{\"topic\":\"pose\",\"interval\":250}}"));
+
+  hub->run(1000);
+  TEST_ASSERT_EQUAL(4, hub->received[1].size());
+}
+
+void test_log_only_sends_what_is_new() {
+  hub->addLines(3);
+  hub->hub.addClient(1);
+  hub->hub.addClient(2);
+  hub->hub.subscribe(1, TELEMETRY_TOPIC::LOG, 100);
+  hub->hub.subscribe(2, TELEMETRY_TOPIC::LOG, 100);
+
+  hub->run(500);
+  // clients in step share a frame, and nothing is sent while there is nothing new.
+  TEST_ASSERT_EQUAL(1, hub->framesOf(1, TELEMETRY_TOPIC::LOG));
+  TEST_ASSERT_EQUAL(1, hub->hub.getFramesSerialized());
+  TEST_ASSERT_TRUE(hub->received[1] == hub->received[2]);
+
+  hub->addLines(2);
+  hub->run(500);
+
+  std::vector<uint16_t> expected = { 1, 2, 3, 4, 5 };
+  TEST_ASSERT_TRUE(expected == hub->logIds(1));
+  TEST_ASSERT_TRUE(expected == hub->logIds(2));
+  TEST_ASSERT_EQUAL(2, hub->hub.getFramesSerialized());
+}
+
+void test_log_cursor_stays_on_dropped_send() {
+  hub->addLines(2);
+  hub->hub.addClient(1);
+  hub->hub.addClient(2);
+  hub->hub.subscribe(1, TELEMETRY_TOPIC::LOG, 100);
+  hub->hub.subscribe(2, TELEMETRY_TOPIC::LOG, 100);
+
+  hub->dropping[2] = true;
+  hub->run(300);
+  hub->addLines(2);
+  hub->run(300);
+
+  // tried again every interval.
+  TEST_ASSERT_EQUAL(0, hub->received[2].size());
+  TEST_ASSERT_EQUAL(6, hub->hub.getFramesDropped());
+
+  // client 2 is behind and gets a frame of its own with everything it missed, client 1 only what's new.
+  hub->dropping[2] = false;
+  hub->addLines(1);
+  hub->run(100);
+
+  std::vector<uint16_t> all = { 1, 2, 3, 4, 5 };
+  TEST_ASSERT_TRUE(all == hub->logIds(1));
+  TEST_ASSERT_TRUE(all == hub->logIds(2));
+  TEST_ASSERT_EQUAL(1, hub->received[2].size());
+  TEST_ASSERT_EQUAL(3, hub->received[1].size());
+}
+
+/**
+* Once the log has passed 32767 lines, a client starting from 0 would see every line as already sent.
+*/
+void test_new_client_gets_lines_kept_after_many_lines() {
+  hub->lastLogId = 40000;
+  hub->addLines(15);
+  hub->hub.addClient(1);
+  hub->hub.subscribe(1, TELEMETRY_TOPIC::LOG, 100);
+
+  hub->run(200);
+
+  auto ids = hub->logIds(1);
+  TEST_ASSERT_EQUAL(10, ids.size());
+  TEST_ASSERT_EQUAL(40006, ids.front());
+  TEST_ASSERT_EQUAL(40015, ids.back());
+
+  // changing interval does not start over.
+  hub->hub.subscribe(1, TELEMETRY_TOPIC::LOG, 200);
+  hub->run(400);
+  TEST_ASSERT_EQUAL(10, hub->logIds(1).size());
+}
+
+void test_encode_log() {
+  std::deque<logLine> lines = { {65534, "a"}, {65535, "bb"}, {0, "ccc"}, {1, "dddd"} };
+  uint8_t buffer[32];
+  uint16_t cursor = 65533;
+
+  // ids wrap around.
+  TEST_ASSERT_EQUAL(4 * 3 + 10, TelemetryHub::encodeLog(buffer, sizeof(buffer), lines, cursor));
+  TEST_ASSERT_EQUAL(1, cursor);
+  TEST_ASSERT_EQUAL(0, TelemetryHub::encodeLog(buffer, sizeof(buffer), lines, cursor));
+
+  // only whole lines, as many as fit.
+  cursor = 65534;
+  TEST_ASSERT_EQUAL(5 + 6, TelemetryHub::encodeLog(buffer, 13, lines, cursor));
+  TEST_ASSERT_EQUAL(0, cursor);
+  TEST_ASSERT_EQUAL(0xFF, buffer[0]);
+  TEST_ASSERT_EQUAL(0xFF, buffer[1]);
+  TEST_ASSERT_EQUAL(2, buffer[2]);
+  TEST_ASSERT_EQUAL('b', buffer[3]);
+  TEST_ASSERT_EQUAL(0, buffer[5]);
+  TEST_ASSERT_EQUAL(3, buffer[7]);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_one_serialization_per_topic_and_tick);
+  RUN_TEST(test_per_client_intervals);
+  RUN_TEST(test_only_registered_topics_and_known_clients);
+  RUN_TEST(test_subscribe_message);
+  RUN_TEST(test_log_only_sends_what_is_new);
+  RUN_TEST(test_log_cursor_stays_on_dropped_send);
+  RUN_TEST(test_new_client_gets_lines_kept_after_many_lines);
+  RUN_TEST(test_encode_log);
+  return UNITY_END();
+}
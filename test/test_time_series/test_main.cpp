@@ -0,0 +1,270 @@
+#include <unity.h>
+#include <algorithm>
+#include <math.h>
+#include "time_series.h"
+
+static const uint16_t BLOCK_SIZE = 256;
+static const uint8_t FIELDS = 3;
+static const uint32_t SAMPLE_INTERVAL = 20;   // seconds, same as Battery.
+static const uint32_t IDLE_SAMPLE_INTERVAL = 300;   // seconds, same as Battery.
+
+fs::FS* fileSystem;
+FlashRing* ring;
+TimeSeries* series;
+
+void setUp() {
+  randomSeed(3);
+  fileSystem = new fs::FS();
+  ring = new FlashRing(*fileSystem, "/history.bin", BLOCK_SIZE, 16);
+  ring->begin();
+  series = new TimeSeries(*ring, BLOCK_SIZE, FIELDS);
+  series->begin();
+}
+
+void tearDown() {
+  delete series;
+  delete ring;
+  delete fileSystem;
+}
+
+struct sample {
+  uint32_t time;
+  float values[FIELDS];
+};
+
+/**
+* Battery samples rounded the same way Battery does it, voltage following the load.
+*/
+sample makeSample(uint32_t index) {
+  float current = (index / 30) % 2 ? 2500 + random(-30, 31) * 10 : 50;
+  float level = 80 - index % 500 * 0.1f;
+
+  return { 1600000000 + index * SAMPLE_INTERVAL, { roundf((16 - current / 10000 + random(-2, 3) / 100.0f) * 100) / 100, current, roundf(level * 10) / 10 } };
+}
+
+void assertSample(const sample& expected, uint32_t time, const float* values) {
+  TEST_ASSERT_EQUAL_UINT32(expected.time, time);
+  // bit-exact, not just close.
+  TEST_ASSERT_EQUAL_MEMORY(expected.values, values, sizeof(expected.values));
+}
+
+void test_empty_series() {
+  auto reader = series->getReader();
+  uint32_t time;
+  float values[FIELDS];
+
+  TEST_ASSERT_EQUAL(0, series->size());
+  TEST_ASSERT_FALSE(reader.next(time, values));
+}
+
+void test_round_trip_over_blocks() {
+  std::vector<sample> samples;
+  for (uint32_t i = 0; i < 500; i++) {
+    samples.push_back(makeSample(i));
+    series->add(samples.back().time, samples.back().values);
+  }
+
+  TEST_ASSERT_EQUAL(500, series->size());
+  TEST_ASSERT_GREATER_THAN(1, ring->size());
+
+  auto reader = series->getReader();
+  uint32_t time;
+  float values[FIELDS];
+  for (auto& expected : samples) {
+    TEST_ASSERT_TRUE(reader.next(time, values));
+    assertSample(expected, time, values);
+  }
+  TEST_ASSERT_FALSE(reader.next(time, values));
+}
+
+/**
+* Time deltas that need each of the delta-of-delta encodings, and values that need a new window or are odd floats.
+*/
+void test_round_trip_irregular_samples() {
+  static const int32_t STEPS[] = { 20, 20, 21, 80, 300, 20, 2000, 20, 100000, 20, 0, 20 };
+  static const float ODD_VALUES[] = { 0, -0.0f, 1e-30f, -1e30f, INFINITY, 3.14159f, 16.8f, 16.81f, -2500 };
+
+  std::vector<sample> samples;
+  uint32_t time = 1000;
+  for (uint8_t i = 0; i < sizeof(STEPS) / sizeof(STEPS[0]); i++) {
+    time += STEPS[i];
+    sample next = { time, { ODD_VALUES[i % 9], ODD_VALUES[(i + 3) % 9], ODD_VALUES[(i * 5) % 9] } };
+    samples.push_back(next);
+    series->add(next.time, next.values);
+  }
+
+  auto reader = series->getReader();
+  float values[FIELDS];
+  for (auto& expected : samples) {
+    TEST_ASSERT_TRUE(reader.next(time, values));
+    assertSample(expected, time, values);
+  }
+}
+
+void test_full_ring_drops_oldest_blocks() {
+  uint32_t added = 0;
+  while (ring->getOverwritten() < 3) {
+    auto next = makeSample(added++);
+    series->add(next.time, next.values);
+  }
+
+  // count every sample the reader gives back, they should be the newest ones and match size().
+  auto reader = series->getReader();
+  uint32_t time;
+  float values[FIELDS];
+  uint32_t count = 0;
+  uint32_t firstTime = 0;
+  while (reader.next(time, values)) {
+    if (count++ == 0) {
+      firstTime = time;
+    }
+  }
+
+  TEST_ASSERT_EQUAL(series->size(), count);
+  TEST_ASSERT_LESS_THAN(added, count);
+  TEST_ASSERT_EQUAL_UINT32(makeSample(added - count).time, firstTime);
+  TEST_ASSERT_EQUAL_UINT32(makeSample(added - 1).time, time);
+}
+
+void test_sample_count_recovered_after_restart() {
+  for (uint32_t i = 0; i < 300; i++) {
+    auto next = makeSample(i);
+    series->add(next.time, next.values);
+  }
+  auto stored = series->size();
+
+  FlashRing reopened(*fileSystem, "/history.bin", BLOCK_SIZE, 16);
+  TEST_ASSERT_TRUE(reopened.begin());
+  TimeSeries restarted(reopened, BLOCK_SIZE, FIELDS);
+  restarted.begin();
+
+  // only the samples in the block kept in RAM are lost.
+  auto unsealed = stored - restarted.size();
+  TEST_ASSERT_EQUAL(ring->size(), reopened.size());
+  TEST_ASSERT_GREATER_THAN(0, unsealed);
+  TEST_ASSERT_LESS_THAN(stored / ring->size(), unsealed);
+
+  auto reader = restarted.getReader();
+  uint32_t time;
+  float values[FIELDS];
+  randomSeed(3);
+  for (uint32_t i = 0; i < restarted.size(); i++) {
+    TEST_ASSERT_TRUE(reader.next(time, values));
+    assertSample(makeSample(i), time, values);
+  }
+  TEST_ASSERT_FALSE(reader.next(time, values));
+}
+
+void test_print_json() {
+  static const char* const names[FIELDS] = {"value", "current", "level"};
+  static const uint8_t decimals[FIELDS] = {2, 0, 1};
+  float first[FIELDS] = { 16.5, 50, 80 };
+  float second[FIELDS] = { 15.25, -1500, 79.9f };
+
+  series->add(1600000000, first);
+  series->add(1600000020, second);
+
+  StringPrint output;
+  series->printJson(output, names, decimals);
+
+  TEST_ASSERT_EQUAL_STRING("{\"time\":[1600000000,1600000020],\"value\":[16.50,15.25],\"current\":[50,-1500],\"level\":[80.0,79.9]}", output.output.c_str());
+}
+
+void test_print_json_downsampled() {
+  static const char* const names[FIELDS] = {"value", "current", "level"};
+  static const uint8_t decimals[FIELDS] = {2, 0, 1};
+
+  for (uint32_t i = 0; i < 500; i++) {
+    auto next = makeSample(i);
+    series->add(next.time, next.values);
+  }
+
+  StringPrint output;
+  series->printJson(output, names, decimals, 50);
+
+  // one more comma than points in each of the four arrays.
+  auto commas = std::count(output.output.begin(), output.output.end(), ',');
+  TEST_ASSERT_EQUAL(4 * 49 + 3, commas);
+  TEST_ASSERT_EQUAL(0, output.output.find("{\"time\":[1600000000,"));
+}
+
+/**
+* 30 days of battery samples in the same ring Battery uses: idle on the dock, mowing with the cutter load varying (4 hours a day), and
+* charging in CC then CV phase. Sampled every 20 s when mowing and every 5 min otherwise, values are rounded the way Battery does it.
+*/
+void test_compression_of_battery_history() {
+  static const uint16_t RING_BLOCKS = 384;   // same as Battery.
+  FlashRing history(*fileSystem, "/battery.bin", BLOCK_SIZE, RING_BLOCKS);
+  history.begin();
+  TimeSeries batteryHistory(history, BLOCK_SIZE, FIELDS);
+  batteryHistory.begin();
+
+  float soc = 1;
+  uint32_t bytesAtFullRing = 0;
+  uint32_t samplesAtFullRing = 0;
+  uint32_t timeAtFullRing = 0;
+  uint32_t lastSampleTime = 0;
+
+  for (uint32_t time = 0; time < 30 * 86400; time += SAMPLE_INTERVAL) {
+    uint32_t secondOfDay = time % 86400;
+    bool mowing = secondOfDay >= 9 * 3600 && secondOfDay < 17 * 3600 && soc > 0.05 && (secondOfDay / 60) % 180 < 90;
+    float current;
+
+    if (mowing) {
+      current = 2000 + random(0, 2001);
+    } else if (soc < 0.8) {
+      current = -1500;
+    } else if (soc < 1) {
+      current = -1500 * (1 - soc) / 0.2;
+    } else {
+      current = 50;
+    }
+
+    soc = constrain(soc - current * SAMPLE_INTERVAL / 3600 / 4400, 0.0f, 1.0f);
+    if (time > 0 && time - lastSampleTime < (mowing ? SAMPLE_INTERVAL : IDLE_SAMPLE_INTERVAL)) {
+      continue;
+    }
+    lastSampleTime = time;
+
+    float voltage = current < -1000 ? 12 + soc * 5.5f : 12 + soc * 4.8f - current / 1000 * 0.12f;
+    float values[FIELDS] = {
+      roundf((voltage + random(-1, 2) / 100.0f) * 100) / 100,
+      roundf(current / 10) * 10 + 0.0f,
+      roundf(soc * 1000) / 10
+    };
+
+    batteryHistory.add(1600000000 + time, values);
+
+    if (bytesAtFullRing == 0 && history.size() == RING_BLOCKS) {
+      bytesAtFullRing = batteryHistory.getUsedBytes();
+      samplesAtFullRing = batteryHistory.size();
+      timeAtFullRing = time;
+    }
+  }
+
+  TEST_ASSERT_NOT_EQUAL(0, bytesAtFullRing);
+
+  float bytesPerSample = (float)bytesAtFullRing / samplesAtFullRing;
+  float rawBytes = 4 + 4 * FIELDS;
+  float days = timeAtFullRing / 86400.0f;
+  char message[100];
+  sprintf(message, "%.2f B/sample (%.1fx), %u kB holds %.1f days", bytesPerSample, rawBytes / bytesPerSample, bytesAtFullRing / 1024, days);
+  TEST_MESSAGE(message);
+
+  // 16 bytes uncompressed, most samples stored are now the noisy ones taken while mowing.
+  TEST_ASSERT_LESS_THAN_FLOAT(8, bytesPerSample);
+  TEST_ASSERT_GREATER_THAN_FLOAT(14, days);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_series);
+  RUN_TEST(test_round_trip_over_blocks);
+  RUN_TEST(test_round_trip_irregular_samples);
+  RUN_TEST(test_full_ring_drops_oldest_blocks);
+  RUN_TEST(test_sample_count_recovered_after_restart);
+  RUN_TEST(test_print_json);
+  RUN_TEST(test_print_json_downsampled);
+  RUN_TEST(test_compression_of_battery_history);
+  return UNITY_END();
+}
@@ -11,6 +11,7 @@ let uptime = new Date(),
       batteryVoltage: Math.floor(Math.random() * (16.8 - 14.0 + 1)) + 14.0,
       batteryLevel: Math.round(Math.random() * 100),
       batteryChargeCurrent: 0.0,
+      batteryRemainingTime: 65535,
       lastFullyChargeTime: new Date() - 1000,
       lastChargeDuration: 1000 * 60 * 60,
       wifiSignal: Math.floor(Math.random() * (-30 - -90 + 1)) + -90,
@@ -21,6 +22,8 @@ let uptime = new Date(),
       pitch: 0,
       roll: 0,
       heading: 0,
+      areaPerWh: 1.85,
+      whPerMowingHour: 38.2,
       obstacles: {
         left: 0,
         front: 0,
@@ -91,12 +94,16 @@ module.exports = {
     let samples = {
           time: [],
           value: [],
+          current: [],
+          level: [],
         },
-        date = new Date().getTime();
+        date = Math.floor(new Date().getTime() / 1000);
 
     for (let i = 0; i < 100; i++) {
-      samples.time.push(date + i);
+      samples.time.push(date - (100 - i) * 20);
       samples.value.push(16.8 - i / 100);
+      samples.current.push(1500 + (i % 7) * 10);
+      samples.level.push(100 - i / 2);
     }
 
     return samples;
@@ -1,15 +1,47 @@
 import * as auth from './authorisation.js';
 import ReconnectingWebSocket from 'reconnecting-websocket';
+import * as telemetry from './telemetry.js';
 alert('använd denna istället: https://sarus.anephenix.com/get-started som websocket lib!');
 alert('använd denna för klarta: https://leafletjs.com/');
 let socket,
-    socketDisconnectedTimeout;
+    socketDisconnectedTimeout,
+    subscriptions = {
+      status: 1000  // milliseconds between updates
+    };
 
 $.ajaxSetup({
   cache: false,
   timeout: 5000 // 5 seconds
 });
 
+function setStatus(status) {
+  if (JSON.stringify(status) !== JSON.stringify(liam.data.status)) {
+    liam.data.status = status;
+    window.dispatchEvent(new Event('statusUpdated'));
+  }
+}
+
+function onTelemetryFrame(buffer) {
+  let frame = telemetry.decodeFrame(buffer);
+
+  if (frame.topic === 'status') {
+    // fields we don't get over telemetry (like wifiSignal) are kept from last REST response.
+    setStatus(Object.assign({}, liam.data.status, frame.payload));
+  } else if (frame.topic === 'pose') {
+    liam.data.pose = frame.payload;
+    window.dispatchEvent(new Event('poseUpdated'));
+  } else if (frame.topic === 'log') {
+    window.dispatchEvent(new CustomEvent('logUpdated', { detail: frame.payload }));
+  }
+}
+
+function sendSubscription(topic) {
+  socketSend('subscribe', {
+    topic: topic,
+    interval: subscriptions[topic]
+  });
+}
+
 function showLostConnectionModal() {
   document.querySelector('.js-no-connection-modal').style.display = 'block';
   document.querySelector('.js-loginbox').style.display = 'none';
@@ -26,6 +58,7 @@ export function setupSocket() {
   if (!socket) {
     let protocol = location.protocol.indexOf('https') === 0 ? 'wss' : 'ws';
     socket = new ReconnectingWebSocket(`${protocol}://${location.host}/ws`);
+    socket.binaryType = 'arraybuffer';
 
     socket.addEventListener('open', () => {
       console.info('Got WS connection.');
@@ -36,6 +69,8 @@ export function setupSocket() {
       if (!auth.isLoginDialogVisible()) {
         hideLostConnectionModal();
       }
+      // mower forgets our subscriptions when we disconnect.
+      Object.keys(subscriptions).forEach(sendSubscription);
     });
 
     socket.addEventListener('close', () => {
@@ -56,19 +91,44 @@ export function setupSocket() {
 
     // Listen for messages
     socket.addEventListener('message', function (event) {
+      if (event.data instanceof ArrayBuffer) {
+        onTelemetryFrame(event.data);
+        return;
+      }
+
       let message = JSON.parse(event.data);
 
       if (message.type === 'status') {
-        let status = message.payload;
-        if (JSON.stringify(status) !== JSON.stringify(liam.data.status)) {
-          liam.data.status = status;
-          window.dispatchEvent(new Event('statusUpdated'));
-        }
+        setStatus(message.payload);
       }
     });
   }
 }
 
+/**
+ * Subscribe to a telemetry topic ('status', 'pose', 'log'), the mower will send updates at the requested rate.
+ * @param {string} topic
+ * @param {number} interval milliseconds between updates, 0 to unsubscribe.
+ */
+export function subscribe(topic, interval) {
+  if (interval > 0) {
+    subscriptions[topic] = interval;
+  } else {
+    delete subscriptions[topic];
+  }
+
+  socketSend('subscribe', {
+    topic: topic,
+    interval: interval
+  });
+}
+
+export function socketSendBinary(data) {
+  if (socket && socket.readyState === socket.OPEN) {
+    socket.send(data);
+  }
+}
+
 export function socketSend(messageType, payload) {
   if (socket && socket.readyState === socket.OPEN) {
     socket.send(JSON.stringify({
@@ -99,8 +159,8 @@ export function getSystem() {
   return $.getJSON('/api/v1/system');
 }
 
-export function getBatteryHistory() {
-  return $.getJSON('/api/v1/history/battery');
+export function getBatteryHistory(points) {
+  return $.getJSON('/api/v1/history/battery', points ? { points } : {});
 }
 
 export function manual(command, params) {
@@ -2,16 +2,55 @@ import * as api from '../api.js';
 import * as auth from '../authorisation.js';
 import { Joystick } from '../components/joystick.js';
 
+// joystick setpoints are streamed to the mower, which stops if they don't keep coming (dead-man timeout of 300 ms).
+const SETPOINT_INTERVAL = 40; // milliseconds, 25 Hz
+const JOYSTICK_FRAME = 1;
+
 let startMowerButton,
     stopMowerButton,
-    joystick;
+    joystick,
+    setpoint = { speed: 0, turnrate: 0 },
+    setpointSequence = 0,
+    setpointTimer;
+
+function sendSetpoint() {
+  let frame = new DataView(new ArrayBuffer(5));
+
+  frame.setUint8(0, JOYSTICK_FRAME);
+  frame.setUint16(1, setpointSequence, true);
+  frame.setInt8(3, setpoint.speed);
+  frame.setInt8(4, setpoint.turnrate);
+  setpointSequence = (setpointSequence + 1) & 0xFFFF;
+
+  api.socketSendBinary(frame.buffer);
+}
+
+function startSetpoints() {
+  if (!setpointTimer) {
+    sendSetpoint();
+    setpointTimer = setInterval(sendSetpoint, SETPOINT_INTERVAL);
+  }
+}
+
+function stopSetpoints() {
+  if (setpointTimer) {
+    clearInterval(setpointTimer);
+    setpointTimer = undefined;
+  }
+  setpoint = { speed: 0, turnrate: 0 };
+  sendSetpoint();
+}
 
 export function selected() {
   stop();
+  // fast pose updates while driving with the joystick.
+  api.subscribe('pose', 100);
 }
 
 export function unselected() {
+  stopSetpoints();
   stop();
+  api.subscribe('pose', 0);
 }
 
 function stop() {
@@ -89,13 +128,16 @@ export function init() {
   });
 
   joystick = new Joystick(document.getElementById('manual_joystick'));
-  joystick.on('stop', () => stop());
+  joystick.on('stop', () => {
+    stopSetpoints();
+    stop();
+  });
   joystick.on('move', movement => {
-    api.socketSend(movement.forward ? "forward" : "backward", {
-      speed: movement.speed,
-      turnrate: movement.turnrate,
-      smooth: true
-    }); 
+    setpoint = {
+      speed: movement.forward ? movement.speed : -movement.speed,
+      turnrate: movement.turnrate
+    };
+    startSetpoints();
   });
 
   window.addEventListener('statusUpdated', updatedStatus);
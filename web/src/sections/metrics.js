@@ -26,12 +26,12 @@ function getMetricsAndRender() {
     requestInProgress = true;
 
     $.when(
-        api.getBatteryHistory(),
+        api.getBatteryHistory(MAX_SAMPLES),
         api.getSystem()
     ).done((battery, system) => {
         let values = battery[0].samples.value,
             times = battery[0].samples.time;
-        // limit number of samples
+        // limit number of samples, in case mower returned more than we asked for.
         if (values.length > MAX_SAMPLES) {
             values = values.slice(-MAX_SAMPLES);
             times = times.slice(-MAX_SAMPLES);
@@ -0,0 +1,153 @@
+// Decoding of binary telemetry frames sent by the mower over WebSocket (see src/telemetry_hub.h).
+// Frame: topic (uint8), sequence number (uint16), then topic specific payload. All little endian.
+
+export const TOPICS = ['status', 'pose', 'map_tiles', 'log'];
+
+// same order as enum State in status.proto.
+const STATES = ['DOCKED', 'LAUNCHING', 'MOWING', 'DOCKING', 'CHARGING', 'STUCK', 'FLIPPED', 'MANUAL', 'STOP', 'TEST'];
+
+// protobuf field number -> [name, type], see status.proto.
+const STATUS_FIELDS = {
+  3: ['state', 'state'],
+  4: ['batteryVoltage', 'millis'],
+  5: ['batteryLevel', 'uint'],
+  6: ['batteryChargeCurrent', 'uint'],
+  7: ['isCharging', 'bool'],
+  8: ['lastFullyChargeTime', 'uint'],
+  9: ['lastChargeDuration', 'uint'],
+  10: ['cutterLoad', 'uint'],
+  11: ['cutterRotating', 'bool'],
+  12: ['uptime', 'uint'],
+  13: ['leftWheelSpd', 'sint'],
+  14: ['rightWheelSpd', 'sint'],
+  15: ['pitch', 'sint'],
+  16: ['roll', 'sint'],
+  17: ['heading', 'uint'],
+  18: ['obstacleFrontDistance', 'uint'],
+  19: ['areaPerWh', 'centi'],
+  20: ['whPerMowingHour', 'deci'],
+};
+
+function readVarint(bytes, pos) {
+  let value = 0,
+      shift = 0,
+      b;
+
+  do {
+    if (pos.offset >= bytes.length) {
+      throw new Error('Truncated varint');
+    }
+    b = bytes[pos.offset++];
+    value += (b & 0x7F) * Math.pow(2, shift);
+    shift += 7;
+  } while (b & 0x80);
+
+  return value;
+}
+
+function decodeStatus(bytes) {
+  let status = {},
+      pos = { offset: 0 };
+
+  while (pos.offset < bytes.length) {
+    let key = readVarint(bytes, pos),
+        wireType = key & 0x07,
+        field = STATUS_FIELDS[Math.floor(key / 8)];
+
+    if (wireType !== 0) {
+      // status frames only contain varints.
+      throw new Error(`Unexpected wire type ${wireType}`);
+    }
+
+    let value = readVarint(bytes, pos);
+
+    if (!field) {
+      continue;
+    }
+
+    switch (field[1]) {
+      case 'state':
+        value = STATES[value];
+        break;
+      case 'millis':
+        value = value / 1000;
+        break;
+      case 'centi':
+        value = value / 100;
+        break;
+      case 'deci':
+        value = value / 10;
+        break;
+      case 'bool':
+        value = value !== 0;
+        break;
+      case 'sint':
+        value = value % 2 ? -(value + 1) / 2 : value / 2;
+        break;
+    }
+
+    status[field[0]] = value;
+  }
+
+  return status;
+}
+
+function decodePose(view) {
+  return {
+    time: view.getUint32(0, true),
+    heading: view.getUint16(4, true),
+    pitch: view.getInt16(6, true),
+    roll: view.getInt16(8, true),
+    leftWheelSpd: view.getInt16(10, true),
+    rightWheelSpd: view.getInt16(12, true),
+  };
+}
+
+function decodeLog(bytes) {
+  let lines = [],
+      offset = 0,
+      decoder = new TextDecoder();
+
+  while (offset + 3 <= bytes.length) {
+    let id = bytes[offset] | (bytes[offset + 1] << 8),
+        length = bytes[offset + 2];
+
+    lines.push({
+      id: id,
+      message: decoder.decode(bytes.subarray(offset + 3, offset + 3 + length)),
+    });
+    offset += 3 + length;
+  }
+
+  return lines;
+}
+
+/**
+ * Decode a frame received from the mower.
+ * @param {ArrayBuffer} buffer
+ * @returns {{topic: string, sequence: number, payload: *}}
+ */
+export function decodeFrame(buffer) {
+  let view = new DataView(buffer),
+      bytes = new Uint8Array(buffer, 3),
+      topic = TOPICS[view.getUint8(0)],
+      payload;
+
+  switch (topic) {
+    case 'status':
+      payload = decodeStatus(bytes);
+      break;
+    case 'pose':
+      payload = decodePose(new DataView(buffer, 3));
+      break;
+    case 'log':
+      payload = decodeLog(bytes);
+      break;
+  }
+
+  return {
+    topic: topic,
+    sequence: view.getUint16(1, true),
+    payload: payload,
+  };
+}